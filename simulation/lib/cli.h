@@ -1,6 +1,8 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include "probes.h"
+
 typedef struct {
     float windSpeed;
     int visualizationMode;
@@ -19,6 +21,12 @@ typedef struct {
     int useSuperRes;
     char srWeightsPath[256];
     char srNormPath[256];
+    float decimateCells; // mesh simplification error, lattice cells (0=off)
+    char spectrumOutputPath[256]; // Cl spectrum CSV, empty = not written
+    float cdTolerance; // auto-stop at this relative Cd CI half-width
+    int sheddingCycles; // also wait for this many stable cycles (0=off)
+    ProbeSet probes;    // --probe / --probe-line, owned by the caller
+    char probeOutputPath[256];
 } CliOptions;
 
 // Parse command-line options. Returns 0 on success, 1 if --help was
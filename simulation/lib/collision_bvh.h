@@ -0,0 +1,58 @@
+#ifndef COLLISION_BVH_H
+#define COLLISION_BVH_H
+
+#include "model_bounds.h"
+
+// Bounding volume hierarchy over the body triangles for per-triangle
+// particle collision (collision mode 2 in particle.comp). Built top-down
+// with binned SAH, so node size follows the triangle density instead of
+// a fixed grid over the body AABB.
+
+#define BVH_MAX_DEPTH 32 // traversal stack size in particle.comp
+#define BVH_LEAF_MAX 8   // larger leaves only where the build stops
+                         // splitting at BVH_MAX_DEPTH
+
+// Flattened node, laid out to match the std430 BVHNode struct in
+// particle.comp (32 bytes). Nodes are in depth-first order: an inner
+// node's first child is the next node and `offset` is the second child;
+// a leaf (count > 0) holds triIndices[offset .. offset + count - 1].
+typedef struct {
+    float minX, minY, minZ;
+    int offset;
+    float maxX, maxY, maxZ;
+    int count;
+} BVHNode;
+
+typedef struct {
+    BVHNode *nodes;
+    int *triIndices; // triangle indices, grouped by leaf
+    int numNodes;
+    int numIndices;
+    int depth; // levels, root included
+} CollisionBVH;
+
+// Builds the hierarchy in parallel with OpenMP tasks; the result does not
+// depend on the thread count. Returns a zeroed BVH when there are no
+// triangles or allocation fails.
+CollisionBVH buildCollisionBVH(const GPUTriangle *tris, int numTris);
+void freeCollisionBVH(CollisionBVH *bvh);
+
+// Closest triangle to p strictly within maxDist: returns its index and
+// fills the closest point and unit face normal, or returns -1.
+int queryCollisionBVH(const CollisionBVH *bvh,
+                      const GPUTriangle *tris,
+                      const float p[3],
+                      float maxDist,
+                      float closest[3],
+                      float normal[3]);
+
+// Distance from p to triangle `tri`, with the closest point and unit face
+// normal (pointTriangleDistance in particle.comp). Returns -1 for a
+// degenerate triangle or when p is at least maxDist from its plane.
+float pointTriangleDistance(const float p[3],
+                            const GPUTriangle *tri,
+                            float maxDist,
+                            float closest[3],
+                            float normal[3]);
+
+#endif // COLLISION_BVH_H
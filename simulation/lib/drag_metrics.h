@@ -1,16 +1,46 @@
 #ifndef DRAG_METRICS_H
 #define DRAG_METRICS_H
 
-#define CD_HISTORY_SIZE 100
 #define CD_SAMPLE_INTERVAL 20
+#define SHEDDING_WINDOW 128      // Cl samples in the online shedding monitor
+#define SHEDDING_TOLERANCE 0.02f // relative drift allowed while settling
 
-// Run a DFT over the Cl time series to estimate the dominant
-// shedding frequency, convert it into a Strouhal number and print
-// the result. Called once after the render loop finishes.
+// One-sided power spectral density of a force coefficient series.
+typedef struct {
+    int numBins;      // segmentLength / 2 + 1
+    float *frequency; // bin centre, in the units of sampleRate
+    float *power;     // PSD, Welch average over segments
+    int segmentLength;
+    int numSegments;
+    float peakFrequency; // dominant non-DC peak, interpolated between bins
+    float peakPower;
+} ClSpectrum;
+
+// Welch estimate of the spectrum of series[0 .. count - 1]: Hann windowed
+// segments with 50% overlap, each with its own mean removed, aligned to
+// end at the last sample. segmentLength <= 0 picks the largest power of
+// two up to count / 2 (a single segment below 128 samples). The peak is
+// refined by a parabola through the log power of its neighbours.
+// Returns 0 on success, -1 on bad input or allocation failure.
+int cl_spectrum(const float *series,
+                int count,
+                float sampleRate,
+                int segmentLength,
+                ClSpectrum *out);
+void cl_spectrum_free(ClSpectrum *spectrum);
+
+// Writes "frequency,power" CSV rows. Returns 0 on success.
+int write_cl_spectrum(const ClSpectrum *spectrum, const char *path);
+
+// Estimate the dominant shedding frequency from the Cl time series,
+// convert it into a Strouhal number and print the result. Writes the
+// spectrum as CSV when spectrumPath is non-empty. Called once after the
+// render loop finishes.
 void compute_strouhal(float *clSeries,
                       int clCount,
                       int lbmSubsteps,
                       float charLength,
-                      float latticeVelocity);
+                      float latticeVelocity,
+                      const char *spectrumPath);
 
 #endif // DRAG_METRICS_H
@@ -0,0 +1,23 @@
+#ifndef FFT_H
+#define FFT_H
+
+// Mixed-radix FFT of real input, any length. Radix 2 and 4 stages are
+// specialised; other prime factors use a generic butterfly, so lengths
+// with large prime factors still work but run closer to O(n^2).
+
+typedef struct FftPlan FftPlan;
+
+// Precomputes twiddles and scratch for length n (n >= 1). Returns NULL
+// on bad length or allocation failure. A plan holds scratch space, so
+// use one plan per thread.
+FftPlan *fft_plan_create(int n);
+void fft_plan_free(FftPlan *plan);
+
+// Forward transform of n real samples into the n/2 + 1 non-negative
+// frequency bins, X[k] = sum_j in[j] exp(-2 pi i j k / n), unnormalised.
+void fft_real(FftPlan *plan,
+              const float *in,
+              float *outRe,
+              float *outIm);
+
+#endif // FFT_H
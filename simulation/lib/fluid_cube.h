@@ -3,6 +3,16 @@
 
 #include "../obj-file-loader/lib/model_loader.h"
 
+#include <stdint.h>
+
+typedef enum {
+    FLUID_SOLVER_GAUSS_SEIDEL = 0, // fixed sweeps of lin_solve
+    FLUID_SOLVER_MULTIGRID = 1     // V-cycles down to a residual tolerance
+} FluidSolver;
+
+struct FluidMultigrid;
+struct FluidDensityBox;
+
 struct FluidCube {
     int sizeX;
     int sizeY;
@@ -23,6 +33,34 @@ struct FluidCube {
     float *Vz0;
 
     Model *model; // Add a pointer to the Model
+
+    // Cells inside the model, from FluidCubeUpdateSolidMask. set_bnd
+    // zeroes the listed cells instead of testing the mesh each call.
+    uint8_t *solid;  // sizeX*sizeY*sizeZ flags
+    int *solidCells; // IX3D indices of the solid cells
+    int solidCount;
+
+    // Linear solver for diffusion and pressure projection. Multigrid
+    // (the default) iterates until the residual drops by
+    // solverTolerance relative to the right-hand side, or
+    // solverMaxCycles V-cycles; lastSolve* report the latest solve.
+    FluidSolver solver;
+    float solverTolerance;
+    int solverMaxCycles;
+    int lastSolveCycles;
+    float lastSolveResidual;
+    struct FluidMultigrid *mg; // built on first use
+
+    // Density diffuse/advect run on a packed box around the plume while
+    // it covers at most half the grid (see FluidCubeStep); set
+    // sparseDensity to 0 for full-grid passes. Density is zero outside
+    // the interior cells densityMin..densityMax (inclusive; empty when
+    // min > max), and lastDensityCells counts the cells last stepped.
+    int sparseDensity;
+    int densityMin[3];
+    int densityMax[3];
+    long lastDensityCells;
+    struct FluidDensityBox *densityBox; // packed scratch, built on use
 };
 typedef struct FluidCube FluidCube;
 
@@ -34,6 +72,22 @@ FluidCube *FluidCubeCreate(int sizeX,
                            float dt,
                            Model *model);
 void FluidCubeFree(FluidCube *cube);
+// Rebuilds the solid mask from cube->model (same test as
+// isInsideCarModel). Call again after moving or replacing the model.
+// Returns 0 on success, -1 when out of memory (the mask is then empty).
+int FluidCubeUpdateSolidMask(FluidCube *cube);
+// tolerance <= 0 or maxCycles <= 0 keep the current value.
+void FluidCubeSetSolver(FluidCube *cube,
+                        FluidSolver solver,
+                        float tolerance,
+                        int maxCycles);
+// Solves c * x - a * (sum of the 6 neighbours) = x0 on the interior
+// cells with the cube's solver, as diffuse (b is the wall type, 0-3) and
+// project (a = 1, c = 6) do. x holds the initial guess and gets its
+// boundary layer and solid cells set; iter is the Gauss-Seidel sweep
+// count.
+void FluidCubeSolve(
+    FluidCube *cube, int b, float *x, float *x0, float a, float c, int iter);
 void FluidCubeAddDensity(FluidCube *cube, int x, int y, int z, float amount);
 void FluidCubeAddVelocity(
     FluidCube *cube, int x, int y, int z, float amtX, float amtY, float amtZ);
@@ -53,6 +53,18 @@ typedef struct {
     GLint stream_fNewZOffsetLoc;
     GLint stream_slabZLoc;
     GLint force_zOffsetLoc;
+
+    // Velocity probes (LBM_SetProbes). Samples go into a GPU ring of
+    // probeRingSlots steps and are read back in one batch.
+    GLuint probeShader;
+    GLuint probePosBuffer;
+    GLuint probeVelBuffer;
+    int numProbes;
+    int probeRingSlots;
+    int probePending; // steps sampled since the last LBM_ReadProbes
+    GLint probe_gridSizeLoc;
+    GLint probe_numProbesLoc;
+    GLint probe_slotLoc;
 } LBMGrid;
 
 // Initialize LBM grid
@@ -79,6 +91,25 @@ void LBM_Step(LBMGrid *grid, float inletVelX, float inletVelY, float inletVelZ);
 // Get velocity buffer for particle shader to sample
 GLuint LBM_GetVelocityBuffer(LBMGrid *grid);
 
+// Upload probe positions in lattice coordinates (4 floats per probe, see
+// probes_locate) and size the sample ring for ringSlots steps. Loads the
+// probe shader on first use. Returns 1 on success, 0 on failure.
+int LBM_SetProbes(LBMGrid *grid,
+                  const float *gridPos,
+                  int count,
+                  int ringSlots);
+
+// Samples the trilinear velocity at every probe into the next ring slot,
+// on the GPU and without waiting for it. Returns the number of pending
+// steps; once that reaches probeRingSlots, LBM_ReadProbes must run
+// before the next sample.
+int LBM_SampleProbes(LBMGrid *grid);
+
+// Reads the pending steps back in one transfer, oldest first: 3 floats
+// (ux, uy, uz) per probe per step in lattice units, room for
+// probeRingSlots steps. Returns the number of steps read.
+int LBM_ReadProbes(LBMGrid *grid, float *out);
+
 // Compute drag force on solid (momentum exchange)
 void LBM_ComputeDragForce(LBMGrid *grid,
                           float *forceX,
@@ -0,0 +1,33 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include "../obj-file-loader/lib/model_loader.h"
+
+typedef struct {
+    int inputFaces;  // triangles considered (valid, non-degenerate)
+    int faceCount;   // triangles after simplification
+    int vertexCount; // vertices after simplification
+    // Largest quadric error accepted, as a distance: no output vertex is
+    // further than this from the plane of any input triangle that was
+    // merged into it.
+    float maxError;
+} SimplifyReport;
+
+// Quadric-error edge-collapse simplification (Garland & Heckbert).
+// Positions are welded exactly first, so OBJ seams do not act as
+// borders. Collapses run cheapest first until the next one would
+// exceed maxError (model units, <= 0 for no limit) or the mesh is down
+// to targetFaces (<= 0 for no target). Open borders are held in place
+// by penalty planes, and collapses that would flip a triangle or pinch
+// the surface into a non-manifold are skipped.
+//
+// `out` receives a new model with 1-based faces and filled bounds
+// (release with freeModel). Returns 0 on success, -1 on allocation
+// failure or an empty input.
+int simplifyModel(const Model *in,
+                  float maxError,
+                  int targetFaces,
+                  Model *out,
+                  SimplifyReport *report);
+
+#endif // MESH_SIMPLIFY_H
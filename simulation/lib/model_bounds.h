@@ -3,8 +3,6 @@
 
 #include "../obj-file-loader/lib/model_loader.h"
 
-#define COLL_GRID_RES 8
-
 typedef struct {
     float minX, minY, minZ;
     float maxX, maxY, maxZ;
@@ -17,18 +15,6 @@ typedef struct {
     float v2x, v2y, v2z, pad2;
 } GPUTriangle;
 
-// Uniform grid for spatial acceleration of per-triangle collision.
-// Triangles are binned into grid cells so particles only test nearby ones.
-typedef struct {
-    int *cellStart;  // offset into triIndices per cell
-    int *cellCount;  // triangle count per cell
-    int *triIndices; // packed triangle indices
-    int totalIndices;
-    int totalCells;
-    float minX, minY, minZ;
-    float cellSizeX, cellSizeY, cellSizeZ;
-} CollisionGrid;
-
 CarBounds computeModelBounds(Model *model,
                              float scale,
                              float offsetX,
@@ -44,13 +30,4 @@ GPUTriangle *createTriangleBuffer(Model *model,
                                   float rotationY,
                                   int *outCount);
 
-CollisionGrid buildCollisionGrid(GPUTriangle *tris,
-                                 int numTris,
-                                 float bminX,
-                                 float bminY,
-                                 float bminZ,
-                                 float bmaxX,
-                                 float bmaxY,
-                                 float bmaxZ);
-
 #endif // MODEL_BOUNDS_H
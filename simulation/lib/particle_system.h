@@ -2,12 +2,23 @@
 #define PARTICLE_SYSTEM_H
 
 #include <SDL2/SDL.h>
+#include <stdint.h>
 #include "fluid_cube.h"
 #include "config.h"
 
-#define GRID_CELL_SIZE 10 // Size of each grid cell
+// Spatial bins: a uniform grid over the tunnel, [-4.5, 4.5] along x
+// (respawns start just upstream of -4) and [-2, 2] across
+#define PARTICLE_GRID_X 36
+#define PARTICLE_GRID_Y 16
+#define PARTICLE_GRID_Z 16
+#define PARTICLE_GRID_CELLS                                                    \
+    (PARTICLE_GRID_X * PARTICLE_GRID_Y * PARTICLE_GRID_Z)
+#define PARTICLE_GRID_MIN_X -4.5f
+#define PARTICLE_GRID_MIN_Y -2.0f
+#define PARTICLE_GRID_MIN_Z -2.0f
+#define PARTICLE_GRID_CELL 0.25f // cell edge length
 
-// Particle structure
+// Particle structure (GPU buffers; the CPU system is stored as SoA)
 // The struct has padding to align with GPU memory layout
 typedef struct {
     float x, y, z;    // Position (vec3)
@@ -16,17 +27,29 @@ typedef struct {
     float life;       // Lifetime (0.0 to 1.0)
 } Particle;
 
-// Grid cell structure for spatial partitioning
+// Particle system, stored as structure-of-arrays so the update loop can
+// load eight particles per AVX2 register. The arrays are allocated by
+// ParticleSystem_Init for `capacity` particles.
 typedef struct {
-    Particle particles[MAX_PARTICLES / GRID_CELL_SIZE];
-    int count;
-} GridCell;
-
-// Particle system structure
-typedef struct {
-    Particle particles[MAX_PARTICLES];
+    float *x, *y, *z;
+    float *vx, *vy, *vz;
+    float *life;
     int numParticles;
-    GridCell grid[GRID_CELL_SIZE][GRID_CELL_SIZE];
+    int capacity;
+    // Particles binned by ParticleSystem_BuildBins: cell c holds
+    // order[cellStart[c]] .. order[cellStart[c + 1] - 1], in ascending
+    // index order. Every particle is in exactly one cell.
+    int *cellStart; // PARTICLE_GRID_CELLS + 1 offsets
+    int *order;     // capacity particle indices, grouped by cell
+    int *cellOf;    // cell of each particle
+    int *binCounts; // binThreads * PARTICLE_GRID_CELLS histogram
+    int binThreads;
+    int binsValid; // cleared by AddParticle, set by BuildBins
+    uint32_t rngKey[2]; // Philox key from ParticleSystem_Seed
+    uint32_t step;      // updates since seeding, part of the RNG counter
+    // Use the AVX2 update where the CPU has it (Init sets 1); 0 forces
+    // the scalar path
+    int simd;
 } ParticleSystem;
 
 // Car collision bounds
@@ -37,7 +60,15 @@ typedef struct {
 } CollisionBounds;
 
 // Function Declarations
-void ParticleSystem_Init(ParticleSystem *system);
+
+// Allocates room for `capacity` particles (MAX_PARTICLES when <= 0).
+// Returns 0 on success, -1 on allocation failure.
+int ParticleSystem_Init(ParticleSystem *system, int capacity);
+void ParticleSystem_Free(ParticleSystem *system);
+// Respawn positions and collision jitter come from a counter-based RNG
+// keyed by this seed (0 after Init): the same seed and inputs give the
+// same particles on any number of threads.
+void ParticleSystem_Seed(ParticleSystem *system, uint64_t seed);
 void ParticleSystem_AddParticle(ParticleSystem *system,
                                 float x,
                                 float y,
@@ -50,6 +81,18 @@ void ParticleSystem_UpdateWithCollision(ParticleSystem *system,
                                         FluidCube *fluid,
                                         float dt,
                                         CollisionBounds *bounds);
+
+// Bins the particles with a parallel, stable counting sort. Called by
+// the update; call it yourself after AddParticle to query the bins.
+void ParticleSystem_BuildBins(ParticleSystem *system);
+// Cell containing a point; points outside the grid go to the nearest
+// edge cell.
+int ParticleSystem_CellIndex(float x, float y, float z);
+// Permutes the particle arrays into bin order, so a cell's particles
+// are contiguous in memory, and rebuilds the bins. Returns -1 if the
+// scratch buffer cannot be allocated (the particles are unchanged).
+int ParticleSystem_SortByCell(ParticleSystem *system);
+
 void ParticleSystem_Render(ParticleSystem *system,
                            SDL_Renderer *renderer,
                            int scale);
@@ -59,6 +102,8 @@ int ParticleSystem_CheckCollision(float x,
                                   float y,
                                   float z,
                                   CollisionBounds *bounds);
-void ParticleSystem_ResolveCollision(Particle *p, CollisionBounds *bounds);
+void ParticleSystem_ResolveCollision(ParticleSystem *system,
+                                     int i,
+                                     CollisionBounds *bounds);
 
-#endif // PARTICLE_SYSTEM_H
\ No newline at end of file
+#endif // PARTICLE_SYSTEM_H
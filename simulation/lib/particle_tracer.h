@@ -0,0 +1,93 @@
+#ifndef PARTICLE_TRACER_H
+#define PARTICLE_TRACER_H
+
+#include "collision_bvh.h"
+
+// Host-side particle tracer: the CPU counterpart of particle.comp for
+// headless analysis (residence times, deposition on the body, wake
+// statistics). Particles are advected through a velocity field array in
+// the LBM layout and collide with the body triangles through the same
+// CollisionBVH the shader uses. Steps run in parallel with OpenMP and
+// do not depend on the thread count.
+
+// Particle states
+#define TRACER_ACTIVE 0
+#define TRACER_DEPOSITED 1 // touched the body with deposit set
+#define TRACER_EXITED 2    // left the domain
+
+// Velocity field, as read back from the LBM velocity buffer (see
+// writeVTI): 4 floats per cell (velocity xyz in lattice units, density),
+// x fastest. Cells map to the world box [-4, 4] x [-2, 2] x [-2, 2] like
+// worldToGrid in the shaders.
+typedef struct {
+    int sizeX, sizeY, sizeZ;
+    const float *velocity;
+    float velocityScale; // lattice to world units (8 in particle.comp)
+} TracerField;
+
+// Body triangles and their hierarchy (see buildCollisionBVH). A particle
+// closer than `radius` to the body either sticks to the closest triangle
+// (deposit != 0) or is pushed out to the radius and loses the normal
+// part of its velocity, as in particle.comp.
+typedef struct {
+    const GPUTriangle *triangles;
+    int numTriangles;
+    const CollisionBVH *bvh;
+    float radius;
+    int deposit;
+} TracerBody;
+
+typedef struct {
+    float dt;         // world time step
+    float relaxation; // fraction of the flow velocity taken per step
+                      // (1 = massless tracer)
+    float exitX;      // particles past this x have left the domain
+} TracerParams;
+
+// Particles as structure-of-arrays
+typedef struct {
+    float *x, *y, *z;
+    float *vx, *vy, *vz;
+    float *time;           // residence time
+    unsigned char *state;  // TRACER_*
+    int *triangle;         // triangle deposited on, -1 otherwise
+    int count;
+    int capacity;
+} ParticleTracer;
+
+// Returns 0 on success, -1 on allocation failure.
+int ParticleTracer_Init(ParticleTracer *tracer, int capacity);
+void ParticleTracer_Free(ParticleTracer *tracer);
+// Adds an active particle; returns its index, or -1 when full.
+int ParticleTracer_Add(ParticleTracer *tracer,
+                       float x,
+                       float y,
+                       float z,
+                       float vx,
+                       float vy,
+                       float vz);
+
+// Trilinear velocity at a world position in world units, clamped to the
+// cell centres half a cell inside the grid as in streamline_trace.comp.
+void ParticleTracer_SampleVelocity(const TracerField *field,
+                                   float x,
+                                   float y,
+                                   float z,
+                                   float out[3]);
+
+// Advances every active particle by one step. `body` may be NULL.
+// Returns the number of particles still active.
+int ParticleTracer_Step(ParticleTracer *tracer,
+                        const TracerField *field,
+                        const TracerBody *body,
+                        const TracerParams *params);
+
+// Steps until no particle is active or maxSteps have run. Returns the
+// number of steps taken.
+int ParticleTracer_Run(ParticleTracer *tracer,
+                       const TracerField *field,
+                       const TracerBody *body,
+                       const TracerParams *params,
+                       int maxSteps);
+
+#endif // PARTICLE_TRACER_H
@@ -0,0 +1,86 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <stdio.h>
+
+// Velocity probes at fixed world positions, sampled every LBM step and
+// appended to one binary time-series file. Points come from --probe and
+// lines of evenly spaced points from --probe-line.
+//
+// File layout, little-endian:
+//   char     magic[8]    "LBMPROBE"
+//   uint32   version     1
+//   uint32   numProbes
+//   uint32   gridX, gridY, gridZ
+//   float32  latticeVelocity   free-stream speed, lattice units
+//   uint64   numRecords        0 until the file is closed cleanly
+//   float32  position[numProbes][3]   world coordinates
+//   int32    group[numProbes]         which --probe/--probe-line option
+// then one record per sample:
+//   uint32   step                     LBM step
+//   float32  velocity[numProbes][3]   lattice units
+
+#define PROBE_FILE_VERSION 1
+#define PROBE_LINE_MAX 4096 // points per --probe-line
+
+typedef struct {
+    int numProbes;
+    int capacity;
+    int numGroups;
+    float *position; // world x, y, z per probe
+    int *group;
+    float *grid;     // lattice x, y, z, 0 per probe (probes_locate)
+
+    FILE *file;
+    long long numRecords;
+} ProbeSet;
+
+void probes_init(ProbeSet *set);
+void probes_free(ProbeSet *set); // closes the file too
+
+// Parses "x,y,z". Returns 0, or -1 on a malformed spec.
+int probes_add_point(ProbeSet *set, const char *spec);
+
+// Parses "x0,y0,z0:x1,y1,z1:n", 2 <= n <= PROBE_LINE_MAX points
+// including both ends. Returns 0, or -1 on a malformed spec or
+// allocation failure, leaving the set unchanged.
+int probes_add_line(ProbeSet *set, const char *spec);
+
+// Maps world positions to lattice coordinates, clamped to the
+// interpolation range as in ParticleTracer_SampleVelocity. Returns 0, or
+// -1 on allocation failure.
+int probes_locate(ProbeSet *set, int sizeX, int sizeY, int sizeZ);
+
+// Trilinear velocity at each probe from a host copy of the LBM velocity
+// buffer (4 floats per cell), 3 floats per probe in lattice units. The
+// GPU path is LBM_SampleProbes.
+void probes_sample(const ProbeSet *set,
+                   const float *velocity,
+                   int sizeX,
+                   int sizeY,
+                   float *out);
+
+// Creates the file and writes the header. Returns 0 on success.
+int probes_open(ProbeSet *set,
+                const char *path,
+                int sizeX,
+                int sizeY,
+                int sizeZ,
+                float latticeVelocity);
+
+// Appends one record; velocity holds 3 floats per probe. Returns 0, or
+// -1 on a write error.
+int probes_append(ProbeSet *set, unsigned int step, const float *velocity);
+
+// Appends records for `steps` consecutive LBM steps from firstStep;
+// velocity holds 3 floats per probe per step, as LBM_ReadProbes returns
+// them. Returns 0, or -1 on a write error.
+int probes_append_steps(ProbeSet *set,
+                        unsigned int firstStep,
+                        int steps,
+                        const float *velocity);
+
+// Writes the record count into the header and closes the file.
+int probes_close(ProbeSet *set);
+
+#endif // PROBES_H
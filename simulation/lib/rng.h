@@ -0,0 +1,29 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Counter-based random numbers (Philox4x32-10, Salmon et al., SC'11).
+ *
+ * Each call maps a 128-bit counter and a 64-bit key to four independent
+ * 32-bit words, with no state in between. Parallel code that numbers its
+ * draws (e.g. particle index, step, event) gets the same stream on any
+ * thread count, with nothing shared between threads.
+ */
+void Rng_Philox4x32(const uint32_t counter[4],
+                    const uint32_t key[2],
+                    uint32_t out[4]);
+
+/* Uniform float in [0, 1) from the top 24 bits of a word. */
+float Rng_Uniform(uint32_t bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RNG_H */
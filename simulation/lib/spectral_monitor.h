@@ -0,0 +1,49 @@
+#ifndef SPECTRAL_MONITOR_H
+#define SPECTRAL_MONITOR_H
+
+// Online estimate of the dominant shedding frequency and amplitude of Cl
+// while the run goes. Samples go into a ring buffer; every
+// updateInterval samples the Welch spectrum of the buffer (two
+// half-length segments plus the overlapping middle one, see
+// cl_spectrum) gives the interpolated peak frequency and the amplitude
+// of the tone from the power around it. The peak counts as stable once
+// both stay within a relative tolerance for stableCycles periods and at
+// least one window; a peak that does not stand well clear of the rest of
+// the spectrum has zero amplitude and never does.
+
+typedef struct {
+    float sampleRate;   // samples per unit time
+    int windowLength;   // ring buffer length, samples
+    int updateInterval; // samples between spectrum updates
+    int stableCycles;   // periods the peak has to hold
+    float tolerance;    // relative frequency and amplitude change allowed
+
+    float *ring;
+    float *linear; // ring unrolled oldest first
+    int head;      // next slot to write
+    long count;    // samples seen
+
+    int updates;     // spectrum updates so far
+    float frequency; // latest peak frequency, 0 before the first update
+    float amplitude; // latest tone amplitude, 0 when no clear peak
+
+    float refFrequency; // estimate the current stable stretch started at
+    float refAmplitude;
+    long stableSince; // sample count at the start of that stretch
+    float cycles;     // periods of refFrequency since stableSince
+    int stable;       // held for stableCycles and a window
+} SpectralMonitor;
+
+// windowLength >= 16. Returns 0, or -1 on bad arguments or allocation
+// failure.
+int spectral_monitor_init(SpectralMonitor *m,
+                          float sampleRate,
+                          int windowLength,
+                          int stableCycles,
+                          float tolerance);
+void spectral_monitor_free(SpectralMonitor *m);
+
+// Adds one sample. Returns 1 when the estimate was updated, else 0.
+int spectral_monitor_add(SpectralMonitor *m, float x);
+
+#endif // SPECTRAL_MONITOR_H
@@ -0,0 +1,55 @@
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+// Running statistics for a scalar time series such as Cd or Cl, sampled
+// as the run goes. Keeps Welford moments over every sample plus the means
+// of consecutive groups of STREAM_STATS_GROUP samples; estimates drop the
+// start-up transient by MSER-5 and put a confidence interval on the mean
+// with batch means, so correlated and periodic series are handled.
+
+#define STREAM_STATS_GROUP 5    // samples per MSER-5 group
+#define STREAM_STATS_BATCHES 20 // batches for the confidence interval
+#define STREAM_STATS_T95 2.093  // Student t, 95% two-sided, 19 d.o.f.
+
+typedef struct {
+    long count; // samples seen
+    double mean;
+    double m2; // sum of squared deviations from the mean (Welford)
+    double min, max;
+
+    double *groups; // mean of each complete group, in order
+    int numGroups;
+    int groupCapacity;
+    double groupSum; // samples of the group being filled
+    int groupFill;
+} StreamStats;
+
+typedef struct {
+    int valid;      // transient over and enough data after it
+    long truncated; // leading samples dropped as transient
+    long used;      // samples the estimate is based on
+    double mean;    // mean of the retained samples
+    double halfWidth;    // 95% confidence interval half-width
+    double relHalfWidth; // halfWidth / |mean|
+    double lag1;         // lag-1 autocorrelation of the batch means
+    int batchSize;       // samples per batch
+} StreamEstimate;
+
+void stream_stats_init(StreamStats *s);
+void stream_stats_free(StreamStats *s);
+
+// Adds one sample. Returns 0, or -1 if the group history could not grow
+// (the moments are still updated).
+int stream_stats_add(StreamStats *s, double x);
+
+// Sample variance over every sample, 0 below two samples.
+double stream_stats_variance(const StreamStats *s);
+
+// MSER-5 truncation point, then STREAM_STATS_BATCHES batch means over the
+// rest. Positive correlation left between batches widens the interval by
+// the AR(1) factor sqrt((1 + r) / (1 - r)). Not valid until the
+// truncation point falls in the first half of the series and at least
+// one group per batch remains after it. O(number of groups).
+void stream_stats_estimate(const StreamStats *s, StreamEstimate *out);
+
+#endif // STREAM_STATS_H
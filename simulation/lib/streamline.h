@@ -0,0 +1,74 @@
+#ifndef STREAMLINE_H
+#define STREAMLINE_H
+
+// Host-side streamline tracer: the post-processing counterpart of
+// streamline_trace.comp. Integrates streamlines through a velocity field
+// (an exported VTI or an in-memory grid) with adaptive RK4, stops them at
+// solid cells, domain exits and stagnation points, and writes them as one
+// binary VTK PolyData (.vtp) file. Seeds are traced in parallel with
+// OpenMP; the output does not depend on the thread count.
+
+// Why a streamline ended
+#define STREAMLINE_EXITED 0   // left the world box (last point clipped to it)
+#define STREAMLINE_SOLID 1    // next step would enter a solid cell
+#define STREAMLINE_STAGNANT 2 // speed fell below minSpeed
+#define STREAMLINE_LIMIT 3    // maxPoints or maxLength reached
+
+// Velocity field in the LBM buffer layout: 4 floats per cell (velocity
+// xyz in lattice units, density), x fastest, plus an optional solid mask
+// (one int per cell, non-zero = solid). Cells map to the world box
+// [-4, 4] x [-2, 2] x [-2, 2] like worldToGrid in the shaders.
+typedef struct {
+    int sizeX, sizeY, sizeZ;
+    float *velocity;
+    int *solid;          // may be NULL
+    float velocityScale; // lattice to world units (8 in the shaders)
+} StreamlineField;
+
+// Lengths are in world units. Streamline_DefaultParams scales them to
+// the cell size of a field.
+typedef struct {
+    float initialStep;
+    float minStep;
+    float maxStep;
+    float tolerance; // local position error allowed per step
+    float minSpeed;  // world units
+    float maxLength;
+    int maxPoints;   // per streamline, seed included
+} StreamlineParams;
+
+// Traced streamlines, stored back to back in seed order. Line i holds
+// points offsets[i] .. offsets[i + 1] - 1; every line has at least its
+// seed point.
+typedef struct {
+    int numLines;
+    int numPoints;
+    float *points;         // 3 * numPoints, world coordinates
+    float *speed;          // numPoints, world units
+    int *offsets;          // numLines + 1
+    unsigned char *reason; // STREAMLINE_* per line
+} Streamlines;
+
+// Reads a field written by writeVTI (velocity, optional rho and solid
+// arrays, raw appended data). Returns 0 on success, -1 on failure; free
+// the arrays with Streamline_FreeField.
+int Streamline_LoadVTI(const char *filename, StreamlineField *field);
+void Streamline_FreeField(StreamlineField *field);
+
+void Streamline_DefaultParams(const StreamlineField *field,
+                              StreamlineParams *params);
+
+// Traces one streamline per seed (3 floats each, world coordinates).
+// Returns 0 on success, -1 on allocation failure.
+int Streamline_Trace(const StreamlineField *field,
+                     const StreamlineParams *params,
+                     const float *seeds,
+                     int numSeeds,
+                     Streamlines *out);
+void Streamline_Free(Streamlines *lines);
+
+// Writes the lines as binary appended VTK PolyData with point data
+// "speed" and cell data "reason". Returns 0 on success, -1 on failure.
+int Streamline_WriteVTP(const Streamlines *lines, const char *filename);
+
+#endif // STREAMLINE_H
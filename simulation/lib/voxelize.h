@@ -10,7 +10,7 @@ extern "C" {
 
 typedef enum {
     VOXELIZE_MODE_SOLID = 0,   /* parity-fill ray casting                  */
-    VOXELIZE_MODE_SURFACE = 1, /* mark voxels touched by any triangle AABB */
+    VOXELIZE_MODE_SURFACE = 1, /* mark voxels a triangle overlaps (exact SAT) */
     VOXELIZE_MODE_AUTO = 2     /* solid, fall back to surface if degenerate */
 } VoxelizeMode;
 
@@ -36,6 +36,101 @@ VoxelGrid *Voxelize_FromModel(const Model *model,
                               int align_longest_x,
                               VoxelizeMode mode);
 
+/*
+ * Axis-aligned world-space box split into dims[0] x dims[1] x dims[2]
+ * cells. Cells need not be cubic: spacing along axis j is
+ * (max[j] - min[j]) / dims[j]. The LBM lattice, for example, is
+ * 128 x 64 x 64 cells over [-4, 4] x [-2, 2] x [-2, 2].
+ */
+typedef struct {
+    int dims[3];
+    float min[3];
+    float max[3];
+} VoxelBox;
+
+typedef struct {
+    VoxelBox box;
+    uint8_t *data; /* nx*ny*nz bytes, index = x + nx*(y + ny*z) */
+} VoxelLattice;
+
+/*
+ * Voxelize into an arbitrary box. The mesh is centered in the box,
+ * optionally aligned longest-axis-to-X, and uniformly scaled to fit
+ * with `padding` (fraction of each half-extent) on every side, as in
+ * Voxelize_FromModel (which is this with the [-1, 1]^3 cube).
+ *
+ * Returns NULL on allocation failure, an empty model or a bad box.
+ */
+VoxelLattice *Voxelize_FromModelInBox(const Model *model,
+                                      const VoxelBox *box,
+                                      float padding,
+                                      int align_longest_x,
+                                      VoxelizeMode mode);
+
+/*
+ * Voxelize a world-space triangle soup as-is (no normalization), e.g.
+ * the transformed mesh the simulation uploads to the GPU. Vertex k of
+ * triangle t starts at xyz[(3*t + k) * vertex_stride].
+ */
+VoxelLattice *Voxelize_TrianglesInBox(const float *xyz,
+                                      int vertex_stride,
+                                      int triangle_count,
+                                      const VoxelBox *box,
+                                      VoxelizeMode mode);
+
+/*
+ * Write a lattice as a version-3 .voxbin.
+ *
+ * Format:
+ *   u32 magic    = 'V','O','X','B'
+ *   u32 version  = 3
+ *   u32 nx, ny, nz
+ *   f32 min[3], f32 max[3]   world-space box
+ *   u8[nx*ny*nz] occupancy bytes, index = x + nx*(y + ny*z)
+ *
+ * Returns 0 on success, non-zero on I/O failure.
+ */
+int Voxelize_WriteLattice(const VoxelLattice *lat, const char *path);
+
+/* Load a version-3 .voxbin. Returns NULL if missing or malformed. */
+VoxelLattice *Voxelize_ReadLattice(const char *path);
+
+void Voxelize_FreeLattice(VoxelLattice *lat);
+
+typedef struct {
+    int resolution; /* R (grid is R x R x R)               */
+    float *data;    /* R*R*R floats, same indexing as VoxelGrid */
+} SdfGrid;
+
+/*
+ * Signed distance field on the same normalized grid as
+ * Voxelize_FromModel. Distances are exact Euclidean distances from each
+ * voxel center to the nearest surface voxel center, in normalized world
+ * units (one voxel = 2/R), negative inside the parity fill. Open meshes
+ * whose fill is degenerate get an unsigned field.
+ *
+ * Returns NULL on allocation failure or if the model is empty.
+ */
+SdfGrid *Voxelize_SdfFromModel(const Model *model,
+                               int resolution,
+                               float padding,
+                               int align_longest_x);
+
+/*
+ * Write an SDF grid.
+ *
+ * Format:
+ *   u32 magic    = 'S','D','F','B'
+ *   u32 version  = 1
+ *   u32 resolution
+ *   f32[R*R*R]   signed distances
+ *
+ * Returns 0 on success, non-zero on I/O failure.
+ */
+int Voxelize_WriteSdf(const SdfGrid *sdf, const char *path);
+
+void Voxelize_FreeSdf(SdfGrid *sdf);
+
 /*
  * Write a grid to a simple binary file.
  *
@@ -49,6 +144,52 @@ VoxelGrid *Voxelize_FromModel(const Model *model,
  */
 int Voxelize_WriteBinary(const VoxelGrid *grid, const char *path);
 
+typedef enum {
+    VOXBIN_ENCODING_BITS = 0, /* 1 bit per voxel, LSB first along X */
+    VOXBIN_ENCODING_RLE = 1   /* per-row alternating empty/solid runs   */
+} VoxbinEncoding;
+
+/*
+ * Write a grid as a version-2 .voxbin.
+ *
+ * Format:
+ *   u32 magic    = 'V','O','X','B'
+ *   u32 version  = 2
+ *   u32 resolution
+ *   u32 encoding (VoxbinEncoding)
+ *   R*R rows along X, row index = y + R*z, each stored as
+ *     BITS: ceil(R/8) bytes, voxel x in bit (x & 7) of byte x >> 3
+ *     RLE:  u16 n, then n u16 run lengths alternating empty, solid,
+ *           empty, ... starting with an empty run (possibly 0). An
+ *           all-empty row has n = 0.
+ *
+ * Returns 0 on success, non-zero on I/O failure.
+ */
+int Voxelize_WriteBinaryV2(const VoxelGrid *grid,
+                           const char *path,
+                           VoxbinEncoding encoding);
+
+/*
+ * Load a version-1 or version-2 .voxbin into a new grid (version-3
+ * lattices go through Voxelize_ReadLattice).
+ * Returns NULL if the file is missing or malformed.
+ */
+VoxelGrid *Voxelize_ReadBinary(const char *path);
+
+/*
+ * Row-streaming reader for either version, for consumers that do not
+ * want the full R^3 grid in memory. Rows come out in file order
+ * (row index = y + R*z), decoded to R bytes of 0/1.
+ */
+typedef struct VoxbinReader VoxbinReader;
+
+VoxbinReader *Voxelize_OpenBinary(const char *path, int *resolution);
+
+/* Returns 1 when a row was decoded, 0 after the last row, -1 on error. */
+int Voxelize_ReadRow(VoxbinReader *reader, uint8_t *row);
+
+void Voxelize_CloseBinary(VoxbinReader *reader);
+
 /*
  * Fraction of cells marked solid (in [0, 1]).
  */
@@ -56,6 +197,88 @@ float Voxelize_SolidFraction(const VoxelGrid *grid);
 
 void Voxelize_Free(VoxelGrid *grid);
 
+/*
+ * Multi-resolution pyramid from a single voxelization. Level 0 is the
+ * finest grid at `resolution`; level l has resolution / 2^l, and a
+ * coarse cell is solid when at least `min_fraction` of the finest
+ * cells it covers are solid (0.5 = majority; use a small value such as
+ * 1/64 to keep thin surface shells visible at coarse levels).
+ */
+typedef struct {
+    int levels;         /* number of grids, finest first           */
+    float min_fraction; /* occupancy threshold used to downsample */
+    VoxelGrid *grids;   /* grids[l].resolution = resolution >> l   */
+} VoxelPyramid;
+
+/*
+ * Returns NULL if resolution is not divisible by 2^(levels-1), levels
+ * is outside [1, 8], min_fraction is outside (0, 1], or voxelization
+ * fails.
+ */
+VoxelPyramid *Voxelize_PyramidFromModel(const Model *model,
+                                        int resolution,
+                                        int levels,
+                                        float padding,
+                                        int align_longest_x,
+                                        VoxelizeMode mode,
+                                        float min_fraction);
+
+/*
+ * Write a pyramid (.voxpyr).
+ *
+ * Format (little-endian):
+ *   u32 magic    = 'V','P','Y','R'
+ *   u32 version  = 1
+ *   u32 levels
+ *   f32 min_fraction
+ *   levels x { u32 resolution, u32 reserved = 0, u64 byte offset }
+ *   u8[R*R*R]    occupancy bytes per level, finest first
+ *
+ * Returns 0 on success, non-zero on I/O failure.
+ */
+int Voxelize_WritePyramid(const VoxelPyramid *pyr, const char *path);
+
+/* Load one level of a .voxpyr. Returns NULL if invalid or out of range. */
+VoxelGrid *Voxelize_PyramidLoad(const char *path, int level);
+
+void Voxelize_FreePyramid(VoxelPyramid *pyr);
+
+/*
+ * Packed multi-shape dataset (.voxpack). One file holds every grid of a
+ * batch so training code can mmap it and slice shape `id` directly.
+ *
+ * Format (little-endian):
+ *   u32 magic    = 'V','O','X','P'
+ *   u32 version  = 1
+ *   u32 count    number of shape slots
+ *   u32 resolution
+ *   u64[count]   byte offset of each grid from the start of the file,
+ *                0 if that shape failed to voxelize
+ *   u8[R*R*R]    occupancy bytes per shape, in completion order
+ *
+ * Shapes may be appended in any order; the offset table is written
+ * when the pack is closed.
+ */
+typedef struct VoxelPackWriter VoxelPackWriter;
+
+/* Returns NULL if the file cannot be created or count/resolution <= 0. */
+VoxelPackWriter *Voxelize_PackOpen(const char *path, int count, int resolution);
+
+/*
+ * Append the grid for slot `id`. Not thread-safe: callers voxelizing
+ * concurrently must serialize appends. Returns 0 on success.
+ */
+int Voxelize_PackAppend(VoxelPackWriter *pack, int id, const VoxelGrid *grid);
+
+/* Write the offset table and close the file. Returns 0 on success. */
+int Voxelize_PackClose(VoxelPackWriter *pack);
+
+/*
+ * Load shape `id` from a pack. Returns NULL if the file is invalid,
+ * id is out of range, or that slot is empty.
+ */
+VoxelGrid *Voxelize_PackLoad(const char *path, int id);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,160 +3,959 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 
-int countVerticesInFile(const char* filePath) {
-    FILE* file = fopen(filePath, "r");
-    if (!file) {
-        printf("Error: Could not open file %s\n", filePath);
-        return 0;
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#define OBJ_NO_MMAP
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of the whole file: mmapped where available, read into
+// a heap buffer otherwise.
+typedef struct {
+    const char* data;
+    size_t size;
+    int mapped;
+} FileView;
+
+static int openFileView(const char* filePath, FileView* view) {
+    memset(view, 0, sizeof(*view));
+#ifndef OBJ_NO_MMAP
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // the whole file is read anyway
+#endif
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    view->data = (const char*)p;
+    view->size = (size_t)st.st_size;
+    view->mapped = 1;
+    return 0;
+#else
+    FILE* file = fopen(filePath, "rb");
+    if (!file)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* buf = size > 0 ? (char*)malloc((size_t)size) : NULL;
+    if (!buf || fread(buf, 1, (size_t)size, file) != (size_t)size) {
+        free(buf);
+        fclose(file);
+        return -1;
     }
+    fclose(file);
+    view->data = buf;
+    view->size = (size_t)size;
+    return 0;
+#endif
+}
+
+static void closeFileView(FileView* view) {
+#ifndef OBJ_NO_MMAP
+    if (view->mapped)
+        munmap((void*)view->data, view->size);
+#else
+    free((void*)view->data);
+#endif
+    memset(view, 0, sizeof(*view));
+}
+
+static inline int isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
 
-    int vertexCount = 0;
-    char line[256];
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end) {
+    const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl + 1 : end;
+}
+
+// Decimal float scanner for OBJ coordinates: [+-]digits[.digits][e[+-]digits].
+// Accumulates up to 19 significant digits and applies the decimal
+// exponent in double, which is exact enough to round correctly to float.
+// Returns the position after the number, or NULL if there is none.
+static const char* scanFloat(const char* p, const char* end, float* out) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22};
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
 
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == 'v' && line[1] == ' ') {
-            vertexCount++;
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0, any = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa)
+                digits++;
+        } else {
+            exponent++;
         }
     }
-    fclose(file);
-    return vertexCount;
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa)
+                    digits++;
+                exponent--;
+            }
+        }
+    }
+    if (!any)
+        return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int eneg = 0, e = 0, edigits = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            eneg = *q == '-';
+            q++;
+        }
+        for (; q < end && *q >= '0' && *q <= '9'; q++, edigits++) {
+            if (e < 10000)
+                e = e * 10 + (*q - '0');
+        }
+        if (edigits) {
+            exponent += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value = exponent >= -22 ? value / pow10[-exponent]
+                                : value * pow(10.0, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * pow10[exponent]
+                               : value * pow(10.0, exponent);
+    *out = (float)(neg ? -value : value);
+    return p;
 }
 
-int countFacesInFile(const char* filePath) {
-    FILE* file = fopen(filePath, "r");
-    if (!file) {
-        printf("Error: could not open file %s\n", filePath);
-        return 0;
+// Integer scanner for face indices. Returns NULL if there is no number.
+static const char* scanInt(const char* p, const char* end, long* out) {
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9')
+        return NULL;
+    long v = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (v < 1000000000L)
+            v = v * 10 + (*p - '0');
     }
+    *out = neg ? -v : v;
+    return p;
+}
 
-    int faceCount = 0;
-    char line[256];
+static int growArray(void** items, int* capacity, size_t itemSize) {
+    int newCap = *capacity ? *capacity * 2 : 1024;
+    void* grown = realloc(*items, (size_t)newCap * itemSize);
+    if (!grown)
+        return -1;
+    *items = grown;
+    *capacity = newCap;
+    return 0;
+}
+
+// Parse output for one newline-aligned slice of the file. Relative
+// (negative) indices are resolved against the chunk's own vertices and
+// listed in `relative` (as face * 3 + corner) so the stitch can add
+// the number of vertices in earlier chunks.
+typedef struct {
+    Vertex* vertices;
+    Face* faces;
+    int* relative;
+    int vertexCount, vertexCap;
+    int faceCount, faceCap;
+    int relativeCount, relativeCap;
+} ObjChunk;
+
+static void freeChunk(ObjChunk* c) {
+    free(c->vertices);
+    free(c->faces);
+    free(c->relative);
+    memset(c, 0, sizeof(*c));
+}
 
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == 'f' && line[1] == ' ') {
-            faceCount++;
+// Single pass over [p, end). Faces accept "v", "v/vt", "v/vt/vn" and
+// "v//vn" tokens, negative (relative) indices, and polygons with more
+// than three vertices, which are fan-triangulated around their first
+// vertex. Malformed face lines are skipped.
+static int parseChunk(const char* p, const char* end, ObjChunk* c) {
+    while (p < end) {
+        p = skipBlanks(p, end);
+        if (p + 1 < end && p[0] == 'v' && isBlank(p[1])) {
+            if (c->vertexCount == c->vertexCap &&
+                growArray((void**)&c->vertices, &c->vertexCap,
+                          sizeof(Vertex)) != 0)
+                return -1;
+            Vertex* v = &c->vertices[c->vertexCount];
+            const char* q = skipBlanks(p + 2, end);
+            if ((q = scanFloat(q, end, &v->x)) &&
+                (q = scanFloat(skipBlanks(q, end), end, &v->y)) &&
+                (q = scanFloat(skipBlanks(q, end), end, &v->z)))
+                c->vertexCount++;
+        } else if (p + 1 < end && p[0] == 'f' && isBlank(p[1])) {
+            const char* q = p + 2;
+            int faceStart = c->faceCount;
+            int relativeStart = c->relativeCount;
+            int first = 0, prev = 0, n = 0;
+            int firstRel = 0, prevRel = 0;
+            for (;;) {
+                q = skipBlanks(q, end);
+                if (q >= end || *q == '\n' || *q == '#')
+                    break;
+                long idx;
+                const char* next = scanInt(q, end, &idx);
+                if (!next) {
+                    // Malformed token: drop the whole polygon.
+                    c->faceCount = faceStart;
+                    c->relativeCount = relativeStart;
+                    break;
+                }
+                // Skip the /vt/vn part of the token.
+                while (next < end && !isBlank(*next) && *next != '\n')
+                    next++;
+                q = next;
+
+                int rel = idx < 0;
+                if (rel)
+                    idx += (long)c->vertexCount + 1;
+                int vi = (int)idx;
+                if (n == 0) {
+                    first = vi;
+                    firstRel = rel;
+                } else if (n >= 2) {
+                    if (c->faceCount == c->faceCap &&
+                        growArray((void**)&c->faces, &c->faceCap,
+                                  sizeof(Face)) != 0)
+                        return -1;
+                    int fi = c->faceCount++;
+                    c->faces[fi].v1 = first;
+                    c->faces[fi].v2 = prev;
+                    c->faces[fi].v3 = vi;
+                    int corners[3] = {firstRel, prevRel, rel};
+                    for (int k = 0; k < 3; k++) {
+                        if (!corners[k])
+                            continue;
+                        if (c->relativeCount == c->relativeCap &&
+                            growArray((void**)&c->relative, &c->relativeCap,
+                                      sizeof(int)) != 0)
+                            return -1;
+                        c->relative[c->relativeCount++] = fi * 3 + k;
+                    }
+                }
+                prev = vi;
+                prevRel = rel;
+                n++;
+            }
         }
+        p = skipLine(p, end);
     }
+    return 0;
+}
 
-    fclose(file);
-    return faceCount;
+// Files below this size are parsed on one thread; above it the file is
+// cut into chunks of at least OBJ_MIN_CHUNK_BYTES, a few per thread so
+// uneven chunks (vertex-heavy vs face-heavy regions) balance out.
+#define OBJ_PARALLEL_MIN_BYTES (8u << 20)
+#define OBJ_MIN_CHUNK_BYTES (1u << 20)
+
+static int chunkCountFor(size_t size) {
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    if (threads <= 1 || size < OBJ_PARALLEL_MIN_BYTES)
+        return 1;
+    size_t chunks = (size_t)threads * 4;
+    if (chunks > size / OBJ_MIN_CHUNK_BYTES)
+        chunks = size / OBJ_MIN_CHUNK_BYTES;
+    return (int)chunks;
+#else
+    (void)size;
+    return 1;
+#endif
 }
 
-// Parse a single vertex index from OBJ face format
-// Handles: "v", "v/vt", "v/vt/vn", "v//vn"
-int parseVertexIndex(const char* token) {
-    int v = 0;
-    sscanf(token, "%d", &v);  // Just get the first number
-    return v;
+static void setCorner(Face* f, int corner, int value) {
+    if (corner == 0)
+        f->v1 = value;
+    else if (corner == 1)
+        f->v2 = value;
+    else
+        f->v3 = value;
 }
 
-Model loadOBJ(const char* filePath) {
-    Model model = {0};
+static int getCorner(const Face* f, int corner) {
+    return corner == 0 ? f->v1 : corner == 1 ? f->v2 : f->v3;
+}
 
-    int vertexCount = countVerticesInFile(filePath);
-    int faceCount = countFacesInFile(filePath);
+// Parses newline-aligned chunks in parallel into per-chunk buffers,
+// then stitches them with a prefix sum over the vertex and face counts.
+static int parseOBJ(const char* p, const char* end, Model* model) {
+    size_t size = (size_t)(end - p);
+    int chunks = chunkCountFor(size);
 
-    printf("File contains %d vertices and %d faces.\n", vertexCount, faceCount);
+    if (chunks == 1) {
+        ObjChunk c = {0};
+        int rc = parseChunk(p, end, &c);
+        // A single chunk starts at vertex 0, so its relative indices
+        // are already absolute.
+        model->vertices = c.vertices;
+        model->faces = c.faces;
+        model->vertexCount = c.vertexCount;
+        model->faceCount = c.faceCount;
+        free(c.relative);
+        return rc;
+    }
 
-    model.vertices = (Vertex*)malloc(vertexCount * sizeof(Vertex));
-    model.faces = (Face*)malloc(faceCount * sizeof(Face));
+    ObjChunk* c = (ObjChunk*)calloc((size_t)chunks, sizeof(ObjChunk));
+    const char** starts =
+        (const char**)malloc((size_t)(chunks + 1) * sizeof(const char*));
+    int* vertexBase = (int*)malloc((size_t)chunks * sizeof(int));
+    int* faceBase = (int*)malloc((size_t)chunks * sizeof(int));
+    int rc = -1;
+    if (!c || !starts || !vertexBase || !faceBase)
+        goto done;
 
-    if (!model.vertices || !model.faces) {
-        printf("Error: Out of memory!\n");
-        free(model.vertices);
-        free(model.faces);
-        return model;
+    starts[0] = p;
+    for (int i = 1; i < chunks; i++) {
+        const char* s = skipLine(p + size / (size_t)chunks * (size_t)i, end);
+        starts[i] = s > starts[i - 1] ? s : starts[i - 1];
     }
+    starts[chunks] = end;
 
-    FILE* file = fopen(filePath, "r");
-    if (!file) {
-        printf("Error: Could not open file %s\n", filePath);
-        free(model.vertices);
-        free(model.faces);
-        return model;
+    int failed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) reduction(| : failed)
+#endif
+    for (int i = 0; i < chunks; i++)
+        failed |= parseChunk(starts[i], starts[i + 1], &c[i]) != 0;
+    if (failed)
+        goto done;
+
+    long totalVertices = 0, totalFaces = 0;
+    for (int i = 0; i < chunks; i++) {
+        vertexBase[i] = (int)totalVertices;
+        faceBase[i] = (int)totalFaces;
+        totalVertices += c[i].vertexCount;
+        totalFaces += c[i].faceCount;
+    }
+    if (totalVertices > INT32_MAX || totalFaces > INT32_MAX)
+        goto done;
+
+    model->vertices =
+        (Vertex*)malloc((size_t)(totalVertices ? totalVertices : 1) *
+                        sizeof(Vertex));
+    model->faces =
+        (Face*)malloc((size_t)(totalFaces ? totalFaces : 1) * sizeof(Face));
+    if (!model->vertices || !model->faces)
+        goto done;
+    model->vertexCount = (int)totalVertices;
+    model->faceCount = (int)totalFaces;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int i = 0; i < chunks; i++) {
+        memcpy(model->vertices + vertexBase[i],
+               c[i].vertices,
+               (size_t)c[i].vertexCount * sizeof(Vertex));
+        Face* out = model->faces + faceBase[i];
+        memcpy(out, c[i].faces, (size_t)c[i].faceCount * sizeof(Face));
+        for (int r = 0; r < c[i].relativeCount; r++) {
+            Face* f = &out[c[i].relative[r] / 3];
+            int corner = c[i].relative[r] % 3;
+            setCorner(f, corner, getCorner(f, corner) + vertexBase[i]);
+        }
+        freeChunk(&c[i]);
+    }
+    rc = 0;
+
+done:
+    for (int i = 0; c && i < chunks; i++)
+        freeChunk(&c[i]);
+    free(c);
+    free(starts);
+    free(vertexBase);
+    free(faceBase);
+    return rc;
+}
+
+static void computeBounds(Model* model) {
+    if (model->vertexCount <= 0)
+        return;
+    for (int j = 0; j < 3; j++) {
+        model->boundsMin[j] = (&model->vertices[0].x)[j];
+        model->boundsMax[j] = model->boundsMin[j];
+    }
+    for (int i = 1; i < model->vertexCount; i++) {
+        const float* v = &model->vertices[i].x;
+        for (int j = 0; j < 3; j++) {
+            if (v[j] < model->boundsMin[j])
+                model->boundsMin[j] = v[j];
+            if (v[j] > model->boundsMax[j])
+                model->boundsMax[j] = v[j];
+        }
+    }
+}
+
+// Binary STL: 80-byte header, u32 triangle count, then one 50-byte
+// record per triangle (f32 normal[3], f32 corners[3][3], u16 attribute).
+#define STL_HEADER_BYTES 84
+#define STL_RECORD_BYTES 50
+
+// Corners closer than this fraction of the bounding-box diagonal (on
+// every axis) are welded into one vertex.
+#define STL_WELD_TOLERANCE 1e-6f
+
+// Spatial hash for welding, one entry per occupied cell of side `eps`.
+// Two corners in the same cell are always within tolerance, so a cell
+// never holds more than one vertex.
+typedef struct {
+    int32_t cell[3];
+    int vertex; // -1 when the slot is empty
+} WeldSlot;
+
+typedef struct {
+    WeldSlot* slots;
+    uint32_t mask;
+    int used;
+} WeldTable;
+
+static inline uint32_t weldHash(const int32_t* c) {
+    uint32_t h = (uint32_t)c[0] * 73856093u ^ (uint32_t)c[1] * 19349663u ^
+                 (uint32_t)c[2] * 83492791u;
+    return h ^ (h >> 15);
+}
+
+static int weldTableInit(WeldTable* t, uint32_t capacity) {
+    t->slots = (WeldSlot*)malloc((size_t)capacity * sizeof(WeldSlot));
+    if (!t->slots)
+        return -1;
+    for (uint32_t i = 0; i < capacity; i++)
+        t->slots[i].vertex = -1;
+    t->mask = capacity - 1;
+    t->used = 0;
+    return 0;
+}
+
+static int weldFind(const WeldTable* t, const int32_t* c) {
+    for (uint32_t i = weldHash(c) & t->mask;; i = (i + 1) & t->mask) {
+        const WeldSlot* s = &t->slots[i];
+        if (s->vertex < 0)
+            return -1;
+        if (s->cell[0] == c[0] && s->cell[1] == c[1] && s->cell[2] == c[2])
+            return s->vertex;
     }
+}
+
+static void weldPut(WeldTable* t, const int32_t* c, int vertex) {
+    uint32_t i = weldHash(c) & t->mask;
+    while (t->slots[i].vertex >= 0)
+        i = (i + 1) & t->mask;
+    memcpy(t->slots[i].cell, c, sizeof(t->slots[i].cell));
+    t->slots[i].vertex = vertex;
+    t->used++;
+}
+
+// Keeps the load factor at or below one half.
+static int weldInsert(WeldTable* t, const int32_t* c, int vertex) {
+    if ((uint32_t)(t->used + 1) * 2 > t->mask + 1) {
+        WeldTable grown;
+        if (weldTableInit(&grown, (t->mask + 1) * 2) != 0)
+            return -1;
+        for (uint32_t i = 0; i <= t->mask; i++)
+            if (t->slots[i].vertex >= 0)
+                weldPut(&grown, t->slots[i].cell, t->slots[i].vertex);
+        free(t->slots);
+        *t = grown;
+    }
+    weldPut(t, c, vertex);
+    return 0;
+}
+
+// Corner k of triangle i is 3 floats at base + i * stride + 12 * k, so
+// binary STL records are welded straight out of the mapped file.
+static int weldTriangles(const char* base,
+                         size_t stride,
+                         int triangleCount,
+                         Model* model) {
+    float lo[3] = {INFINITY, INFINITY, INFINITY};
+    float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (int i = 0; i < triangleCount; i++) {
+        float v[9];
+        memcpy(v, base + (size_t)i * stride, sizeof(v));
+        for (int k = 0; k < 9; k++) {
+            if (!isfinite(v[k]))
+                continue;
+            if (v[k] < lo[k % 3])
+                lo[k % 3] = v[k];
+            if (v[k] > hi[k % 3])
+                hi[k % 3] = v[k];
+        }
+    }
+    for (int j = 0; j < 3; j++)
+        if (!(lo[j] <= hi[j]))
+            lo[j] = hi[j] = 0.0f; // no finite corners
+    float diag = sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) +
+                       (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                       (hi[2] - lo[2]) * (hi[2] - lo[2]));
+    float eps = diag * STL_WELD_TOLERANCE;
+    if (!(eps > 0.0f))
+        eps = 1.0f; // every corner coincides
+    float invEps = 1.0f / eps;
 
-    char line[512];
-    int vertexIndex = 0, faceIndex = 0;
-
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == 'v' && line[1] == ' ') {
-            // Parse vertex
-            sscanf(line, "v %f %f %f", 
-                   &model.vertices[vertexIndex].x,
-                   &model.vertices[vertexIndex].y,
-                   &model.vertices[vertexIndex].z);
-            vertexIndex++;
-        } 
-        else if (line[0] == 'f' && line[1] == ' ') {
-            // Parse face handles multiple formats:
-            // f v1 v2 v3
-            // f v1/vt1 v2/vt2 v3/vt3
-            // f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3
-            // f v1//vn1 v2//vn2 v3//vn3
-            
-            char v1str[64] = {0}, v2str[64] = {0}, v3str[64] = {0};
-            
-            // Skip f and parse the three vertex tokens
-            char* ptr = line + 2;
-            
-            // Skip leading whitespace
-            while (*ptr == ' ' || *ptr == '\t') ptr++;
-            
-            // Read first token
-            int i = 0;
-            while (*ptr && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && i < 63) {
-                v1str[i++] = *ptr++;
+    uint32_t capacity = 1024;
+    while (capacity < (uint32_t)triangleCount && capacity < (1u << 30))
+        capacity *= 2;
+    WeldTable table;
+    if (weldTableInit(&table, capacity) != 0)
+        return -1;
+    int vertexCap = 0, dropped = 0;
+    model->faces = triangleCount > 0
+                       ? (Face*)malloc((size_t)triangleCount * sizeof(Face))
+                       : NULL;
+    if (triangleCount > 0 && !model->faces)
+        goto fail;
+
+    for (int i = 0; i < triangleCount; i++) {
+        const char* record = base + (size_t)i * stride;
+        int idx[3];
+        int finite = 1;
+        for (int k = 0; k < 3; k++) {
+            Vertex v;
+            memcpy(&v, record + 12 * k, sizeof(v));
+            finite = finite && isfinite(v.x) && isfinite(v.y) && isfinite(v.z);
+            if (!finite)
+                break;
+            int32_t c[3] = {(int32_t)floorf((v.x - lo[0]) * invEps),
+                            (int32_t)floorf((v.y - lo[1]) * invEps),
+                            (int32_t)floorf((v.z - lo[2]) * invEps)};
+            // Own cell first: corners shared by exporters are usually
+            // bit-identical. Then any neighbour within tolerance.
+            int found = weldFind(&table, c);
+            for (int n = 0; found < 0 && n < 27; n++) {
+                if (n == 13)
+                    continue;
+                int32_t d[3] = {c[0] + n % 3 - 1, c[1] + n / 3 % 3 - 1,
+                                c[2] + n / 9 - 1};
+                int cand = weldFind(&table, d);
+                if (cand >= 0 && fabsf(model->vertices[cand].x - v.x) <= eps &&
+                    fabsf(model->vertices[cand].y - v.y) <= eps &&
+                    fabsf(model->vertices[cand].z - v.z) <= eps)
+                    found = cand;
             }
-            v1str[i] = '\0';
-            
-            // Skip whitespace
-            while (*ptr == ' ' || *ptr == '\t') ptr++;
-            
-            // Read second token
-            i = 0;
-            while (*ptr && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && i < 63) {
-                v2str[i++] = *ptr++;
+            if (found < 0) {
+                if (model->vertexCount == vertexCap &&
+                    growArray((void**)&model->vertices, &vertexCap,
+                              sizeof(Vertex)) != 0)
+                    goto fail;
+                found = model->vertexCount;
+                model->vertices[model->vertexCount++] = v;
+                if (weldInsert(&table, c, found) != 0)
+                    goto fail;
             }
-            v2str[i] = '\0';
-            
-            // Skip whitespace
-            while (*ptr == ' ' || *ptr == '\t') ptr++;
-            
-            // Read third token
-            i = 0;
-            while (*ptr && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && i < 63) {
-                v3str[i++] = *ptr++;
+            idx[k] = found;
+        }
+        // Triangles that collapse when welded carry no area.
+        if (!finite || idx[0] == idx[1] || idx[1] == idx[2] ||
+            idx[0] == idx[2]) {
+            dropped++;
+            continue;
+        }
+        Face* f = &model->faces[model->faceCount++];
+        f->v1 = idx[0] + 1;
+        f->v2 = idx[1] + 1;
+        f->v3 = idx[2] + 1;
+    }
+
+    free(table.slots);
+    printf("Welded %d STL corners into %d vertices", 3 * triangleCount,
+           model->vertexCount);
+    if (dropped > 0)
+        printf(" (%d degenerate triangles dropped)", dropped);
+    printf(".\n");
+    return 0;
+
+fail:
+    free(table.slots);
+    return -1;
+}
+
+static inline int startsWithWord(const char* p, const char* end,
+                                 const char* word) {
+    size_t n = strlen(word);
+    return (size_t)(end - p) >= n && memcmp(p, word, n) == 0 &&
+           (p + n == end || isBlank(p[n]) || p[n] == '\n');
+}
+
+// ASCII STL: "vertex x y z" lines between "outer loop" and "endloop".
+// Loops with more than three vertices are fan-triangulated; loops with
+// a malformed vertex are skipped. Triangles are gathered as 9 floats
+// each for weldTriangles.
+static int parseAsciiSTL(const char* p,
+                         const char* end,
+                         float** corners,
+                         int* triangleCount) {
+    float* loop = NULL;
+    int loopCount = 0, loopCap = 0, loopBad = 0;
+    int cap = 0;
+    *corners = NULL;
+    *triangleCount = 0;
+    while (p < end) {
+        p = skipBlanks(p, end);
+        if (startsWithWord(p, end, "vertex")) {
+            float v[3];
+            const char* q = skipBlanks(p + 6, end);
+            if ((q = scanFloat(q, end, &v[0])) &&
+                (q = scanFloat(skipBlanks(q, end), end, &v[1])) &&
+                (q = scanFloat(skipBlanks(q, end), end, &v[2]))) {
+                if (loopCount == loopCap &&
+                    growArray((void**)&loop, &loopCap, 3 * sizeof(float)) != 0)
+                    goto fail;
+                memcpy(loop + 3 * loopCount++, v, sizeof(v));
+            } else {
+                loopBad = 1;
+            }
+        } else if (startsWithWord(p, end, "outer")) {
+            loopCount = loopBad = 0;
+        } else if (startsWithWord(p, end, "endloop")) {
+            for (int k = 2; !loopBad && k < loopCount; k++) {
+                if (*triangleCount == cap &&
+                    growArray((void**)corners, &cap, 9 * sizeof(float)) != 0)
+                    goto fail;
+                float* t = *corners + 9 * (size_t)(*triangleCount)++;
+                memcpy(t, loop, 3 * sizeof(float));
+                memcpy(t + 3, loop + 3 * (k - 1), 3 * sizeof(float));
+                memcpy(t + 6, loop + 3 * k, 3 * sizeof(float));
             }
-            v3str[i] = '\0';
-            
-            // Parse vertex indices (handles v/vt/vn format)
-            model.faces[faceIndex].v1 = parseVertexIndex(v1str);
-            model.faces[faceIndex].v2 = parseVertexIndex(v2str);
-            model.faces[faceIndex].v3 = parseVertexIndex(v3str);
-            
-            faceIndex++;
+            loopCount = loopBad = 0;
         }
+        p = skipLine(p, end);
     }
+    free(loop);
+    return 0;
 
-    fclose(file);
+fail:
+    free(loop);
+    free(*corners);
+    *corners = NULL;
+    return -1;
+}
+
+// Returns 0 on success, -1 when out of memory and -2 when the bytes
+// are neither a binary STL nor an ASCII one.
+static int parseSTL(const char* p, const char* end, Model* model) {
+    size_t size = (size_t)(end - p);
+    uint32_t count = 0;
+    if (size >= STL_HEADER_BYTES)
+        memcpy(&count, p + 80, sizeof(count));
+    // Some exporters start binary headers with "solid" too, so the
+    // size check decides.
+    if (size >= STL_HEADER_BYTES && count <= INT32_MAX &&
+        (uint64_t)count * STL_RECORD_BYTES + STL_HEADER_BYTES == size)
+        return weldTriangles(p + STL_HEADER_BYTES + 12, STL_RECORD_BYTES,
+                             (int)count, model);
+
+    const char* q = skipBlanks(p, end);
+    while (q < end && *q == '\n')
+        q = skipBlanks(q + 1, end);
+    if (!startsWithWord(q, end, "solid"))
+        return -2;
+    float* corners;
+    int triangles;
+    if (parseAsciiSTL(q, end, &corners, &triangles) != 0)
+        return -1;
+    int rc = weldTriangles((const char*)corners, 9 * sizeof(float),
+                           triangles, model);
+    free(corners);
+    return rc;
+}
+
+// .meshbin layout: this header, then Vertex[vertexCount] (3 x f32),
+// then Face[faceCount] (3 x u32, 1-based as in the OBJ). Both arrays
+// are used in place, so the format is the in-memory layout.
+typedef struct {
+    char magic[4]; // 'M','S','H','B'
+    uint32_t version;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint32_t vertexCount;
+    uint32_t faceCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint8_t reserved[8];
+} MeshbinHeader;
 
-    model.vertexCount = vertexCount;
-    model.faceCount = faceIndex;
+_Static_assert(sizeof(MeshbinHeader) == 64, "meshbin header is 64 bytes");
+_Static_assert(sizeof(Vertex) == 12 && sizeof(Face) == 12,
+               "meshbin arrays are mapped as Vertex/Face");
 
-    printf("Successfully loaded model with %d vertices and %d faces.\n", vertexCount, faceIndex);
+// A cache entry is only checked against the source's size and hash and
+// this version, so bump it whenever the parser or triangulation changes
+// what a source loads as; otherwise stale .meshbin files keep being
+// served.
+#define MESHBIN_VERSION 1
 
+// 64-bit multiply-xorshift over 8-byte words in four independent lanes
+// (so the multiplies overlap); only has to tell an edited source from
+// the one the cache was built from.
+static inline uint64_t hashMix(uint64_t h, uint64_t w) {
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 32);
+}
+
+static uint64_t hashBytes(const char* p, size_t n) {
+    uint64_t lane[4] = {0x9e3779b97f4a7c15ULL ^ (uint64_t)n,
+                        0xc2b2ae3d27d4eb4fULL,
+                        0x165667b19e3779f9ULL,
+                        0x27d4eb2f165667c5ULL};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        uint64_t w[4];
+        memcpy(w, p + i, 32);
+        for (int k = 0; k < 4; k++)
+            lane[k] = hashMix(lane[k], w[k]);
+    }
+    uint64_t h = lane[0];
+    for (int k = 1; k < 4; k++)
+        h = hashMix(h, lane[k]);
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = hashMix(h, w);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, n - i);
+    h = (h ^ tail) * 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 29);
+}
+
+#ifndef OBJ_NO_MMAP
+static int mapMeshCache(const char* cachePath,
+                        uint64_t sourceSize,
+                        uint64_t sourceHash,
+                        Model* model) {
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshbinHeader)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    // Private writable mapping: edits stay in memory, never in the file.
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+
+    const MeshbinHeader* h = (const MeshbinHeader*)p;
+    size_t expected = sizeof(MeshbinHeader) +
+                      (size_t)h->vertexCount * sizeof(Vertex) +
+                      (size_t)h->faceCount * sizeof(Face);
+    if (memcmp(h->magic, "MSHB", 4) != 0 || h->version != MESHBIN_VERSION ||
+        h->sourceSize != sourceSize || h->sourceHash != sourceHash ||
+        h->vertexCount > INT32_MAX || h->faceCount > INT32_MAX ||
+        size != expected) {
+        munmap(p, size);
+        return -1;
+    }
+
+    char* base = (char*)p;
+    model->vertices = (Vertex*)(base + sizeof(MeshbinHeader));
+    model->faces = (Face*)(base + sizeof(MeshbinHeader) +
+                           (size_t)h->vertexCount * sizeof(Vertex));
+    model->vertexCount = (int)h->vertexCount;
+    model->faceCount = (int)h->faceCount;
+    memcpy(model->boundsMin, h->boundsMin, sizeof(h->boundsMin));
+    memcpy(model->boundsMax, h->boundsMax, sizeof(h->boundsMax));
+    model->mapping = p;
+    model->mappingSize = size;
+    return 0;
+}
+
+// Best effort: written to a temporary file and renamed so concurrent
+// loaders never map a half-written cache.
+static void writeMeshCache(const char* cachePath,
+                           const Model* model,
+                           uint64_t sourceSize,
+                           uint64_t sourceHash) {
+    char tmpPath[4096];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", cachePath) >=
+        (int)sizeof(tmpPath))
+        return;
+    int fd = mkstemp(tmpPath);
+    if (fd < 0)
+        return;
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        unlink(tmpPath);
+        return;
+    }
+
+    MeshbinHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "MSHB", 4);
+    h.version = MESHBIN_VERSION;
+    h.sourceSize = sourceSize;
+    h.sourceHash = sourceHash;
+    h.vertexCount = (uint32_t)model->vertexCount;
+    h.faceCount = (uint32_t)model->faceCount;
+    memcpy(h.boundsMin, model->boundsMin, sizeof(h.boundsMin));
+    memcpy(h.boundsMax, model->boundsMax, sizeof(h.boundsMax));
+
+    size_t nv = (size_t)model->vertexCount, nf = (size_t)model->faceCount;
+    int ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+             fwrite(model->vertices, sizeof(Vertex), nv, file) == nv &&
+             fwrite(model->faces, sizeof(Face), nf, file) == nf;
+    ok = (fclose(file) == 0) && ok;
+    // mkstemp creates 0600; give the cache the usual file permissions.
+    if (!ok || chmod(tmpPath, 0644) != 0 || rename(tmpPath, cachePath) != 0)
+        unlink(tmpPath);
+}
+#endif
+
+// Text or binary mesh parser: fills the model from [p, end) and
+// returns 0, -1 when out of memory or -2 when the input is malformed.
+typedef int (*MeshParser)(const char* p, const char* end, Model* model);
+
+static Model loadMeshImpl(const char* filePath,
+                          int useCache,
+                          MeshParser parse) {
+    Model model = {0};
+
+    FileView view;
+    if (openFileView(filePath, &view) != 0) {
+        printf("Error: Could not open file %s\n", filePath);
+        return model;
+    }
+
+#ifndef OBJ_NO_MMAP
+    char cachePath[4096];
+    uint64_t sourceHash = 0;
+    if (snprintf(cachePath, sizeof(cachePath), "%s.meshbin", filePath) >=
+        (int)sizeof(cachePath))
+        useCache = 0;
+    if (useCache) {
+        sourceHash = hashBytes(view.data, view.size);
+        if (mapMeshCache(cachePath, view.size, sourceHash, &model) == 0) {
+            printf("Loaded cached mesh %s (%d vertices, %d faces).\n",
+                   cachePath,
+                   model.vertexCount,
+                   model.faceCount);
+            closeFileView(&view);
+            return model;
+        }
+    }
+#else
+    (void)useCache;
+#endif
+
+    int rc = parse(view.data, view.data + view.size, &model);
+    if (rc != 0) {
+        if (rc == -2)
+            printf("Error: Could not parse %s\n", filePath);
+        else
+            printf("Error: Out of memory!\n");
+        freeModel(&model);
+    } else {
+        computeBounds(&model);
+        printf("Successfully loaded model with %d vertices and %d faces.\n",
+               model.vertexCount,
+               model.faceCount);
+#ifndef OBJ_NO_MMAP
+        if (useCache && model.vertexCount > 0 && model.faceCount > 0)
+            writeMeshCache(cachePath, &model, view.size, sourceHash);
+#endif
+    }
+
+    closeFileView(&view);
     return model;
 }
 
+Model loadOBJ(const char* filePath) {
+    return loadMeshImpl(filePath, 1, parseOBJ);
+}
+
+Model loadOBJUncached(const char* filePath) {
+    return loadMeshImpl(filePath, 0, parseOBJ);
+}
+
+Model loadSTL(const char* filePath) {
+    return loadMeshImpl(filePath, 1, parseSTL);
+}
+
+static int hasExtension(const char* path, const char* ext) {
+    size_t n = strlen(path), m = strlen(ext);
+    if (n <= m || path[n - m - 1] == '/')
+        return 0;
+    for (size_t i = 0; i < m; i++) {
+        char c = path[n - m + i];
+        if (c >= 'A' && c <= 'Z')
+            c = (char)(c - 'A' + 'a');
+        if (c != ext[i])
+            return 0;
+    }
+    return 1;
+}
+
+Model loadModel(const char* filePath) {
+    if (hasExtension(filePath, ".stl"))
+        return loadSTL(filePath);
+    return loadOBJ(filePath);
+}
+
+int isModelPath(const char* filePath) {
+    return hasExtension(filePath, ".obj") || hasExtension(filePath, ".stl");
+}
+
 void freeModel(Model* model) {
-    free(model->vertices);
-    free(model->faces);
-    model->vertices = NULL;
-    model->faces = NULL;
-    model->vertexCount = 0;
-    model->faceCount = 0;
+#ifndef OBJ_NO_MMAP
+    if (model->mapping) {
+        munmap(model->mapping, model->mappingSize);
+    } else
+#endif
+    {
+        free(model->vertices);
+        free(model->faces);
+    }
+    memset(model, 0, sizeof(*model));
 }
 
 int rayTriangleIntersection(Vertex rayOrigin, Vertex rayDirection, Vertex v0, Vertex v1, Vertex v2, float* t) {
@@ -238,7 +1037,8 @@ int isInsideCarModel(int x, int y, int z, Model* model, int sizeX, int sizeY, in
         Vertex v2 = model->vertices[idx2];
 
         float t;
-        if (rayTriangleIntersection(rayOrigin, rayDirection, v0, v1, v2, &t)) {
+        if (rayTriangleIntersection(rayOrigin, rayDirection, v0, v1, v2, &t) &&
+            t < scaledZ - rayOrigin.z) {
             intersectionCount++;
         }
     }
@@ -1,6 +1,8 @@
 #ifndef MODEL_LOADER_H
 #define MODEL_LOADER_H
 
+#include <stddef.h>
+
 typedef struct {
   float x, y, z;
 } Vertex;
@@ -14,12 +16,41 @@ typedef struct {
   Face* faces; 
   int vertexCount;
   int faceCount;
+  float boundsMin[3]; // vertex AABB, filled by the loaders
+  float boundsMax[3];
+  void* mapping;      // set when vertices/faces point into a mapped .meshbin
+  size_t mappingSize;
 } Model;
 
+// Loads an OBJ, going through a binary cache next to it
+// ("<file>.obj.meshbin"). The cache is written on first load and mapped
+// without parsing on later loads while the source bytes hash the same.
+// Mapped models are copy-on-write, so callers may edit them in place.
 Model loadOBJ(const char* filePath);
+
+// Parses the OBJ text without reading or writing the cache.
+Model loadOBJUncached(const char* filePath);
+
+// Loads a binary or ASCII STL, cached like loadOBJ. Corners within
+// 1e-6 of the bounding-box diagonal are welded into shared vertices
+// through a spatial hash, and triangles that collapse are dropped.
+// Faces are 1-based like the OBJ ones.
+Model loadSTL(const char* filePath);
+
+// loadSTL for a ".stl" path (any case), loadOBJ otherwise.
+Model loadModel(const char* filePath);
+
+// Nonzero when the path ends in ".obj" or ".stl" (any case).
+int isModelPath(const char* filePath);
+
 void freeModel(Model* model);
 
-// Declare the isInsideCarModel function
+// Moller-Trumbore ray/triangle test; on a hit (t > 1e-5) stores the
+// ray parameter in *t and returns 1.
+int rayTriangleIntersection(Vertex rayOrigin, Vertex rayDirection, Vertex v0, Vertex v1, Vertex v2, float* t);
+
+// Parity test for the cell's point in [-1, 1]^3, along a +z ray from
+// z = -2 up to the point.
 int isInsideCarModel(int x, int y, int z, Model* model, int sizeX, int sizeY, int sizeZ);
 
 #endif // MODEL_LOADER_H
\ No newline at end of file
@@ -38,6 +38,15 @@ int cli_parse(int argc, char *argv[], CliOptions *opts) {
             "assets/sr_model_norm.bin",
             sizeof(opts->srNormPath) - 1);
     opts->srNormPath[sizeof(opts->srNormPath) - 1] = '\0';
+    opts->decimateCells = 0.0f;
+    opts->spectrumOutputPath[0] = '\0';
+    opts->cdTolerance = 0.01f;
+    opts->sheddingCycles = 0;
+    probes_init(&opts->probes);
+    strncpy(opts->probeOutputPath,
+            "probes.bin",
+            sizeof(opts->probeOutputPath) - 1);
+    opts->probeOutputPath[sizeof(opts->probeOutputPath) - 1] = '\0';
 
     static struct option long_options[] = {
         {"wind", required_argument, 0, 'w'},
@@ -56,6 +65,13 @@ int cli_parse(int argc, char *argv[], CliOptions *opts) {
         {"vtk-interval", required_argument, 0, 'I'},
         {"superres", no_argument, 0, 'R'},
         {"sr-weights", required_argument, 0, 'W'},
+        {"decimate", required_argument, 0, 'D'},
+        {"spectrum-output", required_argument, 0, 'F'},
+        {"cd-tolerance", required_argument, 0, 'T'},
+        {"shedding-cycles", required_argument, 0, 'C'},
+        {"probe", required_argument, 0, 'P'},
+        {"probe-line", required_argument, 0, 'L'},
+        {"probe-output", required_argument, 0, 'O'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
 
@@ -158,8 +174,45 @@ int cli_parse(int argc, char *argv[], CliOptions *opts) {
             strncpy(opts->srWeightsPath, optarg, sizeof(opts->srWeightsPath) - 1);
             opts->srWeightsPath[sizeof(opts->srWeightsPath) - 1] = '\0';
             break;
+        case 'D':
+            opts->decimateCells = atof(optarg);
+            if (opts->decimateCells < 0.0f)
+                opts->decimateCells = 0.0f;
+            break;
+        case 'F':
+            strncpy(opts->spectrumOutputPath,
+                    optarg,
+                    sizeof(opts->spectrumOutputPath) - 1);
+            opts->spectrumOutputPath[sizeof(opts->spectrumOutputPath) - 1] =
+                '\0';
+            break;
+        case 'T':
+            opts->cdTolerance = atof(optarg);
+            if (opts->cdTolerance < 0.0f)
+                opts->cdTolerance = 0.0f;
+            break;
+        case 'C':
+            opts->sheddingCycles = atoi(optarg);
+            if (opts->sheddingCycles < 0)
+                opts->sheddingCycles = 0;
+            break;
+        case 'P':
+            if (probes_add_point(&opts->probes, optarg) != 0)
+                fprintf(stderr, "Ignoring malformed --probe=%s\n", optarg);
+            break;
+        case 'L':
+            if (probes_add_line(&opts->probes, optarg) != 0)
+                fprintf(stderr, "Ignoring malformed --probe-line=%s\n", optarg);
+            break;
+        case 'O':
+            strncpy(opts->probeOutputPath,
+                    optarg,
+                    sizeof(opts->probeOutputPath) - 1);
+            opts->probeOutputPath[sizeof(opts->probeOutputPath) - 1] = '\0';
+            break;
         case 'h':
         default:
+            probes_free(&opts->probes);
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
             printf("  -w, --wind=SPEED      Wind speed 0-5 (default: 1.0)\n");
@@ -171,7 +224,7 @@ int cli_parse(int argc, char *argv[], CliOptions *opts) {
             printf("  -d, --duration=SECS   Render duration (0=interactive, "
                    "default: 0)\n");
             printf("  -o, --output=PATH     Output directory for frames\n");
-            printf("  -m, --model=PATH      Path to OBJ model file\n");
+            printf("  -m, --model=PATH      Path to OBJ or STL model file\n");
             printf(
                 "  -a, --angle=DEGREES   Ahmed body slant angle (25 or 35)\n");
             printf(
@@ -189,6 +242,30 @@ int cli_parse(int argc, char *argv[], CliOptions *opts) {
                    "upscaling\n");
             printf("  --sr-weights=PATH     Super-resolution weights "
                    "(default: assets/sr_model.bin)\n");
+            printf("  --decimate=CELLS      Simplify the solid/collision mesh "
+                   "to this error in\n"
+                   "                        lattice cells (default: 0=off)\n");
+            printf("  --spectrum-output=PATH\n"
+                   "                        Write the Cl power spectrum as CSV "
+                   "at exit\n");
+            printf("  --cd-tolerance=REL    Auto-stop once the 95%% interval "
+                   "on Cd is within this\n"
+                   "                        fraction of the mean (default: "
+                   "0.01)\n");
+            printf("  --shedding-cycles=N   Auto-stop also waits for the Cl "
+                   "shedding frequency\n"
+                   "                        and amplitude to hold for N "
+                   "cycles (default: 0=off)\n");
+            printf("  --probe=X,Y,Z         Record velocity at this world "
+                   "point every LBM step\n"
+                   "                        (repeatable)\n");
+            printf("  --probe-line=X0,Y0,Z0:X1,Y1,Z1:N\n"
+                   "                        Record N (2-%d) evenly spaced "
+                   "points on a line\n"
+                   "                        (repeatable)\n",
+                   PROBE_LINE_MAX);
+            printf("  --probe-output=PATH   Probe time-series file "
+                   "(default: probes.bin)\n");
             printf("  -h, --help            Show this help\n");
             return 1;
         }
@@ -0,0 +1,449 @@
+#include "../lib/collision_bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define BVH_BINS 16
+// Ranges at least this large are built as separate OpenMP tasks
+#define BVH_TASK_MIN 4096
+
+typedef struct {
+    float min[3], max[3];
+} Box;
+
+// Node of the unflattened tree. A subtree over m triangles owns the 2m - 1
+// slots after its root, so tasks never share slots and the layout does
+// not depend on the schedule.
+typedef struct {
+    Box box;
+    int left, right; // slots, -1 for a leaf
+    int first, count;
+} BuildNode;
+
+typedef struct {
+    const Box *triBox;
+    const float *centroid; // 3 per triangle
+    int *indices;
+    BuildNode *slots;
+} BuildContext;
+
+static void box_empty(Box *b) {
+    for (int a = 0; a < 3; a++) {
+        b->min[a] = FLT_MAX;
+        b->max[a] = -FLT_MAX;
+    }
+}
+
+static void box_grow(Box *b, const Box *o) {
+    for (int a = 0; a < 3; a++) {
+        b->min[a] = fminf(b->min[a], o->min[a]);
+        b->max[a] = fmaxf(b->max[a], o->max[a]);
+    }
+}
+
+static float box_area(const Box *b) {
+    float dx = b->max[0] - b->min[0], dy = b->max[1] - b->min[1],
+          dz = b->max[2] - b->min[2];
+    if (dx < 0.0f)
+        return 0.0f; // empty
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Binned SAH over the three axes: picks the axis and bin boundary
+// (triangles in bins below it go left) with the lowest cost. Returns the
+// cost relative to one triangle test, FLT_MAX when the centroids
+// coincide.
+static float find_split(const BuildContext *ctx,
+                        int begin,
+                        int end,
+                        const Box *cbox,
+                        int *bestAxis,
+                        int *bestBin) {
+    float best = FLT_MAX;
+    for (int a = 0; a < 3; a++) {
+        float extent = cbox->max[a] - cbox->min[a];
+        if (!(extent > 0.0f))
+            continue;
+        float scale = BVH_BINS * (1.0f - 1e-5f) / extent;
+        Box bins[BVH_BINS];
+        int counts[BVH_BINS] = {0};
+        for (int b = 0; b < BVH_BINS; b++)
+            box_empty(&bins[b]);
+        for (int i = begin; i < end; i++) {
+            int t = ctx->indices[i];
+            int b = (int)((ctx->centroid[3 * t + a] - cbox->min[a]) * scale);
+            b = b < 0 ? 0 : (b >= BVH_BINS ? BVH_BINS - 1 : b);
+            counts[b]++;
+            box_grow(&bins[b], &ctx->triBox[t]);
+        }
+        // Sweep from the right for the right-hand areas, then from the
+        // left to cost each boundary
+        float rightArea[BVH_BINS];
+        int rightCount[BVH_BINS];
+        Box acc;
+        box_empty(&acc);
+        int n = 0;
+        for (int b = BVH_BINS - 1; b > 0; b--) {
+            box_grow(&acc, &bins[b]);
+            n += counts[b];
+            rightArea[b] = box_area(&acc);
+            rightCount[b] = n;
+        }
+        box_empty(&acc);
+        n = 0;
+        for (int b = 1; b < BVH_BINS; b++) {
+            box_grow(&acc, &bins[b - 1]);
+            n += counts[b - 1];
+            if (n == 0 || rightCount[b] == 0)
+                continue;
+            float cost = box_area(&acc) * n + rightArea[b] * rightCount[b];
+            if (cost < best) {
+                best = cost;
+                *bestAxis = a;
+                *bestBin = b;
+            }
+        }
+    }
+    return best;
+}
+
+static void build_node(const BuildContext *ctx,
+                       int slot,
+                       int begin,
+                       int end,
+                       int depth) {
+    BuildNode *node = &ctx->slots[slot];
+    Box cbox;
+    box_empty(&node->box);
+    box_empty(&cbox);
+    for (int i = begin; i < end; i++) {
+        int t = ctx->indices[i];
+        box_grow(&node->box, &ctx->triBox[t]);
+        for (int a = 0; a < 3; a++) {
+            cbox.min[a] = fminf(cbox.min[a], ctx->centroid[3 * t + a]);
+            cbox.max[a] = fmaxf(cbox.max[a], ctx->centroid[3 * t + a]);
+        }
+    }
+    int count = end - begin;
+    node->left = node->right = -1;
+    node->first = begin;
+    node->count = count;
+    if (count <= 2 || depth >= BVH_MAX_DEPTH)
+        return;
+
+    // SAH: a split costs one extra box test plus the children's
+    // triangles weighted by their share of the parent's area
+    int axis = 0, bin = 0;
+    float area = box_area(&node->box);
+    float split = find_split(ctx, begin, end, &cbox, &axis, &bin);
+    float splitCost =
+        split < FLT_MAX && area > 0.0f ? 1.0f + split / area : FLT_MAX;
+    if (splitCost >= count && count <= BVH_LEAF_MAX)
+        return;
+
+    int mid = begin;
+    if (split < FLT_MAX) {
+        float scale = BVH_BINS * (1.0f - 1e-5f) / (cbox.max[axis] -
+                                                   cbox.min[axis]);
+        int *idx = ctx->indices;
+        int hi = end - 1;
+        while (mid <= hi) {
+            int t = idx[mid];
+            int b = (int)((ctx->centroid[3 * t + axis] - cbox.min[axis]) *
+                          scale);
+            if (b < bin) {
+                mid++;
+            } else {
+                idx[mid] = idx[hi];
+                idx[hi--] = t;
+            }
+        }
+    }
+    if (mid == begin || mid == end)
+        mid = begin + count / 2; // coincident centroids: halve the range
+
+    node->left = slot + 1;
+    node->right = slot + 2 * (mid - begin);
+    node->count = 0;
+    if (count >= BVH_TASK_MIN) {
+#ifdef _OPENMP
+#pragma omp task
+#endif
+        build_node(ctx, node->left, begin, mid, depth + 1);
+        build_node(ctx, node->right, mid, end, depth + 1);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+    } else {
+        build_node(ctx, node->left, begin, mid, depth + 1);
+        build_node(ctx, node->right, mid, end, depth + 1);
+    }
+}
+
+// Copies the subtree at `slot` into depth-first order; returns its index.
+static int flatten(const BuildNode *slots,
+                   int slot,
+                   BVHNode *nodes,
+                   int *numNodes,
+                   int level,
+                   int *depth) {
+    const BuildNode *s = &slots[slot];
+    int i = (*numNodes)++;
+    BVHNode *n = &nodes[i];
+    n->minX = s->box.min[0];
+    n->minY = s->box.min[1];
+    n->minZ = s->box.min[2];
+    n->maxX = s->box.max[0];
+    n->maxY = s->box.max[1];
+    n->maxZ = s->box.max[2];
+    if (level > *depth)
+        *depth = level;
+    if (s->left < 0) {
+        n->offset = s->first;
+        n->count = s->count;
+    } else {
+        n->count = 0;
+        flatten(slots, s->left, nodes, numNodes, level + 1, depth);
+        n->offset =
+            flatten(slots, s->right, nodes, numNodes, level + 1, depth);
+    }
+    return i;
+}
+
+CollisionBVH buildCollisionBVH(const GPUTriangle *tris, int numTris) {
+    CollisionBVH bvh = {0};
+    if (!tris || numTris < 1)
+        return bvh;
+
+    size_t n = (size_t)numTris;
+    Box *triBox = (Box *)malloc(n * sizeof(Box));
+    float *centroid = (float *)malloc(n * 3 * sizeof(float));
+    BuildNode *slots = (BuildNode *)malloc((2 * n - 1) * sizeof(BuildNode));
+    bvh.triIndices = (int *)malloc(n * sizeof(int));
+    if (!triBox || !centroid || !slots || !bvh.triIndices) {
+        free(triBox);
+        free(centroid);
+        free(slots);
+        free(bvh.triIndices);
+        memset(&bvh, 0, sizeof(bvh));
+        return bvh;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int t = 0; t < numTris; t++) {
+        const GPUTriangle *tr = &tris[t];
+        float v[3][3] = {{tr->v0x, tr->v0y, tr->v0z},
+                         {tr->v1x, tr->v1y, tr->v1z},
+                         {tr->v2x, tr->v2y, tr->v2z}};
+        for (int a = 0; a < 3; a++) {
+            triBox[t].min[a] = fminf(v[0][a], fminf(v[1][a], v[2][a]));
+            triBox[t].max[a] = fmaxf(v[0][a], fmaxf(v[1][a], v[2][a]));
+            centroid[3 * t + a] = (v[0][a] + v[1][a] + v[2][a]) / 3.0f;
+        }
+        bvh.triIndices[t] = t;
+    }
+
+    BuildContext ctx = {triBox, centroid, bvh.triIndices, slots};
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    build_node(&ctx, 0, 0, numTris, 1);
+
+    // Count the used slots, then flatten
+    int used = 0;
+    int stack[BVH_MAX_DEPTH + 1], sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const BuildNode *s = &slots[stack[--sp]];
+        used++;
+        if (s->left >= 0) {
+            stack[sp++] = s->right;
+            stack[sp++] = s->left;
+        }
+    }
+    bvh.nodes = (BVHNode *)malloc((size_t)used * sizeof(BVHNode));
+    if (bvh.nodes)
+        flatten(slots, 0, bvh.nodes, &bvh.numNodes, 1, &bvh.depth);
+    free(triBox);
+    free(centroid);
+    free(slots);
+    if (!bvh.nodes) {
+        free(bvh.triIndices);
+        memset(&bvh, 0, sizeof(bvh));
+        return bvh;
+    }
+    bvh.numIndices = numTris;
+    return bvh;
+}
+
+void freeCollisionBVH(CollisionBVH *bvh) {
+    free(bvh->nodes);
+    free(bvh->triIndices);
+    memset(bvh, 0, sizeof(*bvh));
+}
+
+// Squared distance from p to the node's box (0 inside).
+static float node_dist2(const BVHNode *n, const float p[3]) {
+    float dx = fmaxf(fmaxf(n->minX - p[0], p[0] - n->maxX), 0.0f);
+    float dy = fmaxf(fmaxf(n->minY - p[1], p[1] - n->maxY), 0.0f);
+    float dz = fmaxf(fmaxf(n->minZ - p[2], p[2] - n->maxZ), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+int queryCollisionBVH(const CollisionBVH *bvh,
+                      const GPUTriangle *tris,
+                      const float p[3],
+                      float maxDist,
+                      float closest[3],
+                      float normal[3]) {
+    if (bvh->numNodes < 1)
+        return -1;
+    float best = maxDist, best2 = maxDist * maxDist;
+    int hit = -1;
+
+    // Nearer child first; the farther one waits on the stack with its
+    // box distance so it can be dropped once a closer hit is found
+    int stack[BVH_MAX_DEPTH];
+    float stackDist[BVH_MAX_DEPTH];
+    int sp = 0;
+    int node = node_dist2(&bvh->nodes[0], p) < best2 ? 0 : -1;
+    while (node >= 0) {
+        const BVHNode *n = &bvh->nodes[node];
+        if (n->count > 0) {
+            for (int j = 0; j < n->count; j++) {
+                int t = bvh->triIndices[n->offset + j];
+                float c[3], nrm[3];
+                float d = pointTriangleDistance(p, &tris[t], best, c, nrm);
+                if (d >= 0.0f && d < best) {
+                    best = d;
+                    best2 = d * d;
+                    hit = t;
+                    memcpy(closest, c, sizeof(c));
+                    memcpy(normal, nrm, sizeof(nrm));
+                }
+            }
+            node = -1;
+        } else {
+            int a = node + 1, b = n->offset;
+            float da = node_dist2(&bvh->nodes[a], p);
+            float db = node_dist2(&bvh->nodes[b], p);
+            if (db < da) {
+                int ti = a;
+                a = b;
+                b = ti;
+                float tf = da;
+                da = db;
+                db = tf;
+            }
+            if (db < best2) {
+                stack[sp] = b;
+                stackDist[sp++] = db;
+            }
+            node = da < best2 ? a : -1;
+        }
+        while (node < 0 && sp > 0) {
+            sp--;
+            if (stackDist[sp] < best2)
+                node = stack[sp];
+        }
+    }
+    return hit;
+}
+
+// Closest point on triangle (v0, v1, v2) to p, ported from
+// pointTriangleDistance in particle.comp with an early out on the
+// distance to the triangle's plane.
+float pointTriangleDistance(const float p[3],
+                            const GPUTriangle *tri,
+                            float maxDist,
+                            float closest[3],
+                            float normal[3]) {
+    float v0[3] = {tri->v0x, tri->v0y, tri->v0z};
+    float e0[3] = {tri->v1x - v0[0], tri->v1y - v0[1], tri->v1z - v0[2]};
+    float e1[3] = {tri->v2x - v0[0], tri->v2y - v0[1], tri->v2z - v0[2]};
+    float v0p[3] = {v0[0] - p[0], v0[1] - p[1], v0[2] - p[2]};
+
+    float a = e0[0] * e0[0] + e0[1] * e0[1] + e0[2] * e0[2];
+    float b = e0[0] * e1[0] + e0[1] * e1[1] + e0[2] * e1[2];
+    float c = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+    float d = e0[0] * v0p[0] + e0[1] * v0p[1] + e0[2] * v0p[2];
+    float e = e1[0] * v0p[0] + e1[1] * v0p[1] + e1[2] * v0p[2];
+
+    float n[3] = {e0[1] * e1[2] - e0[2] * e1[1],
+                  e0[2] * e1[0] - e0[0] * e1[2],
+                  e0[0] * e1[1] - e0[1] * e1[0]};
+    float nlen = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (!(nlen > 0.0f))
+        return -1.0f;
+    float plane = n[0] * v0p[0] + n[1] * v0p[1] + n[2] * v0p[2];
+    if (fabsf(plane) >= maxDist * nlen)
+        return -1.0f;
+
+    float det = a * c - b * b;
+    float s = b * e - c * d;
+    float t = b * d - a * e;
+
+    if (s + t <= det) {
+        if (s < 0.0f) {
+            if (t < 0.0f && d < 0.0f) {
+                t = 0.0f;
+                s = clampf(-d / a, 0.0f, 1.0f);
+            } else {
+                s = 0.0f;
+                t = clampf(-e / c, 0.0f, 1.0f);
+            }
+        } else if (t < 0.0f) {
+            t = 0.0f;
+            s = clampf(-d / a, 0.0f, 1.0f);
+        } else {
+            float invDet = 1.0f / det;
+            s *= invDet;
+            t *= invDet;
+        }
+    } else {
+        if (s < 0.0f) {
+            float tmp0 = b + d, tmp1 = c + e;
+            if (tmp1 > tmp0) {
+                s = clampf((tmp1 - tmp0) / (a - 2.0f * b + c), 0.0f, 1.0f);
+                t = 1.0f - s;
+            } else {
+                s = 0.0f;
+                t = clampf(-e / c, 0.0f, 1.0f);
+            }
+        } else if (t < 0.0f) {
+            float tmp0 = b + e, tmp1 = a + d;
+            if (tmp1 > tmp0) {
+                t = clampf((tmp1 - tmp0) / (a - 2.0f * b + c), 0.0f, 1.0f);
+                s = 1.0f - t;
+            } else {
+                t = 0.0f;
+                s = clampf(-d / a, 0.0f, 1.0f);
+            }
+        } else {
+            float numer = (c + e) - (b + d);
+            s = clampf(numer / (a - 2.0f * b + c), 0.0f, 1.0f);
+            t = 1.0f - s;
+        }
+    }
+
+    float dist2 = 0.0f;
+    for (int k = 0; k < 3; k++) {
+        closest[k] = v0[k] + s * e0[k] + t * e1[k];
+        normal[k] = n[k] / nlen;
+        dist2 += (p[k] - closest[k]) * (p[k] - closest[k]);
+    }
+    return sqrtf(dist2);
+}
@@ -1,18 +1,164 @@
 #define _USE_MATH_DEFINES
 #include "../lib/drag_metrics.h"
+#include "../lib/fft.h"
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// Segment length when the caller leaves it to us: a single segment for
+// short series, otherwise the largest power of two that still gives at
+// least three half-overlapping segments.
+static int auto_segment_length(int count) {
+    if (count < 128)
+        return count;
+    int len = 64;
+    while (2 * len <= count / 2)
+        len *= 2;
+    return len;
+}
+
+int cl_spectrum(const float *series,
+                int count,
+                float sampleRate,
+                int segmentLength,
+                ClSpectrum *out) {
+    if (!series || !out || count < 2 || !(sampleRate > 0.0f))
+        return -1;
+    int len = segmentLength > 0 ? segmentLength : auto_segment_length(count);
+    if (len > count)
+        len = count;
+    if (len < 2)
+        return -1;
+    int hop = len / 2 > 0 ? len / 2 : 1;
+    int segments = (count - len) / hop + 1;
+    int first = count - len - (segments - 1) * hop;
+    int bins = len / 2 + 1;
+
+    out->numBins = bins;
+    out->segmentLength = len;
+    out->numSegments = segments;
+    out->peakFrequency = 0.0f;
+    out->peakPower = 0.0f;
+    out->frequency = (float *)malloc((size_t)bins * sizeof(float));
+    out->power = (float *)malloc((size_t)bins * sizeof(float));
+
+    FftPlan *plan = fft_plan_create(len);
+    float *window = (float *)malloc((size_t)len * sizeof(float));
+    float *seg = (float *)malloc((size_t)len * sizeof(float));
+    float *re = (float *)malloc((size_t)bins * sizeof(float));
+    float *im = (float *)malloc((size_t)bins * sizeof(float));
+    double *acc = (double *)calloc((size_t)bins, sizeof(double));
+    int rc = -1;
+    if (!out->frequency || !out->power || !plan || !window || !seg || !re ||
+        !im || !acc)
+        goto done;
+
+    // Periodic Hann window
+    double windowPower = 0.0;
+    for (int i = 0; i < len; i++) {
+        window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / len));
+        windowPower += (double)window[i] * window[i];
+    }
+
+    for (int s = 0; s < segments; s++) {
+        const float *x = series + first + s * hop;
+        double mean = 0.0;
+        for (int i = 0; i < len; i++)
+            mean += x[i];
+        mean /= len;
+        for (int i = 0; i < len; i++)
+            seg[i] = (float)(x[i] - mean) * window[i];
+        fft_real(plan, seg, re, im);
+        for (int k = 0; k < bins; k++)
+            acc[k] += (double)re[k] * re[k] + (double)im[k] * im[k];
+    }
+
+    // One-sided density: every bin but DC and Nyquist folds in its
+    // negative-frequency twin.
+    double scale = 1.0 / ((double)sampleRate * windowPower * segments);
+    for (int k = 0; k < bins; k++) {
+        int mirrored = k > 0 && !(len % 2 == 0 && k == len / 2);
+        out->frequency[k] = (float)k * sampleRate / len;
+        out->power[k] = (float)(acc[k] * scale * (mirrored ? 2.0 : 1.0));
+    }
+
+    int peak = 0;
+    for (int k = 1; k < bins; k++) {
+        if (peak == 0 || out->power[k] > out->power[peak])
+            peak = k;
+    }
+    if (peak > 0) {
+        double offset = 0.0;
+        double height = out->power[peak];
+        if (peak + 1 < bins) {
+            double a = out->power[peak - 1];
+            double b = out->power[peak];
+            double c = out->power[peak + 1];
+            // The Hann main lobe is close to a Gaussian, so the parabola
+            // through log power lands nearer the true peak; fall back to
+            // linear power when a neighbour is exactly zero.
+            int useLog = a > 0.0 && c > 0.0;
+            if (useLog) {
+                a = log(a);
+                b = log(b);
+                c = log(c);
+            }
+            double denom = a - 2.0 * b + c;
+            if (denom < 0.0) {
+                offset = 0.5 * (a - c) / denom;
+                double top = b - 0.25 * (a - c) * offset;
+                height = useLog ? exp(top) : top;
+            }
+        }
+        out->peakFrequency = (float)((peak + offset) * sampleRate / len);
+        out->peakPower = (float)height;
+    }
+    rc = 0;
+
+done:
+    fft_plan_free(plan);
+    free(window);
+    free(seg);
+    free(re);
+    free(im);
+    free(acc);
+    if (rc != 0)
+        cl_spectrum_free(out);
+    return rc;
+}
+
+void cl_spectrum_free(ClSpectrum *spectrum) {
+    if (!spectrum)
+        return;
+    free(spectrum->frequency);
+    free(spectrum->power);
+    spectrum->frequency = NULL;
+    spectrum->power = NULL;
+    spectrum->numBins = 0;
+}
+
+int write_cl_spectrum(const ClSpectrum *spectrum, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write spectrum to %s\n", path);
+        return -1;
+    }
+    fprintf(f, "frequency,power\n");
+    for (int k = 0; k < spectrum->numBins; k++)
+        fprintf(f, "%.9g,%.9g\n", spectrum->frequency[k], spectrum->power[k]);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
 void compute_strouhal(float *clSeries,
                       int clCount,
                       int lbmSubsteps,
                       float charLength,
-                      float latticeVelocity) {
+                      float latticeVelocity,
+                      const char *spectrumPath) {
     // Strouhal number extraction from Cl time series.
     // St = f_peak * L / U, where f_peak is the dominant shedding
-    // frequency found via DFT of the Cl signal.
+    // frequency found in the Welch spectrum of the Cl signal.
     if (!clSeries || clCount < 12) {
         return;
     }
@@ -22,39 +168,15 @@ void compute_strouhal(float *clSeries,
     int n = clCount - start;
     float *sig = clSeries + start;
 
-    // Remove mean
-    float mean = 0;
-    for (int i = 0; i < n; i++)
-        mean += sig[i];
-    mean /= n;
-
-    // Hann window + mean removal
-    float *win = (float *)malloc(n * sizeof(float));
-    for (int i = 0; i < n; i++) {
-        float w = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / (n - 1)));
-        win[i] = (sig[i] - mean) * w;
-    }
-
-    // DFT over one-sided spectrum (skip DC).
     // Each Cl sample corresponds to CD_SAMPLE_INTERVAL frames,
     // each frame running lbmSubsteps lattice timesteps.
     float fs = 1.0f / (CD_SAMPLE_INTERVAL * lbmSubsteps);
-    int nfreqs = n / 2;
-    float peakPow = 0;
-    float peakFreq = 0;
-    for (int k = 1; k < nfreqs; k++) {
-        float re = 0, im = 0;
-        for (int i = 0; i < n; i++) {
-            float angle = 2.0f * (float)M_PI * k * i / n;
-            re += win[i] * cosf(angle);
-            im -= win[i] * sinf(angle);
-        }
-        float pw = re * re + im * im;
-        if (pw > peakPow) {
-            peakPow = pw;
-            peakFreq = (float)k * fs / n;
-        }
+    ClSpectrum spectrum;
+    if (cl_spectrum(sig, n, fs, 0, &spectrum) != 0) {
+        fprintf(stderr, "Cl spectrum failed\n");
+        return;
     }
+    float peakFreq = spectrum.peakFrequency;
 
     float charL = charLength; // lattice units, set during LBM init
     float st =
@@ -64,5 +186,11 @@ void compute_strouhal(float *clSeries,
            peakFreq,
            charL,
            latticeVelocity);
-    free(win);
+    printf("  Cl spectrum: %d segments of %d samples\n",
+           spectrum.numSegments,
+           spectrum.segmentLength);
+    if (spectrumPath && spectrumPath[0] != '\0' &&
+        write_cl_spectrum(&spectrum, spectrumPath) == 0)
+        printf("  Cl spectrum written to %s\n", spectrumPath);
+    cl_spectrum_free(&spectrum);
 }
@@ -0,0 +1,223 @@
+#define _USE_MATH_DEFINES
+#include "../lib/fft.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define FFT_MAX_FACTORS 32
+
+typedef struct {
+    double r, i;
+} Cpx;
+
+struct FftPlan {
+    int n;        // real length
+    int m;        // complex transform length: n / 2 for even n, else n
+    int maxRadix; // largest factor, sizes the generic butterfly scratch
+    int factors[2 * FFT_MAX_FACTORS]; // (radix, remaining length) pairs
+    Cpx *twiddles; // exp(-2 pi i k / m), k < m
+    Cpx *split;    // exp(-2 pi i k / n), k <= m, for even n only
+    Cpx *in;       // packed input, m values
+    Cpx *out;      // complex spectrum, m values
+    Cpx *scratch;  // maxRadix values
+};
+
+static inline Cpx cmul(Cpx a, Cpx b) {
+    return (Cpx){a.r * b.r - a.i * b.i, a.r * b.i + a.i * b.r};
+}
+
+// 4s first, then 2s, then odd factors in increasing order, as in most
+// mixed-radix codes: the radix-4 butterfly does the bulk of the work.
+static int factorize(int n, int *factors) {
+    int count = 0, p = 4, maxRadix = 1;
+    while (n > 1) {
+        while (n % p) {
+            if (p == 4)
+                p = 2;
+            else if (p == 2)
+                p = 3;
+            else
+                p += 2;
+            if ((long long)p * p > n)
+                p = n;
+        }
+        n /= p;
+        factors[2 * count] = p;
+        factors[2 * count + 1] = n;
+        if (p > maxRadix)
+            maxRadix = p;
+        count++;
+    }
+    return maxRadix;
+}
+
+static void butterfly2(Cpx *out, int fstride, const FftPlan *p, int m) {
+    Cpx *out2 = out + m;
+    for (int k = 0; k < m; k++) {
+        Cpx t = cmul(out2[k], p->twiddles[k * fstride]);
+        out2[k] = (Cpx){out[k].r - t.r, out[k].i - t.i};
+        out[k] = (Cpx){out[k].r + t.r, out[k].i + t.i};
+    }
+}
+
+static void butterfly4(Cpx *out, int fstride, const FftPlan *p, int m) {
+    for (int k = 0; k < m; k++) {
+        Cpx s0 = cmul(out[k + m], p->twiddles[k * fstride]);
+        Cpx s1 = cmul(out[k + 2 * m], p->twiddles[2 * k * fstride]);
+        Cpx s2 = cmul(out[k + 3 * m], p->twiddles[3 * k * fstride]);
+        Cpx s5 = {out[k].r - s1.r, out[k].i - s1.i};
+        Cpx a = {out[k].r + s1.r, out[k].i + s1.i};
+        Cpx s3 = {s0.r + s2.r, s0.i + s2.i};
+        Cpx s4 = {s0.r - s2.r, s0.i - s2.i};
+        out[k] = (Cpx){a.r + s3.r, a.i + s3.i};
+        out[k + 2 * m] = (Cpx){a.r - s3.r, a.i - s3.i};
+        out[k + m] = (Cpx){s5.r + s4.i, s5.i - s4.r};
+        out[k + 3 * m] = (Cpx){s5.r - s4.i, s5.i + s4.r};
+    }
+}
+
+static void butterfly_generic(Cpx *out,
+                              int fstride,
+                              const FftPlan *p,
+                              int m,
+                              int radix) {
+    Cpx *scratch = p->scratch;
+    for (int u = 0; u < m; u++) {
+        for (int q = 0; q < radix; q++)
+            scratch[q] = out[u + q * m];
+        for (int q1 = 0; q1 < radix; q1++) {
+            int k = u + q1 * m;
+            // k * fstride * q reduced mod m one step at a time
+            long long step = (long long)k * fstride % p->m;
+            long long tw = 0;
+            Cpx sum = scratch[0];
+            for (int q = 1; q < radix; q++) {
+                tw += step;
+                if (tw >= p->m)
+                    tw -= p->m;
+                Cpx t = cmul(scratch[q], p->twiddles[tw]);
+                sum.r += t.r;
+                sum.i += t.i;
+            }
+            out[k] = sum;
+        }
+    }
+}
+
+// Decimation in time: split the input into `radix` interleaved
+// subsequences, transform each recursively into consecutive blocks of
+// out, then combine them with one butterfly pass.
+static void transform(Cpx *out,
+                      const Cpx *in,
+                      int fstride,
+                      const int *factors,
+                      const FftPlan *p) {
+    int radix = factors[0];
+    int m = factors[1];
+    if (m == 1) {
+        for (int q = 0; q < radix; q++)
+            out[q] = in[q * fstride];
+    } else {
+        for (int q = 0; q < radix; q++)
+            transform(out + q * m, in + q * fstride, fstride * radix,
+                      factors + 2, p);
+    }
+    switch (radix) {
+    case 2:
+        butterfly2(out, fstride, p, m);
+        break;
+    case 4:
+        butterfly4(out, fstride, p, m);
+        break;
+    default:
+        butterfly_generic(out, fstride, p, m, radix);
+        break;
+    }
+}
+
+FftPlan *fft_plan_create(int n) {
+    if (n < 1)
+        return NULL;
+    FftPlan *p = (FftPlan *)calloc(1, sizeof(FftPlan));
+    if (!p)
+        return NULL;
+    p->n = n;
+    p->m = (n % 2 == 0) ? n / 2 : n;
+    p->maxRadix = factorize(p->m, p->factors);
+    p->twiddles = (Cpx *)malloc((size_t)p->m * sizeof(Cpx));
+    p->in = (Cpx *)malloc((size_t)p->m * sizeof(Cpx));
+    p->out = (Cpx *)malloc((size_t)p->m * sizeof(Cpx));
+    p->scratch = (Cpx *)malloc((size_t)p->maxRadix * sizeof(Cpx));
+    if (n % 2 == 0)
+        p->split = (Cpx *)malloc((size_t)(p->m + 1) * sizeof(Cpx));
+    if (!p->twiddles || !p->in || !p->out || !p->scratch ||
+        (n % 2 == 0 && !p->split)) {
+        fft_plan_free(p);
+        return NULL;
+    }
+    for (int k = 0; k < p->m; k++) {
+        double a = -2.0 * M_PI * k / p->m;
+        p->twiddles[k] = (Cpx){cos(a), sin(a)};
+    }
+    if (p->split) {
+        for (int k = 0; k <= p->m; k++) {
+            double a = -2.0 * M_PI * k / n;
+            p->split[k] = (Cpx){cos(a), sin(a)};
+        }
+    }
+    return p;
+}
+
+void fft_plan_free(FftPlan *plan) {
+    if (!plan)
+        return;
+    free(plan->twiddles);
+    free(plan->split);
+    free(plan->in);
+    free(plan->out);
+    free(plan->scratch);
+    free(plan);
+}
+
+void fft_real(FftPlan *plan,
+              const float *in,
+              float *outRe,
+              float *outIm) {
+    int n = plan->n;
+    int m = plan->m;
+    Cpx *z = plan->out;
+
+    if (n % 2) {
+        // Odd length: plain complex transform of the real samples.
+        for (int j = 0; j < n; j++)
+            plan->in[j] = (Cpx){in[j], 0.0};
+        if (m > 1)
+            transform(z, plan->in, 1, plan->factors, plan);
+        else
+            z[0] = plan->in[0];
+        for (int k = 0; k <= n / 2; k++) {
+            outRe[k] = (float)z[k].r;
+            outIm[k] = (float)z[k].i;
+        }
+        return;
+    }
+
+    // Even length: pack even samples into the real part and odd samples
+    // into the imaginary part, transform at half length, then separate
+    // the two spectra: X[k] = E[k] + exp(-2 pi i k / n) O[k].
+    for (int j = 0; j < m; j++)
+        plan->in[j] = (Cpx){in[2 * j], in[2 * j + 1]};
+    if (m > 1)
+        transform(z, plan->in, 1, plan->factors, plan);
+    else
+        z[0] = plan->in[0];
+    for (int k = 0; k <= m; k++) {
+        Cpx a = z[k % m];
+        Cpx b = z[(m - k) % m];
+        Cpx e = {0.5 * (a.r + b.r), 0.5 * (a.i - b.i)};
+        Cpx o = {0.5 * (a.i + b.i), -0.5 * (a.r - b.r)};
+        Cpx t = cmul(o, plan->split[k]);
+        outRe[k] = (float)(e.r + t.r);
+        outIm[k] = (float)(e.i + t.i);
+    }
+}
@@ -3,12 +3,17 @@
 #include "../obj-file-loader/lib/model_loader.h"
 #include "../lib/render_model.h"
 
+#include <string.h>
+
 void SDL_ExitWithError(const char *message) {
     printf("Error: %s > %s\n", message, SDL_GetError());
     SDL_Quit();
     exit(EXIT_FAILURE);
 }
 
+static void multigrid_free(struct FluidMultigrid *mg);
+static void density_box_free(struct FluidDensityBox *box);
+
 FluidCube *FluidCubeCreate(int sizeX,
                            int sizeY,
                            int sizeZ,
@@ -32,6 +37,22 @@ FluidCube *FluidCubeCreate(int sizeX,
     cube->diff = diffusion;
     cube->visc = viscosity;
     cube->model = model; // Store the model pointer
+    cube->solid = NULL;
+    cube->solidCells = NULL;
+    cube->solidCount = 0;
+    cube->solver = FLUID_SOLVER_MULTIGRID;
+    cube->solverTolerance = 1e-3f;
+    cube->solverMaxCycles = 20;
+    cube->lastSolveCycles = 0;
+    cube->lastSolveResidual = 0.0f;
+    cube->mg = NULL;
+    cube->sparseDensity = 1;
+    for (int a = 0; a < 3; a++) {
+        cube->densityMin[a] = 1; // empty: min > max
+        cube->densityMax[a] = 0;
+    }
+    cube->lastDensityCells = 0;
+    cube->densityBox = NULL;
 
     // Allocate memory for arrays...
     cube->s = calloc(N, sizeof(float));
@@ -51,6 +72,12 @@ FluidCube *FluidCubeCreate(int sizeX,
         return NULL;
     }
 
+    if (FluidCubeUpdateSolidMask(cube) != 0) {
+        printf("Out of memory!\n");
+        FluidCubeFree(cube);
+        return NULL;
+    }
+
     printf("Fluid cube memory allocated successfully.\n");
     return cube;
 }
@@ -67,9 +94,157 @@ void FluidCubeFree(FluidCube *cube) {
     free(cube->Vy0);
     free(cube->Vz0);
 
+    free(cube->solid);
+    free(cube->solidCells);
+    multigrid_free(cube->mg);
+    density_box_free(cube->densityBox);
+
     free(cube);
 }
 
+void FluidCubeSetSolver(FluidCube *cube,
+                        FluidSolver solver,
+                        float tolerance,
+                        int maxCycles) {
+    cube->solver = solver;
+    if (tolerance > 0.0f)
+        cube->solverTolerance = tolerance;
+    if (maxCycles > 0)
+        cube->solverMaxCycles = maxCycles;
+}
+
+typedef struct {
+    int column; // i + sizeX * j
+    float t;    // ray parameter from z = -2
+} ColumnHit;
+
+static int compareColumnHits(const void *a, const void *b) {
+    const ColumnHit *p = (const ColumnHit *)a, *q = (const ColumnHit *)b;
+    if (p->column != q->column)
+        return p->column < q->column ? -1 : 1;
+    return (p->t > q->t) - (p->t < q->t);
+}
+
+int FluidCubeUpdateSolidMask(FluidCube *cube) {
+    int sizeX = cube->sizeX, sizeY = cube->sizeY, sizeZ = cube->sizeZ;
+    size_t N = (size_t)sizeX * sizeY * sizeZ;
+
+    free(cube->solidCells);
+    cube->solidCells = NULL;
+    cube->solidCount = 0;
+    multigrid_free(cube->mg); // coarse masks follow the fine one
+    cube->mg = NULL;
+    density_box_free(cube->densityBox); // so does the packed box
+    cube->densityBox = NULL;
+    if (!cube->solid)
+        cube->solid = calloc(N, sizeof(uint8_t));
+    else
+        memset(cube->solid, 0, N);
+    if (!cube->solid)
+        return -1;
+
+    Model *model = cube->model;
+    if (!model || model->faceCount == 0)
+        return 0;
+
+    // isInsideCarModel casts one +z ray per (x, y) column, so cast each
+    // column once, keeping only the triangles whose xy extent covers it,
+    // and read every cell of the column off the sorted hits.
+    ColumnHit *hits = NULL;
+    int hitCount = 0, hitCap = 0;
+    Vertex rayDirection = {0.0f, 0.0f, 1.0f};
+    for (int f = 0; f < model->faceCount; f++) {
+        int idx0 = model->faces[f].v1 - 1;
+        int idx1 = model->faces[f].v2 - 1;
+        int idx2 = model->faces[f].v3 - 1;
+        if (idx0 < 0 || idx0 >= model->vertexCount || idx1 < 0 ||
+            idx1 >= model->vertexCount || idx2 < 0 ||
+            idx2 >= model->vertexCount)
+            continue;
+        Vertex v0 = model->vertices[idx0];
+        Vertex v1 = model->vertices[idx1];
+        Vertex v2 = model->vertices[idx2];
+
+        // Column x maps to x / sizeX * 2 - 1; pad a column for rounding.
+        float minX = fminf(v0.x, fminf(v1.x, v2.x));
+        float maxX = fmaxf(v0.x, fmaxf(v1.x, v2.x));
+        float minY = fminf(v0.y, fminf(v1.y, v2.y));
+        float maxY = fmaxf(v0.y, fmaxf(v1.y, v2.y));
+        float i0f = floorf((minX + 1.0f) * 0.5f * sizeX) - 1.0f;
+        float i1f = ceilf((maxX + 1.0f) * 0.5f * sizeX) + 1.0f;
+        float j0f = floorf((minY + 1.0f) * 0.5f * sizeY) - 1.0f;
+        float j1f = ceilf((maxY + 1.0f) * 0.5f * sizeY) + 1.0f;
+        if (!(i1f >= 0.0f && i0f < sizeX && j1f >= 0.0f && j0f < sizeY))
+            continue;
+        int i0 = i0f < 0.0f ? 0 : (int)i0f;
+        int i1 = i1f >= sizeX ? sizeX - 1 : (int)i1f;
+        int j0 = j0f < 0.0f ? 0 : (int)j0f;
+        int j1 = j1f >= sizeY ? sizeY - 1 : (int)j1f;
+
+        for (int j = j0; j <= j1; j++) {
+            for (int i = i0; i <= i1; i++) {
+                Vertex rayOrigin = {(float)i / sizeX * 2.0f - 1.0f,
+                                    (float)j / sizeY * 2.0f - 1.0f,
+                                    -2.0f};
+                float t;
+                if (!rayTriangleIntersection(
+                        rayOrigin, rayDirection, v0, v1, v2, &t))
+                    continue;
+                if (hitCount == hitCap) {
+                    int newCap = hitCap ? hitCap * 2 : 1024;
+                    ColumnHit *grown =
+                        realloc(hits, (size_t)newCap * sizeof(ColumnHit));
+                    if (!grown) {
+                        free(hits);
+                        return -1;
+                    }
+                    hits = grown;
+                    hitCap = newCap;
+                }
+                hits[hitCount].column = i + sizeX * j;
+                hits[hitCount].t = t;
+                hitCount++;
+            }
+        }
+    }
+    qsort(hits, (size_t)hitCount, sizeof(ColumnHit), compareColumnHits);
+
+    // A cell is inside when an odd number of hits lie below it.
+    for (int h = 0; h < hitCount;) {
+        int column = hits[h].column;
+        int end = h;
+        while (end < hitCount && hits[end].column == column)
+            end++;
+        int i = column % sizeX, j = column / sizeX;
+        int below = h;
+        for (int k = 0; k < sizeZ; k++) {
+            float scaledZ = (float)k / sizeZ * 2.0f - 1.0f;
+            while (below < end && hits[below].t < scaledZ - (-2.0f))
+                below++;
+            if ((below - h) % 2 == 1) {
+                cube->solid[IX3D(i, j, k, sizeX, sizeY)] = 1;
+                cube->solidCount++;
+            }
+        }
+        h = end;
+    }
+    free(hits);
+
+    if (cube->solidCount > 0) {
+        cube->solidCells = malloc((size_t)cube->solidCount * sizeof(int));
+        if (!cube->solidCells) {
+            memset(cube->solid, 0, N);
+            cube->solidCount = 0;
+            return -1;
+        }
+        int n = 0;
+        for (size_t c = 0; c < N; c++)
+            if (cube->solid[c])
+                cube->solidCells[n++] = (int)c;
+    }
+    return 0;
+}
+
 void FluidCubeAddDensity(FluidCube *cube, int x, int y, int z, float amount) {
     if (x < 0 || x >= cube->sizeX || y < 0 || y >= cube->sizeY || z < 0 ||
         z >= cube->sizeZ) {
@@ -80,6 +255,22 @@ void FluidCubeAddDensity(FluidCube *cube, int x, int y, int z, float amount) {
         return;
     }
     cube->density[IX3D(x, y, z, cube->sizeX, cube->sizeY)] += amount;
+
+    // Keep densityMin/Max around every non-zero cell. Boundary cells are
+    // rewritten by set_bnd, so only the interior counts.
+    int cell[3] = {x, y, z};
+    int size[3] = {cube->sizeX, cube->sizeY, cube->sizeZ};
+    for (int a = 0; a < 3; a++) {
+        int c = cell[a] < 1 ? 1 : cell[a] > size[a] - 2 ? size[a] - 2 : cell[a];
+        if (cube->densityMin[a] > cube->densityMax[a]) {
+            cube->densityMin[a] = cube->densityMax[a] = c;
+        } else {
+            if (c < cube->densityMin[a])
+                cube->densityMin[a] = c;
+            if (c > cube->densityMax[a])
+                cube->densityMax[a] = c;
+        }
+    }
 }
 
 void FluidCubeAddVelocity(
@@ -98,11 +289,11 @@ void FluidCubeAddVelocity(
     cube->Vz[index] += amtZ;
 }
 
-static void
-set_bnd(int b, float *x, int sizeX, int sizeY, int sizeZ, FluidCube *cube) {
-    // Implement boundary conditions for 3D
-    for (int i = 1; i < sizeX - 1; i++) {
-        for (int j = 1; j < sizeY - 1; j++) {
+// Domain walls: mirror the neighbouring cell into the boundary layer,
+// negated for the velocity component normal to the wall (b = 1, 2, 3).
+static void set_walls(int b, float *x, int sizeX, int sizeY, int sizeZ) {
+    for (int j = 1; j < sizeY - 1; j++) {
+        for (int i = 1; i < sizeX - 1; i++) {
             x[IX3D(i, j, 0, sizeX, sizeY)] =
                 b == 3 ? -x[IX3D(i, j, 1, sizeX, sizeY)]
                        : x[IX3D(i, j, 1, sizeX, sizeY)];
@@ -112,8 +303,8 @@ set_bnd(int b, float *x, int sizeX, int sizeY, int sizeZ, FluidCube *cube) {
         }
     }
 
-    for (int i = 1; i < sizeX - 1; i++) {
-        for (int k = 1; k < sizeZ - 1; k++) {
+    for (int k = 1; k < sizeZ - 1; k++) {
+        for (int i = 1; i < sizeX - 1; i++) {
             x[IX3D(i, 0, k, sizeX, sizeY)] =
                 b == 2 ? -x[IX3D(i, 1, k, sizeX, sizeY)]
                        : x[IX3D(i, 1, k, sizeX, sizeY)];
@@ -123,8 +314,8 @@ set_bnd(int b, float *x, int sizeX, int sizeY, int sizeZ, FluidCube *cube) {
         }
     }
 
-    for (int j = 1; j < sizeY - 1; j++) {
-        for (int k = 1; k < sizeZ - 1; k++) {
+    for (int k = 1; k < sizeZ - 1; k++) {
+        for (int j = 1; j < sizeY - 1; j++) {
             x[IX3D(0, j, k, sizeX, sizeY)] =
                 b == 1 ? -x[IX3D(1, j, k, sizeX, sizeY)]
                        : x[IX3D(1, j, k, sizeX, sizeY)];
@@ -166,24 +357,385 @@ set_bnd(int b, float *x, int sizeX, int sizeY, int sizeZ, FluidCube *cube) {
         0.5f * (x[IX3D(sizeX - 2, sizeY - 1, sizeZ - 1, sizeX, sizeY)] +
                 x[IX3D(sizeX - 1, sizeY - 2, sizeZ - 1, sizeX, sizeY)] +
                 x[IX3D(sizeX - 1, sizeY - 1, sizeZ - 2, sizeX, sizeY)]);
+}
+
+static void
+set_bnd(int b, float *x, int sizeX, int sizeY, int sizeZ, FluidCube *cube) {
+    set_walls(b, x, sizeX, sizeY, sizeZ);
+
+    // Zero velocity/density inside the car model
+    for (int n = 0; n < cube->solidCount; n++)
+        x[cube->solidCells[n]] = 0;
+}
+
+// One colour of a red-black Gauss-Seidel sweep of
+//   c * x - a * (sum of the 6 neighbours) = x0
+// updating the interior cells with (i + j + k) % 2 == color that are not
+// solid. Cells of one colour only read the other, so z-slabs run in
+// parallel. Only this colour's cells are evaluated (every other cell of
+// a row, which the compiler vectorises with paired loads) into a local
+// buffer, then stored; evaluating the whole row would read the cells
+// that neighbouring slabs are writing.
+#define RB_CHUNK 256
+
+static void red_black_sweep(float *x,
+                            const float *x0,
+                            const uint8_t *solid,
+                            float a,
+                            float cRecip,
+                            int color,
+                            int sizeX,
+                            int sizeY,
+                            int sizeZ) {
+    int slice = sizeX * sizeY;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < sizeZ - 1; k++) {
+        for (int j = 1; j < sizeY - 1; j++) {
+            int row = IX3D(0, j, k, sizeX, sizeY);
+            float *xr = x + row;
+            const float *down = xr - sizeX, *up = xr + sizeX;
+            const float *back = xr - slice, *front = xr + slice;
+            const float *x0r = x0 + row;
+            const uint8_t *sr = solid + row;
+            int first = 2 - ((j + k + color) & 1);
+            for (int i0 = first; i0 < sizeX - 1; i0 += 2 * RB_CHUNK) {
+                int n = (sizeX - i0) / 2;
+                n = n < RB_CHUNK ? n : RB_CHUNK;
+                float v[RB_CHUNK];
+                for (int t = 0; t < n; t++) {
+                    int i = i0 + 2 * t;
+                    v[t] = (x0r[i] + a * (xr[i - 1] + xr[i + 1] + down[i] +
+                                          up[i] + back[i] + front[i])) *
+                           cRecip;
+                }
+                for (int t = 0; t < n; t++)
+                    if (!sr[i0 + 2 * t])
+                        xr[i0 + 2 * t] = v[t];
+            }
+        }
+    }
+}
+
+// Geometric multigrid for the lin_solve system
+//   c * x - a * (sum of the 6 neighbours) = x0
+// on interior cells, with set_walls in the boundary layer and solid
+// cells held at zero. Level 0 works in place on the cube's arrays;
+// each coarser level halves the interior (rounding up) and
+// rediscretises the operator, so `a` shrinks by 4 per level while the
+// diagonal shift c - 6a stays. Red-black Gauss-Seidel smoothing,
+// averaging restriction and trilinear prolongation.
+#define MG_MAX_LEVELS 12
+#define MG_MIN_INTERIOR 4 // coarsen while every interior extent is >= this
+#define MG_PRE_SWEEPS 2
+#define MG_POST_SWEEPS 2
+#define MG_COARSE_SWEEPS 32
+
+typedef struct {
+    int sizeX, sizeY, sizeZ; // including the boundary layer
+    float *x, *b, *r;        // level 0 borrows x from the caller
+    uint8_t *solid;          // level 0 borrows the cube's mask
+} MultigridLevel;
+
+struct FluidMultigrid {
+    int levels;
+    MultigridLevel level[MG_MAX_LEVELS];
+};
+
+static void multigrid_free(struct FluidMultigrid *mg) {
+    if (!mg)
+        return;
+    for (int l = 0; l < mg->levels; l++) {
+        free(mg->level[l].b);
+        free(mg->level[l].r);
+        if (l > 0) {
+            free(mg->level[l].x);
+            free(mg->level[l].solid);
+        }
+    }
+    free(mg);
+}
+
+// Solid cells are held at zero, so they act as Dirichlet conditions. A
+// coarse cell is solid when any of its fine cells is: that keeps every
+// coarse problem as well posed as the fine one, which would not hold if
+// a thin body vanished on the coarse grids.
+static struct FluidMultigrid *multigrid_create(FluidCube *cube) {
+    struct FluidMultigrid *mg = calloc(1, sizeof(*mg));
+    if (!mg)
+        return NULL;
+    int nx = cube->sizeX - 2, ny = cube->sizeY - 2, nz = cube->sizeZ - 2;
+    for (int l = 0; l < MG_MAX_LEVELS; l++) {
+        MultigridLevel *L = &mg->level[l];
+        L->sizeX = nx + 2;
+        L->sizeY = ny + 2;
+        L->sizeZ = nz + 2;
+        size_t N = (size_t)L->sizeX * L->sizeY * L->sizeZ;
+        mg->levels = l + 1;
+        L->b = calloc(N, sizeof(float));
+        L->r = calloc(N, sizeof(float));
+        if (l == 0) {
+            L->solid = cube->solid;
+        } else {
+            L->x = calloc(N, sizeof(float));
+            L->solid = calloc(N, sizeof(uint8_t));
+        }
+        if (!L->b || !L->r || !L->solid || (l > 0 && !L->x)) {
+            multigrid_free(mg);
+            return NULL;
+        }
+        if (l > 0) {
+            const MultigridLevel *F = &mg->level[l - 1];
+            for (int k = 1; k < L->sizeZ - 1; k++)
+                for (int j = 1; j < L->sizeY - 1; j++)
+                    for (int i = 1; i < L->sizeX - 1; i++) {
+                        int any = 0;
+                        for (int d = 0; d < 8 && !any; d++) {
+                            int fi = 2 * i - 1 + (d & 1);
+                            int fj = 2 * j - 1 + ((d >> 1) & 1);
+                            int fk = 2 * k - 1 + (d >> 2);
+                            if (fi < F->sizeX - 1 && fj < F->sizeY - 1 &&
+                                fk < F->sizeZ - 1)
+                                any = F->solid[IX3D(
+                                    fi, fj, fk, F->sizeX, F->sizeY)];
+                        }
+                        L->solid[IX3D(i, j, k, L->sizeX, L->sizeY)] =
+                            (uint8_t)any;
+                    }
+        }
+        if (nx < MG_MIN_INTERIOR || ny < MG_MIN_INTERIOR ||
+            nz < MG_MIN_INTERIOR)
+            break;
+        nx = (nx + 1) / 2;
+        ny = (ny + 1) / 2;
+        nz = (nz + 1) / 2;
+    }
+    return mg;
+}
+
+static void
+multigrid_smooth(const MultigridLevel *L, int b, float a, float c, int sweeps) {
+    int sizeX = L->sizeX, sizeY = L->sizeY, sizeZ = L->sizeZ;
+    float *x = L->x;
+    const float *rhs = L->b;
+    float cRecip = 1.0f / c;
+    for (int s = 0; s < sweeps; s++) {
+        for (int color = 0; color < 2; color++) {
+            set_walls(b, x, sizeX, sizeY, sizeZ);
+            red_black_sweep(
+                x, rhs, L->solid, a, cRecip, color, sizeX, sizeY, sizeZ);
+        }
+    }
+}
+
+// Fills L->r and returns its sum of squares; with `zeroMean` the mean
+// over fluid cells is removed first (pure-Neumann pressure, where only
+// the mean-free part of the right-hand side can be satisfied).
+static double
+multigrid_residual(MultigridLevel *L, int b, float a, float c, int zeroMean) {
+    int sizeX = L->sizeX, sizeY = L->sizeY, sizeZ = L->sizeZ;
+    const float *x = L->x;
+    set_walls(b, L->x, sizeX, sizeY, sizeZ);
+    double sum = 0.0, sumSq = 0.0;
+    long fluid = 0;
+    int slice = sizeX * sizeY;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+ : sum, sumSq, fluid)
+#endif
+    for (int k = 1; k < sizeZ - 1; k++) {
+        for (int j = 1; j < sizeY - 1; j++) {
+            int row = IX3D(0, j, k, sizeX, sizeY);
+            const float *xr = x + row, *br = L->b + row;
+            const float *down = xr - sizeX, *up = xr + sizeX;
+            const float *back = xr - slice, *front = xr + slice;
+            const uint8_t *sr = L->solid + row;
+            float *rr = L->r + row;
+            float rowSum = 0.0f, rowSq = 0.0f;
+            int rowSolid = 0;
+#ifdef _OPENMP
+#pragma omp simd reduction(+ : rowSum, rowSq, rowSolid)
+#endif
+            for (int i = 1; i < sizeX - 1; i++) {
+                float r = br[i] - c * xr[i] +
+                          a * (xr[i - 1] + xr[i + 1] + down[i] + up[i] +
+                               back[i] + front[i]);
+                // Masked by a multiply: GCC does not if-convert a ?: here.
+                r *= (float)(1 - sr[i]);
+                rr[i] = r;
+                rowSum += r;
+                rowSq += r * r;
+                rowSolid += sr[i];
+            }
+            sum += rowSum;
+            sumSq += rowSq;
+            fluid += sizeX - 2 - rowSolid;
+        }
+    }
+    if (zeroMean && fluid > 0) {
+        float mean = (float)(sum / fluid);
+        for (int k = 1; k < sizeZ - 1; k++)
+            for (int j = 1; j < sizeY - 1; j++)
+                for (int i = 1; i < sizeX - 1; i++) {
+                    int idx = IX3D(i, j, k, sizeX, sizeY);
+                    if (!L->solid[idx])
+                        L->r[idx] -= mean;
+                }
+        sumSq -= sum * sum / fluid;
+    }
+    return sumSq;
+}
 
-    // Add boundary conditions for the car model
-    if (cube->model) { // Check if the model exists
-        for (int i = 0; i < sizeX; i++) {
-            for (int j = 0; j < sizeY; j++) {
-                for (int k = 0; k < sizeZ; k++) {
-                    if (isInsideCarModel(
-                            i, j, k, cube->model, sizeX, sizeY, sizeZ)) {
-                        x[IX3D(i, j, k, sizeX, sizeY)] =
-                            0; // Set velocity/density to zero inside the car
-                               // model
+static void multigrid_restrict(const MultigridLevel *F, MultigridLevel *C) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < C->sizeZ - 1; k++) {
+        for (int j = 1; j < C->sizeY - 1; j++) {
+            for (int i = 1; i < C->sizeX - 1; i++) {
+                float sum = 0.0f;
+                int n = 0;
+                for (int d = 0; d < 8; d++) {
+                    int fi = 2 * i - 1 + (d & 1);
+                    int fj = 2 * j - 1 + ((d >> 1) & 1);
+                    int fk = 2 * k - 1 + (d >> 2);
+                    if (fi < F->sizeX - 1 && fj < F->sizeY - 1 &&
+                        fk < F->sizeZ - 1) {
+                        sum += F->r[IX3D(fi, fj, fk, F->sizeX, F->sizeY)];
+                        n++;
                     }
                 }
+                int idx = IX3D(i, j, k, C->sizeX, C->sizeY);
+                C->b[idx] = C->solid[idx] ? 0.0f : sum / n;
+                C->x[idx] = 0.0f;
             }
         }
     }
 }
 
+// Adds the trilinear interpolation of the coarse correction: each
+// fine cell sits a quarter of a coarse cell from its parent's centre,
+// so the weights are 3/4 and 1/4 per axis. Next to a wall the parent's
+// value stands in for the missing neighbour.
+static void multigrid_prolong(const MultigridLevel *C, MultigridLevel *F) {
+    int cx = C->sizeX, cxy = C->sizeX * C->sizeY;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < F->sizeZ - 1; k++) {
+        int K = (k + 1) / 2;
+        int dk = (k & 1) ? (K > 1 ? -cxy : 0) : (K < C->sizeZ - 2 ? cxy : 0);
+        for (int j = 1; j < F->sizeY - 1; j++) {
+            int J = (j + 1) / 2;
+            int dj = (j & 1) ? (J > 1 ? -cx : 0) : (J < C->sizeY - 2 ? cx : 0);
+            for (int i = 1; i < F->sizeX - 1; i++) {
+                int idx = IX3D(i, j, k, F->sizeX, F->sizeY);
+                if (F->solid[idx])
+                    continue;
+                int I = (i + 1) / 2;
+                int di = (i & 1) ? (I > 1 ? -1 : 0) : (I < C->sizeX - 2);
+                const float *e = &C->x[IX3D(I, J, K, C->sizeX, C->sizeY)];
+                float nearZ = 0.75f * (0.75f * e[0] + 0.25f * e[di]) +
+                              0.25f * (0.75f * e[dj] + 0.25f * e[dj + di]);
+                float farZ =
+                    0.75f * (0.75f * e[dk] + 0.25f * e[dk + di]) +
+                    0.25f * (0.75f * e[dk + dj] + 0.25f * e[dk + dj + di]);
+                F->x[idx] += 0.75f * nearZ + 0.25f * farZ;
+            }
+        }
+    }
+}
+
+static void multigrid_vcycle(struct FluidMultigrid *mg,
+                             int l,
+                             int b,
+                             float a,
+                             float shift,
+                             int singular) {
+    MultigridLevel *L = &mg->level[l];
+    float c = shift + 6.0f * a;
+    if (l == mg->levels - 1) {
+        multigrid_smooth(L, b, a, c, MG_COARSE_SWEEPS);
+        return;
+    }
+    multigrid_smooth(L, b, a, c, MG_PRE_SWEEPS);
+    multigrid_residual(L, b, a, c, singular);
+    multigrid_restrict(L, &mg->level[l + 1]);
+    multigrid_vcycle(mg, l + 1, b, 0.25f * a, shift, singular);
+    multigrid_prolong(&mg->level[l + 1], L);
+    multigrid_smooth(L, b, a, c, MG_POST_SWEEPS);
+}
+
+// V-cycles until the residual falls below solverTolerance times its
+// reference (the larger of |x0| and the starting residual).
+static void multigrid_solve(int b,
+                            float *x,
+                            float *x0,
+                            float a,
+                            float c,
+                            int sizeX,
+                            int sizeY,
+                            int sizeZ,
+                            FluidCube *cube) {
+    if (!cube->mg) {
+        cube->mg = multigrid_create(cube);
+        if (!cube->mg) {
+            printf("Out of memory for multigrid; using Gauss-Seidel\n");
+            cube->solver = FLUID_SOLVER_GAUSS_SEIDEL;
+            return;
+        }
+    }
+    struct FluidMultigrid *mg = cube->mg;
+    MultigridLevel *L = &mg->level[0];
+    L->x = x;
+    for (int n = 0; n < cube->solidCount; n++)
+        x[cube->solidCells[n]] = 0.0f;
+
+    // Work on a copy of the right-hand side: in the singular case
+    // (pure-Neumann pressure) its mean cannot be matched and would make
+    // the smoother drift, so it is removed here.
+    float shift = c - 6.0f * a;
+    int singular = shift == 0.0f && cube->solidCount == 0;
+    double sum = 0.0, sumSq = 0.0;
+    long fluid = 0;
+    for (int k = 1; k < sizeZ - 1; k++)
+        for (int j = 1; j < sizeY - 1; j++)
+            for (int i = 1; i < sizeX - 1; i++) {
+                int idx = IX3D(i, j, k, sizeX, sizeY);
+                L->b[idx] = L->solid[idx] ? 0.0f : x0[idx];
+                if (!L->solid[idx]) {
+                    sum += x0[idx];
+                    sumSq += (double)x0[idx] * x0[idx];
+                    fluid++;
+                }
+            }
+    if (singular && fluid > 0) {
+        float mean = (float)(sum / fluid);
+        for (int k = 1; k < sizeZ - 1; k++)
+            for (int j = 1; j < sizeY - 1; j++)
+                for (int i = 1; i < sizeX - 1; i++)
+                    L->b[IX3D(i, j, k, sizeX, sizeY)] -= mean;
+        sumSq -= sum * sum / fluid;
+    }
+    double bNorm = sqrt(fmax(sumSq, 0.0));
+
+    double reference = 0.0, residual = 0.0;
+    int cycle = 0;
+    for (;; cycle++) {
+        residual = sqrt(multigrid_residual(L, b, a, c, singular));
+        if (cycle == 0)
+            reference = fmax(bNorm, residual);
+        if (residual <= cube->solverTolerance * reference ||
+            cycle == cube->solverMaxCycles)
+            break;
+        multigrid_vcycle(mg, 0, b, a, shift, singular);
+    }
+    cube->lastSolveCycles = cycle;
+    cube->lastSolveResidual =
+        reference > 0.0 ? (float)(residual / reference) : 0.0f;
+    set_bnd(b, x, sizeX, sizeY, sizeZ, cube);
+}
+
 static void lin_solve(int b,
                       float *x,
                       float *x0,
@@ -194,27 +746,27 @@ static void lin_solve(int b,
                       int sizeY,
                       int sizeZ,
                       FluidCube *cube) {
-    float cRecip = 1.0 / c;
-    for (int k = 0; k < iter; k++) {
-        for (int i = 1; i < sizeX - 1; i++) {
-            for (int j = 1; j < sizeY - 1; j++) {
-                for (int k = 1; k < sizeZ - 1; k++) {
-                    x[IX3D(i, j, k, sizeX, sizeY)] =
-                        (x0[IX3D(i, j, k, sizeX, sizeY)] +
-                         a * (x[IX3D(i + 1, j, k, sizeX, sizeY)] +
-                              x[IX3D(i - 1, j, k, sizeX, sizeY)] +
-                              x[IX3D(i, j + 1, k, sizeX, sizeY)] +
-                              x[IX3D(i, j - 1, k, sizeX, sizeY)] +
-                              x[IX3D(i, j, k + 1, sizeX, sizeY)] +
-                              x[IX3D(i, j, k - 1, sizeX, sizeY)])) *
-                        cRecip;
-                }
-            }
-        }
+    if (cube->solver == FLUID_SOLVER_MULTIGRID) {
+        multigrid_solve(b, x, x0, a, c, sizeX, sizeY, sizeZ, cube);
+        if (cube->solver == FLUID_SOLVER_MULTIGRID)
+            return;
+    }
+    float cRecip = 1.0f / c;
+    for (int n = 0; n < iter; n++) {
+        red_black_sweep(
+            x, x0, cube->solid, a, cRecip, 0, sizeX, sizeY, sizeZ);
+        red_black_sweep(
+            x, x0, cube->solid, a, cRecip, 1, sizeX, sizeY, sizeZ);
         set_bnd(b, x, sizeX, sizeY, sizeZ, cube);
     }
 }
 
+void FluidCubeSolve(
+    FluidCube *cube, int b, float *x, float *x0, float a, float c, int iter) {
+    lin_solve(
+        b, x, x0, a, c, iter, cube->sizeX, cube->sizeY, cube->sizeZ, cube);
+}
+
 static void diffuse(int b,
                     float *x,
                     float *x0,
@@ -240,21 +792,27 @@ static void project(float *velocX,
                     int sizeY,
                     int sizeZ,
                     FluidCube *cube) {
+    int slice = sizeX * sizeY;
+    float divScale = -0.5f / (sizeX + sizeY + sizeZ);
+
     // Calculate divergence
-    for (int i = 1; i < sizeX - 1; i++) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < sizeZ - 1; k++) {
         for (int j = 1; j < sizeY - 1; j++) {
-            for (int k = 1; k < sizeZ - 1; k++) {
-                div[IX3D(i, j, k, sizeX, sizeY)] =
-                    -0.5f *
-                    (velocX[IX3D(i + 1, j, k, sizeX, sizeY)] -
-                     velocX[IX3D(i - 1, j, k, sizeX, sizeY)] +
-                     velocY[IX3D(i, j + 1, k, sizeX, sizeY)] -
-                     velocY[IX3D(i, j - 1, k, sizeX, sizeY)] +
-                     velocZ[IX3D(i, j, k + 1, sizeX, sizeY)] -
-                     velocZ[IX3D(i, j, k - 1, sizeX, sizeY)]) /
-                    (sizeX + sizeY + sizeZ);
-                p[IX3D(i, j, k, sizeX, sizeY)] = 0;
-            }
+            int row = IX3D(0, j, k, sizeX, sizeY);
+            const float *u = velocX + row;
+            const float *vDown = velocY + row - sizeX;
+            const float *vUp = velocY + row + sizeX;
+            const float *wBack = velocZ + row - slice;
+            const float *wFront = velocZ + row + slice;
+            float *d = div + row;
+            float *pr = p + row;
+            for (int i = 1; i < sizeX - 1; i++)
+                d[i] = divScale * (u[i + 1] - u[i - 1] + vUp[i] - vDown[i] +
+                                   wFront[i] - wBack[i]);
+            memset(pr + 1, 0, (size_t)(sizeX - 2) * sizeof(float));
         }
     }
 
@@ -266,25 +824,27 @@ static void project(float *velocX,
     lin_solve(0, p, div, 1, 6, iter, sizeX, sizeY, sizeZ, cube);
 
     // Update velocity fields based on pressure
-    for (int i = 1; i < sizeX - 1; i++) {
+    float gradX = 0.5f * sizeX, gradY = 0.5f * sizeY, gradZ = 0.5f * sizeZ;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < sizeZ - 1; k++) {
         for (int j = 1; j < sizeY - 1; j++) {
-            for (int k = 1; k < sizeZ - 1; k++) {
-                velocX[IX3D(i, j, k, sizeX, sizeY)] -=
-                    0.5f *
-                    (p[IX3D(i + 1, j, k, sizeX, sizeY)] -
-                     p[IX3D(i - 1, j, k, sizeX, sizeY)]) *
-                    sizeX;
-                velocY[IX3D(i, j, k, sizeX, sizeY)] -=
-                    0.5f *
-                    (p[IX3D(i, j + 1, k, sizeX, sizeY)] -
-                     p[IX3D(i, j - 1, k, sizeX, sizeY)]) *
-                    sizeY;
-                velocZ[IX3D(i, j, k, sizeX, sizeY)] -=
-                    0.5f *
-                    (p[IX3D(i, j, k + 1, sizeX, sizeY)] -
-                     p[IX3D(i, j, k - 1, sizeX, sizeY)]) *
-                    sizeZ;
-            }
+            int row = IX3D(0, j, k, sizeX, sizeY);
+            float *u = velocX + row;
+            float *v = velocY + row;
+            float *w = velocZ + row;
+            const float *pr = p + row;
+            const float *pDown = pr - sizeX, *pUp = pr + sizeX;
+            const float *pBack = pr - slice, *pFront = pr + slice;
+            // One loop per component keeps the alias checks that guard
+            // the vectorised loops few.
+            for (int i = 1; i < sizeX - 1; i++)
+                u[i] -= gradX * (pr[i + 1] - pr[i - 1]);
+            for (int i = 1; i < sizeX - 1; i++)
+                v[i] -= gradY * (pUp[i] - pDown[i]);
+            for (int i = 1; i < sizeX - 1; i++)
+                w[i] -= gradZ * (pFront[i] - pBack[i]);
         }
     }
 
@@ -294,6 +854,61 @@ static void project(float *velocX,
     set_bnd(3, velocZ, sizeX, sizeY, sizeZ, cube);
 }
 
+// Semi-Lagrangian advection: trace each cell centre back along the
+// velocity and sample d0 trilinearly. Back-traced positions are clamped
+// to half a cell inside the boundary layer, so every sample is in range.
+// dtx/dty/dtz turn a velocity into a displacement in cells.
+static void advect_scaled(int b,
+                          float *d,
+                          float *d0,
+                          float *velocX,
+                          float *velocY,
+                          float *velocZ,
+                          float dtx,
+                          float dty,
+                          float dtz,
+                          int sizeX,
+                          int sizeY,
+                          int sizeZ,
+                          FluidCube *cube) {
+    float maxX = sizeX - 1.5f;
+    float maxY = sizeY - 1.5f;
+    float maxZ = sizeZ - 1.5f;
+    int slice = sizeX * sizeY;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 1; k < sizeZ - 1; k++) {
+        for (int j = 1; j < sizeY - 1; j++) {
+            int row = IX3D(0, j, k, sizeX, sizeY);
+            for (int i = 1; i < sizeX - 1; i++) {
+                float x = i - dtx * velocX[row + i];
+                float y = j - dty * velocY[row + i];
+                float z = k - dtz * velocZ[row + i];
+                x = fminf(fmaxf(x, 0.5f), maxX);
+                y = fminf(fmaxf(y, 0.5f), maxY);
+                z = fminf(fmaxf(z, 0.5f), maxZ);
+
+                float i0 = floorf(x), j0 = floorf(y), k0 = floorf(z);
+                float s1 = x - i0, s0 = 1.0f - s1;
+                float t1 = y - j0, t0 = 1.0f - t1;
+                float u1 = z - k0, u0 = 1.0f - u1;
+
+                const float *c =
+                    d0 + IX3D((int)i0, (int)j0, (int)k0, sizeX, sizeY);
+                d[row + i] =
+                    s0 * (t0 * (u0 * c[0] + u1 * c[slice]) +
+                          t1 * (u0 * c[sizeX] + u1 * c[sizeX + slice])) +
+                    s1 * (t0 * (u0 * c[1] + u1 * c[1 + slice]) +
+                          t1 * (u0 * c[1 + sizeX] + u1 * c[1 + sizeX + slice]));
+            }
+        }
+    }
+
+    set_bnd(b, d, sizeX, sizeY, sizeZ, cube);
+}
+
 static void advect(int b,
                    float *d,
                    float *d0,
@@ -305,89 +920,309 @@ static void advect(int b,
                    int sizeY,
                    int sizeZ,
                    FluidCube *cube) {
-    float i0, i1, j0, j1, k0, k1;
-
-    float dtx = dt * (sizeX - 2);
-    float dty = dt * (sizeY - 2);
-    float dtz = dt * (sizeZ - 2);
-
-    float s0, s1, t0, t1, u0, u1;
-    float tmp1, tmp2, tmp3, x, y, z;
-
-    float NfloatX = sizeX;
-    float NfloatY = sizeY;
-    float NfloatZ = sizeZ;
-    float ifloat, jfloat, kfloat;
-    int i, j, k;
-
-    for (i = 1, ifloat = 1; i < sizeX - 1; i++, ifloat++) {
-        for (j = 1, jfloat = 1; j < sizeY - 1; j++, jfloat++) {
-            for (k = 1, kfloat = 1; k < sizeZ - 1; k++, kfloat++) {
-                tmp1 = dtx * velocX[IX3D(i, j, k, sizeX, sizeY)];
-                tmp2 = dty * velocY[IX3D(i, j, k, sizeX, sizeY)];
-                tmp3 = dtz * velocZ[IX3D(i, j, k, sizeX, sizeY)];
-                x = ifloat - tmp1;
-                y = jfloat - tmp2;
-                z = kfloat - tmp3;
-
-                if (x < 0.5f)
-                    x = 0.5f;
-                if (x > NfloatX + 0.5f)
-                    x = NfloatX + 0.5f;
-                i0 = floorf(x);
-                i1 = i0 + 1.0f;
-                if (y < 0.5f)
-                    y = 0.5f;
-                if (y > NfloatY + 0.5f)
-                    y = NfloatY + 0.5f;
-                j0 = floorf(y);
-                j1 = j0 + 1.0f;
-                if (z < 0.5f)
-                    z = 0.5f;
-                if (z > NfloatZ + 0.5f)
-                    z = NfloatZ + 0.5f;
-                k0 = floorf(z);
-                k1 = k0 + 1.0f;
-
-                s1 = x - i0;
-                s0 = 1.0f - s1;
-                t1 = y - j0;
-                t0 = 1.0f - t1;
-                u1 = z - k0;
-                u0 = 1.0f - u1;
-
-                int i0i = i0;
-                int i1i = i1;
-                int j0i = j0;
-                int j1i = j1;
-                int k0i = k0;
-                int k1i = k1;
-
-                // Ensure indices are within bounds
-                if (i0i < 0 || i0i >= sizeX || i1i < 0 || i1i >= sizeX ||
-                    j0i < 0 || j0i >= sizeY || j1i < 0 || j1i >= sizeY ||
-                    k0i < 0 || k0i >= sizeZ || k1i < 0 || k1i >= sizeZ) {
-                    printf("Error: Invalid indices in advect (%d, %d, %d).\n",
-                           i0i,
-                           j0i,
-                           k0i);
-                    continue;
-                }
+    advect_scaled(b,
+                  d,
+                  d0,
+                  velocX,
+                  velocY,
+                  velocZ,
+                  dt * (sizeX - 2),
+                  dt * (sizeY - 2),
+                  dt * (sizeZ - 2),
+                  sizeX,
+                  sizeY,
+                  sizeZ,
+                  cube);
+}
+
+// Sparse density transport. Smoke usually fills a small plume, so the
+// density diffuse/advect passes run on a packed copy of a box around
+// it: the cells above DENSITY_EPSILON, dilated by how far one step can
+// carry density and rounded out to whole bricks so the box (and the
+// multigrid hierarchy built for it) changes only now and then. The
+// copy gets one ghost layer, which set_bnd treats like a wall; the
+// dilation keeps the density there negligible. Cells that fall out of
+// the box are zeroed, so densityMin/Max always bound the non-zero
+// density and the next scan only looks inside them.
+#define FLUID_BRICK 8
+#define DENSITY_EPSILON 1e-5f
+#define DENSITY_DECAY 1e-3f // diffusion tail left outside the box
+#define SPARSE_MAX_FILL 0.5 // larger boxes use the full-grid passes
+
+struct FluidDensityBox {
+    FluidCube view; // sizes, solids and solver state of the packed box
+    int lo[3];      // full-grid cell at packed (1, 1, 1)
+    size_t capacity;
+    float *s, *density, *Vx, *Vy, *Vz;
+};
+
+static void density_box_free(struct FluidDensityBox *box) {
+    if (!box)
+        return;
+    free(box->s);
+    free(box->density);
+    free(box->Vx);
+    free(box->Vy);
+    free(box->Vz);
+    free(box->view.solid);
+    free(box->view.solidCells);
+    multigrid_free(box->view.mg);
+    free(box);
+}
+
+// Sets up cube->densityBox for the interior range lo..hi (inclusive):
+// buffers, packed solid mask and solver settings. The multigrid
+// hierarchy is kept while the box does not move.
+static struct FluidDensityBox *
+density_box_prepare(FluidCube *cube, const int lo[3], const int hi[3]) {
+    struct FluidDensityBox *box = cube->densityBox;
+    int sx = hi[0] - lo[0] + 3, sy = hi[1] - lo[1] + 3;
+    int sz = hi[2] - lo[2] + 3;
+    size_t n = (size_t)sx * sy * sz;
+    if (box && box->view.sizeX == sx && box->view.sizeY == sy &&
+        box->view.sizeZ == sz && box->lo[0] == lo[0] && box->lo[1] == lo[1] &&
+        box->lo[2] == lo[2])
+        goto settings;
 
-                d[IX3D(i, j, k, sizeX, sizeY)] =
-                    s0 * (t0 * (u0 * d0[IX3D(i0i, j0i, k0i, sizeX, sizeY)] +
-                                u1 * d0[IX3D(i0i, j0i, k1i, sizeX, sizeY)]) +
-                          t1 * (u0 * d0[IX3D(i0i, j1i, k0i, sizeX, sizeY)] +
-                                u1 * d0[IX3D(i0i, j1i, k1i, sizeX, sizeY)])) +
-                    s1 * (t0 * (u0 * d0[IX3D(i1i, j0i, k0i, sizeX, sizeY)] +
-                                u1 * d0[IX3D(i1i, j0i, k1i, sizeX, sizeY)]) +
-                          t1 * (u0 * d0[IX3D(i1i, j1i, k0i, sizeX, sizeY)] +
-                                u1 * d0[IX3D(i1i, j1i, k1i, sizeX, sizeY)]));
+    if (!box) {
+        box = calloc(1, sizeof(*box));
+        if (!box)
+            return NULL;
+        cube->densityBox = box;
+    }
+    multigrid_free(box->view.mg);
+    box->view.mg = NULL;
+    if (n > box->capacity) {
+        free(box->s);
+        free(box->density);
+        free(box->Vx);
+        free(box->Vy);
+        free(box->Vz);
+        free(box->view.solid);
+        free(box->view.solidCells);
+        box->s = malloc(n * sizeof(float));
+        box->density = malloc(n * sizeof(float));
+        box->Vx = malloc(n * sizeof(float));
+        box->Vy = malloc(n * sizeof(float));
+        box->Vz = malloc(n * sizeof(float));
+        box->view.solid = malloc(n * sizeof(uint8_t));
+        box->view.solidCells = malloc(n * sizeof(int));
+        box->capacity = n;
+        if (!box->s || !box->density || !box->Vx || !box->Vy || !box->Vz ||
+            !box->view.solid || !box->view.solidCells) {
+            density_box_free(box);
+            cube->densityBox = NULL;
+            return NULL;
+        }
+    }
+    box->view.sizeX = sx;
+    box->view.sizeY = sy;
+    box->view.sizeZ = sz;
+    memcpy(box->lo, lo, sizeof(box->lo));
+
+    // The ghost layer copies the full grid too, so solids there keep
+    // their zero through set_bnd.
+    box->view.solidCount = 0;
+    for (int k = 0; k < sz; k++)
+        for (int j = 0; j < sy; j++)
+            for (int i = 0; i < sx; i++) {
+                int idx = IX3D(i, j, k, sx, sy);
+                uint8_t solid = cube->solid[IX3D(lo[0] - 1 + i,
+                                                 lo[1] - 1 + j,
+                                                 lo[2] - 1 + k,
+                                                 cube->sizeX,
+                                                 cube->sizeY)];
+                box->view.solid[idx] = solid;
+                if (solid)
+                    box->view.solidCells[box->view.solidCount++] = idx;
             }
+
+settings:
+    box->view.solver = cube->solver;
+    box->view.solverTolerance = cube->solverTolerance;
+    box->view.solverMaxCycles = cube->solverMaxCycles;
+    return box;
+}
+
+// Copies the box plus its ghost layer between a full-grid field and a
+// packed one (toBox != 0 packs, 0 unpacks the interior only).
+static void
+density_box_copy(FluidCube *cube, struct FluidDensityBox *box, float *full,
+                 float *packed, int toBox) {
+    int sx = box->view.sizeX, sy = box->view.sizeY, sz = box->view.sizeZ;
+    int edge = toBox ? 0 : 1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = edge; k < sz - edge; k++) {
+        for (int j = edge; j < sy - edge; j++) {
+            float *f = full + IX3D(box->lo[0] - 1,
+                                   box->lo[1] - 1 + j,
+                                   box->lo[2] - 1 + k,
+                                   cube->sizeX,
+                                   cube->sizeY);
+            float *p = packed + IX3D(0, j, k, sx, sy);
+            if (toBox)
+                memcpy(p, f, (size_t)sx * sizeof(float));
+            else
+                memcpy(f + 1, p + 1, (size_t)(sx - 2) * sizeof(float));
         }
     }
+}
 
-    set_bnd(b, d, sizeX, sizeY, sizeZ, cube);
+// Largest distance, in cells, that advect traces back along any axis.
+static float max_displacement(FluidCube *cube) {
+    int n = cube->sizeX * cube->sizeY * cube->sizeZ;
+    float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(max : vx, vy, vz)
+#endif
+    for (int i = 0; i < n; i++) {
+        vx = fmaxf(vx, fabsf(cube->Vx[i]));
+        vy = fmaxf(vy, fabsf(cube->Vy[i]));
+        vz = fmaxf(vz, fabsf(cube->Vz[i]));
+    }
+    return fmaxf(fmaxf(cube->dt * (cube->sizeX - 2) * vx,
+                       cube->dt * (cube->sizeY - 2) * vy),
+                 cube->dt * (cube->sizeZ - 2) * vz);
+}
+
+// Zeroes density inside densityMin/Max but outside lo..hi.
+static void
+density_clear_outside(FluidCube *cube, const int lo[3], const int hi[3]) {
+    const int *mn = cube->densityMin, *mx = cube->densityMax;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = mn[2]; k <= mx[2]; k++) {
+        for (int j = mn[1]; j <= mx[1]; j++) {
+            float *row = cube->density + IX3D(0, j, k, cube->sizeX,
+                                              cube->sizeY);
+            int inside = k >= lo[2] && k <= hi[2] && j >= lo[1] && j <= hi[1];
+            for (int i = mn[0]; i <= mx[0]; i++)
+                if (!inside || i < lo[0] || i > hi[0])
+                    row[i] = 0.0f;
+        }
+    }
+}
+
+// Runs the density diffuse and advect passes on the box around the
+// plume. Returns 0 when done, -1 when the full-grid passes should run
+// instead (box too large, sparse transport off or out of memory).
+static int transport_density_sparse(FluidCube *cube, int iter) {
+    int size[3] = {cube->sizeX, cube->sizeY, cube->sizeZ};
+    if (!cube->sparseDensity)
+        return -1;
+
+    // Cells above the threshold, inside the current bounds.
+    int occMin[3] = {size[0], size[1], size[2]}, occMax[3] = {-1, -1, -1};
+    if (cube->densityMin[0] <= cube->densityMax[0]) {
+        const int *mn = cube->densityMin, *mx = cube->densityMax;
+        int minX = occMin[0], minY = occMin[1], minZ = occMin[2];
+        int maxX = -1, maxY = -1, maxZ = -1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(min : minX, minY, minZ) \
+    reduction(max : maxX, maxY, maxZ)
+#endif
+        for (int k = mn[2]; k <= mx[2]; k++) {
+            for (int j = mn[1]; j <= mx[1]; j++) {
+                const float *row =
+                    cube->density + IX3D(0, j, k, size[0], size[1]);
+                for (int i = mn[0]; i <= mx[0]; i++) {
+                    if (fabsf(row[i]) <= DENSITY_EPSILON)
+                        continue;
+                    minX = i < minX ? i : minX;
+                    maxX = i > maxX ? i : maxX;
+                    minY = j < minY ? j : minY;
+                    maxY = j > maxY ? j : maxY;
+                    minZ = k < minZ ? k : minZ;
+                    maxZ = k > maxZ ? k : maxZ;
+                }
+            }
+        }
+        occMin[0] = minX, occMin[1] = minY, occMin[2] = minZ;
+        occMax[0] = maxX, occMax[1] = maxY, occMax[2] = maxZ;
+    }
+    if (occMax[0] < 0) {
+        // Nothing left worth moving.
+        int none[3] = {1, 1, 1}, noneMax[3] = {0, 0, 0};
+        if (cube->densityMin[0] <= cube->densityMax[0])
+            density_clear_outside(cube, none, noneMax);
+        memcpy(cube->densityMin, none, sizeof(none));
+        memcpy(cube->densityMax, noneMax, sizeof(noneMax));
+        cube->lastDensityCells = 0;
+        return 0;
+    }
+
+    // Reach of one step: the back-trace plus the trilinear stencil, and
+    // the spread of the diffusion solve. Red-black sweeps move density 2
+    // cells each. The converged solve's response to a point shrinks by
+    // exp(-1 / lambda) per cell, lambda = 1 / acosh(1 + 1 / (2a)) (the
+    // 1D decay of (1 + 2a) x - a (left + right) = 0; the 3D one is
+    // faster), so it reaches as far as that takes to fall below
+    // DENSITY_DECAY. The ghost layer reflects what is left, so the box
+    // keeps the mass and the error is well below that tail.
+    float a = cube->dt * cube->diff * (size[0] - 2) * (size[1] - 2) *
+              (size[2] - 2);
+    float spread = 0.0f;
+    if (cube->solver == FLUID_SOLVER_GAUSS_SEIDEL)
+        spread = 2.0f * iter;
+    else if (a > 0.0f)
+        spread = ceilf(-logf(DENSITY_DECAY) / acoshf(1.0f + 0.5f / a));
+    int margin = (int)ceilf(max_displacement(cube) + spread) + 2;
+
+    int lo[3], hi[3];
+    long cells = 1, interior = 1;
+    for (int ax = 0; ax < 3; ax++) {
+        int first = occMin[ax] - margin, last = occMax[ax] + margin;
+        // Whole bricks, counted from the first interior cell.
+        first = first < 1 ? 1 : 1 + (first - 1) / FLUID_BRICK * FLUID_BRICK;
+        last = 1 + ((last - 1) / FLUID_BRICK + 1) * FLUID_BRICK - 1;
+        lo[ax] = first;
+        hi[ax] = last > size[ax] - 2 ? size[ax] - 2 : last;
+        cells *= hi[ax] - lo[ax] + 1;
+        interior *= size[ax] - 2;
+    }
+    if (cells > SPARSE_MAX_FILL * interior)
+        return -1;
+    struct FluidDensityBox *box = density_box_prepare(cube, lo, hi);
+    if (!box)
+        return -1;
+
+    FluidCube *view = &box->view;
+    int sx = view->sizeX, sy = view->sizeY, sz = view->sizeZ;
+    density_box_copy(cube, box, cube->density, box->density, 1);
+    density_box_copy(cube, box, cube->s, box->s, 1);
+    density_box_copy(cube, box, cube->Vx, box->Vx, 1);
+    density_box_copy(cube, box, cube->Vy, box->Vy, 1);
+    density_box_copy(cube, box, cube->Vz, box->Vz, 1);
+
+    lin_solve(0, box->s, box->density, a, 1 + 6 * a, iter, sx, sy, sz, view);
+    set_bnd(0, box->s, sx, sy, sz, view);
+    advect_scaled(0,
+                  box->density,
+                  box->s,
+                  box->Vx,
+                  box->Vy,
+                  box->Vz,
+                  cube->dt * (size[0] - 2),
+                  cube->dt * (size[1] - 2),
+                  cube->dt * (size[2] - 2),
+                  sx,
+                  sy,
+                  sz,
+                  view);
+    cube->lastSolveCycles = view->lastSolveCycles;
+    cube->lastSolveResidual = view->lastSolveResidual;
+
+    density_clear_outside(cube, lo, hi);
+    density_box_copy(cube, box, cube->density, box->density, 0);
+    density_box_copy(cube, box, cube->s, box->s, 0); // next warm start
+    set_bnd(0, cube->density, size[0], size[1], size[2], cube);
+    memcpy(cube->densityMin, lo, sizeof(lo));
+    memcpy(cube->densityMax, hi, sizeof(hi));
+    cube->lastDensityCells = cells;
+    return 0;
 }
 
 void FluidCubeStep(FluidCube *cube) {
@@ -400,26 +1235,29 @@ void FluidCubeStep(FluidCube *cube) {
     float *Vx0 = cube->Vx0;
     float *Vy0 = cube->Vy0;
     float *Vz0 = cube->Vz0;
-    float *p = cube->s;         // Pressure array
-    float *div = cube->density; // Divergence array
 
     // Diffuse velocity fields
     diffuse(1, Vx0, Vx, cube->visc, cube->dt, 4, sizeX, sizeY, sizeZ, cube);
     diffuse(2, Vy0, Vy, cube->visc, cube->dt, 4, sizeX, sizeY, sizeZ, cube);
     diffuse(3, Vz0, Vz, cube->visc, cube->dt, 4, sizeX, sizeY, sizeZ, cube);
 
-    // Project velocity fields to enforce incompressibility
-    project(Vx0, Vy0, Vz0, p, div, 4, sizeX, sizeY, sizeZ, cube);
+    // Project velocity fields to enforce incompressibility. Vx and Vy
+    // are free until advect refills them, so they hold the pressure and
+    // divergence (the density must survive the step).
+    project(Vx0, Vy0, Vz0, Vx, Vy, 4, sizeX, sizeY, sizeZ, cube);
 
     // Advect velocity fields
     advect(1, Vx, Vx0, Vx0, Vy0, Vz0, cube->dt, sizeX, sizeY, sizeZ, cube);
     advect(2, Vy, Vy0, Vx0, Vy0, Vz0, cube->dt, sizeX, sizeY, sizeZ, cube);
     advect(3, Vz, Vz0, Vx0, Vy0, Vz0, cube->dt, sizeX, sizeY, sizeZ, cube);
 
-    // Project velocity fields again
-    project(Vx, Vy, Vz, p, div, 4, sizeX, sizeY, sizeZ, cube);
+    // Project velocity fields again, with Vx0/Vy0 as scratch
+    project(Vx, Vy, Vz, Vx0, Vy0, 4, sizeX, sizeY, sizeZ, cube);
 
-    // Diffuse and advect density
+    // Diffuse and advect density, within the plume's box when it is
+    // small enough
+    if (transport_density_sparse(cube, 4) == 0)
+        return;
     diffuse(0,
             cube->s,
             cube->density,
@@ -441,4 +1279,9 @@ void FluidCubeStep(FluidCube *cube) {
            sizeY,
            sizeZ,
            cube);
+    cube->densityMin[0] = cube->densityMin[1] = cube->densityMin[2] = 1;
+    cube->densityMax[0] = sizeX - 2;
+    cube->densityMax[1] = sizeY - 2;
+    cube->densityMax[2] = sizeZ - 2;
+    cube->lastDensityCells = (long)(sizeX - 2) * (sizeY - 2) * (sizeZ - 2);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../lib/lbm.h"
 #include "../lib/opengl_utils.h"
+#include "../lib/voxelize.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -339,6 +340,12 @@ void LBM_Free(LBMGrid *grid) {
         glDeleteProgram(grid->streamShader);
     if (grid->forceShader)
         glDeleteProgram(grid->forceShader);
+    if (grid->probePosBuffer)
+        glDeleteBuffers(1, &grid->probePosBuffer);
+    if (grid->probeVelBuffer)
+        glDeleteBuffers(1, &grid->probeVelBuffer);
+    if (grid->probeShader)
+        glDeleteProgram(grid->probeShader);
 
     free(grid);
 }
@@ -917,6 +924,78 @@ void LBM_ComputeDragForceDecomposed(LBMGrid *grid,
         *pressureZ = results[6] / 10000.0f;
 }
 
+int LBM_SetProbes(LBMGrid *grid,
+                  const float *gridPos,
+                  int count,
+                  int ringSlots) {
+    if (count <= 0 || ringSlots <= 0)
+        return 0;
+    if (!grid->probeShader) {
+        grid->probeShader = createComputeShader("shaders/lbm_probe.comp");
+        if (!grid->probeShader) {
+            printf("Failed to create probe shader!\n");
+            return 0;
+        }
+        grid->probe_gridSizeLoc =
+            glGetUniformLocation(grid->probeShader, "gridSize");
+        grid->probe_numProbesLoc =
+            glGetUniformLocation(grid->probeShader, "numProbes");
+        grid->probe_slotLoc = glGetUniformLocation(grid->probeShader, "slot");
+        glGenBuffers(1, &grid->probePosBuffer);
+        glGenBuffers(1, &grid->probeVelBuffer);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, grid->probePosBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 (GLsizeiptr)count * 4 * sizeof(float),
+                 gridPos,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, grid->probeVelBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+                 (GLsizeiptr)ringSlots * count * 3 * sizeof(float),
+                 NULL,
+                 GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    grid->numProbes = count;
+    grid->probeRingSlots = ringSlots;
+    grid->probePending = 0;
+    return 1;
+}
+
+int LBM_SampleProbes(LBMGrid *grid) {
+    if (!grid->probeShader || grid->numProbes <= 0 ||
+        grid->probePending >= grid->probeRingSlots)
+        return grid->probePending;
+
+    glUseProgram(grid->probeShader);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, grid->velocityBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, grid->probePosBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, grid->probeVelBuffer);
+    glUniform3i(grid->probe_gridSizeLoc, grid->sizeX, grid->sizeY, grid->sizeZ);
+    glUniform1i(grid->probe_numProbesLoc, grid->numProbes);
+    glUniform1i(grid->probe_slotLoc, grid->probePending);
+    glDispatchCompute((grid->numProbes + 63) / 64, 1, 1);
+    // The next LBM step overwrites the velocity this dispatch reads
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    return ++grid->probePending;
+}
+
+int LBM_ReadProbes(LBMGrid *grid, float *out) {
+    int steps = grid->probePending;
+    if (!grid->probeShader || steps <= 0)
+        return 0;
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, grid->probeVelBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                       0,
+                       (GLsizeiptr)steps * grid->numProbes * 3 * sizeof(float),
+                       out);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    grid->probePending = 0;
+    return steps;
+}
+
 float LBM_ComputeDragCoefficient(LBMGrid *grid,
                                  float inletVelocity,
                                  float refArea) {
@@ -1012,87 +1091,42 @@ void LBM_SetSolidMesh(LBMGrid *grid,
     float scaleY = grid->sizeY / 4.0f; // world y: -2 to 2
     float scaleZ = grid->sizeZ / 4.0f; // world z: -2 to 2
 
-    int solidCount = 0;
+    // Parity-fill the mesh with the shared column voxelizer: one +X ray
+    // per (y, z) column instead of one ray per cell against every
+    // triangle.
+    VoxelBox box = {{grid->sizeX, grid->sizeY, grid->sizeZ},
+                    {-4.0f, -2.0f, -2.0f},
+                    {4.0f, 2.0f, 2.0f}};
+    VoxelLattice *lattice = Voxelize_TrianglesInBox(
+        triangles, 4, numTriangles, &box, VOXELIZE_MODE_SOLID);
+    if (!lattice)
+        printf("Failed to voxelize mesh; no solid cells set\n");
 
-    // For each grid cell, check if it's inside the mesh
-    for (int gz = 0; gz < grid->sizeZ; gz++) {
+    int solidCount = 0;
+    for (int gz = 0; lattice && gz < grid->sizeZ; gz++) {
         for (int gy = 0; gy < grid->sizeY; gy++) {
             for (int gx = 0; gx < grid->sizeX; gx++) {
-                // Grid cell center in world coords
                 float wx = (gx + 0.5f) / scaleX - 4.0f;
                 float wy = (gy + 0.5f) / scaleY - 2.0f;
                 float wz = (gz + 0.5f) / scaleZ - 2.0f;
 
-                // Quick AABB check first
+                // Keep stray fill outside the model's AABB out of the
+                // solid mask.
                 if (wx < minX || wx > maxX || wy < minY || wy > maxY ||
                     wz < minZ || wz > maxZ) {
                     continue;
                 }
 
-                // Ray casting to check if inside mesh
-                // Cast ray in +X direction, count intersections
-                int intersections = 0;
-
-                for (int t = 0; t < numTriangles; t++) {
-                    if (triBounds) {
-                        TriBounds tb = triBounds[t];
-                        if (wy < tb.minY || wy > tb.maxY || wz < tb.minZ ||
-                            wz > tb.maxZ || wx > tb.maxX) {
-                            continue;
-                        }
-                    }
-
-                    float *tri =
-                        &triangles[t * 12]; // 3 verts * 4 floats (with padding)
-
-                    float v0x = tri[0], v0y = tri[1], v0z = tri[2];
-                    float v1x = tri[4], v1y = tri[5], v1z = tri[6];
-                    float v2x = tri[8], v2y = tri[9], v2z = tri[10];
-
-                    // Ray-triangle intersection (Möller–Trumbore)
-                    float e1x = v1x - v0x, e1y = v1y - v0y, e1z = v1z - v0z;
-                    float e2x = v2x - v0x, e2y = v2y - v0y, e2z = v2z - v0z;
-
-                    // Ray direction is (1, 0, 0)
-                    float hx = 0, hy = -e2z, hz = e2y;
-                    float a = e1x * hx + e1y * hy + e1z * hz;
-
-                    if (a > -0.00001f && a < 0.00001f)
-                        continue;
-
-                    float f = 1.0f / a;
-                    float sx = wx - v0x, sy = wy - v0y, sz = wz - v0z;
-                    float u = f * (sx * hx + sy * hy + sz * hz);
-
-                    if (u < 0.0f || u > 1.0f)
-                        continue;
-
-                    float qx = sy * e1z - sz * e1y;
-                    float qy = sz * e1x - sx * e1z;
-                    float qz = sx * e1y - sy * e1x;
-
-                    float v = f * qx; // ray dir dot q, but ray dir is (1,0,0)
-
-                    if (v < 0.0f || u + v > 1.0f)
-                        continue;
-
-                    float dist = f * (e2x * qx + e2y * qy + e2z * qz);
-
-                    if (dist > 0.00001f) {
-                        intersections++;
-                    }
-                }
-
-                // Odd number of intersections = inside
-                if (intersections % 2 == 1) {
-                    int idx =
-                        gx + gy * grid->sizeX + gz * grid->sizeX * grid->sizeY;
+                int idx =
+                    gx + gy * grid->sizeX + gz * grid->sizeX * grid->sizeY;
+                if (lattice->data[idx]) {
                     solidData[idx] = 1;
                     solidCount++;
                 }
             }
         }
     }
+    Voxelize_FreeLattice(lattice);
 
     printf("LBM mesh solid: %d cells marked as solid\n", solidCount);
 
@@ -20,10 +20,15 @@
 #include "../lib/superres.h"
 
 #include "../lib/cli.h"
+#include "../lib/collision_bvh.h"
 #include "../lib/drag_metrics.h"
 #include "../lib/event_handlers.h"
 #include "../lib/gl_helpers.h"
+#include "../lib/mesh_simplify.h"
 #include "../lib/model_bounds.h"
+#include "../lib/probes.h"
+#include "../lib/spectral_monitor.h"
+#include "../lib/stream_stats.h"
 #include "../lib/view_matrix.h"
 #include "../lib/vti_export.h"
 
@@ -98,6 +103,20 @@ int main(int argc, char *argv[]) {
     int gridX = opts.gridX, gridY = opts.gridY, gridZ = opts.gridZ;
     float smagorinskyCs = opts.smagorinskyCs;
     int useMRT = opts.useMRT;
+    float decimateCells = opts.decimateCells;
+    float cdTolerance = opts.cdTolerance;
+    int sheddingCycles = opts.sheddingCycles;
+    ProbeSet probes = opts.probes; // takes ownership of the parsed list
+    char probeOutputPath[256];
+    strncpy(probeOutputPath, opts.probeOutputPath, sizeof(probeOutputPath));
+    probeOutputPath[sizeof(probeOutputPath) - 1] = '\0';
+    float *probeSamples = NULL; // one frame of substeps while recording
+    unsigned int lbmStep = 0;
+    char spectrumOutputPath[256];
+    strncpy(spectrumOutputPath,
+            opts.spectrumOutputPath,
+            sizeof(spectrumOutputPath));
+    spectrumOutputPath[sizeof(spectrumOutputPath) - 1] = '\0';
     char vtkOutputPath[256];
     strncpy(vtkOutputPath, opts.vtkOutputPath, sizeof(vtkOutputPath));
     vtkOutputPath[sizeof(vtkOutputPath) - 1] = '\0';
@@ -236,7 +255,7 @@ int main(int argc, char *argv[]) {
     checkGLError("After setting uniforms");
 
     printf("Loading 3D model: %s\n", modelPath);
-    Model carModel = loadOBJ(modelPath);
+    Model carModel = loadModel(modelPath);
 
     if (carModel.vertexCount == 0) {
         printf("Trying fallback path ../assets/...\n");
@@ -249,23 +268,10 @@ int main(int argc, char *argv[]) {
 
     // Compute model center and auto-center it
     if (carModel.vertexCount > 0) {
-        float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
-        float maxX = -FLT_MAX, maxY = -FLT_MAX, maxZ = -FLT_MAX;
-
-        for (int i = 0; i < carModel.vertexCount; i++) {
-            if (carModel.vertices[i].x < minX)
-                minX = carModel.vertices[i].x;
-            if (carModel.vertices[i].y < minY)
-                minY = carModel.vertices[i].y;
-            if (carModel.vertices[i].z < minZ)
-                minZ = carModel.vertices[i].z;
-            if (carModel.vertices[i].x > maxX)
-                maxX = carModel.vertices[i].x;
-            if (carModel.vertices[i].y > maxY)
-                maxY = carModel.vertices[i].y;
-            if (carModel.vertices[i].z > maxZ)
-                maxZ = carModel.vertices[i].z;
-        }
+        // Raw bounds come precomputed from the loader (or its cache).
+        float minX = carModel.boundsMin[0], maxX = carModel.boundsMax[0];
+        float minY = carModel.boundsMin[1], maxY = carModel.boundsMax[1];
+        float minZ = carModel.boundsMin[2], maxZ = carModel.boundsMax[2];
 
         float centerX = (minX + maxX) * 0.5f;
         float centerY = (minY + maxY) * 0.5f;
@@ -355,15 +361,43 @@ int main(int argc, char *argv[]) {
                                              g_offsetZ,
                                              g_carRotationY);
 
+    // The solid mask, collision grid and triangle SSBO cannot resolve
+    // detail finer than a lattice cell, so --decimate simplifies the
+    // mesh they are built from to an error budget in cells. Rendering
+    // keeps the full mesh.
+    Model simModel = carModel;
+    int simModelOwned = 0;
+    if (decimateCells > 0.0f && carModel.faceCount > 0) {
+        float cellSize = 8.0f / gridX; // LBM domain spans [-4, 4] in x
+        SimplifyReport simplify;
+        if (simplifyModel(&carModel,
+                          decimateCells * cellSize / g_modelScale,
+                          0,
+                          &simModel,
+                          &simplify) == 0) {
+            simModelOwned = 1;
+            printf("Decimated mesh: %d -> %d triangles, error bound %.3f "
+                   "cells\n",
+                   simplify.inputFaces,
+                   simplify.faceCount,
+                   simplify.maxError * g_modelScale / cellSize);
+        } else {
+            simModel = carModel;
+            printf("Mesh decimation failed; using the full mesh\n");
+        }
+    }
+
     printf("Creating triangle buffer...\n");
     int numTriangles = 0;
-    GPUTriangle *triangleData = createTriangleBuffer(&carModel,
+    GPUTriangle *triangleData = createTriangleBuffer(&simModel,
                                                      g_modelScale,
                                                      g_offsetX,
                                                      g_offsetY,
                                                      g_offsetZ,
                                                      g_carRotationY,
                                                      &numTriangles);
+    if (simModelOwned)
+        freeModel(&simModel);
 
     GLuint triangleBuffer = 0;
     if (triangleData && numTriangles > 0) {
@@ -377,50 +411,35 @@ int main(int argc, char *argv[]) {
         printf("Uploaded %d triangles to GPU\n", numTriangles);
     }
 
-    // Build spatial acceleration grid for per-triangle collision
-    GLuint gridCellStartBuf = 0, gridCellCountBuf = 0, gridTriIdxBuf = 0;
-    CollisionGrid collGrid = {0};
+    // Build the BVH for per-triangle collision
+    GLuint bvhNodeBuf = 0, bvhTriIdxBuf = 0;
+    CollisionBVH collBVH = {0};
 
     if (triangleData && numTriangles > 0) {
-        collGrid = buildCollisionGrid(triangleData,
-                                      numTriangles,
-                                      carBounds.minX,
-                                      carBounds.minY,
-                                      carBounds.minZ,
-                                      carBounds.maxX,
-                                      carBounds.maxY,
-                                      carBounds.maxZ);
-
-        glGenBuffers(1, &gridCellStartBuf);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridCellStartBuf);
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-                     collGrid.totalCells * sizeof(int),
-                     collGrid.cellStart,
-                     GL_STATIC_DRAW);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, gridCellStartBuf);
+        collBVH = buildCollisionBVH(triangleData, numTriangles);
 
-        glGenBuffers(1, &gridCellCountBuf);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridCellCountBuf);
+        glGenBuffers(1, &bvhNodeBuf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhNodeBuf);
         glBufferData(GL_SHADER_STORAGE_BUFFER,
-                     collGrid.totalCells * sizeof(int),
-                     collGrid.cellCount,
+                     collBVH.numNodes * sizeof(BVHNode),
+                     collBVH.nodes,
                      GL_STATIC_DRAW);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gridCellCountBuf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, bvhNodeBuf);
 
-        glGenBuffers(1, &gridTriIdxBuf);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridTriIdxBuf);
+        glGenBuffers(1, &bvhTriIdxBuf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhTriIdxBuf);
         glBufferData(GL_SHADER_STORAGE_BUFFER,
-                     collGrid.totalIndices * sizeof(int),
-                     collGrid.triIndices,
+                     collBVH.numIndices * sizeof(int),
+                     collBVH.triIndices,
                      GL_STATIC_DRAW);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, gridTriIdxBuf);
-
-        printf("Collision grid: %dx%dx%d, %d index entries (%.1f KB)\n",
-               COLL_GRID_RES,
-               COLL_GRID_RES,
-               COLL_GRID_RES,
-               collGrid.totalIndices,
-               collGrid.totalIndices * sizeof(int) / 1024.0f);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, bvhTriIdxBuf);
+
+        printf("Collision BVH: %d nodes, depth %d (%.1f KB)\n",
+               collBVH.numNodes,
+               collBVH.depth,
+               (collBVH.numNodes * sizeof(BVHNode) +
+                collBVH.numIndices * sizeof(int)) /
+                   1024.0f);
     }
 
     // Initialize LBM grid
@@ -552,6 +571,35 @@ int main(int argc, char *argv[]) {
             blockageFactor = (1.0f - epsilon) * (1.0f - epsilon);
         }
 
+        // Velocity probes, sampled on the GPU after every LBM step into
+        // a ring that holds one frame of substeps
+        if (probes.numProbes > 0) {
+            probeSamples = (float *)malloc((size_t)lbmSubsteps *
+                                           probes.numProbes * 3 *
+                                           sizeof(float));
+            if (probeSamples &&
+                probes_locate(&probes, lbmSizeX, lbmSizeY, lbmSizeZ) == 0 &&
+                LBM_SetProbes(lbmGrid,
+                              probes.grid,
+                              probes.numProbes,
+                              lbmSubsteps) &&
+                probes_open(&probes,
+                            probeOutputPath,
+                            lbmSizeX,
+                            lbmSizeY,
+                            lbmSizeZ,
+                            latticeVelocity) == 0) {
+                printf("Probes: %d points in %d groups -> %s\n",
+                       probes.numProbes,
+                       probes.numGroups,
+                       probeOutputPath);
+            } else {
+                fprintf(stderr, "Warning: probes disabled\n");
+                free(probeSamples);
+                probeSamples = NULL;
+            }
+        }
+
         printf("LBM initialized successfully\n");
     } else {
         printf("Warning: LBM initialization failed, using simple wind\n");
@@ -619,10 +667,8 @@ int main(int argc, char *argv[]) {
     GLint lbmGridSizeLoc =
         glGetUniformLocation(computeShaderProgram, "lbmGridSize");
     GLint timeLoc = glGetUniformLocation(computeShaderProgram, "time");
-    GLint gridMinLoc = glGetUniformLocation(computeShaderProgram, "gridMin");
-    GLint gridCellSizeLoc =
-        glGetUniformLocation(computeShaderProgram, "gridCellSize");
-    GLint gridResLoc = glGetUniformLocation(computeShaderProgram, "gridRes");
+    GLint bvhNodeCountLoc =
+        glGetUniformLocation(computeShaderProgram, "bvhNodeCount");
     GLint computeVizModeLoc =
         glGetUniformLocation(computeShaderProgram, "vizMode");
 
@@ -890,12 +936,26 @@ int main(int argc, char *argv[]) {
     int outputFrameCount = 0;
     int maxFrames = (renderDuration > 0) ? renderDuration * 60 : 0;
 
-    // Convergence detection for auto-stop. CD_HISTORY_SIZE and
-    // CD_SAMPLE_INTERVAL live in drag_metrics.h.
-    float cdHistory[CD_HISTORY_SIZE];
-    int cdHistoryCount = 0;
+    // Convergence detection for auto-stop: once the start-up transient
+    // is dropped, stop when the Cd_corr confidence interval is narrow
+    // enough. CD_SAMPLE_INTERVAL lives in drag_metrics.h.
+    StreamStats cdStats, clStats;
+    stream_stats_init(&cdStats);
+    stream_stats_init(&clStats);
     int converged = 0;
-    float cdEma = 0.0f;
+
+    // Online Cl spectrum; with --shedding-cycles the auto-stop also waits
+    // for the shedding frequency and amplitude to settle.
+    SpectralMonitor shedding = {0};
+    int sheddingOn =
+        sheddingCycles > 0 &&
+        spectral_monitor_init(&shedding,
+                              1.0f / (CD_SAMPLE_INTERVAL * lbmSubsteps),
+                              SHEDDING_WINDOW,
+                              sheddingCycles,
+                              SHEDDING_TOLERANCE) == 0;
+    int sheddingSettled = 0;
+    int stopScheduled = 0;
 
     // Cl time series for Strouhal extraction (dynamically grown)
     int clCapacity = 256;
@@ -949,6 +1009,26 @@ int main(int argc, char *argv[]) {
 
             for (int i = 0; i < lbmSubsteps; i++) {
                 LBM_Step(lbmGrid, currentInletVel, 0.0f, 0.0f);
+                lbmStep++;
+                // One readback per full ring, i.e. per frame
+                if (probeSamples && LBM_SampleProbes(lbmGrid) ==
+                                        lbmGrid->probeRingSlots) {
+                    int steps = LBM_ReadProbes(lbmGrid, probeSamples);
+                    // Stop at the last complete record; the header count
+                    // written on close keeps the file readable
+                    if (probes_append_steps(&probes,
+                                            lbmStep - steps + 1,
+                                            steps,
+                                            probeSamples) != 0) {
+                        fprintf(stderr,
+                                "Warning: probe write to %s failed, probes "
+                                "disabled\n",
+                                probeOutputPath);
+                        probes_close(&probes);
+                        free(probeSamples);
+                        probeSamples = NULL;
+                    }
+                }
             }
 
             // Super-resolution upscale after LBM step
@@ -1066,26 +1146,13 @@ int main(int argc, char *argv[]) {
                 }
             }
 
-            // Collision grid uniforms
-            if (gridMinLoc != -1)
-                glUniform3f(
-                    gridMinLoc, collGrid.minX, collGrid.minY, collGrid.minZ);
-            if (gridCellSizeLoc != -1)
-                glUniform3f(gridCellSizeLoc,
-                            collGrid.cellSizeX,
-                            collGrid.cellSizeY,
-                            collGrid.cellSizeZ);
-            if (gridResLoc != -1)
-                glUniform3i(
-                    gridResLoc, COLL_GRID_RES, COLL_GRID_RES, COLL_GRID_RES);
-
-            // Bind grid SSBOs
-            if (gridCellStartBuf)
-                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, gridCellStartBuf);
-            if (gridCellCountBuf)
-                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, gridCellCountBuf);
-            if (gridTriIdxBuf)
-                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, gridTriIdxBuf);
+            // Collision BVH
+            if (bvhNodeCountLoc != -1)
+                glUniform1i(bvhNodeCountLoc, collBVH.numNodes);
+            if (bvhNodeBuf)
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, bvhNodeBuf);
+            if (bvhTriIdxBuf)
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, bvhTriIdxBuf);
 
             // Visualization mode for pressure coloring in compute
             if (computeVizModeLoc != -1)
@@ -1305,13 +1372,26 @@ int main(int argc, char *argv[]) {
                 cdDiagPrinted = 1;
             }
 
-            // Exponential moving average tracks corrected Cd
-            if (cdHistoryCount == 0) {
-                cdEma = CdCorr;
-            } else {
-                float alpha = 0.1f;
-                cdEma = alpha * CdCorr + (1.0f - alpha) * cdEma;
+            // Running statistics of corrected Cd and Cl
+            if (Cd > 0 && Cd < 1000)
+                stream_stats_add(&cdStats, CdCorr);
+            stream_stats_add(&clStats, Cl);
+            if (sheddingOn && spectral_monitor_add(&shedding, Cl) &&
+                shedding.stable && !sheddingSettled) {
+                sheddingSettled = 1;
+                float st = (latticeVelocity > 1e-10f)
+                               ? shedding.frequency * charLength /
+                                     latticeVelocity
+                               : 0.0f;
+                printf("  Shedding stable over %d cycles (St %.4f,"
+                       " frequency %.6f, Cl amplitude %.4f)\n",
+                       sheddingCycles,
+                       st,
+                       shedding.frequency,
+                       shedding.amplitude);
             }
+            StreamEstimate cdEst;
+            stream_stats_estimate(&cdStats, &cdEst);
 
             int totalSteps = frameCount * lbmSubsteps;
             float tStar = (charLength > 0)
@@ -1331,7 +1411,7 @@ int main(int argc, char *argv[]) {
                    Cd,
                    CdCorr,
                    Cl,
-                   cdEma,
+                   cdEst.mean,
                    tStar,
                    flowThroughs);
             printf("  Cd_pressure=%.3f Cd_friction=%.3f\n",
@@ -1354,39 +1434,26 @@ int main(int argc, char *argv[]) {
                     clSeries[clCount++] = Cl;
             }
 
-            // Track Cd for convergence detection
-            if (Cd > 0 && Cd < 1000) {
-                cdHistory[cdHistoryCount % CD_HISTORY_SIZE] = Cd;
-                cdHistoryCount++;
-
-                if (cdHistoryCount >= CD_HISTORY_SIZE && !converged) {
-                    float mean = 0;
-                    for (int j = 0; j < CD_HISTORY_SIZE; j++)
-                        mean += cdHistory[j];
-                    mean /= CD_HISTORY_SIZE;
-
-                    float var = 0;
-                    for (int j = 0; j < CD_HISTORY_SIZE; j++) {
-                        float d = cdHistory[j] - mean;
-                        var += d * d;
-                    }
-                    float relStd =
-                        sqrtf(var / CD_HISTORY_SIZE) / (mean + 1e-10f);
-
-                    if (relStd < 0.01f) {
-                        converged = 1;
-                        printf("  Cd converged (mean=%.3f,"
-                               " relStd=%.4f)\n",
-                               mean,
-                               relStd);
-                        // Auto-stop in headless mode
-                        if (maxFrames > 0) {
-                            // Run 2 more seconds for clean video ending
-                            int extra = 120;
-                            if (outputFrameCount + extra < maxFrames)
-                                maxFrames = outputFrameCount + extra;
-                        }
-                    }
+            // Stop once Cd is statistically settled
+            if (!converged && cdEst.valid &&
+                cdEst.relHalfWidth < cdTolerance) {
+                converged = 1;
+                printf("  Cd converged (mean=%.3f +/- %.3f at 95%%,"
+                       " %ld transient samples dropped)\n",
+                       cdEst.mean,
+                       cdEst.halfWidth,
+                       cdEst.truncated);
+            }
+
+            // Auto-stop in headless mode
+            if (converged && (!sheddingOn || sheddingSettled) &&
+                !stopScheduled) {
+                stopScheduled = 1;
+                if (maxFrames > 0) {
+                    // Run 2 more seconds for clean video ending
+                    int extra = 120;
+                    if (outputFrameCount + extra < maxFrames)
+                        maxFrames = outputFrameCount + extra;
                 }
             }
         }
@@ -1412,22 +1479,53 @@ int main(int argc, char *argv[]) {
             GLContext_SwapBuffers(glCtx);
     }
 
+    if (useLBM && cdStats.count > 0) {
+        StreamEstimate est;
+        stream_stats_estimate(&cdStats, &est);
+        printf("Cd_corr mean %.4f +/- %.4f (95%%, %ld of %ld samples,"
+               " lag-1 %.2f)%s\n",
+               est.mean,
+               est.halfWidth,
+               est.used,
+               cdStats.count,
+               est.lag1,
+               est.valid ? "" : " -- transient not over");
+        stream_stats_estimate(&clStats, &est);
+        printf("Cl mean %.4f +/- %.4f (95%%, %ld of %ld samples,"
+               " lag-1 %.2f)%s\n",
+               est.mean,
+               est.halfWidth,
+               est.used,
+               clStats.count,
+               est.lag1,
+               est.valid ? "" : " -- transient not over");
+    }
+
     if (useLBM) {
         compute_strouhal(clSeries,
                          clCount,
                          lbmSubsteps,
                          charLength,
-                         latticeVelocity);
+                         latticeVelocity,
+                         spectrumOutputPath);
     }
 
+    if (probeSamples)
+        printf("Probes: %lld samples written to %s\n",
+               probes.numRecords,
+               probeOutputPath);
+
     printf("Cleaning up...\n");
     free(particles);
     if (triangleData)
         free(triangleData);
     free(clSeries);
-    free(collGrid.cellStart);
-    free(collGrid.cellCount);
-    free(collGrid.triIndices);
+    stream_stats_free(&cdStats);
+    stream_stats_free(&clStats);
+    spectral_monitor_free(&shedding);
+    probes_free(&probes);
+    free(probeSamples);
+    freeCollisionBVH(&collBVH);
     freeModel(&carModel);
     if (lbmGrid)
         LBM_Free(lbmGrid);
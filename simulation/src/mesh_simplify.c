@@ -0,0 +1,586 @@
+#include "../lib/mesh_simplify.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Border edges are kept in place by a plane through the edge,
+// perpendicular to its triangle, weighted this much more than a face.
+#define BORDER_WEIGHT 1000.0
+
+// Symmetric 4x4 quadric: a2 ab ac ad b2 bc bd c2 cd d2.
+typedef struct {
+    double q[10];
+} Quadric;
+
+static void quadricAddPlane(
+    Quadric *Q, double a, double b, double c, double d, double w) {
+    Q->q[0] += w * a * a;
+    Q->q[1] += w * a * b;
+    Q->q[2] += w * a * c;
+    Q->q[3] += w * a * d;
+    Q->q[4] += w * b * b;
+    Q->q[5] += w * b * c;
+    Q->q[6] += w * b * d;
+    Q->q[7] += w * c * c;
+    Q->q[8] += w * c * d;
+    Q->q[9] += w * d * d;
+}
+
+static void quadricAdd(Quadric *dst, const Quadric *a, const Quadric *b) {
+    for (int i = 0; i < 10; i++)
+        dst->q[i] = a->q[i] + b->q[i];
+}
+
+static double quadricEval(const Quadric *Q, const double *p) {
+    const double *q = Q->q;
+    double x = p[0], y = p[1], z = p[2];
+    return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+           2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+           q[7] * z * z + 2 * q[8] * z + q[9];
+}
+
+// Minimizer of the quadric, if its 3x3 part is well conditioned.
+static int quadricOptimum(const Quadric *Q, double *p) {
+    const double *q = Q->q;
+    double a00 = q[0], a01 = q[1], a02 = q[2];
+    double a11 = q[4], a12 = q[5], a22 = q[7];
+    double c0 = a11 * a22 - a12 * a12;
+    double c1 = a02 * a12 - a01 * a22;
+    double c2 = a01 * a12 - a02 * a11;
+    double det = a00 * c0 + a01 * c1 + a02 * c2;
+    double scale = a00 + a11 + a22;
+    if (!(fabs(det) > 1e-9 * scale * scale * scale))
+        return 0;
+    double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+    double inv = 1.0 / det;
+    p[0] = (c0 * b0 + c1 * b1 + c2 * b2) * inv;
+    p[1] = (c1 * b0 + (a00 * a22 - a02 * a02) * b1 +
+            (a01 * a02 - a00 * a12) * b2) *
+           inv;
+    p[2] = (c2 * b0 + (a01 * a02 - a00 * a12) * b1 +
+            (a00 * a11 - a01 * a01) * b2) *
+           inv;
+    return 1;
+}
+
+typedef struct {
+    int *items;
+    int count, cap;
+} IntList;
+
+static int intListPush(IntList *l, int value) {
+    if (l->count == l->cap) {
+        int cap = l->cap ? l->cap * 2 : 8;
+        int *items = (int *)realloc(l->items, (size_t)cap * sizeof(int));
+        if (!items)
+            return -1;
+        l->items = items;
+        l->cap = cap;
+    }
+    l->items[l->count++] = value;
+    return 0;
+}
+
+typedef struct {
+    double cost;
+    double pos[3];
+    int u, v;
+    unsigned stampU, stampV;
+} Collapse;
+
+typedef struct {
+    Collapse *items;
+    int count, cap;
+} CollapseHeap;
+
+static int heapPush(CollapseHeap *h, const Collapse *c) {
+    if (h->count == h->cap) {
+        int cap = h->cap ? h->cap * 2 : 1024;
+        Collapse *items =
+            (Collapse *)realloc(h->items, (size_t)cap * sizeof(Collapse));
+        if (!items)
+            return -1;
+        h->items = items;
+        h->cap = cap;
+    }
+    int i = h->count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (h->items[parent].cost <= c->cost)
+            break;
+        h->items[i] = h->items[parent];
+        i = parent;
+    }
+    h->items[i] = *c;
+    return 0;
+}
+
+static Collapse heapPop(CollapseHeap *h) {
+    Collapse top = h->items[0];
+    Collapse last = h->items[--h->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= h->count)
+            break;
+        if (child + 1 < h->count &&
+            h->items[child + 1].cost < h->items[child].cost)
+            child++;
+        if (last.cost <= h->items[child].cost)
+            break;
+        h->items[i] = h->items[child];
+        i = child;
+    }
+    if (h->count > 0)
+        h->items[i] = last;
+    return top;
+}
+
+typedef struct {
+    int vertexCount, faceCount, liveFaces;
+    double *pos;        // 3 per vertex
+    Quadric *quadrics;  // per vertex
+    unsigned *stamp;    // bumped whenever a vertex changes
+    uint8_t *alive;     // per vertex
+    int *faces;         // 3 per face, 0-based
+    uint8_t *faceAlive; // per face
+    IntList *vertexFaces;
+    int *mark; // scratch per vertex, compared against markStamp
+    int markStamp;
+    CollapseHeap heap;
+} Simplifier;
+
+static int faceHas(const int *f, int v) {
+    return f[0] == v || f[1] == v || f[2] == v;
+}
+
+static void faceNormal(const double *a,
+                       const double *b,
+                       const double *c,
+                       double *n) {
+    double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static int pushCollapse(Simplifier *s, int u, int v) {
+    Quadric Q;
+    quadricAdd(&Q, &s->quadrics[u], &s->quadrics[v]);
+    Collapse c;
+    c.u = u;
+    c.v = v;
+    c.stampU = s->stamp[u];
+    c.stampV = s->stamp[v];
+    if (quadricOptimum(&Q, c.pos)) {
+        c.cost = quadricEval(&Q, c.pos);
+    } else {
+        // Flat or linear neighbourhood: best of the ends and midpoint.
+        const double *pu = &s->pos[3 * u], *pv = &s->pos[3 * v];
+        double mid[3] = {0.5 * (pu[0] + pv[0]), 0.5 * (pu[1] + pv[1]),
+                         0.5 * (pu[2] + pv[2])};
+        const double *cand[3] = {pu, pv, mid};
+        c.cost = DBL_MAX;
+        for (int k = 0; k < 3; k++) {
+            double e = quadricEval(&Q, cand[k]);
+            if (e < c.cost) {
+                c.cost = e;
+                memcpy(c.pos, cand[k], sizeof(c.pos));
+            }
+        }
+    }
+    if (c.cost < 0.0)
+        c.cost = 0.0; // rounding
+    return heapPush(&s->heap, &c);
+}
+
+// Rejects collapses that would fold a triangle over or leave an edge
+// shared by more than two triangles (u and v may only have the
+// neighbours of their shared triangles in common).
+static int collapseIsValid(Simplifier *s, int u, int v, const double *p) {
+    s->markStamp++;
+    int shared = 0;
+    const IntList *fu = &s->vertexFaces[u];
+    for (int i = 0; i < fu->count; i++) {
+        const int *f = &s->faces[3 * fu->items[i]];
+        if (!s->faceAlive[fu->items[i]])
+            continue;
+        for (int k = 0; k < 3; k++)
+            s->mark[f[k]] = s->markStamp;
+        if (faceHas(f, v))
+            shared++;
+    }
+    if (shared == 0)
+        return 0;
+
+    s->markStamp++;
+    int common = 0;
+    const IntList *fv = &s->vertexFaces[v];
+    for (int i = 0; i < fv->count; i++) {
+        const int *f = &s->faces[3 * fv->items[i]];
+        if (!s->faceAlive[fv->items[i]])
+            continue;
+        for (int k = 0; k < 3; k++) {
+            int w = f[k];
+            if (w != u && w != v && s->mark[w] == s->markStamp - 1) {
+                s->mark[w] = s->markStamp; // count each once
+                common++;
+            }
+        }
+    }
+    if (common > shared)
+        return 0;
+
+    for (int side = 0; side < 2; side++) {
+        int moved = side ? v : u, other = side ? u : v;
+        const IntList *fl = &s->vertexFaces[moved];
+        for (int i = 0; i < fl->count; i++) {
+            int fi = fl->items[i];
+            const int *f = &s->faces[3 * fi];
+            if (!s->faceAlive[fi] || faceHas(f, other))
+                continue;
+            const double *c[3], *m[3];
+            for (int k = 0; k < 3; k++) {
+                c[k] = &s->pos[3 * f[k]];
+                m[k] = f[k] == moved ? p : c[k];
+            }
+            double before[3], after[3];
+            faceNormal(c[0], c[1], c[2], before);
+            faceNormal(m[0], m[1], m[2], after);
+            double dot = before[0] * after[0] + before[1] * after[1] +
+                         before[2] * after[2];
+            if (dot <= 0.0)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+// Merges v into u at p and queues the edges around u again.
+static int collapseEdge(Simplifier *s, int u, int v, const double *p) {
+    IntList *fu = &s->vertexFaces[u], *fv = &s->vertexFaces[v];
+    for (int i = 0; i < fv->count; i++) {
+        int fi = fv->items[i];
+        int *f = &s->faces[3 * fi];
+        if (!s->faceAlive[fi])
+            continue;
+        if (faceHas(f, u)) {
+            s->faceAlive[fi] = 0;
+            s->liveFaces--;
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+            if (f[k] == v)
+                f[k] = u;
+        if (intListPush(fu, fi) != 0)
+            return -1;
+    }
+    free(fv->items);
+    memset(fv, 0, sizeof(*fv));
+
+    int kept = 0;
+    for (int i = 0; i < fu->count; i++)
+        if (s->faceAlive[fu->items[i]])
+            fu->items[kept++] = fu->items[i];
+    fu->count = kept;
+
+    memcpy(&s->pos[3 * u], p, 3 * sizeof(double));
+    quadricAdd(&s->quadrics[u], &s->quadrics[u], &s->quadrics[v]);
+    s->alive[v] = 0;
+    s->stamp[u]++;
+
+    s->markStamp++;
+    for (int i = 0; i < fu->count; i++) {
+        const int *f = &s->faces[3 * fu->items[i]];
+        for (int k = 0; k < 3; k++) {
+            int w = f[k];
+            if (w == u || s->mark[w] == s->markStamp)
+                continue;
+            s->mark[w] = s->markStamp;
+            if (pushCollapse(s, u, w) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// Position plus index, so welding sorts without a global context
+// (qsort has no context pointer) and stays reentrant.
+typedef struct {
+    float x, y, z;
+    int index;
+} VertexKey;
+
+static int cmpPosition(const VertexKey *p, const VertexKey *q) {
+    if (p->x != q->x)
+        return p->x < q->x ? -1 : 1;
+    if (p->y != q->y)
+        return p->y < q->y ? -1 : 1;
+    if (p->z != q->z)
+        return p->z < q->z ? -1 : 1;
+    return 0;
+}
+
+static int cmpVertexKey(const void *a, const void *b) {
+    const VertexKey *p = (const VertexKey *)a, *q = (const VertexKey *)b;
+    int c = cmpPosition(p, q);
+    if (c)
+        return c;
+    return (p->index > q->index) - (p->index < q->index);
+}
+
+typedef struct {
+    uint64_t key; // lower vertex << 32 | higher vertex
+    int face;
+} EdgeRef;
+
+static int cmpEdge(const void *a, const void *b) {
+    uint64_t x = ((const EdgeRef *)a)->key, y = ((const EdgeRef *)b)->key;
+    return x < y ? -1 : x > y;
+}
+
+static void freeSimplifier(Simplifier *s) {
+    free(s->pos);
+    free(s->quadrics);
+    free(s->stamp);
+    free(s->alive);
+    free(s->faces);
+    free(s->faceAlive);
+    if (s->vertexFaces)
+        for (int i = 0; i < s->vertexCount; i++)
+            free(s->vertexFaces[i].items);
+    free(s->vertexFaces);
+    free(s->mark);
+    free(s->heap.items);
+    memset(s, 0, sizeof(*s));
+}
+
+// Welds identical positions and drops invalid or repeated-index faces.
+static int buildSimplifier(const Model *in, Simplifier *s) {
+    int nv = in->vertexCount;
+    VertexKey *order = (VertexKey *)malloc((size_t)nv * sizeof(VertexKey));
+    int *remap = (int *)malloc((size_t)nv * sizeof(int));
+    s->pos = (double *)malloc((size_t)nv * 3 * sizeof(double));
+    s->faces = (int *)malloc((size_t)in->faceCount * 3 * sizeof(int));
+    if (!order || !remap || !s->pos || !s->faces) {
+        free(order);
+        free(remap);
+        return -1;
+    }
+    for (int i = 0; i < nv; i++) {
+        const Vertex *v = &in->vertices[i];
+        order[i] = (VertexKey){v->x, v->y, v->z, i};
+    }
+    qsort(order, (size_t)nv, sizeof(VertexKey), cmpVertexKey);
+    for (int i = 0; i < nv; i++) {
+        if (i == 0 || cmpPosition(&order[i - 1], &order[i])) {
+            double *p = &s->pos[3 * s->vertexCount++];
+            p[0] = order[i].x;
+            p[1] = order[i].y;
+            p[2] = order[i].z;
+        }
+        remap[order[i].index] = s->vertexCount - 1;
+    }
+    free(order);
+
+    for (int i = 0; i < in->faceCount; i++) {
+        int idx[3] = {in->faces[i].v1 - 1, in->faces[i].v2 - 1,
+                      in->faces[i].v3 - 1};
+        int ok = 1;
+        for (int k = 0; k < 3; k++) {
+            ok = ok && idx[k] >= 0 && idx[k] < nv;
+            if (ok)
+                idx[k] = remap[idx[k]];
+        }
+        if (!ok || idx[0] == idx[1] || idx[1] == idx[2] || idx[0] == idx[2])
+            continue;
+        memcpy(&s->faces[3 * s->faceCount++], idx, sizeof(idx));
+    }
+    free(remap);
+    s->liveFaces = s->faceCount;
+
+    int n = s->vertexCount;
+    s->quadrics = (Quadric *)calloc((size_t)n, sizeof(Quadric));
+    s->stamp = (unsigned *)calloc((size_t)n, sizeof(unsigned));
+    s->alive = (uint8_t *)malloc((size_t)n);
+    s->faceAlive = (uint8_t *)malloc((size_t)s->faceCount + 1);
+    s->vertexFaces = (IntList *)calloc((size_t)n, sizeof(IntList));
+    s->mark = (int *)calloc((size_t)n, sizeof(int));
+    if (!s->quadrics || !s->stamp || !s->alive || !s->faceAlive ||
+        !s->vertexFaces || !s->mark)
+        return -1;
+    memset(s->alive, 1, (size_t)n);
+    memset(s->faceAlive, 1, (size_t)s->faceCount);
+    for (int i = 0; i < s->faceCount; i++)
+        for (int k = 0; k < 3; k++)
+            if (intListPush(&s->vertexFaces[s->faces[3 * i + k]], i) != 0)
+                return -1;
+    return 0;
+}
+
+// Face planes into the vertex quadrics, border planes for edges used
+// by one triangle, then every edge onto the heap.
+static int seedQuadrics(Simplifier *s) {
+    size_t edgeCount = (size_t)s->faceCount * 3;
+    EdgeRef *edges = (EdgeRef *)malloc(edgeCount * sizeof(EdgeRef));
+    if (!edges)
+        return -1;
+    for (int i = 0; i < s->faceCount; i++) {
+        const int *f = &s->faces[3 * i];
+        double n[3];
+        faceNormal(&s->pos[3 * f[0]], &s->pos[3 * f[1]], &s->pos[3 * f[2]],
+                   n);
+        double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 0.0) {
+            const double *p = &s->pos[3 * f[0]];
+            double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]) / len;
+            for (int k = 0; k < 3; k++)
+                quadricAddPlane(&s->quadrics[f[k]], n[0] / len, n[1] / len,
+                                n[2] / len, d, 1.0);
+        }
+        for (int k = 0; k < 3; k++) {
+            uint64_t a = (uint32_t)f[k], b = (uint32_t)f[(k + 1) % 3];
+            edges[3 * i + k].key = a < b ? (a << 32 | b) : (b << 32 | a);
+            edges[3 * i + k].face = i;
+        }
+    }
+    qsort(edges, edgeCount, sizeof(EdgeRef), cmpEdge);
+
+    int rc = 0;
+    for (size_t i = 0; i < edgeCount && rc == 0;) {
+        size_t j = i + 1;
+        while (j < edgeCount && edges[j].key == edges[i].key)
+            j++;
+        int a = (int)(edges[i].key >> 32);
+        int b = (int)(edges[i].key & 0xffffffffu);
+        if (j - i == 1) {
+            const int *f = &s->faces[3 * edges[i].face];
+            const double *pa = &s->pos[3 * a], *pb = &s->pos[3 * b];
+            double n[3], e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            faceNormal(&s->pos[3 * f[0]], &s->pos[3 * f[1]],
+                       &s->pos[3 * f[2]], n);
+            double m[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2],
+                           e[0] * n[1] - e[1] * n[0]};
+            double len = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+            if (len > 0.0) {
+                m[0] /= len;
+                m[1] /= len;
+                m[2] /= len;
+                double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                quadricAddPlane(&s->quadrics[a], m[0], m[1], m[2], d,
+                                BORDER_WEIGHT);
+                quadricAddPlane(&s->quadrics[b], m[0], m[1], m[2], d,
+                                BORDER_WEIGHT);
+            }
+        }
+        i = j;
+    }
+    // Second pass once every quadric is complete.
+    for (size_t i = 0; i < edgeCount && rc == 0; i++)
+        if (i == 0 || edges[i].key != edges[i - 1].key)
+            rc = pushCollapse(s, (int)(edges[i].key >> 32),
+                              (int)(edges[i].key & 0xffffffffu));
+    free(edges);
+    return rc;
+}
+
+// Compacts the surviving vertices and faces into a Model.
+static int exportModel(const Simplifier *s, Model *out) {
+    int *remap = (int *)malloc((size_t)s->vertexCount * sizeof(int));
+    out->vertices = (Vertex *)malloc((size_t)s->vertexCount * sizeof(Vertex));
+    out->faces = (Face *)malloc((size_t)s->liveFaces * sizeof(Face) + 1);
+    if (!remap || !out->vertices || !out->faces) {
+        free(remap);
+        return -1;
+    }
+    for (int i = 0; i < s->vertexCount; i++)
+        remap[i] = -1;
+    for (int i = 0; i < s->faceCount; i++) {
+        if (!s->faceAlive[i])
+            continue;
+        int idx[3];
+        for (int k = 0; k < 3; k++) {
+            int v = s->faces[3 * i + k];
+            if (remap[v] < 0) {
+                const double *p = &s->pos[3 * v];
+                Vertex *o = &out->vertices[out->vertexCount];
+                o->x = (float)p[0];
+                o->y = (float)p[1];
+                o->z = (float)p[2];
+                for (int j = 0; j < 3; j++) {
+                    float c = (&o->x)[j];
+                    if (out->vertexCount == 0 || c < out->boundsMin[j])
+                        out->boundsMin[j] = c;
+                    if (out->vertexCount == 0 || c > out->boundsMax[j])
+                        out->boundsMax[j] = c;
+                }
+                remap[v] = out->vertexCount++;
+            }
+            idx[k] = remap[v] + 1;
+        }
+        Face *f = &out->faces[out->faceCount++];
+        f->v1 = idx[0];
+        f->v2 = idx[1];
+        f->v3 = idx[2];
+    }
+    free(remap);
+    return 0;
+}
+
+int simplifyModel(const Model *in,
+                  float maxError,
+                  int targetFaces,
+                  Model *out,
+                  SimplifyReport *report) {
+    memset(out, 0, sizeof(*out));
+    if (report)
+        memset(report, 0, sizeof(*report));
+    if (!in || in->vertexCount <= 0 || in->faceCount <= 0)
+        return -1;
+
+    Simplifier s;
+    memset(&s, 0, sizeof(s));
+    if (buildSimplifier(in, &s) != 0 || seedQuadrics(&s) != 0) {
+        freeSimplifier(&s);
+        return -1;
+    }
+
+    double limit = maxError > 0.0f ? (double)maxError * maxError : DBL_MAX;
+    double worst = 0.0;
+    while (s.heap.count > 0 && s.liveFaces > targetFaces) {
+        Collapse c = heapPop(&s.heap);
+        if (!s.alive[c.u] || !s.alive[c.v] || s.stamp[c.u] != c.stampU ||
+            s.stamp[c.v] != c.stampV)
+            continue; // superseded by a later collapse
+        if (c.cost > limit)
+            break;
+        if (!collapseIsValid(&s, c.u, c.v, c.pos))
+            continue;
+        if (collapseEdge(&s, c.u, c.v, c.pos) != 0) {
+            freeSimplifier(&s);
+            return -1;
+        }
+        if (c.cost > worst)
+            worst = c.cost;
+    }
+
+    int inputFaces = s.faceCount;
+    int rc = exportModel(&s, out);
+    freeSimplifier(&s);
+    if (rc != 0) {
+        freeModel(out);
+        return -1;
+    }
+    if (report) {
+        report->inputFaces = inputFaces;
+        report->faceCount = out->faceCount;
+        report->vertexCount = out->vertexCount;
+        report->maxError = (float)sqrt(worst);
+    }
+    return 0;
+}
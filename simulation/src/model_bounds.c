@@ -5,143 +5,6 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-
-CollisionGrid buildCollisionGrid(GPUTriangle *tris,
-                                 int numTris,
-                                 float bminX,
-                                 float bminY,
-                                 float bminZ,
-                                 float bmaxX,
-                                 float bmaxY,
-                                 float bmaxZ) {
-    CollisionGrid g = {0};
-    int R = COLL_GRID_RES;
-    g.totalCells = R * R * R;
-
-    // Expand AABB slightly so particles near the surface still map
-    // into a valid cell.
-    float pad = 0.05f;
-    g.minX = bminX - pad;
-    g.minY = bminY - pad;
-    g.minZ = bminZ - pad;
-    float gMaxX = bmaxX + pad;
-    float gMaxY = bmaxY + pad;
-    float gMaxZ = bmaxZ + pad;
-    g.cellSizeX = (gMaxX - g.minX) / R;
-    g.cellSizeY = (gMaxY - g.minY) / R;
-    g.cellSizeZ = (gMaxZ - g.minZ) / R;
-
-    // First pass: count how many cells each triangle overlaps
-    g.cellCount = (int *)calloc(g.totalCells, sizeof(int));
-    int *tmpCount = (int *)calloc(g.totalCells, sizeof(int));
-    if (!g.cellCount || !tmpCount) {
-        free(g.cellCount);
-        free(tmpCount);
-        memset(&g, 0, sizeof(g));
-        return g;
-    }
-
-    for (int t = 0; t < numTris; t++) {
-        float txMin = fminf(tris[t].v0x, fminf(tris[t].v1x, tris[t].v2x));
-        float txMax = fmaxf(tris[t].v0x, fmaxf(tris[t].v1x, tris[t].v2x));
-        float tyMin = fminf(tris[t].v0y, fminf(tris[t].v1y, tris[t].v2y));
-        float tyMax = fmaxf(tris[t].v0y, fmaxf(tris[t].v1y, tris[t].v2y));
-        float tzMin = fminf(tris[t].v0z, fminf(tris[t].v1z, tris[t].v2z));
-        float tzMax = fmaxf(tris[t].v0z, fmaxf(tris[t].v1z, tris[t].v2z));
-
-        int x0 = (int)floorf((txMin - g.minX) / g.cellSizeX);
-        int x1 = (int)floorf((txMax - g.minX) / g.cellSizeX);
-        int y0 = (int)floorf((tyMin - g.minY) / g.cellSizeY);
-        int y1 = (int)floorf((tyMax - g.minY) / g.cellSizeY);
-        int z0 = (int)floorf((tzMin - g.minZ) / g.cellSizeZ);
-        int z1 = (int)floorf((tzMax - g.minZ) / g.cellSizeZ);
-
-        if (x0 < 0)
-            x0 = 0;
-        if (x1 >= R)
-            x1 = R - 1;
-        if (y0 < 0)
-            y0 = 0;
-        if (y1 >= R)
-            y1 = R - 1;
-        if (z0 < 0)
-            z0 = 0;
-        if (z1 >= R)
-            z1 = R - 1;
-
-        for (int cz = z0; cz <= z1; cz++)
-            for (int cy = y0; cy <= y1; cy++)
-                for (int cx = x0; cx <= x1; cx++) {
-                    int idx = cx + cy * R + cz * R * R;
-                    g.cellCount[idx]++;
-                    g.totalIndices++;
-                }
-    }
-
-    // Prefix sum to get cellStart
-    g.cellStart = (int *)malloc(g.totalCells * sizeof(int));
-    if (!g.cellStart) {
-        free(g.cellCount);
-        free(tmpCount);
-        memset(&g, 0, sizeof(g));
-        return g;
-    }
-    g.cellStart[0] = 0;
-    for (int i = 1; i < g.totalCells; i++)
-        g.cellStart[i] = g.cellStart[i - 1] + g.cellCount[i - 1];
-
-    // Second pass: fill triIndices
-    g.triIndices = (int *)malloc(g.totalIndices * sizeof(int));
-    if (!g.triIndices) {
-        free(g.cellStart);
-        free(g.cellCount);
-        free(tmpCount);
-        memset(&g, 0, sizeof(g));
-        return g;
-    }
-
-    for (int t = 0; t < numTris; t++) {
-        float txMin = fminf(tris[t].v0x, fminf(tris[t].v1x, tris[t].v2x));
-        float txMax = fmaxf(tris[t].v0x, fmaxf(tris[t].v1x, tris[t].v2x));
-        float tyMin = fminf(tris[t].v0y, fminf(tris[t].v1y, tris[t].v2y));
-        float tyMax = fmaxf(tris[t].v0y, fmaxf(tris[t].v1y, tris[t].v2y));
-        float tzMin = fminf(tris[t].v0z, fminf(tris[t].v1z, tris[t].v2z));
-        float tzMax = fmaxf(tris[t].v0z, fmaxf(tris[t].v1z, tris[t].v2z));
-
-        int x0 = (int)floorf((txMin - g.minX) / g.cellSizeX);
-        int x1 = (int)floorf((txMax - g.minX) / g.cellSizeX);
-        int y0 = (int)floorf((tyMin - g.minY) / g.cellSizeY);
-        int y1 = (int)floorf((tyMax - g.minY) / g.cellSizeY);
-        int z0 = (int)floorf((tzMin - g.minZ) / g.cellSizeZ);
-        int z1 = (int)floorf((tzMax - g.minZ) / g.cellSizeZ);
-
-        if (x0 < 0)
-            x0 = 0;
-        if (x1 >= R)
-            x1 = R - 1;
-        if (y0 < 0)
-            y0 = 0;
-        if (y1 >= R)
-            y1 = R - 1;
-        if (z0 < 0)
-            z0 = 0;
-        if (z1 >= R)
-            z1 = R - 1;
-
-        for (int cz = z0; cz <= z1; cz++)
-            for (int cy = y0; cy <= y1; cy++)
-                for (int cx = x0; cx <= x1; cx++) {
-                    int idx = cx + cy * R + cz * R * R;
-                    int pos = g.cellStart[idx] + tmpCount[idx];
-                    g.triIndices[pos] = t;
-                    tmpCount[idx]++;
-                }
-    }
-
-    free(tmpCount);
-    return g;
-}
 
 CarBounds computeModelBounds(Model *model,
                              float scale,
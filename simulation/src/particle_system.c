@@ -1,26 +1,219 @@
 #include "../lib/particle_system.h"
 #include "../lib/fluid_cube.h"
 #include "../lib/config.h"
+#include "../lib/rng.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
-#ifdef __AVX__
+// The AVX2 update is compiled with a target attribute and picked at run
+// time, so it is available without building the whole program for AVX2.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PARTICLE_AVX2 1
 #include <immintrin.h>
 #endif
 
+// Particles handed to each OpenMP task by the update loop
+#define PARTICLE_CHUNK 4096
+
+// Random draws are numbered (particle, step, event), so the stream does
+// not depend on thread count or scheduling.
+enum { RNG_EVENT_RESPAWN = 0, RNG_EVENT_COLLISION = 1 };
+
+static void particle_random(const ParticleSystem *system,
+                            int i,
+                            uint32_t event,
+                            float u[4]) {
+    const uint32_t counter[4] = {(uint32_t)i, system->step, event, 0};
+    uint32_t bits[4];
+    Rng_Philox4x32(counter, system->rngKey, bits);
+    for (int k = 0; k < 4; k++) {
+        u[k] = Rng_Uniform(bits[k]);
+    }
+}
+
 // Initialize the particle system
-void ParticleSystem_Init(ParticleSystem *system) {
+int ParticleSystem_Init(ParticleSystem *system, int capacity) {
+    if (capacity <= 0)
+        capacity = MAX_PARTICLES;
+#ifdef _OPENMP
+    int binThreads = omp_get_max_threads();
+#else
+    int binThreads = 1;
+#endif
+
+    // One block for the seven float arrays
+    float *block = (float *)malloc((size_t)7 * capacity * sizeof(float));
+    int *cellStart = (int *)malloc((PARTICLE_GRID_CELLS + 1) * sizeof(int));
+    int *order = (int *)malloc((size_t)capacity * sizeof(int));
+    int *cellOf = (int *)malloc((size_t)capacity * sizeof(int));
+    int *binCounts = (int *)malloc((size_t)binThreads *
+                                   PARTICLE_GRID_CELLS * sizeof(int));
+    if (!block || !cellStart || !order || !cellOf || !binCounts) {
+        free(block);
+        free(cellStart);
+        free(order);
+        free(cellOf);
+        free(binCounts);
+        system->x = NULL;
+        system->cellStart = system->order = NULL;
+        system->cellOf = system->binCounts = NULL;
+        system->numParticles = system->capacity = 0;
+        return -1;
+    }
+
+    system->x = block;
+    system->y = block + (size_t)capacity;
+    system->z = block + (size_t)2 * capacity;
+    system->vx = block + (size_t)3 * capacity;
+    system->vy = block + (size_t)4 * capacity;
+    system->vz = block + (size_t)5 * capacity;
+    system->life = block + (size_t)6 * capacity;
     system->numParticles = 0;
-    for (int i = 0; i < GRID_CELL_SIZE; i++) {
-        for (int j = 0; j < GRID_CELL_SIZE; j++) {
-            system->grid[i][j].count = 0;
+    system->capacity = capacity;
+    system->cellStart = cellStart;
+    system->order = order;
+    system->cellOf = cellOf;
+    system->binCounts = binCounts;
+    system->binThreads = binThreads;
+    system->simd = 1;
+    ParticleSystem_Seed(system, 0);
+    ParticleSystem_BuildBins(system);
+    return 0;
+}
+
+void ParticleSystem_Free(ParticleSystem *system) {
+    free(system->x);
+    free(system->cellStart);
+    free(system->order);
+    free(system->cellOf);
+    free(system->binCounts);
+    system->x = system->y = system->z = NULL;
+    system->vx = system->vy = system->vz = NULL;
+    system->life = NULL;
+    system->cellStart = system->order = NULL;
+    system->cellOf = system->binCounts = NULL;
+    system->numParticles = system->capacity = 0;
+    system->binsValid = 0;
+}
+
+void ParticleSystem_Seed(ParticleSystem *system, uint64_t seed) {
+    system->rngKey[0] = (uint32_t)seed;
+    system->rngKey[1] = (uint32_t)(seed >> 32);
+    system->step = 0;
+}
+
+static int grid_coord(float v, float lo, int n) {
+    float f = (v - lo) * (1.0f / PARTICLE_GRID_CELL);
+    if (!(f >= 0.0f)) // also catches NaN
+        return 0;
+    return f < (float)(n - 1) ? (int)f : n - 1;
+}
+
+int ParticleSystem_CellIndex(float x, float y, float z) {
+    int cx = grid_coord(x, PARTICLE_GRID_MIN_X, PARTICLE_GRID_X);
+    int cy = grid_coord(y, PARTICLE_GRID_MIN_Y, PARTICLE_GRID_Y);
+    int cz = grid_coord(z, PARTICLE_GRID_MIN_Z, PARTICLE_GRID_Z);
+    return cx + PARTICLE_GRID_X * (cy + PARTICLE_GRID_Y * cz);
+}
+
+// Counting sort over the cells. Each thread histograms a contiguous
+// slice of the particles, the per-thread counts are scanned cell-major
+// into write offsets, then each thread scatters its slice. Slices are in
+// index order, so the result is stable and does not depend on the
+// thread count.
+void ParticleSystem_BuildBins(ParticleSystem *system) {
+    int n = system->numParticles;
+    int *cellOf = system->cellOf;
+    int *order = system->order;
+    int *counts = system->binCounts;
+    int threads = system->binThreads;
+    int *cellStart = system->cellStart;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads)
+#endif
+    {
+#ifdef _OPENMP
+        int t = omp_get_thread_num();
+        int team = omp_get_num_threads();
+#else
+        int t = 0, team = 1;
+#endif
+        // Threads missing from a smaller team leave empty slices
+        for (int u = t; u < threads; u += team) {
+            int *hist = counts + (size_t)u * PARTICLE_GRID_CELLS;
+            int begin = (int)((long long)n * u / threads);
+            int end = (int)((long long)n * (u + 1) / threads);
+            memset(hist, 0, PARTICLE_GRID_CELLS * sizeof(int));
+            for (int i = begin; i < end; i++) {
+                int c = ParticleSystem_CellIndex(
+                    system->x[i], system->y[i], system->z[i]);
+                cellOf[i] = c;
+                hist[c]++;
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            int offset = 0;
+            for (int c = 0; c < PARTICLE_GRID_CELLS; c++) {
+                cellStart[c] = offset;
+                for (int u = 0; u < threads; u++) {
+                    int *slot = counts + (size_t)u * PARTICLE_GRID_CELLS + c;
+                    int count = *slot;
+                    *slot = offset;
+                    offset += count;
+                }
+            }
+            cellStart[PARTICLE_GRID_CELLS] = offset;
+        }
+
+        for (int u = t; u < threads; u += team) {
+            int *next = counts + (size_t)u * PARTICLE_GRID_CELLS;
+            int begin = (int)((long long)n * u / threads);
+            int end = (int)((long long)n * (u + 1) / threads);
+            for (int i = begin; i < end; i++) {
+                order[next[cellOf[i]]++] = i;
+            }
         }
     }
+    system->binsValid = 1;
+}
+
+static void permute(float *values, const int *order, int n, float *scratch) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < n; k++) {
+        scratch[k] = values[order[k]];
+    }
+    memcpy(values, scratch, (size_t)n * sizeof(float));
+}
+
+int ParticleSystem_SortByCell(ParticleSystem *system) {
+    int n = system->numParticles;
+    float *scratch = (float *)malloc((size_t)(n > 0 ? n : 1) * sizeof(float));
+    if (!scratch)
+        return -1;
+    if (!system->binsValid)
+        ParticleSystem_BuildBins(system);
+    float *arrays[7] = {system->x,  system->y,  system->z,   system->vx,
+                        system->vy, system->vz, system->life};
+    for (int a = 0; a < 7; a++) {
+        permute(arrays[a], system->order, n, scratch);
+    }
+    free(scratch);
+    ParticleSystem_BuildBins(system);
+    return 0;
 }
 
 // Add a particle to the system
@@ -31,27 +224,16 @@ void ParticleSystem_AddParticle(ParticleSystem *system,
                                 float vx,
                                 float vy,
                                 float vz) {
-    if (system->numParticles < MAX_PARTICLES) {
-        Particle *p = &system->particles[system->numParticles++];
-        p->x = x;
-        p->y = y;
-        p->z = z;
-        p->padding1 = 0.0f;
-        p->vx = vx;
-        p->vy = vy;
-        p->vz = vz;
-        p->life = 1.0f;
-
-        // Add particle to the grid
-        int gridX = (int)(x / GRID_CELL_SIZE);
-        int gridY = (int)(y / GRID_CELL_SIZE);
-        if (gridX >= 0 && gridX < GRID_CELL_SIZE && gridY >= 0 &&
-            gridY < GRID_CELL_SIZE) {
-            GridCell *cell = &system->grid[gridX][gridY];
-            if (cell->count < MAX_PARTICLES / GRID_CELL_SIZE) {
-                cell->particles[cell->count++] = *p;
-            }
-        }
+    if (system->numParticles < system->capacity) {
+        int i = system->numParticles++;
+        system->x[i] = x;
+        system->y[i] = y;
+        system->z[i] = z;
+        system->vx[i] = vx;
+        system->vy[i] = vy;
+        system->vz[i] = vz;
+        system->life[i] = 1.0f;
+        system->binsValid = 0;
     }
 }
 
@@ -64,15 +246,17 @@ int ParticleSystem_CheckCollision(float x,
             y <= bounds->maxY && z >= bounds->minZ && z <= bounds->maxZ);
 }
 
-// Resolve collision - push particle out and reflect velocity
-void ParticleSystem_ResolveCollision(Particle *p, CollisionBounds *bounds) {
+// Resolve collision - push particle i out and reflect its velocity
+void ParticleSystem_ResolveCollision(ParticleSystem *system,
+                                     int i,
+                                     CollisionBounds *bounds) {
     float halfSizeX = (bounds->maxX - bounds->minX) * 0.5f;
     float halfSizeY = (bounds->maxY - bounds->minY) * 0.5f;
     float halfSizeZ = (bounds->maxZ - bounds->minZ) * 0.5f;
 
-    float toParticleX = p->x - bounds->centerX;
-    float toParticleY = p->y - bounds->centerY;
-    float toParticleZ = p->z - bounds->centerZ;
+    float toParticleX = system->x[i] - bounds->centerX;
+    float toParticleY = system->y[i] - bounds->centerY;
+    float toParticleZ = system->z[i] - bounds->centerZ;
 
     // Find penetration depth for each axis
     float penX = halfSizeX - fabsf(toParticleX);
@@ -84,103 +268,203 @@ void ParticleSystem_ResolveCollision(Particle *p, CollisionBounds *bounds) {
 
     if (penX < penY && penX < penZ) {
         normalX = (toParticleX > 0) ? 1.0f : -1.0f;
-        p->x = bounds->centerX + normalX * (halfSizeX + 0.01f);
+        system->x[i] = bounds->centerX + normalX * (halfSizeX + 0.01f);
     } else if (penY < penZ) {
         normalY = (toParticleY > 0) ? 1.0f : -1.0f;
-        p->y = bounds->centerY + normalY * (halfSizeY + 0.01f);
+        system->y[i] = bounds->centerY + normalY * (halfSizeY + 0.01f);
     } else {
         normalZ = (toParticleZ > 0) ? 1.0f : -1.0f;
-        p->z = bounds->centerZ + normalZ * (halfSizeZ + 0.01f);
+        system->z[i] = bounds->centerZ + normalZ * (halfSizeZ + 0.01f);
     }
 
     // Reflect velocity with energy loss
     float restitution = 0.3f;
-    float velDotNormal = p->vx * normalX + p->vy * normalY + p->vz * normalZ;
+    float velDotNormal = system->vx[i] * normalX + system->vy[i] * normalY +
+                         system->vz[i] * normalZ;
 
     if (velDotNormal < 0.0f) {
-        p->vx -= (1.0f + restitution) * velDotNormal * normalX;
-        p->vy -= (1.0f + restitution) * velDotNormal * normalY;
-        p->vz -= (1.0f + restitution) * velDotNormal * normalZ;
+        system->vx[i] -= (1.0f + restitution) * velDotNormal * normalX;
+        system->vy[i] -= (1.0f + restitution) * velDotNormal * normalY;
+        system->vz[i] -= (1.0f + restitution) * velDotNormal * normalZ;
 
         // Add turbulence
-        p->vy += ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
-        p->vz += ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
+        float u[4];
+        particle_random(system, i, RNG_EVENT_COLLISION, u);
+        system->vy[i] += (u[0] - 0.5f) * 0.1f;
+        system->vz[i] += (u[1] - 0.5f) * 0.1f;
     }
 }
 
-// Update with collision detection (CPU fallback)
-void ParticleSystem_UpdateWithCollision(ParticleSystem *system,
-                                        FluidCube *fluid,
-                                        float dt,
-                                        CollisionBounds *bounds) {
-    int sizeX = fluid->sizeX;
-    int sizeY = fluid->sizeY;
-    int sizeZ = fluid->sizeZ;
-
-    // Clear the grid
-    for (int i = 0; i < GRID_CELL_SIZE; i++) {
-        for (int j = 0; j < GRID_CELL_SIZE; j++) {
-            system->grid[i][j].count = 0;
-        }
+// Reset an expired particle at the tunnel inlet (wind tunnel style)
+static void respawn(ParticleSystem *system, int i) {
+    float u[4];
+    particle_random(system, i, RNG_EVENT_RESPAWN, u);
+    system->x[i] = -4.0f - u[0] * 0.5f; // Randomize start X slightly
+    system->y[i] = (u[1] - 0.5f) * 3.0f;
+    system->z[i] = (u[2] - 0.5f) * 3.0f;
+    system->vx[i] = 0.5f + u[3] * 0.2f;
+    system->vy[i] = 0.0f;
+    system->vz[i] = 0.0f;
+    system->life[i] = 1.0f;
+}
+
+// One particle: integrate, collide, age, respawn, clamp to the walls
+static void
+update_one(ParticleSystem *system, int i, float dt, CollisionBounds *bounds) {
+    system->x[i] += system->vx[i] * dt;
+    system->y[i] += system->vy[i] * dt;
+    system->z[i] += system->vz[i] * dt;
+
+    if (bounds && ParticleSystem_CheckCollision(
+                      system->x[i], system->y[i], system->z[i], bounds)) {
+        ParticleSystem_ResolveCollision(system, i, bounds);
     }
 
-// Update particles
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (int i = 0; i < system->numParticles; i++) {
-        Particle *p = &system->particles[i];
+    system->life[i] -= 0.01f * dt;
 
-        // Update position
-        p->x += p->vx * dt;
-        p->y += p->vy * dt;
-        p->z += p->vz * dt;
+    if (system->life[i] <= 0.0f || system->x[i] > 4.0f) {
+        respawn(system, i);
+    }
 
-        // Check collision with car bounds
-        if (bounds && ParticleSystem_CheckCollision(p->x, p->y, p->z, bounds)) {
-            ParticleSystem_ResolveCollision(p, bounds);
-        }
+    // Boundary constraints with epsilon pushback
+    if (system->y[i] < -2.0f || system->y[i] > 2.0f) {
+        system->vy[i] *= -0.5f;
+        system->y[i] = (system->y[i] < -2.0f) ? -1.99f : 1.99f;
+    }
+    if (system->z[i] < -2.0f || system->z[i] > 2.0f) {
+        system->vz[i] *= -0.5f;
+        system->z[i] = (system->z[i] < -2.0f) ? -1.99f : 1.99f;
+    }
+}
 
-        // Decrease lifetime
-        p->life -= 0.01f * dt;
-
-        // Reset expired particles (wind tunnel style)
-        if (p->life <= 0.0f || p->x > 4.0f) {
-            p->x = -4.0f - ((float)rand() / RAND_MAX *
-                            0.5f); // Randomize start X slightly
-            p->y = ((float)rand() / RAND_MAX - 0.5f) * 3.0f;
-            p->z = ((float)rand() / RAND_MAX - 0.5f) * 3.0f;
-            p->vx = 0.5f + ((float)rand() / RAND_MAX) * 0.2f;
-            p->vy = 0.0f;
-            p->vz = 0.0f;
-            p->life = 1.0f;
-        }
+static void update_range_scalar(ParticleSystem *system,
+                                int begin,
+                                int end,
+                                float dt,
+                                CollisionBounds *bounds) {
+    for (int i = begin; i < end; i++) {
+        update_one(system, i, dt, bounds);
+    }
+}
+
+#ifdef PARTICLE_AVX2
+// Reflect lanes that left [-2, 2] back inside with half their velocity,
+// as update_one does.
+__attribute__((target("avx2"))) static inline void
+wall_avx2(float *pos, float *vel) {
+    const __m256 lo = _mm256_set1_ps(-2.0f), hi = _mm256_set1_ps(2.0f);
+    __m256 p = _mm256_loadu_ps(pos);
+    __m256 v = _mm256_loadu_ps(vel);
+    __m256 below = _mm256_cmp_ps(p, lo, _CMP_LT_OQ);
+    __m256 out = _mm256_or_ps(below, _mm256_cmp_ps(p, hi, _CMP_GT_OQ));
+    __m256 pushed = _mm256_blendv_ps(
+        _mm256_set1_ps(1.99f), _mm256_set1_ps(-1.99f), below);
+    v = _mm256_blendv_ps(v, _mm256_mul_ps(v, _mm256_set1_ps(-0.5f)), out);
+    _mm256_storeu_ps(pos, _mm256_blendv_ps(p, pushed, out));
+    _mm256_storeu_ps(vel, v);
+}
 
-        // Boundary constraints with epsilon pushback
-        if (p->y < -2.0f || p->y > 2.0f) {
-            p->vy *= -0.5f;
-            p->y = (p->y < -2.0f) ? -1.99f : 1.99f;
+// Eight particles per iteration. Integration, ageing and the walls are
+// done in registers; the lanes that hit the car or expire are handed to
+// the scalar collision and respawn code between those stages, so the
+// result matches update_one exactly.
+__attribute__((target("avx2"))) static void
+update_range_avx2(ParticleSystem *system,
+                  int begin,
+                  int end,
+                  float dt,
+                  CollisionBounds *bounds) {
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 decay = _mm256_set1_ps(0.01f * dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 outlet = _mm256_set1_ps(4.0f);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_add_ps(
+            _mm256_loadu_ps(system->x + i),
+            _mm256_mul_ps(_mm256_loadu_ps(system->vx + i), step));
+        __m256 y = _mm256_add_ps(
+            _mm256_loadu_ps(system->y + i),
+            _mm256_mul_ps(_mm256_loadu_ps(system->vy + i), step));
+        __m256 z = _mm256_add_ps(
+            _mm256_loadu_ps(system->z + i),
+            _mm256_mul_ps(_mm256_loadu_ps(system->vz + i), step));
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(system->life + i), decay);
+        _mm256_storeu_ps(system->x + i, x);
+        _mm256_storeu_ps(system->y + i, y);
+        _mm256_storeu_ps(system->z + i, z);
+        _mm256_storeu_ps(system->life + i, life);
+
+        if (bounds) {
+            __m256 in = _mm256_and_ps(
+                _mm256_cmp_ps(x, _mm256_set1_ps(bounds->minX), _CMP_GE_OQ),
+                _mm256_cmp_ps(x, _mm256_set1_ps(bounds->maxX), _CMP_LE_OQ));
+            in = _mm256_and_ps(
+                in,
+                _mm256_cmp_ps(y, _mm256_set1_ps(bounds->minY), _CMP_GE_OQ));
+            in = _mm256_and_ps(
+                in,
+                _mm256_cmp_ps(y, _mm256_set1_ps(bounds->maxY), _CMP_LE_OQ));
+            in = _mm256_and_ps(
+                in,
+                _mm256_cmp_ps(z, _mm256_set1_ps(bounds->minZ), _CMP_GE_OQ));
+            in = _mm256_and_ps(
+                in,
+                _mm256_cmp_ps(z, _mm256_set1_ps(bounds->maxZ), _CMP_LE_OQ));
+            int hit = _mm256_movemask_ps(in);
+            if (hit) {
+                for (; hit; hit &= hit - 1) {
+                    ParticleSystem_ResolveCollision(
+                        system, i + __builtin_ctz(hit), bounds);
+                }
+                x = _mm256_loadu_ps(system->x + i);
+            }
         }
-        if (p->z < -2.0f || p->z > 2.0f) {
-            p->vz *= -0.5f;
-            p->z = (p->z < -2.0f) ? -1.99f : 1.99f;
+
+        int expired = _mm256_movemask_ps(
+            _mm256_or_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ),
+                         _mm256_cmp_ps(x, outlet, _CMP_GT_OQ)));
+        for (; expired; expired &= expired - 1) {
+            respawn(system, i + __builtin_ctz(expired));
         }
+
+        wall_avx2(system->y + i, system->vy + i);
+        wall_avx2(system->z + i, system->vz + i);
     }
+    update_range_scalar(system, i, end, dt, bounds);
+}
+#endif
 
-    // Reinsert particles into grid
-    for (int i = 0; i < system->numParticles; i++) {
-        Particle *p = &system->particles[i];
-        int gridX = (int)((p->x + 4.0f) / 8.0f * GRID_CELL_SIZE);
-        int gridY = (int)((p->y + 2.0f) / 4.0f * GRID_CELL_SIZE);
+// Update with collision detection (CPU fallback)
+void ParticleSystem_UpdateWithCollision(ParticleSystem *system,
+                                        FluidCube *fluid,
+                                        float dt,
+                                        CollisionBounds *bounds) {
+    (void)fluid;
+    int n = system->numParticles;
+    int chunks = (n + PARTICLE_CHUNK - 1) / PARTICLE_CHUNK;
+#ifdef PARTICLE_AVX2
+    int simd = system->simd && __builtin_cpu_supports("avx2");
+#endif
 
-        if (gridX >= 0 && gridX < GRID_CELL_SIZE && gridY >= 0 &&
-            gridY < GRID_CELL_SIZE) {
-            GridCell *cell = &system->grid[gridX][gridY];
-            if (cell->count < MAX_PARTICLES / GRID_CELL_SIZE) {
-                cell->particles[cell->count++] = *p;
-            }
+// Update particles
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int c = 0; c < chunks; c++) {
+        int begin = c * PARTICLE_CHUNK;
+        int end = begin + PARTICLE_CHUNK < n ? begin + PARTICLE_CHUNK : n;
+#ifdef PARTICLE_AVX2
+        if (simd) {
+            update_range_avx2(system, begin, end, dt, bounds);
+            continue;
         }
+#endif
+        update_range_scalar(system, begin, end, dt, bounds);
     }
+
+    system->step++;
+    ParticleSystem_BuildBins(system);
 }
 
 void ParticleSystem_Update(ParticleSystem *system, FluidCube *fluid, float dt) {
@@ -194,29 +478,29 @@ void ParticleSystem_Render(ParticleSystem *system,
     // Set particle color with alpha blending
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
-    for (int i = 0; i < GRID_CELL_SIZE; i++) {
-        for (int j = 0; j < GRID_CELL_SIZE; j++) {
-            GridCell *cell = &system->grid[i][j];
-            for (int k = 0; k < cell->count; k++) {
-                Particle *p = &cell->particles[k];
+    if (!system->binsValid)
+        ParticleSystem_BuildBins(system);
 
-                // Calculate distance from the camera (simplified to 2D for now)
-                float distance = sqrt(p->x * p->x + p->y * p->y);
+    // Walk the particles cell by cell
+    for (int k = 0; k < system->numParticles; k++) {
+        int p = system->order[k];
+        float x = system->x[p], y = system->y[p];
 
-                // Skip particles that are far away (LOD)
-                if (distance > 200)
-                    continue;
+        // Calculate distance from the camera (simplified to 2D for now)
+        float distance = sqrtf(x * x + y * y);
 
-                // Map particle position to screen coordinates
-                int screenX = (int)(p->x * scale);
-                int screenY = (int)(p->y * scale);
+        // Skip particles that are far away (LOD)
+        if (distance > 200)
+            continue;
 
-                // Draw particle as a small rectangle (2x2 pixels)
-                SDL_Rect rect = {screenX, screenY, 2, 2};
-                Uint8 alpha = (Uint8)(p->life * 255);
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
-                SDL_RenderFillRect(renderer, &rect);
-            }
-        }
+        // Map particle position to screen coordinates
+        int screenX = (int)(x * scale);
+        int screenY = (int)(y * scale);
+
+        // Draw particle as a small rectangle (2x2 pixels)
+        SDL_Rect rect = {screenX, screenY, 2, 2};
+        Uint8 alpha = (Uint8)(system->life[p] * 255);
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
+        SDL_RenderFillRect(renderer, &rect);
     }
-}
\ No newline at end of file
+}
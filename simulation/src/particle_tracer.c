@@ -0,0 +1,194 @@
+#include "../lib/particle_tracer.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Particles handed to each OpenMP task
+#define TRACER_CHUNK 1024
+
+int ParticleTracer_Init(ParticleTracer *tracer, int capacity) {
+    if (capacity < 1)
+        capacity = 1;
+    size_t n = (size_t)capacity;
+    // One block for the seven float arrays
+    float *block = (float *)malloc(7 * n * sizeof(float));
+    unsigned char *state = (unsigned char *)malloc(n);
+    int *triangle = (int *)malloc(n * sizeof(int));
+    if (!block || !state || !triangle) {
+        free(block);
+        free(state);
+        free(triangle);
+        tracer->x = NULL;
+        tracer->state = NULL;
+        tracer->triangle = NULL;
+        tracer->count = tracer->capacity = 0;
+        return -1;
+    }
+    tracer->x = block;
+    tracer->y = block + n;
+    tracer->z = block + 2 * n;
+    tracer->vx = block + 3 * n;
+    tracer->vy = block + 4 * n;
+    tracer->vz = block + 5 * n;
+    tracer->time = block + 6 * n;
+    tracer->state = state;
+    tracer->triangle = triangle;
+    tracer->count = 0;
+    tracer->capacity = capacity;
+    return 0;
+}
+
+void ParticleTracer_Free(ParticleTracer *tracer) {
+    free(tracer->x);
+    free(tracer->state);
+    free(tracer->triangle);
+    tracer->x = tracer->y = tracer->z = NULL;
+    tracer->vx = tracer->vy = tracer->vz = NULL;
+    tracer->time = NULL;
+    tracer->state = NULL;
+    tracer->triangle = NULL;
+    tracer->count = tracer->capacity = 0;
+}
+
+int ParticleTracer_Add(ParticleTracer *tracer,
+                       float x,
+                       float y,
+                       float z,
+                       float vx,
+                       float vy,
+                       float vz) {
+    if (tracer->count >= tracer->capacity)
+        return -1;
+    int i = tracer->count++;
+    tracer->x[i] = x;
+    tracer->y[i] = y;
+    tracer->z[i] = z;
+    tracer->vx[i] = vx;
+    tracer->vy[i] = vy;
+    tracer->vz[i] = vz;
+    tracer->time[i] = 0.0f;
+    tracer->state[i] = TRACER_ACTIVE;
+    tracer->triangle[i] = -1;
+    return i;
+}
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void ParticleTracer_SampleVelocity(const TracerField *field,
+                                   float x,
+                                   float y,
+                                   float z,
+                                   float out[3]) {
+    int nx = field->sizeX, ny = field->sizeY, nz = field->sizeZ;
+
+    // worldToGrid, clamped to [0.5, size - 1.5]
+    float gx = clampf((x + 4.0f) / 8.0f * nx, 0.5f, nx - 1.5f);
+    float gy = clampf((y + 2.0f) / 4.0f * ny, 0.5f, ny - 1.5f);
+    float gz = clampf((z + 2.0f) / 4.0f * nz, 0.5f, nz - 1.5f);
+
+    int i0 = (int)gx, j0 = (int)gy, k0 = (int)gz;
+    float fx = gx - i0, fy = gy - j0, fz = gz - k0;
+    size_t sx = 4, sy = (size_t)4 * nx, sz = (size_t)4 * nx * ny;
+    const float *c = field->velocity + i0 * sx + j0 * sy + k0 * sz;
+
+    for (int a = 0; a < 3; a++) {
+        float v00 = c[a] + fx * (c[sx + a] - c[a]);
+        float v10 = c[sy + a] + fx * (c[sy + sx + a] - c[sy + a]);
+        float v01 = c[sz + a] + fx * (c[sz + sx + a] - c[sz + a]);
+        float v11 =
+            c[sz + sy + a] + fx * (c[sz + sy + sx + a] - c[sz + sy + a]);
+        float v0 = v00 + fy * (v10 - v00);
+        float v1 = v01 + fy * (v11 - v01);
+        out[a] = (v0 + fz * (v1 - v0)) * field->velocityScale;
+    }
+}
+
+static void step_one(ParticleTracer *tr,
+                     int i,
+                     const TracerField *field,
+                     const TracerBody *body,
+                     const TracerParams *params) {
+    float flow[3];
+    ParticleTracer_SampleVelocity(field, tr->x[i], tr->y[i], tr->z[i], flow);
+
+    // Relax towards the flow, then move
+    float r = params->relaxation, dt = params->dt;
+    float v[3] = {tr->vx[i] + r * (flow[0] - tr->vx[i]),
+                  tr->vy[i] + r * (flow[1] - tr->vy[i]),
+                  tr->vz[i] + r * (flow[2] - tr->vz[i])};
+    float p[3] = {tr->x[i] + v[0] * dt, tr->y[i] + v[1] * dt,
+                  tr->z[i] + v[2] * dt};
+    tr->time[i] += dt;
+
+    if (body && body->bvh && body->numTriangles > 0) {
+        float closest[3], normal[3];
+        int hit = queryCollisionBVH(body->bvh, body->triangles, p,
+                                    body->radius, closest, normal);
+        if (hit >= 0 && body->deposit) {
+            tr->state[i] = TRACER_DEPOSITED;
+            tr->triangle[i] = hit;
+            for (int k = 0; k < 3; k++) {
+                p[k] = closest[k];
+                v[k] = 0.0f;
+            }
+        } else if (hit >= 0) {
+            float vdn = v[0] * normal[0] + v[1] * normal[1] + v[2] * normal[2];
+            for (int k = 0; k < 3; k++) {
+                p[k] = closest[k] + normal[k] * (body->radius + 0.001f);
+                if (vdn < 0.0f)
+                    v[k] -= 1.05f * vdn * normal[k];
+            }
+        }
+    }
+
+    if (tr->state[i] == TRACER_ACTIVE &&
+        (p[0] > params->exitX || p[0] < -4.0f || fabsf(p[1]) > 2.0f ||
+         fabsf(p[2]) > 2.0f))
+        tr->state[i] = TRACER_EXITED;
+
+    tr->x[i] = p[0];
+    tr->y[i] = p[1];
+    tr->z[i] = p[2];
+    tr->vx[i] = v[0];
+    tr->vy[i] = v[1];
+    tr->vz[i] = v[2];
+}
+
+int ParticleTracer_Step(ParticleTracer *tracer,
+                        const TracerField *field,
+                        const TracerBody *body,
+                        const TracerParams *params) {
+    int n = tracer->count;
+    int active = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, TRACER_CHUNK) reduction(+ : active)
+#endif
+    for (int i = 0; i < n; i++) {
+        if (tracer->state[i] != TRACER_ACTIVE)
+            continue;
+        step_one(tracer, i, field, body, params);
+        active += tracer->state[i] == TRACER_ACTIVE;
+    }
+    return active;
+}
+
+int ParticleTracer_Run(ParticleTracer *tracer,
+                       const TracerField *field,
+                       const TracerBody *body,
+                       const TracerParams *params,
+                       int maxSteps) {
+    int steps = 0;
+    while (steps < maxSteps) {
+        int active = ParticleTracer_Step(tracer, field, body, params);
+        steps++;
+        if (active == 0)
+            break;
+    }
+    return steps;
+}
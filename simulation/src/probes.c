@@ -0,0 +1,186 @@
+#include "../lib/probes.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void probes_init(ProbeSet *set) {
+    memset(set, 0, sizeof(*set));
+}
+
+void probes_free(ProbeSet *set) {
+    if (set->file)
+        probes_close(set);
+    free(set->position);
+    free(set->group);
+    free(set->grid);
+    probes_init(set);
+}
+
+static int push(ProbeSet *set, float x, float y, float z) {
+    if (set->numProbes == set->capacity) {
+        int capacity = set->capacity ? 2 * set->capacity : 16;
+        float *pos = (float *)realloc(set->position,
+                                      (size_t)capacity * 3 * sizeof(float));
+        if (!pos)
+            return -1;
+        set->position = pos;
+        int *group = (int *)realloc(set->group, (size_t)capacity * sizeof(int));
+        if (!group)
+            return -1;
+        set->group = group;
+        set->capacity = capacity;
+    }
+    float *p = set->position + 3 * set->numProbes;
+    p[0] = x;
+    p[1] = y;
+    p[2] = z;
+    set->group[set->numProbes++] = set->numGroups;
+    return 0;
+}
+
+int probes_add_point(ProbeSet *set, const char *spec) {
+    float x, y, z;
+    int used = 0;
+    if (sscanf(spec, "%f,%f,%f%n", &x, &y, &z, &used) != 3 ||
+        spec[used] != '\0')
+        return -1;
+    if (push(set, x, y, z) != 0)
+        return -1;
+    set->numGroups++;
+    return 0;
+}
+
+int probes_add_line(ProbeSet *set, const char *spec) {
+    float a[3], b[3];
+    int n, used = 0;
+    if (sscanf(spec, "%f,%f,%f:%f,%f,%f:%d%n", &a[0], &a[1], &a[2], &b[0],
+               &b[1], &b[2], &n, &used) != 7 ||
+        spec[used] != '\0' || n < 2 || n > PROBE_LINE_MAX)
+        return -1;
+    int first = set->numProbes;
+    for (int i = 0; i < n; i++) {
+        float t = (float)i / (n - 1);
+        if (push(set, a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]),
+                 a[2] + t * (b[2] - a[2])) != 0) {
+            set->numProbes = first;
+            return -1;
+        }
+    }
+    set->numGroups++;
+    return 0;
+}
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+int probes_locate(ProbeSet *set, int sizeX, int sizeY, int sizeZ) {
+    free(set->grid);
+    set->grid = (float *)malloc((size_t)(set->numProbes ? set->numProbes : 1) *
+                                4 * sizeof(float));
+    if (!set->grid)
+        return -1;
+    for (int i = 0; i < set->numProbes; i++) {
+        const float *p = set->position + 3 * i;
+        float *g = set->grid + 4 * i;
+        g[0] = clampf((p[0] + 4.0f) / 8.0f * sizeX, 0.5f, sizeX - 1.5f);
+        g[1] = clampf((p[1] + 2.0f) / 4.0f * sizeY, 0.5f, sizeY - 1.5f);
+        g[2] = clampf((p[2] + 2.0f) / 4.0f * sizeZ, 0.5f, sizeZ - 1.5f);
+        g[3] = 0.0f;
+    }
+    return 0;
+}
+
+void probes_sample(const ProbeSet *set,
+                   const float *velocity,
+                   int sizeX,
+                   int sizeY,
+                   float *out) {
+    size_t sx = 4, sy = (size_t)4 * sizeX, sz = (size_t)4 * sizeX * sizeY;
+    for (int i = 0; i < set->numProbes; i++) {
+        const float *g = set->grid + 4 * i;
+        int i0 = (int)g[0], j0 = (int)g[1], k0 = (int)g[2];
+        float fx = g[0] - i0, fy = g[1] - j0, fz = g[2] - k0;
+        const float *c = velocity + i0 * sx + j0 * sy + k0 * sz;
+        for (int a = 0; a < 3; a++) {
+            float v00 = c[a] + fx * (c[sx + a] - c[a]);
+            float v10 = c[sy + a] + fx * (c[sy + sx + a] - c[sy + a]);
+            float v01 = c[sz + a] + fx * (c[sz + sx + a] - c[sz + a]);
+            float v11 =
+                c[sz + sy + a] + fx * (c[sz + sy + sx + a] - c[sz + sy + a]);
+            float v0 = v00 + fy * (v10 - v00);
+            float v1 = v01 + fy * (v11 - v01);
+            out[3 * i + a] = v0 + fz * (v1 - v0);
+        }
+    }
+}
+
+// Byte offset of numRecords in the header
+#define RECORD_COUNT_OFFSET (8 + 6 * 4)
+
+int probes_open(ProbeSet *set,
+                const char *path,
+                int sizeX,
+                int sizeY,
+                int sizeZ,
+                float latticeVelocity) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write probes to %s\n", path);
+        return -1;
+    }
+    uint32_t head[5] = {PROBE_FILE_VERSION, (uint32_t)set->numProbes,
+                        (uint32_t)sizeX, (uint32_t)sizeY, (uint32_t)sizeZ};
+    uint64_t records = 0;
+    int ok = fwrite("LBMPROBE", 1, 8, f) == 8 &&
+             fwrite(head, sizeof(head), 1, f) == 1 &&
+             fwrite(&latticeVelocity, sizeof(float), 1, f) == 1 &&
+             fwrite(&records, sizeof(records), 1, f) == 1;
+    if (ok && set->numProbes > 0) {
+        size_t n = (size_t)set->numProbes;
+        ok = fwrite(set->position, 3 * sizeof(float), n, f) == n &&
+             fwrite(set->group, sizeof(int), n, f) == n;
+    }
+    if (!ok) {
+        fclose(f);
+        return -1;
+    }
+    set->file = f;
+    set->numRecords = 0;
+    return 0;
+}
+
+int probes_append(ProbeSet *set, unsigned int step, const float *velocity) {
+    if (!set->file)
+        return -1;
+    uint32_t s = step;
+    size_t n = (size_t)set->numProbes;
+    if (fwrite(&s, sizeof(s), 1, set->file) != 1 ||
+        fwrite(velocity, 3 * sizeof(float), n, set->file) != n)
+        return -1;
+    set->numRecords++;
+    return 0;
+}
+
+int probes_append_steps(ProbeSet *set,
+                        unsigned int firstStep,
+                        int steps,
+                        const float *velocity) {
+    size_t stride = (size_t)set->numProbes * 3;
+    for (int s = 0; s < steps; s++)
+        if (probes_append(set, firstStep + s, velocity + s * stride) != 0)
+            return -1;
+    return 0;
+}
+
+int probes_close(ProbeSet *set) {
+    if (!set->file)
+        return -1;
+    uint64_t records = (uint64_t)set->numRecords;
+    int ok = fseek(set->file, RECORD_COUNT_OFFSET, SEEK_SET) == 0 &&
+             fwrite(&records, sizeof(records), 1, set->file) == 1;
+    ok = fclose(set->file) == 0 && ok;
+    set->file = NULL;
+    return ok ? 0 : -1;
+}
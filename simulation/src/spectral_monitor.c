@@ -0,0 +1,99 @@
+#include "../lib/spectral_monitor.h"
+#include "../lib/drag_metrics.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPECTRAL_PROMINENCE 10.0f
+
+int spectral_monitor_init(SpectralMonitor *m,
+                          float sampleRate,
+                          int windowLength,
+                          int stableCycles,
+                          float tolerance) {
+    memset(m, 0, sizeof(*m));
+    if (!(sampleRate > 0.0f) || windowLength < 16 || stableCycles < 1 ||
+        !(tolerance > 0.0f))
+        return -1;
+    m->sampleRate = sampleRate;
+    m->windowLength = windowLength;
+    m->updateInterval = windowLength / 8;
+    m->stableCycles = stableCycles;
+    m->tolerance = tolerance;
+    m->ring = (float *)malloc((size_t)windowLength * sizeof(float));
+    m->linear = (float *)malloc((size_t)windowLength * sizeof(float));
+    if (!m->ring || !m->linear) {
+        spectral_monitor_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+void spectral_monitor_free(SpectralMonitor *m) {
+    free(m->ring);
+    free(m->linear);
+    m->ring = NULL;
+    m->linear = NULL;
+}
+
+// Amplitude of a tone from its power: a sinusoid of amplitude A has
+// variance A^2 / 2, which the PSD spreads over the Hann main lobe. Summing
+// the lobe instead of reading the peak bin makes the result independent
+// of where the tone falls between bins. Returns 0 unless the lobe stands
+// SPECTRAL_PROMINENCE times above the mean power of the other bins, so
+// broadband noise is never taken for shedding.
+static float tone_amplitude(const ClSpectrum *s) {
+    float df = s->frequency[1] - s->frequency[0];
+    int peak = (int)lrintf(s->peakFrequency / df);
+    double var = 0.0, rest = 0.0;
+    int restBins = 0;
+    for (int k = 1; k < s->numBins; k++) {
+        if (k >= peak - 2 && k <= peak + 2) {
+            var += s->power[k] * df;
+        } else {
+            rest += s->power[k];
+            restBins++;
+        }
+    }
+    if (restBins > 0 && s->peakPower < SPECTRAL_PROMINENCE * rest / restBins)
+        return 0.0f;
+    return (float)sqrt(2.0 * var);
+}
+
+int spectral_monitor_add(SpectralMonitor *m, float x) {
+    int w = m->windowLength;
+    m->ring[m->head] = x;
+    m->head = (m->head + 1) % w;
+    m->count++;
+    if (m->count < w || (m->count - w) % m->updateInterval != 0)
+        return 0;
+
+    size_t tail = (size_t)(w - m->head);
+    memcpy(m->linear, m->ring + m->head, tail * sizeof(float));
+    memcpy(m->linear + tail, m->ring, (size_t)m->head * sizeof(float));
+    ClSpectrum s;
+    if (cl_spectrum(m->linear, w, m->sampleRate, w / 2, &s) != 0)
+        return 0;
+    m->frequency = s.peakFrequency;
+    m->amplitude = tone_amplitude(&s);
+    m->updates++;
+    cl_spectrum_free(&s);
+
+    float tol = m->tolerance;
+    int holds = m->refFrequency > 0.0f && m->refAmplitude > 0.0f &&
+                fabsf(m->frequency - m->refFrequency) <= tol * m->refFrequency &&
+                fabsf(m->amplitude - m->refAmplitude) <= tol * m->refAmplitude;
+    if (!holds) {
+        m->refFrequency = m->frequency;
+        m->refAmplitude = m->amplitude;
+        m->stableSince = m->count;
+    }
+    m->cycles = (float)(m->count - m->stableSince) * m->refFrequency /
+                m->sampleRate;
+    // Successive windows share most of their samples, so the stretch also
+    // has to outlast one window before the estimates are independent.
+    m->stable = m->cycles >= m->stableCycles &&
+                m->count - m->stableSince >= m->windowLength;
+    return 1;
+}
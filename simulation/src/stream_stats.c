@@ -0,0 +1,126 @@
+#include "../lib/stream_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void stream_stats_init(StreamStats *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void stream_stats_free(StreamStats *s) {
+    free(s->groups);
+    stream_stats_init(s);
+}
+
+int stream_stats_add(StreamStats *s, double x) {
+    // Welford update
+    s->count++;
+    double delta = x - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * (x - s->mean);
+    if (s->count == 1 || x < s->min)
+        s->min = x;
+    if (s->count == 1 || x > s->max)
+        s->max = x;
+
+    s->groupSum += x;
+    if (++s->groupFill < STREAM_STATS_GROUP)
+        return 0;
+    double groupMean = s->groupSum / STREAM_STATS_GROUP;
+    s->groupSum = 0.0;
+    s->groupFill = 0;
+    if (s->numGroups == s->groupCapacity) {
+        int capacity = s->groupCapacity ? 2 * s->groupCapacity : 64;
+        double *tmp =
+            (double *)realloc(s->groups, (size_t)capacity * sizeof(double));
+        if (!tmp)
+            return -1;
+        s->groups = tmp;
+        s->groupCapacity = capacity;
+    }
+    s->groups[s->numGroups++] = groupMean;
+    return 0;
+}
+
+double stream_stats_variance(const StreamStats *s) {
+    return s->count > 1 ? s->m2 / (s->count - 1) : 0.0;
+}
+
+// MSER statistic of the groups from d on is their variance divided by
+// their count; the minimiser balances dropping biased early data against
+// keeping enough to average. Searched over the first half only; a
+// minimiser on that boundary means the series is still drifting.
+static int mser_truncation(const double *z, int m) {
+    int last = m / 2;
+    double shift = z[m - 1]; // keeps the sums small relative to the data
+    double sum = 0.0, sumSq = 0.0, best = HUGE_VAL;
+    int bestD = 0;
+    for (int d = m - 1; d >= 0; d--) {
+        double v = z[d] - shift;
+        sum += v;
+        sumSq += v * v;
+        if (d > last)
+            continue;
+        double n = m - d;
+        double stat = (sumSq - sum * sum / n) / (n * n);
+        if (stat <= best) {
+            best = stat;
+            bestD = d;
+        }
+    }
+    return bestD;
+}
+
+void stream_stats_estimate(const StreamStats *s, StreamEstimate *out) {
+    memset(out, 0, sizeof(*out));
+    out->mean = s->mean;
+    out->used = s->count;
+    int m = s->numGroups;
+    if (m < STREAM_STATS_BATCHES)
+        return;
+
+    int d = mser_truncation(s->groups, m);
+    int clamped = m - d < STREAM_STATS_BATCHES;
+    if (clamped)
+        d = m - STREAM_STATS_BATCHES;
+    int perBatch = (m - d) / STREAM_STATS_BATCHES;
+    int first = m - perBatch * STREAM_STATS_BATCHES;
+    double batch[STREAM_STATS_BATCHES];
+    double mean = 0.0;
+    for (int b = 0; b < STREAM_STATS_BATCHES; b++) {
+        double sum = 0.0;
+        for (int j = 0; j < perBatch; j++)
+            sum += s->groups[first + b * perBatch + j];
+        batch[b] = sum / perBatch;
+        mean += batch[b];
+    }
+    mean /= STREAM_STATS_BATCHES;
+
+    double var = 0.0, cov = 0.0;
+    for (int b = 0; b < STREAM_STATS_BATCHES; b++) {
+        double dev = batch[b] - mean;
+        var += dev * dev;
+        if (b > 0)
+            cov += dev * (batch[b - 1] - mean);
+    }
+    double lag1 = var > 0.0 ? cov / var : 0.0;
+    var /= STREAM_STATS_BATCHES - 1;
+
+    double inflate = 1.0;
+    if (lag1 > 0.0) {
+        double r = lag1 < 0.9 ? lag1 : 0.9;
+        inflate = sqrt((1.0 + r) / (1.0 - r));
+    }
+
+    out->valid = d < m / 2 && !clamped;
+    out->truncated = (long)d * STREAM_STATS_GROUP;
+    out->used = (long)perBatch * STREAM_STATS_BATCHES * STREAM_STATS_GROUP;
+    out->mean = mean;
+    out->halfWidth =
+        STREAM_STATS_T95 * sqrt(var / STREAM_STATS_BATCHES) * inflate;
+    out->relHalfWidth =
+        fabs(mean) > 0.0 ? out->halfWidth / fabs(mean) : HUGE_VAL;
+    out->lag1 = lag1;
+    out->batchSize = perBatch * STREAM_STATS_GROUP;
+}
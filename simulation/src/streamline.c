@@ -0,0 +1,584 @@
+#include "../lib/streamline.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Seeds handed to each OpenMP task
+#define STREAMLINE_CHUNK 64
+
+// ---------------------------------------------------------------------------
+// VTI input
+// ---------------------------------------------------------------------------
+
+// Value of attribute `key` ("Name=\"" style prefix) inside the tag that
+// starts at `tag`, or NULL when the tag has no such attribute.
+static const char *tag_attr(const char *tag, const char *key) {
+    const char *end = strchr(tag, '>');
+    const char *a = strstr(tag, key);
+    return a && (!end || a < end) ? a + strlen(key) : NULL;
+}
+
+// Appended-data offset of the DataArray named `name`, or -1.
+static long array_offset(const char *header, const char *name) {
+    char key[64];
+    snprintf(key, sizeof(key), "Name=\"%s\"", name);
+    const char *a = strstr(header, key);
+    if (!a)
+        return -1;
+    while (a > header && *a != '<')
+        a--;
+    const char *off = tag_attr(a, "offset=\"");
+    return off ? strtol(off, NULL, 10) : -1;
+}
+
+// Start and byte count of the appended block at `offset`; NULL when it
+// runs past the end of the file.
+static const unsigned char *appended_block(const unsigned char *data,
+                                           size_t available,
+                                           long offset,
+                                           int header64,
+                                           uint64_t *bytes) {
+    size_t hsize = header64 ? sizeof(uint64_t) : sizeof(uint32_t);
+    if (offset < 0 || (size_t)offset + hsize > available)
+        return NULL;
+    if (header64) {
+        memcpy(bytes, data + offset, sizeof(uint64_t));
+    } else {
+        uint32_t b32;
+        memcpy(&b32, data + offset, sizeof(uint32_t));
+        *bytes = b32;
+    }
+    if (*bytes > available - (size_t)offset - hsize)
+        return NULL;
+    return data + offset + hsize;
+}
+
+int Streamline_LoadVTI(const char *filename, StreamlineField *field) {
+    memset(field, 0, sizeof(*field));
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Streamline: cannot open %s\n", filename);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *file = size > 0 ? (char *)malloc((size_t)size + 1) : NULL;
+    if (!file || fread(file, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "Streamline: cannot read %s\n", filename);
+        free(file);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    file[size] = '\0';
+
+    // The XML header ends at the '_' that opens the raw appended data
+    const char *appended = strstr(file, "<AppendedData");
+    const char *raw = appended ? tag_attr(appended, "encoding=\"") : NULL;
+    const char *underscore = appended ? strchr(appended, '_') : NULL;
+    if (!raw || strncmp(raw, "raw\"", 4) != 0 || !underscore) {
+        fprintf(stderr, "Streamline: %s has no raw appended data\n",
+                filename);
+        free(file);
+        return -1;
+    }
+    file[appended - file] = '\0'; // header searches stop here
+    const unsigned char *data = (const unsigned char *)underscore + 1;
+    size_t available = (size_t)size - (size_t)(underscore + 1 - file);
+
+    const char *image = strstr(file, "<ImageData");
+    const char *extent = image ? tag_attr(image, "WholeExtent=\"") : NULL;
+    const char *type = strstr(file, "header_type=\"UInt32\"");
+    int e[6];
+    long velOffset = array_offset(file, "velocity");
+    long solidOffset = array_offset(file, "solid");
+    if (!extent || strstr(file, "BigEndian") ||
+        sscanf(extent, "%d %d %d %d %d %d", &e[0], &e[1], &e[2], &e[3],
+               &e[4], &e[5]) != 6 ||
+        velOffset < 0) {
+        fprintf(stderr, "Streamline: %s is not a velocity VTI\n", filename);
+        free(file);
+        return -1;
+    }
+
+    uint64_t velBytes = 0, solidBytes = 0;
+    const unsigned char *vel =
+        appended_block(data, available, velOffset, !type, &velBytes);
+    const unsigned char *solid =
+        solidOffset < 0 ? NULL
+                        : appended_block(data, available, solidOffset, !type,
+                                         &solidBytes);
+
+    // writeVTI stores n cells along an extent of 0..n; standard VTK point
+    // data would hold n + 1 points per axis. Accept either.
+    int nx = e[1] - e[0], ny = e[3] - e[2], nz = e[5] - e[4];
+    uint64_t points = vel ? velBytes / (3 * sizeof(float)) : 0;
+    if (points != (uint64_t)nx * ny * nz) {
+        nx++;
+        ny++;
+        nz++;
+    }
+    if (!vel || nx < 2 || ny < 2 || nz < 2 ||
+        points != (uint64_t)nx * ny * nz ||
+        velBytes != points * 3 * sizeof(float) ||
+        (solid && solidBytes != points * sizeof(int))) {
+        fprintf(stderr, "Streamline: %s has inconsistent array sizes\n",
+                filename);
+        free(file);
+        return -1;
+    }
+
+    size_t total = (size_t)points;
+    field->velocity = (float *)malloc(total * 4 * sizeof(float));
+    field->solid = solid ? (int *)malloc(total * sizeof(int)) : NULL;
+    if (!field->velocity || (solid && !field->solid)) {
+        free(file);
+        Streamline_FreeField(field);
+        return -1;
+    }
+    for (size_t i = 0; i < total; i++) {
+        memcpy(field->velocity + 4 * i, vel + 12 * i, 3 * sizeof(float));
+        field->velocity[4 * i + 3] = 1.0f;
+    }
+    if (solid)
+        memcpy(field->solid, solid, total * sizeof(int));
+    field->sizeX = nx;
+    field->sizeY = ny;
+    field->sizeZ = nz;
+    field->velocityScale = 8.0f;
+    free(file);
+    return 0;
+}
+
+void Streamline_FreeField(StreamlineField *field) {
+    free(field->velocity);
+    free(field->solid);
+    field->velocity = NULL;
+    field->solid = NULL;
+    field->sizeX = field->sizeY = field->sizeZ = 0;
+}
+
+void Streamline_DefaultParams(const StreamlineField *field,
+                              StreamlineParams *params) {
+    float cell = 8.0f / field->sizeX;
+    if (4.0f / field->sizeY < cell)
+        cell = 4.0f / field->sizeY;
+    if (4.0f / field->sizeZ < cell)
+        cell = 4.0f / field->sizeZ;
+    params->initialStep = 0.5f * cell;
+    params->minStep = 0.01f * cell;
+    params->maxStep = 2.0f * cell;
+    params->tolerance = 1e-3f * cell;
+    params->minSpeed = 1e-4f;
+    params->maxLength = 16.0f; // twice the tunnel length
+    params->maxPoints = 2000;
+}
+
+// ---------------------------------------------------------------------------
+// Integration
+// ---------------------------------------------------------------------------
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Trilinear world velocity, as ParticleTracer_SampleVelocity and
+// sampleVelocity in streamline_trace.comp. Returns the speed.
+static float sample(const StreamlineField *field,
+                    const float p[3],
+                    float out[3]) {
+    int nx = field->sizeX, ny = field->sizeY, nz = field->sizeZ;
+    float gx = clampf((p[0] + 4.0f) / 8.0f * nx, 0.5f, nx - 1.5f);
+    float gy = clampf((p[1] + 2.0f) / 4.0f * ny, 0.5f, ny - 1.5f);
+    float gz = clampf((p[2] + 2.0f) / 4.0f * nz, 0.5f, nz - 1.5f);
+
+    int i0 = (int)gx, j0 = (int)gy, k0 = (int)gz;
+    float fx = gx - i0, fy = gy - j0, fz = gz - k0;
+    size_t sx = 4, sy = (size_t)4 * nx, sz = (size_t)4 * nx * ny;
+    const float *c = field->velocity + i0 * sx + j0 * sy + k0 * sz;
+
+    for (int a = 0; a < 3; a++) {
+        float v00 = c[a] + fx * (c[sx + a] - c[a]);
+        float v10 = c[sy + a] + fx * (c[sy + sx + a] - c[sy + a]);
+        float v01 = c[sz + a] + fx * (c[sz + sx + a] - c[sz + a]);
+        float v11 =
+            c[sz + sy + a] + fx * (c[sz + sy + sx + a] - c[sz + sy + a]);
+        float v0 = v00 + fy * (v10 - v00);
+        float v1 = v01 + fy * (v11 - v01);
+        out[a] = (v0 + fz * (v1 - v0)) * field->velocityScale;
+    }
+    return sqrtf(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+}
+
+// Unit flow direction at p (zero where the flow stops). Streamlines are
+// integrated in arc length so steps stay bounded in slow regions.
+static void direction(const StreamlineField *field,
+                      const float p[3],
+                      float k[3]) {
+    float speed = sample(field, p, k);
+    float inv = speed > 1e-12f ? 1.0f / speed : 0.0f;
+    k[0] *= inv;
+    k[1] *= inv;
+    k[2] *= inv;
+}
+
+static int outside(const float p[3]) {
+    return p[0] < -4.0f || p[0] > 4.0f || p[1] < -2.0f || p[1] > 2.0f ||
+           p[2] < -2.0f || p[2] > 2.0f;
+}
+
+// Solid mask of the cell holding p, as the shaders' int(worldToGrid(p)).
+static int in_solid(const StreamlineField *field, const float p[3]) {
+    if (!field->solid)
+        return 0;
+    int nx = field->sizeX, ny = field->sizeY, nz = field->sizeZ;
+    int i = (int)clampf((p[0] + 4.0f) / 8.0f * nx, 0.0f, nx - 1.0f);
+    int j = (int)clampf((p[1] + 2.0f) / 4.0f * ny, 0.0f, ny - 1.0f);
+    int k = (int)clampf((p[2] + 2.0f) / 4.0f * nz, 0.0f, nz - 1.0f);
+    return field->solid[i + (size_t)nx * (j + (size_t)ny * k)] != 0;
+}
+
+// Moves q back along the segment from p (inside the box) to the box face.
+static void clip_to_box(const float p[3], float q[3]) {
+    static const float lo[3] = {-4.0f, -2.0f, -2.0f};
+    static const float hi[3] = {4.0f, 2.0f, 2.0f};
+    float t = 1.0f;
+    for (int a = 0; a < 3; a++) {
+        float d = q[a] - p[a];
+        if (q[a] > hi[a] && d > 0.0f)
+            t = fminf(t, (hi[a] - p[a]) / d);
+        else if (q[a] < lo[a] && d < 0.0f)
+            t = fminf(t, (lo[a] - p[a]) / d);
+    }
+    for (int a = 0; a < 3; a++)
+        q[a] = clampf(p[a] + t * (q[a] - p[a]), lo[a], hi[a]);
+}
+
+// Per-thread point storage: x, y, z, speed per point
+typedef struct {
+    float *data;
+    int count;
+    int capacity;
+} LineBuffer;
+
+static int push_point(LineBuffer *b, const float p[3], float speed) {
+    if (b->count >= b->capacity) {
+        int cap = b->capacity ? b->capacity * 2 : 4096;
+        float *data =
+            (float *)realloc(b->data, (size_t)cap * 4 * sizeof(float));
+        if (!data)
+            return -1;
+        b->data = data;
+        b->capacity = cap;
+    }
+    float *d = b->data + 4 * (size_t)b->count++;
+    d[0] = p[0];
+    d[1] = p[1];
+    d[2] = p[2];
+    d[3] = speed;
+    return 0;
+}
+
+// Cash-Karp tableau: a fourth-order RK step with an embedded fifth-order
+// solution for the error estimate. The fourth-order result is kept.
+static const float CK_A[6][5] = {
+    {0.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+    {1.0f / 5.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+    {3.0f / 40.0f, 9.0f / 40.0f, 0.0f, 0.0f, 0.0f},
+    {3.0f / 10.0f, -9.0f / 10.0f, 6.0f / 5.0f, 0.0f, 0.0f},
+    {-11.0f / 54.0f, 5.0f / 2.0f, -70.0f / 27.0f, 35.0f / 27.0f, 0.0f},
+    {1631.0f / 55296.0f, 175.0f / 512.0f, 575.0f / 13824.0f,
+     44275.0f / 110592.0f, 253.0f / 4096.0f}};
+static const float CK_B4[6] = {2825.0f / 27648.0f,  0.0f,
+                               18575.0f / 48384.0f, 13525.0f / 55296.0f,
+                               277.0f / 14336.0f,   1.0f / 4.0f};
+static const float CK_B5[6] = {37.0f / 378.0f,  0.0f, 250.0f / 621.0f,
+                               125.0f / 594.0f, 0.0f, 512.0f / 1771.0f};
+
+// One trial step of length h from p with k[0] already holding the
+// direction at p. Writes the new point to q and returns the error norm.
+static float rk_step(const StreamlineField *field,
+                     const float p[3],
+                     float h,
+                     float k[6][3],
+                     float q[3]) {
+    for (int s = 1; s < 6; s++) {
+        float x[3];
+        for (int a = 0; a < 3; a++) {
+            float sum = 0.0f;
+            for (int r = 0; r < s; r++)
+                sum += CK_A[s][r] * k[r][a];
+            x[a] = p[a] + h * sum;
+        }
+        direction(field, x, k[s]);
+    }
+    float err2 = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float y4 = 0.0f, e = 0.0f;
+        for (int s = 0; s < 6; s++) {
+            y4 += CK_B4[s] * k[s][a];
+            e += (CK_B5[s] - CK_B4[s]) * k[s][a];
+        }
+        q[a] = p[a] + h * y4;
+        err2 += e * e;
+    }
+    return h * sqrtf(err2);
+}
+
+// Traces one streamline into b. Returns the STREAMLINE_* reason, or -1
+// when b cannot grow.
+static int trace_one(const StreamlineField *field,
+                     const StreamlineParams *params,
+                     const float seed[3],
+                     LineBuffer *b) {
+    float p[3] = {seed[0], seed[1], seed[2]}, v[3], k[6][3];
+    float speed = sample(field, p, v);
+    if (push_point(b, p, speed) != 0)
+        return -1;
+    if (outside(p))
+        return STREAMLINE_EXITED;
+    if (in_solid(field, p))
+        return STREAMLINE_SOLID;
+    if (speed < params->minSpeed)
+        return STREAMLINE_STAGNANT;
+
+    float h = params->initialStep, length = 0.0f, tol = params->tolerance;
+    int points = 1;
+    direction(field, p, k[0]);
+    for (;;) {
+        if (points >= params->maxPoints || length >= params->maxLength)
+            return STREAMLINE_LIMIT;
+
+        float q[3];
+        float err = rk_step(field, p, h, k, q);
+        if (err > tol && h > params->minStep) {
+            float shrink = 0.9f * powf(tol / err, 0.25f);
+            h = fmaxf(params->minStep, h * fmaxf(shrink, 0.1f));
+            continue;
+        }
+
+        if (outside(q)) {
+            clip_to_box(p, q);
+            if (push_point(b, q, sample(field, q, v)) != 0)
+                return -1;
+            return STREAMLINE_EXITED;
+        }
+        if (in_solid(field, q))
+            return STREAMLINE_SOLID;
+        speed = sample(field, q, v);
+        if (push_point(b, q, speed) != 0)
+            return -1;
+        points++;
+        length += h;
+        if (speed < params->minSpeed)
+            return STREAMLINE_STAGNANT;
+
+        p[0] = q[0];
+        p[1] = q[1];
+        p[2] = q[2];
+        float inv = speed > 1e-12f ? 1.0f / speed : 0.0f;
+        k[0][0] = v[0] * inv;
+        k[0][1] = v[1] * inv;
+        k[0][2] = v[2] * inv;
+
+        float grow = err > 0.0f ? 0.9f * powf(tol / err, 0.2f) : 5.0f;
+        h = fminf(params->maxStep, h * fminf(grow, 5.0f));
+    }
+}
+
+int Streamline_Trace(const StreamlineField *field,
+                     const StreamlineParams *params,
+                     const float *seeds,
+                     int numSeeds,
+                     Streamlines *out) {
+    memset(out, 0, sizeof(*out));
+    if (numSeeds < 0)
+        numSeeds = 0;
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    // Lines are traced into per-thread buffers, then gathered in seed
+    // order, so the output does not depend on the schedule.
+    LineBuffer *buffers = (LineBuffer *)calloc(threads, sizeof(LineBuffer));
+    int *owner = (int *)malloc(((size_t)numSeeds + 1) * sizeof(int));
+    int *start = (int *)malloc(((size_t)numSeeds + 1) * sizeof(int));
+    out->offsets = (int *)malloc(((size_t)numSeeds + 1) * sizeof(int));
+    out->reason = (unsigned char *)malloc((size_t)numSeeds + 1);
+    int failed = !buffers || !owner || !start || !out->offsets ||
+                 !out->reason;
+
+    if (!failed) {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads) reduction(| : failed)
+#endif
+        {
+            int t = 0;
+#ifdef _OPENMP
+            t = omp_get_thread_num();
+#endif
+            LineBuffer *b = &buffers[t];
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, STREAMLINE_CHUNK)
+#endif
+            for (int s = 0; s < numSeeds; s++) {
+                int first = b->count;
+                int reason = trace_one(field, params, seeds + 3 * (size_t)s,
+                                       b);
+                failed |= reason < 0;
+                owner[s] = t;
+                start[s] = first;
+                out->offsets[s] = b->count - first; // length for now
+                out->reason[s] = (unsigned char)(reason < 0 ? 0 : reason);
+            }
+        }
+    }
+
+    long long total = 0;
+    for (int s = 0; !failed && s < numSeeds; s++) {
+        int n = out->offsets[s];
+        out->offsets[s] = (int)total;
+        total += n;
+        failed = total > INT32_MAX;
+    }
+    if (!failed) {
+        out->offsets[numSeeds] = (int)total;
+        out->points = (float *)malloc(((size_t)total + 1) * 3 * sizeof(float));
+        out->speed = (float *)malloc(((size_t)total + 1) * sizeof(float));
+        failed = !out->points || !out->speed;
+    }
+    if (!failed) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int s = 0; s < numSeeds; s++) {
+            const float *src = buffers[owner[s]].data + 4 * (size_t)start[s];
+            for (int i = out->offsets[s]; i < out->offsets[s + 1]; i++) {
+                out->points[3 * (size_t)i] = src[0];
+                out->points[3 * (size_t)i + 1] = src[1];
+                out->points[3 * (size_t)i + 2] = src[2];
+                out->speed[i] = src[3];
+                src += 4;
+            }
+        }
+        out->numLines = numSeeds;
+        out->numPoints = (int)total;
+    }
+
+    for (int t = 0; buffers && t < threads; t++)
+        free(buffers[t].data);
+    free(buffers);
+    free(owner);
+    free(start);
+    if (failed) {
+        Streamline_Free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void Streamline_Free(Streamlines *lines) {
+    free(lines->points);
+    free(lines->speed);
+    free(lines->offsets);
+    free(lines->reason);
+    memset(lines, 0, sizeof(*lines));
+}
+
+// ---------------------------------------------------------------------------
+// VTP output
+// ---------------------------------------------------------------------------
+
+static int write_block(FILE *f, const void *data, size_t bytes) {
+    uint64_t size = bytes;
+    return fwrite(&size, sizeof(size), 1, f) == 1 &&
+           (bytes == 0 || fwrite(data, 1, bytes, f) == bytes);
+}
+
+int Streamline_WriteVTP(const Streamlines *lines, const char *filename) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "VTK: cannot open %s\n", filename);
+        return -1;
+    }
+    size_t np = (size_t)lines->numPoints, nl = (size_t)lines->numLines;
+
+    // Appended-data offsets, each block preceded by a UInt64 byte count
+    size_t h = sizeof(uint64_t);
+    size_t speedOffset = h + np * 3 * sizeof(float);
+    size_t reasonOffset = speedOffset + h + np * sizeof(float);
+    size_t connOffset = reasonOffset + h + nl;
+    size_t offsetsOffset = connOffset + h + np * sizeof(int32_t);
+
+    fprintf(f,
+            "<?xml version=\"1.0\"?>\n"
+            "<VTKFile type=\"PolyData\" version=\"1.0\""
+            " byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+            "  <PolyData>\n"
+            "    <Piece NumberOfPoints=\"%llu\" NumberOfVerts=\"0\""
+            " NumberOfLines=\"%llu\" NumberOfStrips=\"0\""
+            " NumberOfPolys=\"0\">\n"
+            "      <PointData Scalars=\"speed\">\n"
+            "        <DataArray type=\"Float32\" Name=\"speed\""
+            " format=\"appended\" offset=\"%llu\"/>\n"
+            "      </PointData>\n"
+            "      <CellData Scalars=\"reason\">\n"
+            "        <DataArray type=\"UInt8\" Name=\"reason\""
+            " format=\"appended\" offset=\"%llu\"/>\n"
+            "      </CellData>\n"
+            "      <Points>\n"
+            "        <DataArray type=\"Float32\" NumberOfComponents=\"3\""
+            " format=\"appended\" offset=\"0\"/>\n"
+            "      </Points>\n"
+            "      <Lines>\n"
+            "        <DataArray type=\"Int32\" Name=\"connectivity\""
+            " format=\"appended\" offset=\"%llu\"/>\n"
+            "        <DataArray type=\"Int32\" Name=\"offsets\""
+            " format=\"appended\" offset=\"%llu\"/>\n"
+            "      </Lines>\n"
+            "    </Piece>\n"
+            "  </PolyData>\n"
+            "  <AppendedData encoding=\"raw\">\n_",
+            (unsigned long long)np,
+            (unsigned long long)nl,
+            (unsigned long long)speedOffset,
+            (unsigned long long)reasonOffset,
+            (unsigned long long)connOffset,
+            (unsigned long long)offsetsOffset);
+
+    int writeOk = write_block(f, lines->points, np * 3 * sizeof(float)) &&
+                  write_block(f, lines->speed, np * sizeof(float)) &&
+                  write_block(f, lines->reason, nl);
+
+    // Connectivity is just 0 .. numPoints - 1, written in slices
+    uint64_t connBytes = np * sizeof(int32_t);
+    writeOk = writeOk && fwrite(&connBytes, sizeof(connBytes), 1, f) == 1;
+    int32_t slice[4096];
+    for (size_t i = 0; i < np && writeOk; i += 4096) {
+        size_t n = np - i < 4096 ? np - i : 4096;
+        for (size_t j = 0; j < n; j++)
+            slice[j] = (int32_t)(i + j);
+        writeOk = fwrite(slice, sizeof(int32_t), n, f) == n;
+    }
+
+    // VTK offsets are the end of each line
+    writeOk = writeOk &&
+              write_block(f, nl ? lines->offsets + 1 : NULL,
+                          nl * sizeof(int32_t));
+    if (writeOk)
+        fprintf(f, "\n  </AppendedData>\n</VTKFile>\n");
+    if (fclose(f) != 0 || !writeOk) {
+        fprintf(stderr, "VTK: write error for %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
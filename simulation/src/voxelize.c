@@ -1,3 +1,7 @@
+/* fseeko, with a 64-bit off_t on 32-bit POSIX targets. */
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
 #include "../lib/voxelize.h"
 
 #include <math.h>
@@ -5,6 +9,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
 #define VOXELIZE_EPS 1e-8f
 
 typedef struct {
@@ -15,9 +23,40 @@ static inline int voxel_index(int x, int y, int z, int R) {
     return x + R * (y + R * z);
 }
 
+static inline size_t box_index(int x, int y, int z, const int dims[3]) {
+    return (size_t)x + (size_t)dims[0] * ((size_t)y + (size_t)dims[1] * z);
+}
+
+static inline float box_spacing(const VoxelBox *box, int axis) {
+    return (box->max[axis] - box->min[axis]) / (float)box->dims[axis];
+}
+
+static size_t box_cells(const VoxelBox *box) {
+    return (size_t)box->dims[0] * box->dims[1] * box->dims[2];
+}
+
+static int box_valid(const VoxelBox *box) {
+    for (int j = 0; j < 3; j++)
+        if (box->dims[j] <= 0 || !(box->max[j] > box->min[j]))
+            return 0;
+    return 1;
+}
+
+/* The [-1, 1]^3 cube at R^3 that VoxelGrid lives in. */
+static VoxelBox cube_box(int R) {
+    VoxelBox box = {{R, R, R}, {-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}};
+    return box;
+}
+
+/*
+ * Center the mesh in `box`, optionally permute its longest axis to X,
+ * and scale it uniformly so it fits with `padding` (a fraction of each
+ * half-extent) left free on every side.
+ */
 static Vec3 *copy_and_normalize_vertices(const Model *model,
                                          float padding,
-                                         int align_longest_x) {
+                                         int align_longest_x,
+                                         const VoxelBox *box) {
     if (model->vertexCount <= 0)
         return NULL;
 
@@ -76,19 +115,30 @@ static Vec3 *copy_and_normalize_vertices(const Model *model,
         }
     }
 
-    float max_dim = size_x;
-    if (size_y > max_dim) max_dim = size_y;
-    if (size_z > max_dim) max_dim = size_z;
-    if (max_dim < VOXELIZE_EPS) {
+    /* Largest uniform scale that fits every axis; for the cube this is
+     * (2 - 2*padding) / longest dimension. */
+    float size[3] = {size_x, size_y, size_z};
+    float scale = -1.0f;
+    for (int j = 0; j < 3; j++) {
+        if (size[j] < VOXELIZE_EPS)
+            continue;
+        float extent = box->max[j] - box->min[j];
+        float s = (extent - extent * padding) / size[j];
+        if (scale < 0.0f || s < scale)
+            scale = s;
+    }
+    if (scale < 0.0f) {
         free(v);
         return NULL;
     }
 
-    float scale = (2.0f - 2.0f * padding) / max_dim;
+    float bx = 0.5f * (box->min[0] + box->max[0]);
+    float by = 0.5f * (box->min[1] + box->max[1]);
+    float bz = 0.5f * (box->min[2] + box->max[2]);
     for (int i = 0; i < model->vertexCount; i++) {
-        v[i].x *= scale;
-        v[i].y *= scale;
-        v[i].z *= scale;
+        v[i].x = v[i].x * scale + bx;
+        v[i].y = v[i].y * scale + by;
+        v[i].z = v[i].z * scale + bz;
     }
 
     return v;
@@ -124,9 +174,13 @@ static int cmp_float(const void *a, const void *b) {
 static void voxelize_solid(const Vec3 *verts,
                            const Face *faces,
                            int face_count,
-                           int R,
+                           const VoxelBox *box,
                            uint8_t *grid) {
-    HitList *hits = (HitList *)calloc((size_t)R * R, sizeof(HitList));
+    int nx = box->dims[0], ny = box->dims[1], nz = box->dims[2];
+    float sx_cell = box_spacing(box, 0);
+    float sy_cell = box_spacing(box, 1);
+    float sz_cell = box_spacing(box, 2);
+    HitList *hits = (HitList *)calloc((size_t)ny * nz, sizeof(HitList));
     if (!hits)
         return;
 
@@ -143,17 +197,18 @@ static void voxelize_solid(const Vec3 *verts,
         float z_min = fminf(v0.z, fminf(v1.z, v2.z));
         float z_max = fmaxf(v0.z, fmaxf(v1.z, v2.z));
 
-        if (y_max < -1.0f || y_min > 1.0f || z_max < -1.0f || z_min > 1.0f)
+        if (y_max < box->min[1] || y_min > box->max[1] ||
+            z_max < box->min[2] || z_min > box->max[2])
             continue;
 
-        int gy_lo = (int)floorf((y_min + 1.0f) * 0.5f * R);
-        int gy_hi = (int)ceilf((y_max + 1.0f) * 0.5f * R) + 1;
-        int gz_lo = (int)floorf((z_min + 1.0f) * 0.5f * R);
-        int gz_hi = (int)ceilf((z_max + 1.0f) * 0.5f * R) + 1;
+        int gy_lo = (int)floorf((y_min - box->min[1]) / sy_cell);
+        int gy_hi = (int)ceilf((y_max - box->min[1]) / sy_cell) + 1;
+        int gz_lo = (int)floorf((z_min - box->min[2]) / sz_cell);
+        int gz_hi = (int)ceilf((z_max - box->min[2]) / sz_cell) + 1;
         if (gy_lo < 0) gy_lo = 0;
         if (gz_lo < 0) gz_lo = 0;
-        if (gy_hi > R) gy_hi = R;
-        if (gz_hi > R) gz_hi = R;
+        if (gy_hi > ny) gy_hi = ny;
+        if (gz_hi > nz) gz_hi = nz;
         if (gy_lo >= gy_hi || gz_lo >= gz_hi)
             continue;
 
@@ -169,10 +224,10 @@ static void voxelize_solid(const Vec3 *verts,
         float inv_a = 1.0f / a;
 
         for (int gy = gy_lo; gy < gy_hi; gy++) {
-            float wy = ((float)gy + 0.5f) / (float)R * 2.0f - 1.0f;
+            float wy = box->min[1] + ((float)gy + 0.5f) * sy_cell;
             float sy = wy - v0.y;
             for (int gz = gz_lo; gz < gz_hi; gz++) {
-                float wz = ((float)gz + 0.5f) / (float)R * 2.0f - 1.0f;
+                float wz = box->min[2] + ((float)gz + 0.5f) * sz_cell;
                 float sz = wz - v0.z;
 
                 /* u = inv_a * (s . h)  where s_x is irrelevant (h_x = 0) */
@@ -194,15 +249,15 @@ static void voxelize_solid(const Vec3 *verts,
                 /* t = inv_a * (e2 . q); since origin is (0, wy, wz) and
                  * dir is (1, 0, 0), the intersection x-coordinate is t. */
                 float t = inv_a * (e2x * qx + e2y * qy + e2z * qz);
-                if (hitlist_push(&hits[gy * R + gz], t) != 0)
+                if (hitlist_push(&hits[gy * nz + gz], t) != 0)
                     goto cleanup;
             }
         }
     }
 
-    for (int gy = 0; gy < R; gy++) {
-        for (int gz = 0; gz < R; gz++) {
-            HitList *h = &hits[gy * R + gz];
+    for (int gy = 0; gy < ny; gy++) {
+        for (int gz = 0; gz < nz; gz++) {
+            HitList *h = &hits[gy * nz + gz];
             if (h->count < 2)
                 continue;
             qsort(h->xs, (size_t)h->count, sizeof(float), cmp_float);
@@ -218,66 +273,238 @@ static void voxelize_solid(const Vec3 *verts,
             for (int i = 0; i + 1 < n; i += 2) {
                 float x0 = h->xs[i];
                 float x1 = h->xs[i + 1];
-                int gx0 = (int)ceilf((x0 + 1.0f) * 0.5f * R - 0.5f);
-                int gx1 = (int)floorf((x1 + 1.0f) * 0.5f * R - 0.5f) + 1;
+                int gx0 = (int)ceilf((x0 - box->min[0]) / sx_cell - 0.5f);
+                int gx1 =
+                    (int)floorf((x1 - box->min[0]) / sx_cell - 0.5f) + 1;
                 if (gx0 < 0) gx0 = 0;
-                if (gx1 > R) gx1 = R;
+                if (gx1 > nx) gx1 = nx;
                 for (int gx = gx0; gx < gx1; gx++) {
-                    grid[voxel_index(gx, gy, gz, R)] = 1;
+                    grid[box_index(gx, gy, gz, box->dims)] = 1;
                 }
             }
         }
     }
 
 cleanup:
-    for (int i = 0; i < R * R; i++)
+    for (int i = 0; i < ny * nz; i++)
         free(hits[i].xs);
     free(hits);
 }
 
+/*
+ * Separating axis test between a triangle and an axis-aligned box
+ * (Akenine-Moller 2001): 9 edge x box-axis axes, the 3 box face normals
+ * and the triangle normal. Touching counts as overlap so the shell stays
+ * 6-connected where the surface runs along a voxel face.
+ */
+static int tri_box_overlap(const float center[3],
+                           const float half[3],
+                           const float tri[3][3]) {
+    float v[3][3], e[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            v[i][j] = tri[i][j] - center[j];
+    for (int j = 0; j < 3; j++) {
+        e[0][j] = v[1][j] - v[0][j];
+        e[1][j] = v[2][j] - v[1][j];
+        e[2][j] = v[0][j] - v[2][j];
+    }
+
+    for (int i = 0; i < 3; i++) {
+        for (int k = 0; k < 3; k++) {
+            /* axis = unit_k x e_i */
+            float a[3];
+            a[k] = 0.0f;
+            a[(k + 1) % 3] = -e[i][(k + 2) % 3];
+            a[(k + 2) % 3] = e[i][(k + 1) % 3];
+            float p0 = a[0] * v[0][0] + a[1] * v[0][1] + a[2] * v[0][2];
+            float p1 = a[0] * v[1][0] + a[1] * v[1][1] + a[2] * v[1][2];
+            float p2 = a[0] * v[2][0] + a[1] * v[2][1] + a[2] * v[2][2];
+            float mn = fminf(p0, fminf(p1, p2));
+            float mx = fmaxf(p0, fmaxf(p1, p2));
+            float r = half[0] * fabsf(a[0]) + half[1] * fabsf(a[1]) +
+                      half[2] * fabsf(a[2]);
+            if (mn > r || mx < -r)
+                return 0;
+        }
+    }
+
+    for (int j = 0; j < 3; j++) {
+        float mn = fminf(v[0][j], fminf(v[1][j], v[2][j]));
+        float mx = fmaxf(v[0][j], fmaxf(v[1][j], v[2][j]));
+        if (mn > half[j] || mx < -half[j])
+            return 0;
+    }
+
+    float n[3] = {e[0][1] * e[1][2] - e[0][2] * e[1][1],
+                  e[0][2] * e[1][0] - e[0][0] * e[1][2],
+                  e[0][0] * e[1][1] - e[0][1] * e[1][0]};
+    float d = n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2];
+    float r = half[0] * fabsf(n[0]) + half[1] * fabsf(n[1]) +
+              half[2] * fabsf(n[2]);
+    return fabsf(d) <= r;
+}
+
+/*
+ * Conservative surface voxelization. Each triangle walks the columns of
+ * its footprint on the plane most perpendicular to its normal; within a
+ * column only the cells between the plane's min and max height over the
+ * column are SAT-tested, so work follows the triangle's area instead of
+ * its AABB volume.
+ */
 static void voxelize_surface(const Vec3 *verts,
                              const Face *faces,
                              int face_count,
-                             int R,
+                             const VoxelBox *box,
                              uint8_t *grid) {
+    const float *o = box->min;
+    float sp[3], half[3];
+    for (int j = 0; j < 3; j++) {
+        sp[j] = box_spacing(box, j);
+        half[j] = 0.5f * sp[j];
+    }
+
     for (int f = 0; f < face_count; f++) {
-        int i0 = faces[f].v1 - 1;
-        int i1 = faces[f].v2 - 1;
-        int i2 = faces[f].v3 - 1;
-        Vec3 v0 = verts[i0];
-        Vec3 v1 = verts[i1];
-        Vec3 v2 = verts[i2];
+        const Vec3 *p[3] = {&verts[faces[f].v1 - 1],
+                            &verts[faces[f].v2 - 1],
+                            &verts[faces[f].v3 - 1]};
+        float tri[3][3];
+        for (int i = 0; i < 3; i++) {
+            tri[i][0] = p[i]->x;
+            tri[i][1] = p[i]->y;
+            tri[i][2] = p[i]->z;
+        }
 
-        float x_min = fminf(v0.x, fminf(v1.x, v2.x));
-        float x_max = fmaxf(v0.x, fmaxf(v1.x, v2.x));
-        float y_min = fminf(v0.y, fminf(v1.y, v2.y));
-        float y_max = fmaxf(v0.y, fmaxf(v1.y, v2.y));
-        float z_min = fminf(v0.z, fminf(v1.z, v2.z));
-        float z_max = fmaxf(v0.z, fmaxf(v1.z, v2.z));
+        int lo[3], hi[3];
+        for (int j = 0; j < 3; j++) {
+            float mn = fminf(tri[0][j], fminf(tri[1][j], tri[2][j]));
+            float mx = fmaxf(tri[0][j], fmaxf(tri[1][j], tri[2][j]));
+            lo[j] = (int)floorf((mn - o[j]) / sp[j]);
+            hi[j] = (int)floorf((mx - o[j]) / sp[j]);
+            if (lo[j] < 0) lo[j] = 0;
+            if (hi[j] > box->dims[j] - 1) hi[j] = box->dims[j] - 1;
+            if (lo[j] > hi[j])
+                goto next_face;
+        }
+        if (lo[0] == hi[0] && lo[1] == hi[1] && lo[2] == hi[2]) {
+            /* Fine meshes: the triangle sits inside a single cell. */
+            grid[box_index(lo[0], lo[1], lo[2], box->dims)] = 1;
+            continue;
+        }
 
-        int gx0 = (int)floorf((x_min + 1.0f) * 0.5f * R);
-        int gx1 = (int)ceilf((x_max + 1.0f) * 0.5f * R);
-        int gy0 = (int)floorf((y_min + 1.0f) * 0.5f * R);
-        int gy1 = (int)ceilf((y_max + 1.0f) * 0.5f * R);
-        int gz0 = (int)floorf((z_min + 1.0f) * 0.5f * R);
-        int gz1 = (int)ceilf((z_max + 1.0f) * 0.5f * R);
-        if (gx0 < 0) gx0 = 0;
-        if (gy0 < 0) gy0 = 0;
-        if (gz0 < 0) gz0 = 0;
-        if (gx1 > R) gx1 = R;
-        if (gy1 > R) gy1 = R;
-        if (gz1 > R) gz1 = R;
-
-        for (int z = gz0; z < gz1; z++) {
-            for (int y = gy0; y < gy1; y++) {
-                for (int x = gx0; x < gx1; x++) {
-                    grid[voxel_index(x, y, z, R)] = 1;
+        float e1[3], e2[3];
+        for (int j = 0; j < 3; j++) {
+            e1[j] = tri[1][j] - tri[0][j];
+            e2[j] = tri[2][j] - tri[0][j];
+        }
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                      e1[2] * e2[0] - e1[0] * e2[2],
+                      e1[0] * e2[1] - e1[1] * e2[0]};
+
+        /* Dominant normal axis d; columns run along d over axes a, b. */
+        int d = 0;
+        if (fabsf(n[1]) > fabsf(n[d])) d = 1;
+        if (fabsf(n[2]) > fabsf(n[d])) d = 2;
+        int a = (d + 1) % 3, b = (d + 2) % 3;
+        float k = n[0] * tri[0][0] + n[1] * tri[0][1] + n[2] * tri[0][2];
+        int flat = fabsf(n[d]) < VOXELIZE_EPS;
+
+        /* Plane height over (a, b) and the 2D edge functions of the
+         * projected triangle (interior positive) are all linear, so
+         * their extremes over a column are the value at the column
+         * center plus or minus a fixed per-triangle reach. */
+        float ga = 0.0f, gb = 0.0f, g0 = 0.0f, greach = 0.0f;
+        if (!flat) {
+            ga = -n[a] / n[d];
+            gb = -n[b] / n[d];
+            g0 = k / n[d];
+            greach = fabsf(ga) * half[a] + fabsf(gb) * half[b];
+        }
+        float ea[3], eb[3], ec[3], ereach[3];
+        float orient = n[d] < 0.0f ? -1.0f : 1.0f;
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3;
+            /* E_i(pa, pb) = ea*pb - eb*pa + ec */
+            ea[i] = (tri[j][a] - tri[i][a]) * orient;
+            eb[i] = (tri[j][b] - tri[i][b]) * orient;
+            ec[i] = eb[i] * tri[i][a] - ea[i] * tri[i][b];
+            ereach[i] = fabsf(eb[i]) * half[a] + fabsf(ea[i]) * half[b];
+        }
+
+        /* Inner loop over the lower-stride axis to keep writes local. */
+        int outer = a > b ? a : b, inner = a > b ? b : a;
+        int cell[3];
+        float center[3];
+        for (cell[outer] = lo[outer]; cell[outer] <= hi[outer]; cell[outer]++) {
+            center[outer] = o[outer] + ((float)cell[outer] + 0.5f) * sp[outer];
+
+            /* Clip the row to the columns each edge can reach: along the
+             * row, E_i + reach >= 0 is a half-line in the inner axis.
+             * Widened by a cell; the per-column test below is exact. */
+            int i0 = lo[inner], i1 = hi[inner];
+            for (int i = 0; !flat && i < 3; i++) {
+                float slope = inner == a ? -eb[i] : ea[i];
+                float base = ereach[i] + ec[i] +
+                             (outer == a ? -eb[i] : ea[i]) * center[outer];
+                if (fabsf(slope) < VOXELIZE_EPS)
+                    continue;
+                float c = -base / slope; /* world coord where E + reach = 0 */
+                int ci = (int)floorf((c - o[inner]) / sp[inner]);
+                if (slope > 0.0f && ci - 1 > i0) i0 = ci - 1;
+                if (slope < 0.0f && ci + 1 < i1) i1 = ci + 1;
+            }
+
+            for (cell[inner] = i0; cell[inner] <= i1; cell[inner]++) {
+                center[inner] =
+                    o[inner] + ((float)cell[inner] + 0.5f) * sp[inner];
+
+                int d0 = lo[d], d1 = hi[d];
+                int interior = 0;
+                if (!flat) {
+                    int miss = 0;
+                    interior = 1;
+                    for (int i = 0; i < 3; i++) {
+                        float e = ea[i] * center[b] - eb[i] * center[a] + ec[i];
+                        if (e + ereach[i] < 0.0f)
+                            miss = 1; /* whole column outside this edge */
+                        if (e - ereach[i] < 0.0f)
+                            interior = 0;
+                    }
+                    if (miss)
+                        continue;
+
+                    float pd = g0 + ga * center[a] + gb * center[b];
+                    int c0 = (int)floorf((pd - greach - o[d]) / sp[d]);
+                    int c1 = (int)floorf((pd + greach - o[d]) / sp[d]);
+                    if (c0 > d0) d0 = c0;
+                    if (c1 < d1) d1 = c1;
+                }
+
+                for (cell[d] = d0; cell[d] <= d1; cell[d]++) {
+                    size_t idx =
+                        box_index(cell[0], cell[1], cell[2], box->dims);
+                    /* The triangle spans the whole column cross-section,
+                     * so every cell the plane crosses here is touched. */
+                    if (interior || grid[idx]) {
+                        grid[idx] = 1;
+                        continue;
+                    }
+                    center[d] = o[d] + ((float)cell[d] + 0.5f) * sp[d];
+                    if (tri_box_overlap(center, half, tri))
+                        grid[idx] = 1;
                 }
             }
         }
+    next_face:;
     }
 }
 
+/* A parity fill that is nearly empty or nearly full means the mesh is
+ * not watertight, so inside/outside cannot be trusted. */
+static int fill_is_degenerate(float solid_fraction) {
+    return solid_fraction < 0.001f || solid_fraction > 0.99f;
+}
+
 static int faces_valid(const Model *model) {
     for (int i = 0; i < model->faceCount; i++) {
         int i0 = model->faces[i].v1 - 1;
@@ -290,6 +517,30 @@ static int faces_valid(const Model *model) {
     return 1;
 }
 
+/* Fill `data` (box_cells bytes, zeroed) per `mode`. */
+static void voxelize_into(const Vec3 *verts,
+                          const Face *faces,
+                          int face_count,
+                          const VoxelBox *box,
+                          VoxelizeMode mode,
+                          uint8_t *data) {
+    if (mode == VOXELIZE_MODE_SURFACE) {
+        voxelize_surface(verts, faces, face_count, box, data);
+        return;
+    }
+    voxelize_solid(verts, faces, face_count, box, data);
+    if (mode == VOXELIZE_MODE_AUTO) {
+        size_t n = box_cells(box);
+        size_t solid = 0;
+        for (size_t i = 0; i < n; i++)
+            solid += data[i];
+        if (fill_is_degenerate((float)solid / (float)n)) {
+            memset(data, 0, n);
+            voxelize_surface(verts, faces, face_count, box, data);
+        }
+    }
+}
+
 VoxelGrid *Voxelize_FromModel(const Model *model,
                               int resolution,
                               float padding,
@@ -304,7 +555,9 @@ VoxelGrid *Voxelize_FromModel(const Model *model,
     if (!faces_valid(model))
         return NULL;
 
-    Vec3 *verts = copy_and_normalize_vertices(model, padding, align_longest_x);
+    VoxelBox box = cube_box(resolution);
+    Vec3 *verts =
+        copy_and_normalize_vertices(model, padding, align_longest_x, &box);
     if (!verts)
         return NULL;
 
@@ -314,32 +567,99 @@ VoxelGrid *Voxelize_FromModel(const Model *model,
         return NULL;
     }
     grid->resolution = resolution;
-    size_t n = (size_t)resolution * resolution * resolution;
-    grid->data = (uint8_t *)calloc(n, 1);
+    grid->data = (uint8_t *)calloc(box_cells(&box), 1);
     if (!grid->data) {
         free(verts);
         free(grid);
         return NULL;
     }
 
-    if (mode == VOXELIZE_MODE_SURFACE) {
-        voxelize_surface(verts, model->faces, model->faceCount, resolution,
-                         grid->data);
-    } else {
-        voxelize_solid(verts, model->faces, model->faceCount, resolution,
-                       grid->data);
-        if (mode == VOXELIZE_MODE_AUTO) {
-            float frac = Voxelize_SolidFraction(grid);
-            if (frac < 0.001f || frac > 0.99f) {
-                memset(grid->data, 0, n);
-                voxelize_surface(verts, model->faces, model->faceCount,
-                                 resolution, grid->data);
-            }
-        }
+    voxelize_into(verts, model->faces, model->faceCount, &box, mode,
+                  grid->data);
+    free(verts);
+    return grid;
+}
+
+static VoxelLattice *lattice_alloc(const VoxelBox *box) {
+    VoxelLattice *lat = (VoxelLattice *)malloc(sizeof(VoxelLattice));
+    if (!lat)
+        return NULL;
+    lat->box = *box;
+    lat->data = (uint8_t *)calloc(box_cells(box), 1);
+    if (!lat->data) {
+        free(lat);
+        return NULL;
+    }
+    return lat;
+}
+
+VoxelLattice *Voxelize_FromModelInBox(const Model *model,
+                                      const VoxelBox *box,
+                                      float padding,
+                                      int align_longest_x,
+                                      VoxelizeMode mode) {
+    if (!model || !box || !box_valid(box) || model->vertexCount <= 0 ||
+        model->faceCount <= 0)
+        return NULL;
+    if (padding < 0.0f) padding = 0.0f;
+    if (padding >= 0.5f) padding = 0.499f;
+    if (!faces_valid(model))
+        return NULL;
+
+    Vec3 *verts =
+        copy_and_normalize_vertices(model, padding, align_longest_x, box);
+    if (!verts)
+        return NULL;
+    VoxelLattice *lat = lattice_alloc(box);
+    if (lat)
+        voxelize_into(verts, model->faces, model->faceCount, box, mode,
+                      lat->data);
+    free(verts);
+    return lat;
+}
+
+VoxelLattice *Voxelize_TrianglesInBox(const float *xyz,
+                                      int vertex_stride,
+                                      int triangle_count,
+                                      const VoxelBox *box,
+                                      VoxelizeMode mode) {
+    if (!xyz || vertex_stride < 3 || triangle_count <= 0 || !box ||
+        !box_valid(box))
+        return NULL;
+
+    int vertex_count = 3 * triangle_count;
+    Vec3 *verts = (Vec3 *)malloc((size_t)vertex_count * sizeof(Vec3));
+    Face *faces = (Face *)malloc((size_t)triangle_count * sizeof(Face));
+    VoxelLattice *lat = NULL;
+    if (!verts || !faces)
+        goto done;
+    for (int i = 0; i < vertex_count; i++) {
+        const float *p = xyz + (size_t)i * vertex_stride;
+        verts[i].x = p[0];
+        verts[i].y = p[1];
+        verts[i].z = p[2];
     }
+    for (int t = 0; t < triangle_count; t++) {
+        faces[t].v1 = 3 * t + 1;
+        faces[t].v2 = 3 * t + 2;
+        faces[t].v3 = 3 * t + 3;
+    }
+
+    lat = lattice_alloc(box);
+    if (lat)
+        voxelize_into(verts, faces, triangle_count, box, mode, lat->data);
 
+done:
     free(verts);
-    return grid;
+    free(faces);
+    return lat;
+}
+
+void Voxelize_FreeLattice(VoxelLattice *lat) {
+    if (!lat)
+        return;
+    free(lat->data);
+    free(lat);
 }
 
 float Voxelize_SolidFraction(const VoxelGrid *grid) {
@@ -380,8 +700,750 @@ fail:
     return -1;
 }
 
+/* Squared distance standing in for "no seed on this line". Finite so
+ * the parabola intersections below stay well defined. */
+#define EDT_INF 1e20f
+
+/*
+ * 1D squared Euclidean distance transform (Felzenszwalb & Huttenlocher):
+ * lower envelope of parabolas rooted at each sample, O(n).
+ * v holds n parabola roots, z holds n+1 envelope boundaries.
+ */
+static void edt_1d(const float *f, int n, float *d, int *v, float *z) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -EDT_INF;
+    z[1] = EDT_INF;
+    for (int q = 1; q < n; q++) {
+        float s;
+        for (;;) {
+            int r = v[k];
+            s = ((f[q] + (float)q * q) - (f[r] + (float)r * r)) /
+                (2.0f * (float)(q - r));
+            /* z[0] = -EDT_INF bounds s from below, so k never underflows. */
+            if (s > z[k])
+                break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = EDT_INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < (float)q)
+            k++;
+        float dq = (float)(q - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+/*
+ * One separable pass along an axis with the given element stride. Lines
+ * are independent, so they are split across threads. Every thread must
+ * reach the worksharing loop, so a thread whose scratch allocation failed
+ * still enters it and skips its lines.
+ */
+static int edt_pass(float *grid, int R, int stride, int line_step_a,
+                    int line_step_b) {
+    int failed = 0;
+#ifdef _OPENMP
+#pragma omp parallel reduction(| : failed)
+#endif
+    {
+        float *f = (float *)malloc((size_t)R * sizeof(float));
+        float *d = (float *)malloc((size_t)R * sizeof(float));
+        float *z = (float *)malloc((size_t)(R + 1) * sizeof(float));
+        int *v = (int *)malloc((size_t)R * sizeof(int));
+        int ok = f && d && z && v;
+        if (!ok)
+            failed = 1;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (int line = 0; line < R * R; line++) {
+            if (!ok)
+                continue;
+            float *base = grid + (size_t)(line % R) * line_step_a +
+                          (size_t)(line / R) * line_step_b;
+            for (int i = 0; i < R; i++)
+                f[i] = base[(size_t)i * stride];
+            edt_1d(f, R, d, v, z);
+            for (int i = 0; i < R; i++)
+                base[(size_t)i * stride] = d[i];
+        }
+        free(f);
+        free(d);
+        free(z);
+        free(v);
+    }
+    return failed ? -1 : 0;
+}
+
+SdfGrid *Voxelize_SdfFromModel(const Model *model,
+                               int resolution,
+                               float padding,
+                               int align_longest_x) {
+    VoxelGrid *shell = Voxelize_FromModel(
+        model, resolution, padding, align_longest_x, VOXELIZE_MODE_SURFACE);
+    VoxelGrid *fill = Voxelize_FromModel(
+        model, resolution, padding, align_longest_x, VOXELIZE_MODE_SOLID);
+    SdfGrid *sdf = (SdfGrid *)malloc(sizeof(SdfGrid));
+    size_t n = (size_t)resolution * resolution * resolution;
+    float *dist = (float *)malloc(n * sizeof(float));
+    if (!shell || !fill || !sdf || !dist)
+        goto fail;
+
+    for (size_t i = 0; i < n; i++)
+        dist[i] = shell->data[i] ? 0.0f : EDT_INF;
+
+    int R = resolution;
+    if (edt_pass(dist, R, 1, R, R * R) != 0 ||     /* along X */
+        edt_pass(dist, R, R, 1, R * R) != 0 ||     /* along Y */
+        edt_pass(dist, R, R * R, 1, R) != 0)       /* along Z */
+        goto fail;
+
+    int use_sign = !fill_is_degenerate(Voxelize_SolidFraction(fill));
+    float voxel = 2.0f / (float)R;
+    for (size_t i = 0; i < n; i++) {
+        float d = sqrtf(dist[i]) * voxel;
+        dist[i] = (use_sign && fill->data[i] && !shell->data[i]) ? -d : d;
+    }
+
+    Voxelize_Free(shell);
+    Voxelize_Free(fill);
+    sdf->resolution = R;
+    sdf->data = dist;
+    return sdf;
+
+fail:
+    Voxelize_Free(shell);
+    Voxelize_Free(fill);
+    free(sdf);
+    free(dist);
+    return NULL;
+}
+
+int Voxelize_WriteSdf(const SdfGrid *sdf, const char *path) {
+    if (!sdf || !sdf->data || !path)
+        return -1;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    const char magic[4] = {'S', 'D', 'F', 'B'};
+    uint32_t version = 1;
+    uint32_t resolution = (uint32_t)sdf->resolution;
+    size_t n = (size_t)sdf->resolution * sdf->resolution * sdf->resolution;
+
+    int rc = -1;
+    if (fwrite(magic, 1, 4, f) == 4 &&
+        fwrite(&version, sizeof(uint32_t), 1, f) == 1 &&
+        fwrite(&resolution, sizeof(uint32_t), 1, f) == 1 &&
+        fwrite(sdf->data, sizeof(float), n, f) == n)
+        rc = 0;
+    if (fclose(f) != 0)
+        rc = -1;
+    return rc;
+}
+
+void Voxelize_FreeSdf(SdfGrid *sdf) {
+    if (!sdf) return;
+    free(sdf->data);
+    free(sdf);
+}
+
+static int write_row_bits(FILE *f, const uint8_t *row, int R, uint8_t *buf) {
+    size_t nbytes = (size_t)(R + 7) / 8;
+    memset(buf, 0, nbytes);
+    for (int x = 0; x < R; x++) {
+        if (row[x])
+            buf[x >> 3] |= (uint8_t)(1u << (x & 7));
+    }
+    return fwrite(buf, 1, nbytes, f) == nbytes ? 0 : -1;
+}
+
+static int write_row_rle(FILE *f, const uint8_t *row, int R, uint16_t *runs) {
+    /* Runs alternate empty/solid starting with empty, so a row that
+     * begins solid gets a leading zero-length run. */
+    uint16_t n = 0;
+    int solid = 0;
+    for (int x = 0; x < R;) {
+        int start = x;
+        while (x < R && (row[x] != 0) == solid)
+            x++;
+        runs[n++] = (uint16_t)(x - start);
+        solid = !solid;
+    }
+    if (n == 1)
+        n = 0; /* one empty run spanning the row */
+
+    if (fwrite(&n, sizeof(uint16_t), 1, f) != 1)
+        return -1;
+    return fwrite(runs, sizeof(uint16_t), n, f) == n ? 0 : -1;
+}
+
+int Voxelize_WriteBinaryV2(const VoxelGrid *grid,
+                           const char *path,
+                           VoxbinEncoding encoding) {
+    if (!grid || !grid->data || !path || grid->resolution > UINT16_MAX)
+        return -1;
+    if (encoding != VOXBIN_ENCODING_BITS && encoding != VOXBIN_ENCODING_RLE)
+        return -1;
+
+    int R = grid->resolution;
+    /* Big enough for either a bit row or R+1 run lengths. */
+    void *scratch = malloc((size_t)(R + 1) * sizeof(uint16_t));
+    if (!scratch)
+        return -1;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(scratch);
+        return -1;
+    }
+
+    const char magic[4] = {'V', 'O', 'X', 'B'};
+    uint32_t header[3] = {2, (uint32_t)R, (uint32_t)encoding};
+    int rc = -1;
+    if (fwrite(magic, 1, 4, f) != 4) goto done;
+    if (fwrite(header, sizeof(uint32_t), 3, f) != 3) goto done;
+
+    for (int row = 0; row < R * R; row++) {
+        const uint8_t *src = grid->data + (size_t)row * R;
+        int err = encoding == VOXBIN_ENCODING_BITS
+                      ? write_row_bits(f, src, R, (uint8_t *)scratch)
+                      : write_row_rle(f, src, R, (uint16_t *)scratch);
+        if (err)
+            goto done;
+    }
+    rc = 0;
+
+done:
+    if (fclose(f) != 0)
+        rc = -1;
+    free(scratch);
+    return rc;
+}
+
+struct VoxbinReader {
+    FILE *f;
+    int resolution;
+    uint32_t version;
+    uint32_t encoding;
+    int rows_left;
+    void *scratch;
+};
+
+VoxbinReader *Voxelize_OpenBinary(const char *path, int *resolution) {
+    if (!path)
+        return NULL;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    char magic[4];
+    uint32_t version = 0, res = 0, encoding = 0;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "VOXB", 4) != 0 ||
+        fread(&version, sizeof(uint32_t), 1, f) != 1 ||
+        fread(&res, sizeof(uint32_t), 1, f) != 1)
+        goto fail;
+    if (version == 2) {
+        if (fread(&encoding, sizeof(uint32_t), 1, f) != 1 ||
+            (encoding != VOXBIN_ENCODING_BITS &&
+             encoding != VOXBIN_ENCODING_RLE))
+            goto fail;
+    } else if (version != 1) {
+        goto fail;
+    }
+    if (res == 0 || res > UINT16_MAX)
+        goto fail;
+
+    VoxbinReader *r = (VoxbinReader *)calloc(1, sizeof(*r));
+    if (!r)
+        goto fail;
+    r->scratch = malloc((size_t)(res + 1) * sizeof(uint16_t));
+    if (!r->scratch) {
+        free(r);
+        goto fail;
+    }
+    r->f = f;
+    r->resolution = (int)res;
+    r->version = version;
+    r->encoding = encoding;
+    r->rows_left = (int)(res * res);
+    if (resolution)
+        *resolution = (int)res;
+    return r;
+
+fail:
+    fclose(f);
+    return NULL;
+}
+
+int Voxelize_ReadRow(VoxbinReader *r, uint8_t *row) {
+    if (!r || !row)
+        return -1;
+    if (r->rows_left == 0)
+        return 0;
+
+    int R = r->resolution;
+    if (r->version == 1) {
+        if (fread(row, 1, (size_t)R, r->f) != (size_t)R)
+            return -1;
+    } else if (r->encoding == VOXBIN_ENCODING_BITS) {
+        uint8_t *bits = (uint8_t *)r->scratch;
+        size_t nbytes = (size_t)(R + 7) / 8;
+        if (fread(bits, 1, nbytes, r->f) != nbytes)
+            return -1;
+        for (int x = 0; x < R; x++)
+            row[x] = (bits[x >> 3] >> (x & 7)) & 1u;
+    } else {
+        uint16_t *runs = (uint16_t *)r->scratch;
+        uint16_t n = 0;
+        if (fread(&n, sizeof(uint16_t), 1, r->f) != 1 || n > R + 1)
+            return -1;
+        if (fread(runs, sizeof(uint16_t), n, r->f) != n)
+            return -1;
+        if (n == 0) {
+            memset(row, 0, (size_t)R);
+        } else {
+            int x = 0;
+            for (int i = 0; i < n; i++) {
+                if (x + runs[i] > R)
+                    return -1;
+                memset(row + x, i & 1, runs[i]);
+                x += runs[i];
+            }
+            if (x != R)
+                return -1;
+        }
+    }
+
+    r->rows_left--;
+    return 1;
+}
+
+void Voxelize_CloseBinary(VoxbinReader *r) {
+    if (!r)
+        return;
+    fclose(r->f);
+    free(r->scratch);
+    free(r);
+}
+
+VoxelGrid *Voxelize_ReadBinary(const char *path) {
+    int R = 0;
+    VoxbinReader *r = Voxelize_OpenBinary(path, &R);
+    if (!r)
+        return NULL;
+
+    VoxelGrid *grid = (VoxelGrid *)malloc(sizeof(VoxelGrid));
+    if (grid) {
+        grid->resolution = R;
+        grid->data = (uint8_t *)malloc((size_t)R * R * R);
+    }
+    if (!grid || !grid->data) {
+        free(grid);
+        Voxelize_CloseBinary(r);
+        return NULL;
+    }
+
+    for (int row = 0; row < R * R; row++) {
+        if (Voxelize_ReadRow(r, grid->data + (size_t)row * R) != 1) {
+            Voxelize_Free(grid);
+            grid = NULL;
+            break;
+        }
+    }
+    Voxelize_CloseBinary(r);
+    return grid;
+}
+
+int Voxelize_WriteLattice(const VoxelLattice *lat, const char *path) {
+    if (!lat || !lat->data || !path || !box_valid(&lat->box))
+        return -1;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    const char magic[4] = {'V', 'O', 'X', 'B'};
+    uint32_t header[4] = {3,
+                          (uint32_t)lat->box.dims[0],
+                          (uint32_t)lat->box.dims[1],
+                          (uint32_t)lat->box.dims[2]};
+    if (fwrite(magic, 1, 4, f) != 4) goto fail;
+    if (fwrite(header, sizeof(uint32_t), 4, f) != 4) goto fail;
+    if (fwrite(lat->box.min, sizeof(float), 3, f) != 3) goto fail;
+    if (fwrite(lat->box.max, sizeof(float), 3, f) != 3) goto fail;
+
+    size_t n = box_cells(&lat->box);
+    if (fwrite(lat->data, 1, n, f) != n) goto fail;
+
+    return fclose(f) == 0 ? 0 : -1;
+
+fail:
+    fclose(f);
+    return -1;
+}
+
+VoxelLattice *Voxelize_ReadLattice(const char *path) {
+    if (!path)
+        return NULL;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    char magic[4];
+    uint32_t header[4];
+    VoxelBox box;
+    VoxelLattice *lat = NULL;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "VOXB", 4) != 0 ||
+        fread(header, sizeof(uint32_t), 4, f) != 4 || header[0] != 3)
+        goto done;
+    for (int j = 0; j < 3; j++) {
+        if (header[j + 1] == 0 || header[j + 1] > 65536)
+            goto done;
+        box.dims[j] = (int)header[j + 1];
+    }
+    if (fread(box.min, sizeof(float), 3, f) != 3 ||
+        fread(box.max, sizeof(float), 3, f) != 3 || !box_valid(&box))
+        goto done;
+
+    lat = lattice_alloc(&box);
+    if (lat && fread(lat->data, 1, box_cells(&box), f) != box_cells(&box)) {
+        Voxelize_FreeLattice(lat);
+        lat = NULL;
+    }
+
+done:
+    fclose(f);
+    return lat;
+}
+
 void Voxelize_Free(VoxelGrid *grid) {
     if (!grid) return;
     free(grid->data);
     free(grid);
 }
+
+#define VOXPACK_HEADER_BYTES 16
+
+/*
+ * Absolute seek to a 64-bit file offset. fseek takes a long, which is 32
+ * bits on some targets, so offsets past 2 GB would wrap; this fails
+ * instead when the platform offset type cannot hold `offset`.
+ */
+static int seek_abs(FILE *f, uint64_t offset) {
+#ifdef _WIN32
+    if (offset > (uint64_t)INT64_MAX)
+        return -1;
+    return _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+    off_t pos = (off_t)offset;
+    if (pos < 0 || (uint64_t)pos != offset)
+        return -1;
+    return fseeko(f, pos, SEEK_SET);
+#endif
+}
+
+struct VoxelPackWriter {
+    FILE *f;
+    int count;
+    int resolution;
+    uint64_t *offsets;
+    uint64_t end; /* current file size, where the next grid goes */
+};
+
+VoxelPackWriter *Voxelize_PackOpen(const char *path, int count, int resolution) {
+    if (!path || count <= 0 || resolution <= 0)
+        return NULL;
+
+    VoxelPackWriter *pack = (VoxelPackWriter *)calloc(1, sizeof(*pack));
+    if (!pack)
+        return NULL;
+    pack->offsets = (uint64_t *)calloc((size_t)count, sizeof(uint64_t));
+    pack->f = fopen(path, "wb");
+    if (!pack->offsets || !pack->f)
+        goto fail;
+    pack->count = count;
+    pack->resolution = resolution;
+
+    const char magic[4] = {'V', 'O', 'X', 'P'};
+    uint32_t header[3] = {1, (uint32_t)count, (uint32_t)resolution};
+    if (fwrite(magic, 1, 4, pack->f) != 4) goto fail;
+    if (fwrite(header, sizeof(uint32_t), 3, pack->f) != 3) goto fail;
+
+    /* Placeholder table, rewritten by Voxelize_PackClose. */
+    if (fwrite(pack->offsets, sizeof(uint64_t), (size_t)count, pack->f) !=
+        (size_t)count)
+        goto fail;
+    pack->end = VOXPACK_HEADER_BYTES + (uint64_t)count * sizeof(uint64_t);
+    return pack;
+
+fail:
+    if (pack->f)
+        fclose(pack->f);
+    free(pack->offsets);
+    free(pack);
+    return NULL;
+}
+
+int Voxelize_PackAppend(VoxelPackWriter *pack, int id, const VoxelGrid *grid) {
+    if (!pack || !grid || !grid->data || id < 0 || id >= pack->count)
+        return -1;
+    if (grid->resolution != pack->resolution || pack->offsets[id] != 0)
+        return -1;
+
+    size_t n = (size_t)grid->resolution * grid->resolution * grid->resolution;
+    if (fwrite(grid->data, 1, n, pack->f) != n)
+        return -1;
+    pack->offsets[id] = pack->end;
+    pack->end += n;
+    return 0;
+}
+
+int Voxelize_PackClose(VoxelPackWriter *pack) {
+    if (!pack)
+        return -1;
+
+    int rc = 0;
+    if (fseek(pack->f, VOXPACK_HEADER_BYTES, SEEK_SET) != 0 ||
+        fwrite(pack->offsets, sizeof(uint64_t), (size_t)pack->count,
+               pack->f) != (size_t)pack->count)
+        rc = -1;
+    if (fclose(pack->f) != 0)
+        rc = -1;
+    free(pack->offsets);
+    free(pack);
+    return rc;
+}
+
+VoxelGrid *Voxelize_PackLoad(const char *path, int id) {
+    if (!path || id < 0)
+        return NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    char magic[4];
+    uint32_t header[3];
+    uint64_t offset = 0;
+    VoxelGrid *grid = NULL;
+
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "VOXP", 4) != 0)
+        goto done;
+    if (fread(header, sizeof(uint32_t), 3, f) != 3 || header[0] != 1)
+        goto done;
+    if ((uint32_t)id >= header[1] || header[2] == 0)
+        goto done;
+    if (seek_abs(f, VOXPACK_HEADER_BYTES + (uint64_t)id * sizeof(uint64_t)) !=
+            0 ||
+        fread(&offset, sizeof(uint64_t), 1, f) != 1 || offset == 0)
+        goto done;
+    if (seek_abs(f, offset) != 0)
+        goto done;
+
+    int R = (int)header[2];
+    size_t n = (size_t)R * R * R;
+    grid = (VoxelGrid *)malloc(sizeof(VoxelGrid));
+    if (!grid)
+        goto done;
+    grid->resolution = R;
+    grid->data = (uint8_t *)malloc(n);
+    if (!grid->data || fread(grid->data, 1, n, f) != n) {
+        Voxelize_Free(grid);
+        grid = NULL;
+    }
+
+done:
+    fclose(f);
+    return grid;
+}
+
+#define VOXPYR_HEADER_BYTES 16
+
+VoxelPyramid *Voxelize_PyramidFromModel(const Model *model,
+                                        int resolution,
+                                        int levels,
+                                        float padding,
+                                        int align_longest_x,
+                                        VoxelizeMode mode,
+                                        float min_fraction) {
+    if (levels <= 0 || levels > 8 || min_fraction <= 0.0f ||
+        min_fraction > 1.0f)
+        return NULL;
+    if (resolution % (1 << (levels - 1)) != 0)
+        return NULL;
+
+    VoxelPyramid *pyr = (VoxelPyramid *)calloc(1, sizeof(VoxelPyramid));
+    if (!pyr)
+        return NULL;
+    pyr->grids = (VoxelGrid *)calloc((size_t)levels, sizeof(VoxelGrid));
+    if (!pyr->grids)
+        goto fail;
+    pyr->levels = levels;
+    pyr->min_fraction = min_fraction;
+
+    VoxelGrid *finest = Voxelize_FromModel(
+        model, resolution, padding, align_longest_x, mode);
+    if (!finest)
+        goto fail;
+    pyr->grids[0] = *finest;
+    free(finest);
+
+    /* Solid counts per coarse cell are summed level to level, so every
+     * level thresholds the exact occupancy of its finest-level block. */
+    uint32_t *counts = NULL;
+    for (int l = 1; l < levels; l++) {
+        int Rf = pyr->grids[l - 1].resolution;
+        int R = Rf / 2;
+        size_t n = (size_t)R * R * R;
+        uint32_t *next = (uint32_t *)malloc(n * sizeof(uint32_t));
+        uint8_t *data = (uint8_t *)malloc(n);
+        if (!next || !data) {
+            free(next);
+            free(data);
+            free(counts);
+            goto fail;
+        }
+        const uint8_t *fine = pyr->grids[l - 1].data;
+        uint32_t block = 1u << (3 * l); /* finest cells per coarse cell */
+        uint32_t needed = (uint32_t)ceilf(min_fraction * (float)block);
+        if (needed == 0)
+            needed = 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int z = 0; z < R; z++) {
+            for (int y = 0; y < R; y++) {
+                for (int x = 0; x < R; x++) {
+                    uint32_t sum = 0;
+                    for (int k = 0; k < 8; k++) {
+                        int i = voxel_index(2 * x + (k & 1),
+                                            2 * y + ((k >> 1) & 1),
+                                            2 * z + (k >> 2),
+                                            Rf);
+                        sum += counts ? counts[i] : fine[i];
+                    }
+                    int c = voxel_index(x, y, z, R);
+                    next[c] = sum;
+                    data[c] = sum >= needed ? 1 : 0;
+                }
+            }
+        }
+
+        free(counts);
+        counts = next;
+        pyr->grids[l].resolution = R;
+        pyr->grids[l].data = data;
+    }
+    free(counts);
+    return pyr;
+
+fail:
+    Voxelize_FreePyramid(pyr);
+    return NULL;
+}
+
+int Voxelize_WritePyramid(const VoxelPyramid *pyr, const char *path) {
+    if (!pyr || pyr->levels <= 0 || !path)
+        return -1;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    const char magic[4] = {'V', 'P', 'Y', 'R'};
+    uint32_t version = 1;
+    uint32_t levels = (uint32_t)pyr->levels;
+    float min_fraction = pyr->min_fraction;
+    if (fwrite(magic, 1, 4, f) != 4) goto fail;
+    if (fwrite(&version, sizeof(uint32_t), 1, f) != 1) goto fail;
+    if (fwrite(&levels, sizeof(uint32_t), 1, f) != 1) goto fail;
+    if (fwrite(&min_fraction, sizeof(float), 1, f) != 1) goto fail;
+
+    uint64_t offset = VOXPYR_HEADER_BYTES + (uint64_t)levels * 16;
+    for (int l = 0; l < pyr->levels; l++) {
+        uint32_t entry[2] = {(uint32_t)pyr->grids[l].resolution, 0};
+        if (fwrite(entry, sizeof(uint32_t), 2, f) != 2) goto fail;
+        if (fwrite(&offset, sizeof(uint64_t), 1, f) != 1) goto fail;
+        uint64_t R = (uint64_t)pyr->grids[l].resolution;
+        offset += R * R * R;
+    }
+    for (int l = 0; l < pyr->levels; l++) {
+        const VoxelGrid *g = &pyr->grids[l];
+        size_t n = (size_t)g->resolution * g->resolution * g->resolution;
+        if (!g->data || fwrite(g->data, 1, n, f) != n) goto fail;
+    }
+
+    return fclose(f) == 0 ? 0 : -1;
+
+fail:
+    fclose(f);
+    return -1;
+}
+
+VoxelGrid *Voxelize_PyramidLoad(const char *path, int level) {
+    if (!path || level < 0)
+        return NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    char magic[4];
+    uint32_t header[2];
+    float min_fraction;
+    uint32_t entry[2];
+    uint64_t offset;
+    VoxelGrid *grid = NULL;
+
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "VPYR", 4) != 0)
+        goto done;
+    if (fread(header, sizeof(uint32_t), 2, f) != 2 || header[0] != 1)
+        goto done;
+    if (fread(&min_fraction, sizeof(float), 1, f) != 1)
+        goto done;
+    if ((uint32_t)level >= header[1])
+        goto done;
+    if (seek_abs(f, VOXPYR_HEADER_BYTES + (uint64_t)level * 16) != 0 ||
+        fread(entry, sizeof(uint32_t), 2, f) != 2 ||
+        fread(&offset, sizeof(uint64_t), 1, f) != 1 || entry[0] == 0)
+        goto done;
+    if (seek_abs(f, offset) != 0)
+        goto done;
+
+    int R = (int)entry[0];
+    size_t n = (size_t)R * R * R;
+    grid = (VoxelGrid *)malloc(sizeof(VoxelGrid));
+    if (!grid)
+        goto done;
+    grid->resolution = R;
+    grid->data = (uint8_t *)malloc(n);
+    if (!grid->data || fread(grid->data, 1, n, f) != n) {
+        Voxelize_Free(grid);
+        grid = NULL;
+    }
+
+done:
+    fclose(f);
+    return grid;
+}
+
+void Voxelize_FreePyramid(VoxelPyramid *pyr) {
+    if (!pyr)
+        return;
+    if (pyr->grids) {
+        for (int l = 0; l < pyr->levels; l++)
+            free(pyr->grids[l].data);
+        free(pyr->grids);
+    }
+    free(pyr);
+}
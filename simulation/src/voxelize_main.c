@@ -1,41 +1,303 @@
 /*
- * voxelize_obj: standalone CLI that rasterizes an OBJ mesh into a
- * fixed-resolution binary occupancy grid (.voxbin). Used by the ML
- * dataset pipeline to generate input tensors for the Cd surrogate.
+ * voxelize_obj: standalone CLI that rasterizes an OBJ or STL mesh
+ * (chosen by extension) into a fixed-resolution binary occupancy grid
+ * (.voxbin). Used by the ML dataset pipeline to generate input tensors
+ * for the Cd surrogate.
  *
  * Example:
  *   ./build/voxelize_obj assets/3d-files/ahmed_25deg_m.obj \
  *       --resolution 32 --output ahmed25.voxbin
+ *
+ * --encoding bits|rle writes the compact version-2 format instead of
+ * one byte per voxel. --sdf PATH also writes a signed distance field.
+ * --levels N writes a .voxpyr holding the grid at N resolutions
+ * (R, R/2, ...) downsampled from one voxelization; a coarse cell is
+ * solid when --min-fraction of its finest cells are (default 0.5).
+ *
+ * --dims NX,NY,NZ voxelizes into a non-cubic lattice (version-3
+ * .voxbin) instead of R^3. The mesh is fitted into --box
+ * X0,Y0,Z0,X1,Y1,Z1, which defaults to a box with cubic cells around
+ * the origin. To match the default LBM lattice:
+ *   ./build/voxelize_obj car.obj --dims 128,64,64 --box -4,-2,-2,4,2,2
+ *
+ * Batch mode voxelizes every OBJ/STL listed in a manifest (one path per
+ * line, '#' comments allowed) or found in a directory, in parallel,
+ * into a single .voxpack. Shape ids are manifest line order, or sorted
+ * filename order for a directory:
+ *   ./build/voxelize_obj --batch shapes/ --resolution 64 \
+ *       --output shapes.voxpack
  */
 
 #include "../lib/voxelize.h"
 #include "../obj-file-loader/lib/model_loader.h"
 
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 static void usage(const char *prog) {
     fprintf(stderr,
-            "usage: %s <input.obj> [--resolution N] [--padding F] "
-            "[--mode solid|surface|auto] [--no-align] [--output PATH]\n",
+            "usage: %s <input.obj|stl> [--resolution N] [--padding F] "
+            "[--mode solid|surface|auto] [--no-align] [--output PATH]\n"
+            "       [--encoding raw|bits|rle] [--sdf PATH] [--levels N "
+            "[--min-fraction F]]\n"
+            "       [--dims NX,NY,NZ [--box X0,Y0,Z0,X1,Y1,Z1]]\n"
+            "       %s --batch <manifest|dir> --output PACK.voxpack "
+            "[--threads N] [options]\n",
+            prog,
             prog);
 }
 
+typedef struct {
+    char **items;
+    int count;
+    int capacity;
+} PathList;
+
+static int pathlist_push(PathList *l, const char *path) {
+    if (l->count >= l->capacity) {
+        int new_cap = l->capacity ? l->capacity * 2 : 64;
+        char **items =
+            (char **)realloc(l->items, (size_t)new_cap * sizeof(char *));
+        if (!items)
+            return -1;
+        l->items = items;
+        l->capacity = new_cap;
+    }
+    size_t len = strlen(path);
+    char *copy = (char *)malloc(len + 1);
+    if (!copy)
+        return -1;
+    memcpy(copy, path, len + 1);
+    l->items[l->count++] = copy;
+    return 0;
+}
+
+static void pathlist_free(PathList *l) {
+    for (int i = 0; i < l->count; i++)
+        free(l->items[i]);
+    free(l->items);
+    memset(l, 0, sizeof(*l));
+}
+
+static int cmp_path(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int collect_dir(const char *dir, PathList *out) {
+    DIR *d = opendir(dir);
+    if (!d)
+        return -1;
+    struct dirent *e;
+    char path[4096];
+    while ((e = readdir(d)) != NULL) {
+        if (!isModelPath(e->d_name))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (pathlist_push(out, path) != 0) {
+            closedir(d);
+            return -1;
+        }
+    }
+    closedir(d);
+    /* readdir order is filesystem-dependent; sort so ids are stable. */
+    qsort(out->items, (size_t)out->count, sizeof(char *), cmp_path);
+    return 0;
+}
+
+static int collect_manifest(const char *manifest, PathList *out) {
+    FILE *f = fopen(manifest, "r");
+    if (!f)
+        return -1;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t'))
+            line[--len] = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '\0' || *p == '#')
+            continue;
+        if (pathlist_push(out, p) != 0) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static int run_lattice(const Model *model,
+                       const int dims[3],
+                       const float *box_bounds,
+                       float padding,
+                       int align_longest_x,
+                       VoxelizeMode mode,
+                       const char *output_path) {
+    VoxelBox box;
+    int dmax = dims[0];
+    if (dims[1] > dmax) dmax = dims[1];
+    if (dims[2] > dmax) dmax = dims[2];
+    for (int j = 0; j < 3; j++) {
+        box.dims[j] = dims[j];
+        if (box_bounds) {
+            box.min[j] = box_bounds[j];
+            box.max[j] = box_bounds[j + 3];
+        } else {
+            /* Cubic cells, longest axis spanning [-1, 1]. */
+            box.max[j] = (float)dims[j] / (float)dmax;
+            box.min[j] = -box.max[j];
+        }
+    }
+
+    VoxelLattice *lat =
+        Voxelize_FromModelInBox(model, &box, padding, align_longest_x, mode);
+    if (!lat) {
+        fprintf(stderr, "voxelization failed\n");
+        return 1;
+    }
+
+    size_t total = (size_t)dims[0] * dims[1] * dims[2];
+    size_t solid = 0;
+    for (size_t i = 0; i < total; i++)
+        solid += lat->data[i];
+    printf("voxelized %dx%dx%d in [%g,%g]x[%g,%g]x[%g,%g], "
+           "solid=%zu/%zu (%.2f%%)\n",
+           dims[0], dims[1], dims[2],
+           box.min[0], box.max[0], box.min[1], box.max[1],
+           box.min[2], box.max[2],
+           solid, total, 100.0 * (double)solid / (double)total);
+
+    int rc = 0;
+    if (output_path) {
+        if (Voxelize_WriteLattice(lat, output_path) != 0) {
+            fprintf(stderr, "failed to write %s\n", output_path);
+            rc = 1;
+        } else {
+            printf("wrote %s\n", output_path);
+        }
+    }
+    Voxelize_FreeLattice(lat);
+    return rc;
+}
+
+static int run_batch(const char *batch_path,
+                     const char *output_path,
+                     int resolution,
+                     float padding,
+                     int align_longest_x,
+                     VoxelizeMode mode,
+                     int threads) {
+    PathList inputs = {0};
+    struct stat st;
+    if (stat(batch_path, &st) != 0) {
+        fprintf(stderr, "cannot stat %s\n", batch_path);
+        return 1;
+    }
+    int rc = S_ISDIR(st.st_mode) ? collect_dir(batch_path, &inputs)
+                                 : collect_manifest(batch_path, &inputs);
+    if (rc != 0 || inputs.count == 0) {
+        fprintf(stderr, "no OBJ/STL inputs found in %s\n", batch_path);
+        pathlist_free(&inputs);
+        return 1;
+    }
+
+    VoxelPackWriter *pack =
+        Voxelize_PackOpen(output_path, inputs.count, resolution);
+    if (!pack) {
+        fprintf(stderr, "failed to create %s\n", output_path);
+        pathlist_free(&inputs);
+        return 1;
+    }
+
+#ifdef _OPENMP
+    if (threads > 0)
+        omp_set_num_threads(threads);
+#else
+    (void)threads;
+#endif
+
+    int failed = 0;
+    int write_error = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : failed)
+#endif
+    for (int i = 0; i < inputs.count; i++) {
+        Model model = loadModel(inputs.items[i]);
+        VoxelGrid *grid = NULL;
+        if (model.vertexCount > 0 && model.faceCount > 0) {
+            grid = Voxelize_FromModel(
+                &model, resolution, padding, align_longest_x, mode);
+        }
+        freeModel(&model);
+
+        if (!grid) {
+            fprintf(stderr, "voxelization failed for %s\n", inputs.items[i]);
+            failed++;
+            continue;
+        }
+
+#ifdef _OPENMP
+#pragma omp critical(voxpack_append)
+#endif
+        {
+            if (Voxelize_PackAppend(pack, i, grid) != 0)
+                write_error = 1;
+        }
+        Voxelize_Free(grid);
+    }
+
+    if (Voxelize_PackClose(pack) != 0)
+        write_error = 1;
+
+    if (write_error) {
+        fprintf(stderr, "failed to write %s\n", output_path);
+        rc = 1;
+    } else {
+        printf("wrote %s: %d shapes at %d^3 (%d failed)\n",
+               output_path,
+               inputs.count - failed,
+               resolution,
+               failed);
+        rc = failed == inputs.count ? 1 : 0;
+    }
+
+    pathlist_free(&inputs);
+    return rc;
+}
+
 int main(int argc, char **argv) {
     if (argc < 2) {
         usage(argv[0]);
         return 2;
     }
 
-    const char *input_path = argv[1];
+    const char *input_path = NULL;
+    const char *batch_path = NULL;
     int resolution = 32;
     float padding = 0.05f;
     VoxelizeMode mode = VOXELIZE_MODE_AUTO;
     int align_longest_x = 1;
     const char *output_path = NULL;
+    int threads = 0;
+    int encoding = -1; /* -1 = version-1 raw bytes */
+    const char *sdf_path = NULL;
+    int levels = 1;
+    float min_fraction = 0.5f;
+    int dims[3] = {0, 0, 0};
+    float box_bounds[6];
+    int have_box = 0;
 
-    for (int i = 2; i < argc; i++) {
+    for (int i = 1; i < argc; i++) {
         const char *a = argv[i];
         if (strcmp(a, "--resolution") == 0 && i + 1 < argc) {
             resolution = atoi(argv[++i]);
@@ -50,10 +312,48 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "unknown mode: %s\n", m);
                 return 2;
             }
+        } else if (strcmp(a, "--encoding") == 0 && i + 1 < argc) {
+            const char *e = argv[++i];
+            if (strcmp(e, "raw") == 0) encoding = -1;
+            else if (strcmp(e, "bits") == 0) encoding = VOXBIN_ENCODING_BITS;
+            else if (strcmp(e, "rle") == 0) encoding = VOXBIN_ENCODING_RLE;
+            else {
+                fprintf(stderr, "unknown encoding: %s\n", e);
+                return 2;
+            }
         } else if (strcmp(a, "--no-align") == 0) {
             align_longest_x = 0;
         } else if (strcmp(a, "--output") == 0 && i + 1 < argc) {
             output_path = argv[++i];
+        } else if (strcmp(a, "--sdf") == 0 && i + 1 < argc) {
+            sdf_path = argv[++i];
+        } else if (strcmp(a, "--levels") == 0 && i + 1 < argc) {
+            levels = atoi(argv[++i]);
+        } else if (strcmp(a, "--min-fraction") == 0 && i + 1 < argc) {
+            min_fraction = (float)atof(argv[++i]);
+        } else if (strcmp(a, "--dims") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d,%d", &dims[0], &dims[1], &dims[2]) !=
+                    3 ||
+                dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0) {
+                fprintf(stderr, "--dims expects NX,NY,NZ\n");
+                return 2;
+            }
+        } else if (strcmp(a, "--box") == 0 && i + 1 < argc) {
+            float *b = box_bounds;
+            if (sscanf(argv[++i], "%f,%f,%f,%f,%f,%f",
+                       &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6 ||
+                !(b[3] > b[0] && b[4] > b[1] && b[5] > b[2])) {
+                fprintf(stderr, "--box expects X0,Y0,Z0,X1,Y1,Z1 with "
+                                "min < max\n");
+                return 2;
+            }
+            have_box = 1;
+        } else if (strcmp(a, "--batch") == 0 && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (strcmp(a, "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (a[0] != '-' && !input_path) {
+            input_path = a;
         } else {
             fprintf(stderr, "unknown argument: %s\n", a);
             usage(argv[0]);
@@ -66,15 +366,92 @@ int main(int argc, char **argv) {
         return 2;
     }
 
-    Model model = loadOBJ(input_path);
+    if (levels < 1 || levels > 8 || resolution % (1 << (levels - 1)) != 0) {
+        fprintf(stderr,
+                "--levels must be in [1, 8] with resolution divisible by "
+                "2^(levels-1)\n");
+        return 2;
+    }
+    if (min_fraction <= 0.0f || min_fraction > 1.0f) {
+        fprintf(stderr, "--min-fraction must be in (0, 1]\n");
+        return 2;
+    }
+    if (levels > 1 && (encoding >= 0 || batch_path)) {
+        fprintf(stderr, "--levels cannot be combined with --encoding or "
+                        "--batch\n");
+        return 2;
+    }
+
+    int lattice = dims[0] > 0;
+    if (have_box && !lattice) {
+        fprintf(stderr, "--box requires --dims\n");
+        return 2;
+    }
+    if (lattice && (levels > 1 || encoding >= 0 || sdf_path || batch_path)) {
+        fprintf(stderr, "--dims cannot be combined with --levels, "
+                        "--encoding, --sdf or --batch\n");
+        return 2;
+    }
+    if (batch_path && encoding >= 0) {
+        fprintf(stderr, "--batch packs raw grids and cannot be combined "
+                        "with --encoding bits|rle\n");
+        return 2;
+    }
+    if (batch_path && sdf_path) {
+        fprintf(stderr, "--sdf cannot be combined with --batch\n");
+        return 2;
+    }
+
+    if (batch_path) {
+        if (input_path || !output_path) {
+            fprintf(stderr, "--batch takes no input file and needs --output\n");
+            usage(argv[0]);
+            return 2;
+        }
+        return run_batch(batch_path,
+                         output_path,
+                         resolution,
+                         padding,
+                         align_longest_x,
+                         mode,
+                         threads);
+    }
+
+    if (!input_path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Model model = loadModel(input_path);
     if (model.vertexCount == 0 || model.faceCount == 0) {
-        fprintf(stderr, "failed to load OBJ: %s\n", input_path);
+        fprintf(stderr, "failed to load mesh: %s\n", input_path);
         freeModel(&model);
         return 1;
     }
 
-    VoxelGrid *grid =
-        Voxelize_FromModel(&model, resolution, padding, align_longest_x, mode);
+    if (lattice) {
+        int rc = run_lattice(&model, dims, have_box ? box_bounds : NULL,
+                             padding, align_longest_x, mode, output_path);
+        freeModel(&model);
+        return rc;
+    }
+
+    VoxelPyramid *pyr = NULL;
+    VoxelGrid *grid = NULL;
+    if (levels > 1) {
+        pyr = Voxelize_PyramidFromModel(&model, resolution, levels, padding,
+                                        align_longest_x, mode, min_fraction);
+        if (pyr)
+            grid = &pyr->grids[0];
+    } else {
+        grid = Voxelize_FromModel(
+            &model, resolution, padding, align_longest_x, mode);
+    }
+    SdfGrid *sdf = NULL;
+    if (grid && sdf_path) {
+        sdf = Voxelize_SdfFromModel(
+            &model, resolution, padding, align_longest_x);
+    }
     freeModel(&model);
 
     if (!grid) {
@@ -88,10 +465,23 @@ int main(int argc, char **argv) {
     printf("voxelized %s: %dx%dx%d, solid=%zu/%zu (%.2f%%)\n",
            input_path, grid->resolution, grid->resolution, grid->resolution,
            solid, total, 100.0f * frac);
+    for (int l = 1; pyr && l < pyr->levels; l++) {
+        printf("  level %d: %d^3, solid %.2f%%\n",
+               l, pyr->grids[l].resolution,
+               100.0f * Voxelize_SolidFraction(&pyr->grids[l]));
+    }
 
     int rc = 0;
     if (output_path) {
-        if (Voxelize_WriteBinary(grid, output_path) != 0) {
+        int err;
+        if (pyr)
+            err = Voxelize_WritePyramid(pyr, output_path);
+        else if (encoding < 0)
+            err = Voxelize_WriteBinary(grid, output_path);
+        else
+            err = Voxelize_WriteBinaryV2(
+                grid, output_path, (VoxbinEncoding)encoding);
+        if (err != 0) {
             fprintf(stderr, "failed to write %s\n", output_path);
             rc = 1;
         } else {
@@ -99,6 +489,19 @@ int main(int argc, char **argv) {
         }
     }
 
-    Voxelize_Free(grid);
+    if (sdf_path) {
+        if (!sdf || Voxelize_WriteSdf(sdf, sdf_path) != 0) {
+            fprintf(stderr, "failed to write SDF %s\n", sdf_path);
+            rc = 1;
+        } else {
+            printf("wrote %s\n", sdf_path);
+        }
+    }
+
+    Voxelize_FreeSdf(sdf);
+    if (pyr)
+        Voxelize_FreePyramid(pyr);
+    else
+        Voxelize_Free(grid);
     return rc;
 }
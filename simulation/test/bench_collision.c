@@ -0,0 +1,340 @@
+/*
+ * Benchmark: collision BVH vs the fixed 8 x 8 x 8 CollisionGrid it
+ * replaced, kept here as a reference. For each mesh (the bundled models
+ * by default, plus a dense synthetic sphere) reports build time, query
+ * throughput for points near the surface and in the padded body box,
+ * and how many triangles the grid would test per query; plus BVH build
+ * thread scaling when built with OpenMP.
+ *
+ *   ./build/bench_collision                      # run from simulation/
+ *   ./build/bench_collision mesh.obj [more.obj ...]
+ */
+
+#include "../lib/collision_bvh.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define QUERIES 200000
+#define RADIUS 0.03f
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ---- Legacy uniform grid ------------------------------------------- */
+
+#define COLL_GRID_RES 8
+
+typedef struct {
+    int *cellStart;
+    int *cellCount;
+    int *triIndices;
+    int totalIndices;
+    float minX, minY, minZ;
+    float cellSizeX, cellSizeY, cellSizeZ;
+} CollisionGrid;
+
+/* Cell range of a triangle, clamped to the grid. */
+static void grid_range(const CollisionGrid *g,
+                       const GPUTriangle *t,
+                       int lo[3],
+                       int hi[3]) {
+    const float *v = &t->v0x;
+    const float *mn = &g->minX, *cs = &g->cellSizeX;
+    for (int a = 0; a < 3; a++) {
+        float tmin = fminf(v[a], fminf(v[4 + a], v[8 + a]));
+        float tmax = fmaxf(v[a], fmaxf(v[4 + a], v[8 + a]));
+        lo[a] = (int)floorf((tmin - mn[a]) / cs[a]);
+        hi[a] = (int)floorf((tmax - mn[a]) / cs[a]);
+        lo[a] = lo[a] < 0 ? 0 : lo[a];
+        hi[a] = hi[a] >= COLL_GRID_RES ? COLL_GRID_RES - 1 : hi[a];
+    }
+}
+
+/* buildCollisionGrid as it was: two counting passes over the triangles
+ * into R^3 cells over the body box padded by 0.05. */
+static CollisionGrid legacy_build(const GPUTriangle *tris,
+                                  int n,
+                                  const float bmin[3],
+                                  const float bmax[3]) {
+    CollisionGrid g = {0};
+    int R = COLL_GRID_RES, cells = R * R * R;
+    g.minX = bmin[0] - 0.05f;
+    g.minY = bmin[1] - 0.05f;
+    g.minZ = bmin[2] - 0.05f;
+    g.cellSizeX = (bmax[0] + 0.05f - g.minX) / R;
+    g.cellSizeY = (bmax[1] + 0.05f - g.minY) / R;
+    g.cellSizeZ = (bmax[2] + 0.05f - g.minZ) / R;
+    g.cellCount = (int *)calloc(cells, sizeof(int));
+    g.cellStart = (int *)malloc(cells * sizeof(int));
+    int *fill = (int *)calloc(cells, sizeof(int));
+    int lo[3], hi[3];
+    for (int t = 0; t < n; t++) {
+        grid_range(&g, &tris[t], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++)
+            for (int y = lo[1]; y <= hi[1]; y++)
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    g.cellCount[x + y * R + z * R * R]++;
+                    g.totalIndices++;
+                }
+    }
+    g.cellStart[0] = 0;
+    for (int c = 1; c < cells; c++)
+        g.cellStart[c] = g.cellStart[c - 1] + g.cellCount[c - 1];
+    g.triIndices = (int *)malloc((size_t)g.totalIndices * sizeof(int));
+    for (int t = 0; t < n; t++) {
+        grid_range(&g, &tris[t], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++)
+            for (int y = lo[1]; y <= hi[1]; y++)
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    int c = x + y * R + z * R * R;
+                    g.triIndices[g.cellStart[c] + fill[c]++] = t;
+                }
+    }
+    free(fill);
+    return g;
+}
+
+/* particle.comp's old search: first triangle within RADIUS in the 27
+ * cells around p. Adds the number of triangles tested to *tests. */
+static int legacy_query(const CollisionGrid *g,
+                        const GPUTriangle *tris,
+                        const float p[3],
+                        long long *tests) {
+    int R = COLL_GRID_RES;
+    int cell[3] = {(int)floorf((p[0] - g->minX) / g->cellSizeX),
+                   (int)floorf((p[1] - g->minY) / g->cellSizeY),
+                   (int)floorf((p[2] - g->minZ) / g->cellSizeZ)};
+    int lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+        if (cell[a] < -1 || cell[a] > R)
+            return -1;
+        lo[a] = cell[a] - 1 > 0 ? cell[a] - 1 : 0;
+        hi[a] = cell[a] + 1 < R - 1 ? cell[a] + 1 : R - 1;
+    }
+    for (int z = lo[2]; z <= hi[2]; z++)
+        for (int y = lo[1]; y <= hi[1]; y++)
+            for (int x = lo[0]; x <= hi[0]; x++) {
+                int c = x + y * R + z * R * R;
+                const int *idx = g->triIndices + g->cellStart[c];
+                for (int j = 0; j < g->cellCount[c]; j++) {
+                    float cp[3], nrm[3];
+                    (*tests)++;
+                    float d = pointTriangleDistance(p, &tris[idx[j]],
+                                                    RADIUS, cp, nrm);
+                    if (d >= 0.0f && d < RADIUS)
+                        return idx[j];
+                }
+            }
+    return -1;
+}
+
+/* ---- Meshes and query points ---------------------------------------- */
+
+static uint32_t rng_state = 2463534242u;
+
+static float frand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+/* Scales the mesh to length 2 along its longest axis, centred on the
+ * origin (about the size the simulation uses), and returns its box. */
+static void normalise(GPUTriangle *tris, int n, float bmin[3], float bmax[3]) {
+    for (int a = 0; a < 3; a++) {
+        bmin[a] = 1e30f;
+        bmax[a] = -1e30f;
+    }
+    for (int t = 0; t < n; t++)
+        for (int k = 0; k < 3; k++)
+            for (int a = 0; a < 3; a++) {
+                float v = (&tris[t].v0x)[4 * k + a];
+                bmin[a] = fminf(bmin[a], v);
+                bmax[a] = fmaxf(bmax[a], v);
+            }
+    float ext = 0.0f;
+    for (int a = 0; a < 3; a++)
+        ext = fmaxf(ext, bmax[a] - bmin[a]);
+    float s = ext > 0.0f ? 2.0f / ext : 1.0f;
+    float c[3];
+    for (int a = 0; a < 3; a++)
+        c[a] = 0.5f * (bmin[a] + bmax[a]);
+    for (int t = 0; t < n; t++)
+        for (int k = 0; k < 3; k++)
+            for (int a = 0; a < 3; a++) {
+                float *v = &(&tris[t].v0x)[4 * k + a];
+                *v = (*v - c[a]) * s;
+            }
+    for (int a = 0; a < 3; a++) {
+        bmin[a] = (bmin[a] - c[a]) * s;
+        bmax[a] = (bmax[a] - c[a]) * s;
+    }
+}
+
+/* UV sphere of radius 1 with 2 * rings * rings triangles. */
+static GPUTriangle *sphere_mesh(int rings, int *count) {
+    GPUTriangle *t =
+        (GPUTriangle *)malloc((size_t)2 * rings * rings * sizeof(*t));
+    int n = 0;
+    for (int r = 0; r < rings; r++)
+        for (int s = 0; s < rings; s++) {
+            float th0 = (float)M_PI * r / rings,
+                  th1 = (float)M_PI * (r + 1) / rings;
+            float ph0 = 2.0f * (float)M_PI * s / rings,
+                  ph1 = 2.0f * (float)M_PI * (s + 1) / rings;
+            float p[4][3] = {
+                {sinf(th0) * cosf(ph0), sinf(th0) * sinf(ph0), cosf(th0)},
+                {sinf(th1) * cosf(ph0), sinf(th1) * sinf(ph0), cosf(th1)},
+                {sinf(th1) * cosf(ph1), sinf(th1) * sinf(ph1), cosf(th1)},
+                {sinf(th0) * cosf(ph1), sinf(th0) * sinf(ph1), cosf(th0)}};
+            static const int q[2][3] = {{0, 1, 2}, {0, 2, 3}};
+            for (int h = 0; h < 2; h++) {
+                const float *a = p[q[h][0]], *b = p[q[h][1]],
+                            *c = p[q[h][2]];
+                t[n++] = (GPUTriangle){a[0], a[1], a[2], 0, b[0], b[1],
+                                       b[2], 0, c[0], c[1], c[2], 0};
+            }
+        }
+    *count = n;
+    return t;
+}
+
+/* Half the points within 0.05 of a random triangle's centroid, half
+ * anywhere in the padded body box. */
+static float *query_points(const GPUTriangle *tris,
+                           int n,
+                           const float bmin[3],
+                           const float bmax[3]) {
+    float *p = (float *)malloc((size_t)QUERIES * 3 * sizeof(float));
+    for (int q = 0; q < QUERIES; q++) {
+        float *x = p + 3 * q;
+        if (q % 2 == 0) {
+            const GPUTriangle *t = &tris[(int)(frand() * n) % n];
+            x[0] = (t->v0x + t->v1x + t->v2x) / 3.0f;
+            x[1] = (t->v0y + t->v1y + t->v2y) / 3.0f;
+            x[2] = (t->v0z + t->v1z + t->v2z) / 3.0f;
+            for (int a = 0; a < 3; a++)
+                x[a] += 0.1f * (frand() - 0.5f);
+        } else {
+            for (int a = 0; a < 3; a++)
+                x[a] = bmin[a] - 0.05f +
+                       (bmax[a] - bmin[a] + 0.1f) * frand();
+        }
+    }
+    return p;
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+static void bench_mesh(const char *name, GPUTriangle *tris, int n) {
+    float bmin[3], bmax[3];
+    normalise(tris, n, bmin, bmax);
+    float *pts = query_points(tris, n, bmin, bmax);
+
+    double t0 = now_sec();
+    CollisionGrid grid = legacy_build(tris, n, bmin, bmax);
+    double t1 = now_sec();
+    CollisionBVH bvh = buildCollisionBVH(tris, n);
+    double t2 = now_sec();
+
+    long long tests = 0;
+    int gridHits = 0, bvhHits = 0;
+    double t3 = now_sec();
+    for (int q = 0; q < QUERIES; q++)
+        gridHits += legacy_query(&grid, tris, pts + 3 * q, &tests) >= 0;
+    double t4 = now_sec();
+    for (int q = 0; q < QUERIES; q++) {
+        float c[3], nrm[3];
+        bvhHits += queryCollisionBVH(&bvh, tris, pts + 3 * q, RADIUS, c,
+                                     nrm) >= 0;
+    }
+    double t5 = now_sec();
+
+    int maxCell = 0;
+    for (int c = 0; c < COLL_GRID_RES * COLL_GRID_RES * COLL_GRID_RES; c++)
+        maxCell = grid.cellCount[c] > maxCell ? grid.cellCount[c] : maxCell;
+    printf("%s: %d triangles\n", name, n);
+    printf("  build: grid %.1f ms (max %d per cell), BVH %.1f ms "
+           "(%d nodes, depth %d)\n",
+           (t1 - t0) * 1e3, maxCell, (t2 - t1) * 1e3, bvh.numNodes,
+           bvh.depth);
+    printf("  query: grid %.3f M/s (%.0f triangles per query), "
+           "BVH %.2f M/s, %.0fx; hits %d / %d\n",
+           QUERIES / (t4 - t3) * 1e-6, (double)tests / QUERIES,
+           QUERIES / (t5 - t4) * 1e-6, (t4 - t3) / (t5 - t4), gridHits,
+           bvhHits);
+
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("  BVH build scaling:");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        double s0 = now_sec();
+        CollisionBVH b = buildCollisionBVH(tris, n);
+        double s1 = now_sec();
+        printf(" %d: %.1f ms", t, (s1 - s0) * 1e3);
+        freeCollisionBVH(&b);
+    }
+    printf("\n");
+    omp_set_num_threads(max_threads);
+#endif
+
+    free(grid.cellStart);
+    free(grid.cellCount);
+    free(grid.triIndices);
+    freeCollisionBVH(&bvh);
+    free(pts);
+}
+
+int main(int argc, char **argv) {
+    static const char *bundled[] = {"assets/3d-files/car-model.obj",
+                                    "assets/3d-files/ahmed_25deg_m.obj",
+                                    "assets/3d-files/ahmed_35deg_m.obj"};
+    const char **paths = argc > 1 ? (const char **)argv + 1 : bundled;
+    int count = argc > 1 ? argc - 1 : 3;
+
+    for (int i = 0; i < count; i++) {
+        Model model = loadModel(paths[i]);
+        int n = 0;
+        GPUTriangle *tris =
+            model.faceCount > 0
+                ? createTriangleBuffer(&model, 1.0f, 0, 0, 0, 0, &n)
+                : NULL;
+        freeModel(&model);
+        if (!tris || n == 0) {
+            fprintf(stderr, "failed to load %s\n", paths[i]);
+            free(tris);
+            continue;
+        }
+        bench_mesh(paths[i], tris, n);
+        free(tris);
+    }
+
+    if (argc == 1) {
+        int n = 0;
+        GPUTriangle *tris = sphere_mesh(300, &n);
+        bench_mesh("sphere", tris, n);
+        free(tris);
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Benchmark: FluidCubeStep at 64^3 and 128^3 with the fixed
+ * Gauss-Seidel sweeps and with the multigrid solver, optionally around
+ * a mesh obstacle, plus thread scaling of the 128^3 step when built
+ * with OpenMP.
+ *
+ *   ./build/bench_fluid_cube                  # empty box, 10 steps
+ *   ./build/bench_fluid_cube car.obj [steps]
+ */
+
+#include "../lib/fluid_cube.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Centre the mesh and scale its longest side to 1.6, so it spans the
+ * middle 80% of the cube. */
+static void normalize_model(Model *m) {
+    float centre[3], extent = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        centre[a] = 0.5f * (m->boundsMin[a] + m->boundsMax[a]);
+        extent = fmaxf(extent, m->boundsMax[a] - m->boundsMin[a]);
+    }
+    float scale = extent > 0.0f ? 1.6f / extent : 1.0f;
+    for (int i = 0; i < m->vertexCount; i++) {
+        Vertex *v = &m->vertices[i];
+        v->x = (v->x - centre[0]) * scale;
+        v->y = (v->y - centre[1]) * scale;
+        v->z = (v->z - centre[2]) * scale;
+    }
+}
+
+/* Milliseconds per step, best of `steps`, with an inflow jet and dye
+ * source added before each step. */
+static double
+time_steps(int n, FluidSolver solver, Model *model, int steps, int *cycles) {
+    FluidCube *cube = FluidCubeCreate(n, n, n, 1e-4f, 1e-4f, 0.1f, model);
+    if (!cube)
+        return -1.0;
+    FluidCubeSetSolver(cube, solver, 0.0f, 0);
+    double best = 1e30;
+    for (int s = 0; s < steps; s++) {
+        for (int j = n / 2 - 2; j < n / 2 + 2; j++)
+            for (int k = n / 2 - 2; k < n / 2 + 2; k++) {
+                FluidCubeAddVelocity(cube, 2, j, k, 5.0f, 0.0f, 0.0f);
+                FluidCubeAddDensity(cube, 2, j, k, 10.0f);
+            }
+        double t0 = now_sec();
+        FluidCubeStep(cube);
+        double t1 = now_sec();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    *cycles = cube->lastSolveCycles;
+    FluidCubeFree(cube);
+    return best * 1e3;
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+int main(int argc, char **argv) {
+    int steps = argc > 2 ? atoi(argv[2]) : 10;
+    if (steps < 1)
+        steps = 1;
+    Model model = {0};
+    Model *obstacle = NULL;
+    if (argc > 1) {
+        model = loadModel(argv[1]);
+        if (model.faceCount == 0) {
+            fprintf(stderr, "failed to load %s\n", argv[1]);
+            return 1;
+        }
+        normalize_model(&model);
+        obstacle = &model;
+    }
+
+    static const int sizes[] = {64, 128};
+    static const FluidSolver solvers[] = {FLUID_SOLVER_GAUSS_SEIDEL,
+                                          FLUID_SOLVER_MULTIGRID};
+    double ms[2][2];
+    int cycles[2][2];
+    for (int s = 0; s < 2; s++)
+        for (int v = 0; v < 2; v++)
+            ms[s][v] = time_steps(
+                sizes[s], solvers[v], obstacle, steps, &cycles[s][v]);
+
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("128^3 multigrid step scaling:\n");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        int c;
+        double best =
+            time_steps(128, FLUID_SOLVER_MULTIGRID, obstacle, steps, &c);
+        printf("  %2d threads: %8.1f ms\n", t, best);
+    }
+    omp_set_num_threads(max_threads);
+#endif
+
+    printf("FluidCubeStep, best of %d steps (%s):\n", steps,
+           obstacle ? argv[1] : "empty box");
+    for (int s = 0; s < 2; s++)
+        printf("  %3d^3: gauss-seidel %8.1f ms, multigrid %8.1f ms "
+               "(%d V-cycles in the last solve)\n",
+               sizes[s], ms[s][0], ms[s][1], cycles[s][1]);
+
+    freeModel(&model);
+    return ms[0][0] < 0.0 || ms[1][1] < 0.0 ? 1 : 0;
+}
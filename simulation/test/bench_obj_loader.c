@@ -0,0 +1,213 @@
+/*
+ * Benchmark: single-pass mmap OBJ parsing vs the previous three-pass
+ * fgets/sscanf loader, kept here as a reference, and a warm .meshbin
+ * cache load, plus thread scaling of the parser when built with
+ * OpenMP. Also checks that the parsers produce the same vertices
+ * and, for triangle-only meshes, the same faces.
+ *
+ *   ./build/bench_obj_loader                 # synthetic 2M-triangle mesh
+ *   ./build/bench_obj_loader big.obj [reps]
+ */
+
+#include "../obj-file-loader/lib/model_loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* The pre-mmap loader: counts vertices and faces in two passes, then
+ * parses with fgets + sscanf, keeping the first three indices of each
+ * face. */
+static int legacy_count(const char *path, char tag) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    char line[256];
+    int n = 0;
+    while (fgets(line, sizeof(line), f))
+        if (line[0] == tag && line[1] == ' ')
+            n++;
+    fclose(f);
+    return n;
+}
+
+static int legacy_index(const char **p) {
+    while (**p == ' ' || **p == '\t')
+        (*p)++;
+    char tok[64];
+    int i = 0;
+    while (**p && **p != ' ' && **p != '\t' && **p != '\n' && i < 63)
+        tok[i++] = *(*p)++;
+    tok[i] = '\0';
+    int v = 0;
+    sscanf(tok, "%d", &v);
+    return v;
+}
+
+static Model legacy_load(const char *path) {
+    Model m = {0};
+    int nv = legacy_count(path, 'v');
+    int nf = legacy_count(path, 'f');
+    m.vertices = (Vertex *)malloc((size_t)nv * sizeof(Vertex));
+    m.faces = (Face *)malloc((size_t)nf * sizeof(Face));
+    FILE *f = fopen(path, "r");
+    if (!m.vertices || !m.faces || !f) {
+        if (f)
+            fclose(f);
+        freeModel(&m);
+        return m;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == 'v' && line[1] == ' ' && m.vertexCount < nv) {
+            Vertex *v = &m.vertices[m.vertexCount++];
+            sscanf(line, "v %f %f %f", &v->x, &v->y, &v->z);
+        } else if (line[0] == 'f' && line[1] == ' ' && m.faceCount < nf) {
+            const char *p = line + 2;
+            Face *fc = &m.faces[m.faceCount++];
+            fc->v1 = legacy_index(&p);
+            fc->v2 = legacy_index(&p);
+            fc->v3 = legacy_index(&p);
+        }
+    }
+    fclose(f);
+    return m;
+}
+
+/* A (n x n) grid of height-field vertices split into 2 n^2 triangles,
+ * with v/vt/vn-style tokens so the face path sees realistic input. */
+static int write_synthetic(const char *path, int n) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    for (int j = 0; j <= n; j++)
+        for (int i = 0; i <= n; i++) {
+            float x = (float)i / n, y = (float)j / n;
+            fprintf(f, "v %.6f %.6f %.6f\n", x, y, 0.1f * x * y - 0.05f);
+        }
+    for (int j = 0; j < n; j++)
+        for (int i = 0; i < n; i++) {
+            int a = j * (n + 1) + i + 1, b = a + 1, c = a + n + 1,
+                d = c + 1;
+            fprintf(f, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, d, d);
+            fprintf(f, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, d, d, c, c);
+        }
+    return fclose(f);
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "/tmp/bench_obj_loader.obj";
+    int reps = argc > 2 ? atoi(argv[2]) : 3;
+    if (reps < 1)
+        reps = 1;
+    if (argc < 2) {
+        printf("writing synthetic mesh %s\n", path);
+        if (write_synthetic(path, 1000) != 0) {
+            fprintf(stderr, "failed to write %s\n", path);
+            return 1;
+        }
+    }
+
+    double best_new = 1e30, best_old = 1e30;
+    Model cur = {0}, old = {0};
+    for (int r = 0; r < reps; r++) {
+        freeModel(&cur);
+        freeModel(&old);
+        double t0 = now_sec();
+        cur = loadOBJUncached(path);
+        double t1 = now_sec();
+        old = legacy_load(path);
+        double t2 = now_sec();
+        if (t1 - t0 < best_new)
+            best_new = t1 - t0;
+        if (t2 - t1 < best_old)
+            best_old = t2 - t1;
+    }
+
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("parser scaling:\n");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        double best = 1e30;
+        for (int r = 0; r < reps; r++) {
+            double t0 = now_sec();
+            Model m = loadOBJUncached(path);
+            double t1 = now_sec();
+            freeModel(&m);
+            if (t1 - t0 < best)
+                best = t1 - t0;
+        }
+        printf("  %2d threads: %8.1f ms\n", t, best * 1e3);
+    }
+    omp_set_num_threads(max_threads);
+#endif
+
+    /* First call writes the cache, the timed ones map it. */
+    Model cached = loadOBJ(path);
+    double best_cached = 1e30;
+    for (int r = 0; r < reps; r++) {
+        freeModel(&cached);
+        double t0 = now_sec();
+        cached = loadOBJ(path);
+        double t1 = now_sec();
+        if (t1 - t0 < best_cached)
+            best_cached = t1 - t0;
+    }
+    int cache_ok = cached.mapping != NULL &&
+                   cached.vertexCount == cur.vertexCount &&
+                   cached.faceCount == cur.faceCount &&
+                   memcmp(cached.vertices, cur.vertices,
+                          (size_t)cur.vertexCount * sizeof(Vertex)) == 0 &&
+                   memcmp(cached.faces, cur.faces,
+                          (size_t)cur.faceCount * sizeof(Face)) == 0;
+
+    int same_verts = cur.vertexCount == old.vertexCount &&
+                     memcmp(cur.vertices, old.vertices,
+                            (size_t)cur.vertexCount * sizeof(Vertex)) == 0;
+    int same_faces = cur.faceCount == old.faceCount &&
+                     memcmp(cur.faces, old.faces,
+                            (size_t)cur.faceCount * sizeof(Face)) == 0;
+
+    printf("%s: %d vertices\n", path, cur.vertexCount);
+    printf("  legacy loader: %8.1f ms, %d faces\n", best_old * 1e3,
+           old.faceCount);
+    printf("  mmap loader:   %8.1f ms, %d faces (%.1fx)\n", best_new * 1e3,
+           cur.faceCount, best_old / best_new);
+    printf("  meshbin cache: %8.1f ms (%s)\n", best_cached * 1e3,
+           cache_ok ? "matches parse" : "NOT USED OR MISMATCH");
+    printf("  vertices %s, faces %s\n", same_verts ? "identical" : "DIFFER",
+           same_faces ? "identical"
+                      : "differ (expected when the mesh has n-gons)");
+
+    freeModel(&cur);
+    freeModel(&old);
+    freeModel(&cached);
+    if (argc < 2) {
+        char cache_path[4096];
+        snprintf(cache_path, sizeof(cache_path), "%s.meshbin", path);
+        remove(path);
+        remove(cache_path);
+    }
+    return same_verts && cache_ok ? 0 : 1;
+}
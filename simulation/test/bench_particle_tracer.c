@@ -0,0 +1,174 @@
+/*
+ * Benchmark: host-side particle tracer through potential flow around a
+ * sphere on a 128 x 64 x 64 field, with per-triangle collision against
+ * a 2k-triangle sphere mesh, plus thread scaling when built with
+ * OpenMP. Reports particle steps per second and the deposition and
+ * exit counts.
+ *
+ *   ./build/bench_particle_tracer [particles] [steps]
+ */
+
+#include "../lib/particle_tracer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define NX 128
+#define NY 64
+#define NZ 64
+#define RADIUS 0.5f
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Potential flow past a sphere at the origin, free stream 1 world unit
+ * per time unit (0.125 lattice units at scale 8), zero inside. */
+static float *sphere_flow(void) {
+    float *v = (float *)calloc((size_t)4 * NX * NY * NZ, sizeof(float));
+    if (!v)
+        return NULL;
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 0; i < NX; i++) {
+                float x = (i + 0.5f) / NX * 8.0f - 4.0f;
+                float y = (j + 0.5f) / NY * 4.0f - 2.0f;
+                float z = (k + 0.5f) / NZ * 4.0f - 2.0f;
+                float r2 = x * x + y * y + z * z;
+                float *c = v + 4 * ((size_t)i + NX * (j + (size_t)NY * k));
+                c[3] = 1.0f;
+                if (r2 < RADIUS * RADIUS)
+                    continue;
+                float a3 = RADIUS * RADIUS * RADIUS;
+                float r5 = r2 * r2 * sqrtf(r2);
+                c[0] = 0.125f * (1.0f + 0.5f * a3 * (r2 - 3.0f * x * x) / r5);
+                c[1] = 0.125f * (-1.5f * a3 * x * y / r5);
+                c[2] = 0.125f * (-1.5f * a3 * x * z / r5);
+            }
+    return v;
+}
+
+/* UV sphere of RADIUS, 2 * 32 * 32 triangles (poles included). */
+static GPUTriangle *sphere_mesh(int *count) {
+    int rings = 32, segments = 32;
+    GPUTriangle *t =
+        (GPUTriangle *)malloc((size_t)2 * rings * segments * sizeof(*t));
+    if (!t)
+        return NULL;
+    int n = 0;
+    for (int r = 0; r < rings; r++)
+        for (int s = 0; s < segments; s++) {
+            float th0 = (float)M_PI * r / rings,
+                  th1 = (float)M_PI * (r + 1) / rings;
+            float ph0 = 2.0f * (float)M_PI * s / segments,
+                  ph1 = 2.0f * (float)M_PI * (s + 1) / segments;
+            float p[4][3] = {
+                {sinf(th0) * cosf(ph0), sinf(th0) * sinf(ph0), cosf(th0)},
+                {sinf(th1) * cosf(ph0), sinf(th1) * sinf(ph0), cosf(th1)},
+                {sinf(th1) * cosf(ph1), sinf(th1) * sinf(ph1), cosf(th1)},
+                {sinf(th0) * cosf(ph1), sinf(th0) * sinf(ph1), cosf(th0)}};
+            static const int q[2][3] = {{0, 1, 2}, {0, 2, 3}};
+            for (int h = 0; h < 2; h++) {
+                const float *a = p[q[h][0]], *b = p[q[h][1]], *c = p[q[h][2]];
+                t[n++] = (GPUTriangle){
+                    RADIUS * a[0], RADIUS * a[1], RADIUS * a[2], 0,
+                    RADIUS * b[0], RADIUS * b[1], RADIUS * b[2], 0,
+                    RADIUS * c[0], RADIUS * c[1], RADIUS * c[2], 0};
+            }
+        }
+    *count = n;
+    return t;
+}
+
+/* Seconds for `steps` steps of n massive particles released on a
+ * jittered grid over the x = -3 plane. */
+static double run(int n,
+                  int steps,
+                  const TracerField *f,
+                  const TracerBody *body,
+                  int *deposited,
+                  int *exited) {
+    ParticleTracer tr;
+    if (ParticleTracer_Init(&tr, n) != 0)
+        return -1.0;
+    int side = (int)ceil(sqrt((double)n));
+    for (int i = 0; i < n; i++) {
+        float y = -0.8f + 1.6f * ((i / side) + 0.5f) / side;
+        float z = -0.8f + 1.6f * ((i % side) + 0.5f) / side;
+        ParticleTracer_Add(&tr, -3.0f - 0.5f * (float)(i % 7) / 7.0f, y, z,
+                           1.0f, 0.0f, 0.0f);
+    }
+    TracerParams p = {0.02f, 0.2f, 3.5f};
+    double t0 = now_sec();
+    ParticleTracer_Run(&tr, f, body, &p, steps);
+    double t1 = now_sec();
+    *deposited = *exited = 0;
+    for (int i = 0; i < tr.count; i++) {
+        *deposited += tr.state[i] == TRACER_DEPOSITED;
+        *exited += tr.state[i] == TRACER_EXITED;
+    }
+    ParticleTracer_Free(&tr);
+    return t1 - t0;
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    int steps = argc > 2 ? atoi(argv[2]) : 400;
+    if (n < 1)
+        n = 1;
+    if (steps < 1)
+        steps = 1;
+
+    float *vel = sphere_flow();
+    int ntri = 0;
+    GPUTriangle *tris = sphere_mesh(&ntri);
+    if (!vel || !tris) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+    CollisionBVH bvh = buildCollisionBVH(tris, ntri);
+    TracerField field = {NX, NY, NZ, vel, 8.0f};
+    TracerBody body = {tris, ntri, &bvh, 0.03f, 1};
+
+    int dep, ex;
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("tracer scaling:\n");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        double s = run(n, steps, &field, &body, &dep, &ex);
+        printf("  %2d threads: %8.1f M particle steps/s\n", t,
+               (double)n * steps / s * 1e-6);
+    }
+    omp_set_num_threads(max_threads);
+#endif
+
+    double s = run(n, steps, &field, &body, &dep, &ex);
+    printf("%d particles, %d steps, %d triangles: %.2f s, "
+           "%.1f M particle steps/s\n",
+           n, steps, ntri, s, (double)n * steps / s * 1e-6);
+    printf("  deposited %d, exited %d, still active %d\n", dep, ex,
+           n - dep - ex);
+
+    freeCollisionBVH(&bvh);
+    free(tris);
+    free(vel);
+    return s < 0.0 ? 1 : 0;
+}
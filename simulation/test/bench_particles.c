@@ -0,0 +1,205 @@
+/*
+ * Benchmark: ParticleSystem_UpdateWithCollision on the structure-of-
+ * arrays store (AVX2 when the CPU has it) against the previous
+ * array-of-structs loop with rand(), kept here as a reference, at 30k,
+ * 1M and 10M particles, plus thread scaling at 1M when built with OpenMP.
+ *
+ *   ./build/bench_particles [steps]
+ */
+
+#include "../lib/particle_system.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static float frand(float lo, float hi) {
+    return lo + (hi - lo) * ((float)rand() / RAND_MAX);
+}
+
+/* A box in the middle of the tunnel, about the size of the car. */
+static CollisionBounds car_bounds(void) {
+    CollisionBounds b = {-1.0f, -0.5f, -0.6f, 1.0f, 0.5f, 0.6f,
+                         0.0f,  0.0f,  0.0f};
+    return b;
+}
+
+/* The pre-SoA collision response and update, without the grid copies:
+ * one Particle struct per iteration. */
+static void legacy_resolve(Particle *p, CollisionBounds *b) {
+    float hx = (b->maxX - b->minX) * 0.5f;
+    float hy = (b->maxY - b->minY) * 0.5f;
+    float hz = (b->maxZ - b->minZ) * 0.5f;
+    float tx = p->x - b->centerX, ty = p->y - b->centerY,
+          tz = p->z - b->centerZ;
+    float penX = hx - fabsf(tx), penY = hy - fabsf(ty), penZ = hz - fabsf(tz);
+    float nx = 0.0f, ny = 0.0f, nz = 0.0f;
+    if (penX < penY && penX < penZ) {
+        nx = tx > 0 ? 1.0f : -1.0f;
+        p->x = b->centerX + nx * (hx + 0.01f);
+    } else if (penY < penZ) {
+        ny = ty > 0 ? 1.0f : -1.0f;
+        p->y = b->centerY + ny * (hy + 0.01f);
+    } else {
+        nz = tz > 0 ? 1.0f : -1.0f;
+        p->z = b->centerZ + nz * (hz + 0.01f);
+    }
+    float vn = p->vx * nx + p->vy * ny + p->vz * nz;
+    if (vn < 0.0f) {
+        p->vx -= 1.3f * vn * nx;
+        p->vy -= 1.3f * vn * ny;
+        p->vz -= 1.3f * vn * nz;
+        p->vy += ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
+        p->vz += ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
+    }
+}
+
+static void legacy_update(Particle *ps, int n, float dt, CollisionBounds *b) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < n; i++) {
+        Particle *p = &ps[i];
+        p->x += p->vx * dt;
+        p->y += p->vy * dt;
+        p->z += p->vz * dt;
+        if (ParticleSystem_CheckCollision(p->x, p->y, p->z, b))
+            legacy_resolve(p, b);
+        p->life -= 0.01f * dt;
+        if (p->life <= 0.0f || p->x > 4.0f) {
+            p->x = -4.0f - ((float)rand() / RAND_MAX * 0.5f);
+            p->y = ((float)rand() / RAND_MAX - 0.5f) * 3.0f;
+            p->z = ((float)rand() / RAND_MAX - 0.5f) * 3.0f;
+            p->vx = 0.5f + ((float)rand() / RAND_MAX) * 0.2f;
+            p->vy = 0.0f;
+            p->vz = 0.0f;
+            p->life = 1.0f;
+        }
+        if (p->y < -2.0f || p->y > 2.0f) {
+            p->vy *= -0.5f;
+            p->y = (p->y < -2.0f) ? -1.99f : 1.99f;
+        }
+        if (p->z < -2.0f || p->z > 2.0f) {
+            p->vz *= -0.5f;
+            p->z = (p->z < -2.0f) ? -1.99f : 1.99f;
+        }
+    }
+}
+
+/* Best particles per second over `steps` updates of n particles spread
+ * through the tunnel, or -1 when the store cannot be allocated. The
+ * update includes rebinning; `bins` receives the rate of the binning
+ * alone. */
+static double time_soa(int n, int steps, double *bins) {
+    ParticleSystem ps;
+    if (ParticleSystem_Init(&ps, n) != 0)
+        return -1.0;
+    srand(1);
+    for (int i = 0; i < n; i++)
+        ParticleSystem_AddParticle(&ps, frand(-4.0f, 4.0f),
+                                   frand(-1.5f, 1.5f), frand(-1.5f, 1.5f),
+                                   frand(0.5f, 0.7f), frand(-0.1f, 0.1f),
+                                   frand(-0.1f, 0.1f));
+    CollisionBounds b = car_bounds();
+    double best = 1e30, best_bins = 1e30;
+    for (int s = 0; s < steps; s++) {
+        double t0 = now_sec();
+        /* The CPU update does not read the fluid. */
+        ParticleSystem_UpdateWithCollision(&ps, NULL, 0.016f, &b);
+        double t1 = now_sec();
+        ParticleSystem_BuildBins(&ps);
+        double t2 = now_sec();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+        if (t2 - t1 < best_bins)
+            best_bins = t2 - t1;
+    }
+    ParticleSystem_Free(&ps);
+    *bins = n / best_bins;
+    return n / best;
+}
+
+static double time_legacy(int n, int steps) {
+    Particle *ps = (Particle *)malloc((size_t)n * sizeof(Particle));
+    if (!ps)
+        return -1.0;
+    srand(1);
+    for (int i = 0; i < n; i++)
+        ps[i] = (Particle){frand(-4.0f, 4.0f),  frand(-1.5f, 1.5f),
+                           frand(-1.5f, 1.5f),  0.0f,
+                           frand(0.5f, 0.7f),   frand(-0.1f, 0.1f),
+                           frand(-0.1f, 0.1f), 1.0f};
+    CollisionBounds b = car_bounds();
+    double best = 1e30;
+    for (int s = 0; s < steps; s++) {
+        double t0 = now_sec();
+        legacy_update(ps, n, 0.016f, &b);
+        double t1 = now_sec();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    free(ps);
+    return n / best;
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+int main(int argc, char **argv) {
+    int steps = argc > 1 ? atoi(argv[1]) : 10;
+    if (steps < 1)
+        steps = 1;
+
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("1M particle update scaling:\n");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        double bins = 0.0;
+        double rate = time_soa(1000000, steps, &bins);
+        printf("  %2d threads: %8.1f M particles/s, binning %8.1f M/s\n", t,
+               rate * 1e-6, bins * 1e-6);
+    }
+    omp_set_num_threads(max_threads);
+#endif
+
+    static const int counts[] = {30000, 1000000, 10000000};
+    int failed = 0;
+    const char *path = "scalar";
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx2"))
+        path = "AVX2";
+#endif
+    printf("particle update, best of %d steps (%s):\n", steps, path);
+    for (int c = 0; c < 3; c++) {
+        double bins = 0.0;
+        double soa = time_soa(counts[c], steps, &bins);
+        double aos = time_legacy(counts[c], steps);
+        if (soa < 0.0 || aos < 0.0) {
+            printf("  %8d: allocation failed\n", counts[c]);
+            failed = 1;
+            continue;
+        }
+        printf("  %8d: SoA %8.1f M particles/s, legacy AoS %8.1f M "
+               "particles/s (%.1fx), binning alone %8.1f M/s\n",
+               counts[c], soa * 1e-6, aos * 1e-6, soa / aos, bins * 1e-6);
+    }
+    return failed;
+}
@@ -0,0 +1,146 @@
+/*
+ * Benchmark: host-side streamline tracing through potential flow around
+ * a sphere on a 128 x 64 x 64 field with the sphere cells marked solid,
+ * plus thread scaling when built with OpenMP. Reports seeds per second,
+ * points per line and the VTP write time.
+ *
+ *   ./build/bench_streamlines [seeds]
+ */
+
+#include "../lib/streamline.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define NX 128
+#define NY 64
+#define NZ 64
+#define RADIUS 0.5f
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Potential flow past a sphere at the origin, free stream 1 world unit
+ * per time unit (0.125 lattice units at scale 8), zero and solid
+ * inside. */
+static int sphere_flow(StreamlineField *f) {
+    size_t total = (size_t)NX * NY * NZ;
+    f->sizeX = NX;
+    f->sizeY = NY;
+    f->sizeZ = NZ;
+    f->velocityScale = 8.0f;
+    f->velocity = (float *)calloc(total * 4, sizeof(float));
+    f->solid = (int *)calloc(total, sizeof(int));
+    if (!f->velocity || !f->solid)
+        return -1;
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 0; i < NX; i++) {
+                float x = (i + 0.5f) / NX * 8.0f - 4.0f;
+                float y = (j + 0.5f) / NY * 4.0f - 2.0f;
+                float z = (k + 0.5f) / NZ * 4.0f - 2.0f;
+                float r2 = x * x + y * y + z * z;
+                size_t c = (size_t)i + NX * (j + (size_t)NY * k);
+                float *v = f->velocity + 4 * c;
+                v[3] = 1.0f;
+                if (r2 < RADIUS * RADIUS) {
+                    f->solid[c] = 1;
+                    continue;
+                }
+                float a3 = RADIUS * RADIUS * RADIUS;
+                float r5 = r2 * r2 * sqrtf(r2);
+                v[0] = 0.125f * (1.0f + 0.5f * a3 * (r2 - 3.0f * x * x) / r5);
+                v[1] = 0.125f * (-1.5f * a3 * x * y / r5);
+                v[2] = 0.125f * (-1.5f * a3 * x * z / r5);
+            }
+    return 0;
+}
+
+/* Seconds to trace n seeds on a grid over x = -3.5, |y|, |z| <= 1.5. */
+static double run(const StreamlineField *f,
+                  const float *seeds,
+                  int n,
+                  Streamlines *out) {
+    StreamlineParams p;
+    Streamline_DefaultParams(f, &p);
+    double t0 = now_sec();
+    int rc = Streamline_Trace(f, &p, seeds, n, out);
+    double t1 = now_sec();
+    return rc == 0 ? t1 - t0 : -1.0;
+}
+
+#ifdef _OPENMP
+/* 1, 2, 4, ... and finally the maximum itself. */
+static int next_thread_count(int t, int max_threads) {
+    if (t == max_threads)
+        return max_threads + 1;
+    return 2 * t < max_threads ? 2 * t : max_threads;
+}
+#endif
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    if (n < 1)
+        n = 1;
+
+    StreamlineField field = {0};
+    float *seeds = (float *)malloc((size_t)n * 3 * sizeof(float));
+    if (sphere_flow(&field) != 0 || !seeds) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+    int side = (int)ceil(sqrt((double)n));
+    for (int s = 0; s < n; s++) {
+        seeds[3 * s] = -3.5f;
+        seeds[3 * s + 1] = -1.5f + 3.0f * ((s / side) + 0.5f) / side;
+        seeds[3 * s + 2] = -1.5f + 3.0f * ((s % side) + 0.5f) / side;
+    }
+
+    Streamlines lines;
+#ifdef _OPENMP
+    int max_threads = omp_get_max_threads();
+    printf("streamline scaling:\n");
+    for (int t = 1; t <= max_threads; t = next_thread_count(t, max_threads)) {
+        omp_set_num_threads(t);
+        double s = run(&field, seeds, n, &lines);
+        printf("  %2d threads: %8.0f seeds/s\n", t, n / s);
+        Streamline_Free(&lines);
+    }
+    omp_set_num_threads(max_threads);
+#endif
+
+    double s = run(&field, seeds, n, &lines);
+    if (s < 0.0) {
+        fprintf(stderr, "trace failed\n");
+        return 1;
+    }
+    int solid = 0;
+    for (int i = 0; i < lines.numLines; i++)
+        solid += lines.reason[i] == STREAMLINE_SOLID;
+    printf("%d seeds: %.2f s, %.0f seeds/s, %.1f points per line, "
+           "%d stopped at the body\n",
+           n, s, n / s, (double)lines.numPoints / n, solid);
+
+    const char *path = "/tmp/bench_streamlines.vtp";
+    double t0 = now_sec();
+    int rc = Streamline_WriteVTP(&lines, path);
+    double t1 = now_sec();
+    if (rc == 0)
+        printf("VTP write: %.2f s (%.1f MB)\n", t1 - t0,
+               lines.numPoints * 20e-6);
+    remove(path);
+
+    Streamline_Free(&lines);
+    Streamline_FreeField(&field);
+    free(seeds);
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*
+ * Benchmark: Strouhal peak search on synthetic Cl series (a shedding
+ * tone plus noise), legacy single-window O(n^2) DFT against the Welch
+ * FFT spectrum. Reports time per call and the frequency error of each.
+ *
+ *   ./build/bench_strouhal [max samples]
+ */
+
+#define _USE_MATH_DEFINES
+#include "../lib/drag_metrics.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rng_state = 12345u;
+
+static float frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+/* The peak search compute_strouhal used before the FFT: Hann window over
+ * the whole series, direct DFT, strongest bin. */
+static float legacy_peak(const float *sig, int n, float fs) {
+    float mean = 0;
+    for (int i = 0; i < n; i++)
+        mean += sig[i];
+    mean /= n;
+
+    float *win = (float *)malloc(n * sizeof(float));
+    for (int i = 0; i < n; i++) {
+        float w = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / (n - 1)));
+        win[i] = (sig[i] - mean) * w;
+    }
+
+    int nfreqs = n / 2;
+    float peakPow = 0;
+    float peakFreq = 0;
+    for (int k = 1; k < nfreqs; k++) {
+        float re = 0, im = 0;
+        for (int i = 0; i < n; i++) {
+            float angle = 2.0f * (float)M_PI * k * i / n;
+            re += win[i] * cosf(angle);
+            im -= win[i] * sinf(angle);
+        }
+        float pw = re * re + im * im;
+        if (pw > peakPow) {
+            peakPow = pw;
+            peakFreq = (float)k * fs / n;
+        }
+    }
+    free(win);
+    return peakFreq;
+}
+
+int main(int argc, char **argv) {
+    int maxN = argc > 1 ? atoi(argv[1]) : 16000;
+    if (maxN < 64)
+        maxN = 64;
+
+    float fs = 1.0f / (CD_SAMPLE_INTERVAL * 2); /* 2 LBM substeps */
+    double f0 = 0.2461357 * fs; /* between bins at every length */
+    float *x = (float *)malloc((size_t)maxN * sizeof(float));
+    for (int i = 0; i < maxN; i++)
+        x[i] = 0.05f + 0.2f * (float)sin(2.0 * M_PI * f0 * i / fs) +
+               0.1f * (2.0f * frand() - 1.0f);
+
+    printf("%8s %12s %12s %8s %12s %12s\n", "samples", "DFT ms",
+           "Welch ms", "speedup", "DFT err %", "Welch err %");
+    for (int n = 1000; n <= maxN; n *= 4) {
+        double t0 = now_sec();
+        float fd = legacy_peak(x, n, fs);
+        double t1 = now_sec();
+
+        int reps = 0;
+        ClSpectrum s = {0};
+        double t2 = now_sec(), t3;
+        do {
+            cl_spectrum_free(&s);
+            if (cl_spectrum(x, n, fs, 0, &s) != 0) {
+                fprintf(stderr, "spectrum failed\n");
+                return 1;
+            }
+            reps++;
+            t3 = now_sec();
+        } while (t3 - t2 < 0.2);
+        double welch = (t3 - t2) / reps;
+
+        printf("%8d %12.3f %12.3f %7.0fx %12.3f %12.3f\n", n,
+               (t1 - t0) * 1e3, welch * 1e3, (t1 - t0) / welch,
+               100.0 * fabs(fd - f0) / f0,
+               100.0 * fabs(s.peakFrequency - f0) / f0);
+        cl_spectrum_free(&s);
+    }
+    free(x);
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Unit tests for the collision BVH: tree invariants, closest-triangle
+ * queries against brute force, degenerate input and thread-count
+ * independence of the parallel build.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#include "../lib/collision_bvh.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static uint32_t rng_state = 12345u;
+
+static float frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+/* n small triangles scattered over a sphere shell of radius 1, so the
+ * density varies like a surface mesh. */
+static GPUTriangle *triangle_soup(int n) {
+    GPUTriangle *t = (GPUTriangle *)malloc((size_t)n * sizeof(*t));
+    for (int i = 0; i < n; i++) {
+        float c[3], len = 0.0f;
+        for (int a = 0; a < 3; a++) {
+            c[a] = 2.0f * frand() - 1.0f;
+            len += c[a] * c[a];
+        }
+        len = sqrtf(len) + 1e-6f;
+        float v[3][3];
+        for (int k = 0; k < 3; k++)
+            for (int a = 0; a < 3; a++)
+                v[k][a] = c[a] / len + 0.05f * (frand() - 0.5f);
+        t[i] = (GPUTriangle){v[0][0], v[0][1], v[0][2], 0,
+                             v[1][0], v[1][1], v[1][2], 0,
+                             v[2][0], v[2][1], v[2][2], 0};
+    }
+    return t;
+}
+
+static int box_inside(const BVHNode *in, const BVHNode *out) {
+    return in->minX >= out->minX && in->minY >= out->minY &&
+           in->minZ >= out->minZ && in->maxX <= out->maxX &&
+           in->maxY <= out->maxY && in->maxZ <= out->maxZ;
+}
+
+static int tri_inside(const GPUTriangle *t, const BVHNode *n) {
+    const float *v = &t->v0x;
+    for (int k = 0; k < 3; k++)
+        if (v[4 * k] < n->minX || v[4 * k] > n->maxX ||
+            v[4 * k + 1] < n->minY || v[4 * k + 1] > n->maxY ||
+            v[4 * k + 2] < n->minZ || v[4 * k + 2] > n->maxZ)
+            return 0;
+    return 1;
+}
+
+/* Every triangle in exactly one leaf, children inside their parent,
+ * leaf triangles inside their leaf. */
+static int tree_valid(const CollisionBVH *bvh,
+                      const GPUTriangle *tris,
+                      int n,
+                      int maxLeaf) {
+    char *seen = (char *)calloc((size_t)n, 1);
+    int ok = bvh->numNodes >= 1 && bvh->numNodes <= 2 * n - 1 &&
+             bvh->numIndices == n && bvh->depth <= BVH_MAX_DEPTH;
+    int covered = 0;
+    for (int i = 0; ok && i < bvh->numNodes; i++) {
+        const BVHNode *node = &bvh->nodes[i];
+        if (node->count > 0) {
+            ok = node->count <= maxLeaf &&
+                 node->offset + node->count <= bvh->numIndices;
+            for (int j = 0; ok && j < node->count; j++) {
+                int t = bvh->triIndices[node->offset + j];
+                ok = t >= 0 && t < n && !seen[t] && tri_inside(&tris[t], node);
+                if (ok) {
+                    seen[t] = 1;
+                    covered++;
+                }
+            }
+        } else {
+            ok = i + 1 < bvh->numNodes && node->offset > i + 1 &&
+                 node->offset < bvh->numNodes &&
+                 box_inside(&bvh->nodes[i + 1], node) &&
+                 box_inside(&bvh->nodes[node->offset], node);
+        }
+    }
+    free(seen);
+    return ok && covered == n;
+}
+
+/* Test 1: no triangles gives an empty tree that never hits. */
+static void test_empty(void) {
+    printf("test_empty\n");
+    CollisionBVH bvh = buildCollisionBVH(NULL, 0);
+    float p[3] = {0, 0, 0}, c[3], nrm[3];
+    CHECK(bvh.numNodes == 0 && bvh.nodes == NULL, "empty tree");
+    CHECK(queryCollisionBVH(&bvh, NULL, p, 1.0f, c, nrm) == -1, "no hit");
+    freeCollisionBVH(&bvh);
+}
+
+/* Test 2: the tree over a scattered mesh is well formed and adapts:
+ * far fewer triangles per leaf than a coarse grid cell would hold. */
+static void test_structure(void) {
+    printf("test_structure\n");
+    int n = 5000;
+    GPUTriangle *tris = triangle_soup(n);
+    CollisionBVH bvh = buildCollisionBVH(tris, n);
+    CHECK(tree_valid(&bvh, tris, n, BVH_LEAF_MAX), "tree invariants");
+    int leaves = 0;
+    for (int i = 0; i < bvh.numNodes; i++)
+        leaves += bvh.nodes[i].count > 0;
+    CHECK(leaves > n / BVH_LEAF_MAX, "small leaves");
+    CHECK(sizeof(BVHNode) == 32, "node matches the std430 layout");
+    freeCollisionBVH(&bvh);
+    free(tris);
+
+    /* Coincident triangles cannot be split by SAH; they are halved. */
+    n = 100;
+    tris = (GPUTriangle *)malloc((size_t)n * sizeof(*tris));
+    for (int i = 0; i < n; i++)
+        tris[i] = (GPUTriangle){0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0};
+    bvh = buildCollisionBVH(tris, n);
+    CHECK(tree_valid(&bvh, tris, n, BVH_LEAF_MAX), "coincident triangles");
+    freeCollisionBVH(&bvh);
+    free(tris);
+}
+
+/* Closest triangle within maxDist by testing all of them. */
+static float brute_force(const GPUTriangle *tris,
+                         int n,
+                         const float p[3],
+                         float maxDist) {
+    float best = maxDist;
+    for (int t = 0; t < n; t++) {
+        float c[3], nrm[3];
+        float d = pointTriangleDistance(p, &tris[t], best, c, nrm);
+        if (d >= 0.0f && d < best)
+            best = d;
+    }
+    return best;
+}
+
+/* Test 3: queries agree with brute force near and away from the
+ * surface, for a collision radius and for an unbounded search. */
+static void test_query(void) {
+    printf("test_query\n");
+    int n = 3000;
+    GPUTriangle *tris = triangle_soup(n);
+    CollisionBVH bvh = buildCollisionBVH(tris, n);
+    int mismatch = 0, hits = 0, normals = 0;
+    for (int q = 0; q < 2000; q++) {
+        float p[3], c[3], nrm[3];
+        float r = q % 2 ? 0.9f + 0.2f * frand() : 1.5f * frand();
+        float len = 0.0f;
+        for (int a = 0; a < 3; a++) {
+            p[a] = 2.0f * frand() - 1.0f;
+            len += p[a] * p[a];
+        }
+        len = sqrtf(len) + 1e-6f;
+        for (int a = 0; a < 3; a++)
+            p[a] *= r / len;
+        float maxDist = q % 4 < 2 ? 0.03f : 10.0f;
+        float expect = brute_force(tris, n, p, maxDist);
+        int t = queryCollisionBVH(&bvh, tris, p, maxDist, c, nrm);
+        if (t < 0) {
+            mismatch += expect < maxDist;
+            continue;
+        }
+        hits++;
+        float d = sqrtf((p[0] - c[0]) * (p[0] - c[0]) +
+                        (p[1] - c[1]) * (p[1] - c[1]) +
+                        (p[2] - c[2]) * (p[2] - c[2]));
+        mismatch += fabsf(d - expect) > 1e-6f;
+        normals += fabsf(nrm[0] * nrm[0] + nrm[1] * nrm[1] +
+                         nrm[2] * nrm[2] - 1.0f) > 1e-5f;
+    }
+    CHECK(mismatch == 0, "same distance as brute force");
+    CHECK(hits > 1000, "queries hit the surface");
+    CHECK(normals == 0, "unit normals");
+    freeCollisionBVH(&bvh);
+    free(tris);
+}
+
+/* Test 4: the parallel build gives the same tree on any thread count. */
+static void test_threads(void) {
+    printf("test_threads\n");
+    int n = 40000; /* several build tasks */
+    GPUTriangle *tris = triangle_soup(n);
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    CollisionBVH a = buildCollisionBVH(tris, n);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    CollisionBVH b = buildCollisionBVH(tris, n);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    CHECK(a.numNodes == b.numNodes && a.depth == b.depth &&
+              memcmp(a.nodes, b.nodes,
+                     (size_t)a.numNodes * sizeof(BVHNode)) == 0 &&
+              memcmp(a.triIndices, b.triIndices, (size_t)n * sizeof(int)) ==
+                  0,
+          "same tree on 1 and 4 threads");
+    CHECK(tree_valid(&b, tris, n, BVH_LEAF_MAX), "tree invariants");
+    freeCollisionBVH(&a);
+    freeCollisionBVH(&b);
+    free(tris);
+}
+
+int main(void) {
+    printf("collision BVH unit tests\n");
+    test_empty();
+    test_structure();
+    test_query();
+    test_threads();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+/*
+ * Unit tests for the CPU FluidCube solver: the precomputed solid mask,
+ * the multigrid Poisson solver and sparse density transport.
+ * Pure CPU code -- no GL context needed (SDL only for
+ * SDL_ExitWithError).
+ */
+
+#define _USE_MATH_DEFINES
+#include "../lib/fluid_cube.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static uint32_t rng_state = 12345u;
+
+static float frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+/* Closed axis-aligned box, 12 triangles. */
+static Model make_box(const float lo[3], const float hi[3]) {
+    Model m = {0};
+    m.vertices = (Vertex *)malloc(8 * sizeof(Vertex));
+    m.faces = (Face *)malloc(12 * sizeof(Face));
+    for (int c = 0; c < 8; c++)
+        m.vertices[m.vertexCount++] = (Vertex){(c & 1) ? hi[0] : lo[0],
+                                               (c & 2) ? hi[1] : lo[1],
+                                               (c & 4) ? hi[2] : lo[2]};
+    /* Two triangles per side, 1-based corners. */
+    static const int quads[6][4] = {{1, 3, 7, 5}, {2, 6, 8, 4},
+                                    {1, 5, 6, 2}, {3, 4, 8, 7},
+                                    {1, 2, 4, 3}, {5, 7, 8, 6}};
+    for (int q = 0; q < 6; q++) {
+        const int *v = quads[q];
+        m.faces[m.faceCount++] = (Face){v[0], v[1], v[2]};
+        m.faces[m.faceCount++] = (Face){v[0], v[2], v[3]};
+    }
+    return m;
+}
+
+/* Closed UV sphere. */
+static Model
+make_sphere(int rings, int segments, const float centre[3], float radius) {
+    Model m = {0};
+    m.vertices = (Vertex *)malloc((size_t)((rings - 1) * segments + 2) *
+                                  sizeof(Vertex));
+    m.faces = (Face *)malloc((size_t)2 * rings * segments * sizeof(Face));
+    m.vertices[m.vertexCount++] =
+        (Vertex){centre[0], centre[1], centre[2] + radius};
+    for (int r = 1; r < rings; r++) {
+        double theta = M_PI * r / rings;
+        for (int s = 0; s < segments; s++) {
+            double phi = 2.0 * M_PI * s / segments;
+            m.vertices[m.vertexCount++] = (Vertex){
+                centre[0] + radius * (float)(sin(theta) * cos(phi)),
+                centre[1] + radius * (float)(sin(theta) * sin(phi)),
+                centre[2] + radius * (float)cos(theta)};
+        }
+    }
+    int south = m.vertexCount + 1;
+    m.vertices[m.vertexCount++] =
+        (Vertex){centre[0], centre[1], centre[2] - radius};
+    for (int s = 0; s < segments; s++) {
+        int s1 = (s + 1) % segments;
+        m.faces[m.faceCount++] = (Face){1, 2 + s, 2 + s1};
+        for (int r = 1; r < rings - 1; r++) {
+            int a = 2 + (r - 1) * segments + s, b = 2 + (r - 1) * segments + s1;
+            int c = a + segments, d = b + segments;
+            m.faces[m.faceCount++] = (Face){a, c, d};
+            m.faces[m.faceCount++] = (Face){a, d, b};
+        }
+        int last = 2 + (rings - 2) * segments;
+        m.faces[m.faceCount++] = (Face){last + s, south, last + s1};
+    }
+    return m;
+}
+
+/* Cells where the mask and a per-cell isInsideCarModel disagree, or -1
+ * when the solid cell list does not match the mask. */
+static long mask_mismatches(FluidCube *cube) {
+    int sx = cube->sizeX, sy = cube->sizeY, sz = cube->sizeZ;
+    long wrong = 0, solid = 0;
+    for (int k = 0; k < sz; k++)
+        for (int j = 0; j < sy; j++)
+            for (int i = 0; i < sx; i++) {
+                int idx = i + sx * (j + sy * k);
+                int inside = isInsideCarModel(i, j, k, cube->model, sx, sy, sz);
+                wrong += (cube->solid[idx] != 0) != inside;
+                if (cube->solid[idx]) {
+                    if (solid >= cube->solidCount ||
+                        cube->solidCells[solid] != idx)
+                        return -1;
+                    solid++;
+                }
+            }
+    return solid == cube->solidCount ? wrong : -1;
+}
+
+/* Test 1: the column-ray mask equals per-cell isInsideCarModel on a box
+ * and a sphere, on cubic and anisotropic grids, and follows the model
+ * when it moves. */
+static void test_solid_mask(void) {
+    printf("test_solid_mask\n");
+    float lo[3] = {-0.43f, -0.37f, -0.29f}, hi[3] = {0.51f, 0.22f, 0.47f};
+    float centre[3] = {0.07f, -0.05f, 0.03f};
+    Model models[2] = {make_box(lo, hi), make_sphere(24, 48, centre, 0.6f)};
+    const int sizes[2][3] = {{17, 17, 17}, {20, 24, 28}};
+    for (int m = 0; m < 2; m++) {
+        for (int s = 0; s < 2; s++) {
+            FluidCube *cube = FluidCubeCreate(sizes[s][0], sizes[s][1],
+                                              sizes[s][2], 0.0f, 0.0f, 0.1f,
+                                              &models[m]);
+            CHECK(cube && cube->solidCount > 0, "solid cells found");
+            CHECK(cube && mask_mismatches(cube) == 0,
+                  "mask matches isInsideCarModel");
+            FluidCubeFree(cube);
+        }
+    }
+
+    FluidCube *cube = FluidCubeCreate(20, 24, 28, 0.0f, 0.0f, 0.1f,
+                                      &models[1]);
+    int before = cube->solidCount;
+    for (int v = 0; v < models[1].vertexCount; v++)
+        models[1].vertices[v].x += 0.25f;
+    CHECK(FluidCubeUpdateSolidMask(cube) == 0, "rebuilt");
+    CHECK(mask_mismatches(cube) == 0, "moved model matches");
+    CHECK(cube->solidCount < before, "sphere partly left the grid");
+    cube->model = NULL;
+    CHECK(FluidCubeUpdateSolidMask(cube) == 0 && cube->solidCount == 0,
+          "no model, no solids");
+    FluidCubeFree(cube);
+
+    for (int m = 0; m < 2; m++)
+        freeModel(&models[m]);
+}
+
+/* Right-hand side with random fluid cells, zero elsewhere. */
+static float *random_rhs(const FluidCube *cube, float mean) {
+    size_t n = (size_t)cube->sizeX * cube->sizeY * cube->sizeZ;
+    float *x0 = (float *)calloc(n, sizeof(float));
+    for (int k = 1; k < cube->sizeZ - 1; k++)
+        for (int j = 1; j < cube->sizeY - 1; j++)
+            for (int i = 1; i < cube->sizeX - 1; i++)
+                x0[i + cube->sizeX * (j + cube->sizeY * k)] =
+                    mean + frand() - 0.5f;
+    return x0;
+}
+
+/* |x0 - (c x - a * neighbours)| / |x0| over the fluid interior cells,
+ * with the mean of x0 removed first when `zeroMean` is set. */
+static double relative_residual(const FluidCube *cube,
+                                const float *x,
+                                const float *x0,
+                                float a,
+                                float c,
+                                int zeroMean) {
+    int sx = cube->sizeX, sy = cube->sizeY, sz = cube->sizeZ;
+    double mean = 0.0;
+    long fluid = 0;
+    for (int k = 1; k < sz - 1; k++)
+        for (int j = 1; j < sy - 1; j++)
+            for (int i = 1; i < sx - 1; i++) {
+                int idx = i + sx * (j + sy * k);
+                if (!cube->solid[idx]) {
+                    mean += x0[idx];
+                    fluid++;
+                }
+            }
+    mean = zeroMean && fluid ? mean / fluid : 0.0;
+    double rr = 0.0, bb = 0.0;
+    for (int k = 1; k < sz - 1; k++)
+        for (int j = 1; j < sy - 1; j++)
+            for (int i = 1; i < sx - 1; i++) {
+                int idx = i + sx * (j + sy * k);
+                if (cube->solid[idx])
+                    continue;
+                double nb = (double)x[idx - 1] + x[idx + 1] + x[idx - sx] +
+                            x[idx + sx] + x[idx - sx * sy] + x[idx + sx * sy];
+                double b = x0[idx] - mean;
+                double r = b - (c * (double)x[idx] - a * nb);
+                rr += r * r;
+                bb += b * b;
+            }
+    return sqrt(rr / bb);
+}
+
+/* Test 2: V-cycles bring the residual below solverTolerance within
+ * solverMaxCycles, for diffusion and for pressure around a solid. */
+static void test_multigrid_converges(void) {
+    printf("test_multigrid_converges\n");
+    float centre[3] = {0.07f, -0.05f, 0.03f};
+    Model sphere = make_sphere(16, 32, centre, 0.5f);
+    FluidCube *cube =
+        FluidCubeCreate(26, 22, 30, 0.0f, 0.0f, 0.1f, &sphere);
+    size_t n = (size_t)26 * 22 * 30;
+    float *x = (float *)calloc(n, sizeof(float));
+    float *x0 = random_rhs(cube, 0.0f);
+    const float system[2][2] = {{2.7f, 1.0f + 6.0f * 2.7f}, {1.0f, 6.0f}};
+    const float tolerance[2] = {1e-3f, 1e-5f};
+    for (int s = 0; s < 2; s++) {
+        for (int t = 0; t < 2; t++) {
+            float a = system[s][0], c = system[s][1];
+            FluidCubeSetSolver(cube, FLUID_SOLVER_MULTIGRID, tolerance[t], 40);
+            memset(x, 0, n * sizeof(float));
+            FluidCubeSolve(cube, 0, x, x0, a, c, 4);
+            CHECK(cube->solver == FLUID_SOLVER_MULTIGRID, "still multigrid");
+            CHECK(cube->lastSolveCycles > 0 &&
+                      cube->lastSolveCycles < cube->solverMaxCycles,
+                  "converged before the cycle limit");
+            CHECK(cube->lastSolveResidual <= tolerance[t],
+                  "reported residual below tolerance");
+            CHECK(relative_residual(cube, x, x0, a, c, 0) <=
+                      1.01 * tolerance[t],
+                  "actual residual below tolerance");
+        }
+    }
+    free(x);
+    free(x0);
+    FluidCubeFree(cube);
+    freeModel(&sphere);
+}
+
+/* Test 3: multigrid and many Gauss-Seidel sweeps agree on the pressure
+ * around a solid. */
+static void test_multigrid_matches_gauss_seidel(void) {
+    printf("test_multigrid_matches_gauss_seidel\n");
+    float centre[3] = {-0.11f, 0.06f, 0.0f};
+    Model sphere = make_sphere(16, 32, centre, 0.45f);
+    FluidCube *cube =
+        FluidCubeCreate(16, 16, 16, 0.0f, 0.0f, 0.1f, &sphere);
+    size_t n = (size_t)16 * 16 * 16;
+    float *mg = (float *)calloc(n, sizeof(float));
+    float *gs = (float *)calloc(n, sizeof(float));
+    float *x0 = random_rhs(cube, 0.0f);
+    CHECK(cube->solidCount > 0, "solid cells");
+    FluidCubeSetSolver(cube, FLUID_SOLVER_MULTIGRID, 1e-6f, 100);
+    FluidCubeSolve(cube, 0, mg, x0, 1.0f, 6.0f, 0);
+    FluidCubeSetSolver(cube, FLUID_SOLVER_GAUSS_SEIDEL, 0.0f, 0);
+    FluidCubeSolve(cube, 0, gs, x0, 1.0f, 6.0f, 3000);
+    float diff = 0.0f, peak = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        diff = fmaxf(diff, fabsf(mg[i] - gs[i]));
+        peak = fmaxf(peak, fabsf(gs[i]));
+    }
+    CHECK(peak > 0.0f && diff <= 1e-4f * peak, "solutions agree");
+    free(mg);
+    free(gs);
+    free(x0);
+    FluidCubeFree(cube);
+    freeModel(&sphere);
+}
+
+/* Test 4: without solids the pressure system is singular; the mean of
+ * the right-hand side is removed and the rest still converges. */
+static void test_singular_pressure(void) {
+    printf("test_singular_pressure\n");
+    FluidCube *cube = FluidCubeCreate(24, 20, 18, 0.0f, 0.0f, 0.1f, NULL);
+    size_t n = (size_t)24 * 20 * 18;
+    float *x = (float *)calloc(n, sizeof(float));
+    float *x0 = random_rhs(cube, 0.3f);
+    FluidCubeSolve(cube, 0, x, x0, 1.0f, 6.0f, 4);
+    CHECK(cube->lastSolveCycles > 0 &&
+              cube->lastSolveCycles < cube->solverMaxCycles,
+          "converged before the cycle limit");
+    CHECK(cube->lastSolveResidual <= cube->solverTolerance,
+          "reported residual below tolerance");
+    CHECK(relative_residual(cube, x, x0, 1.0f, 6.0f, 1) <=
+              1.01 * cube->solverTolerance,
+          "mean-free residual below tolerance");
+    float peak = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        peak = fmaxf(peak, fabsf(x[i]));
+    CHECK(isfinite(peak) && peak < 10.0f, "no drift from the mean");
+    free(x);
+    free(x0);
+    FluidCubeFree(cube);
+}
+
+/* A swirling jet along +x through the middle of the cube, with dye in
+ * a (2h)^2 patch for the first `dyeSteps` steps. */
+static void drive(FluidCube *cube, int step, int dyeSteps, int h) {
+    int n = cube->sizeX;
+    for (int k = n / 2 - h; k < n / 2 + h; k++)
+        for (int j = n / 2 - h; j < n / 2 + h; j++) {
+            FluidCubeAddVelocity(cube, n / 3, j, k, 1.0f,
+                                 0.5f * (k - n / 2), -0.5f * (j - n / 2));
+            if (step < dyeSteps)
+                FluidCubeAddDensity(cube, n / 3, j, k, 5.0f);
+        }
+}
+
+typedef struct {
+    float maxDiff;  /* largest |sparse - full| over the steps */
+    float peak;     /* largest full-grid density */
+    long minCells;  /* fewest cells a sparse step transported */
+    int boundsHold; /* density zero outside densityMin..densityMax */
+} SparseRun;
+
+/* Steps two identical cubes, one with sparse density transport and one
+ * with the full-grid passes, and compares their density every step. */
+static SparseRun
+compare_sparse(int n, float diff, FluidSolver solver, int steps, int h) {
+    SparseRun run = {0.0f, 0.0f, -1, 1};
+    FluidCube *sparse = FluidCubeCreate(n, n, n, diff, 1e-4f, 0.1f, NULL);
+    FluidCube *full = FluidCubeCreate(n, n, n, diff, 1e-4f, 0.1f, NULL);
+    full->sparseDensity = 0;
+    FluidCubeSetSolver(sparse, solver, 0.0f, 0);
+    FluidCubeSetSolver(full, solver, 0.0f, 0);
+    for (int s = 0; s < steps; s++) {
+        drive(sparse, s, steps / 2, h);
+        drive(full, s, steps / 2, h);
+        FluidCubeStep(sparse);
+        FluidCubeStep(full);
+        if (run.minCells < 0 || sparse->lastDensityCells < run.minCells)
+            run.minCells = sparse->lastDensityCells;
+        const int *lo = sparse->densityMin, *hi = sparse->densityMax;
+        for (int k = 1; k < n - 1; k++)
+            for (int j = 1; j < n - 1; j++)
+                for (int i = 1; i < n - 1; i++) {
+                    int idx = i + n * (j + n * k);
+                    float d = sparse->density[idx];
+                    run.maxDiff =
+                        fmaxf(run.maxDiff, fabsf(d - full->density[idx]));
+                    run.peak = fmaxf(run.peak, fabsf(full->density[idx]));
+                    int inside = i >= lo[0] && i <= hi[0] && j >= lo[1] &&
+                                 j <= hi[1] && k >= lo[2] && k <= hi[2];
+                    if (!inside && d != 0.0f)
+                        run.boundsHold = 0;
+                }
+    }
+    FluidCubeFree(sparse);
+    FluidCubeFree(full);
+    return run;
+}
+
+/* Test 5: sparse transport of a small plume matches the full-grid
+ * passes, including a diffusion reach of several cells per step (a
+ * near 1) that the box margin has to cover. */
+static void test_sparse_density(void) {
+    printf("test_sparse_density\n");
+    long interior = 62L * 62 * 62;
+    const float diffs[3] = {0.0f, 4e-6f, 4e-5f};
+    for (int d = 0; d < 3; d++) {
+        SparseRun run =
+            compare_sparse(64, diffs[d], FLUID_SOLVER_MULTIGRID, 8, 2);
+        CHECK(run.minCells > 0 && run.minCells < interior / 4,
+              "multigrid: ran on a small box");
+        CHECK(run.peak > 1.0f && run.maxDiff <= 1e-5f * run.peak,
+              "multigrid: matches the full-grid passes");
+        CHECK(run.boundsHold, "multigrid: density within the bounds");
+    }
+    SparseRun run =
+        compare_sparse(64, 4e-5f, FLUID_SOLVER_GAUSS_SEIDEL, 8, 2);
+    CHECK(run.minCells > 0 && run.minCells < interior / 4,
+          "gauss-seidel: ran on a small box");
+    CHECK(run.peak > 1.0f && run.maxDiff <= 1e-5f * run.peak,
+          "gauss-seidel: matches the full-grid passes");
+    CHECK(run.boundsHold, "gauss-seidel: density within the bounds");
+}
+
+/* Test 6: a plume whose box would cover more than SPARSE_MAX_FILL of
+ * the grid takes the full-grid passes and gives the same density. */
+static void test_sparse_fallback(void) {
+    printf("test_sparse_fallback\n");
+    SparseRun run = compare_sparse(32, 1e-5f, FLUID_SOLVER_MULTIGRID, 4, 12);
+    CHECK(run.minCells == 30L * 30 * 30, "full grid stepped");
+    CHECK(run.peak > 1.0f && run.maxDiff == 0.0f, "identical density");
+}
+
+int main(void) {
+    printf("FluidCube unit tests\n");
+    test_solid_mask();
+    test_multigrid_converges();
+    test_multigrid_matches_gauss_seidel();
+    test_singular_pressure();
+    test_sparse_density();
+    test_sparse_fallback();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
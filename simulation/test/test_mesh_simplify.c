@@ -0,0 +1,199 @@
+/*
+ * Unit tests for quadric-error mesh simplification. Pure CPU code -- no
+ * GL context needed.
+ */
+
+#include "../lib/mesh_simplify.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+/* n x n unit square in the z = 0 plane, 2 n^2 triangles. Each interior
+ * vertex is stored twice (as OBJ seams often are) when `split` is set,
+ * with the right half of the grid using the copies. */
+static Model make_grid(int n, int split) {
+    Model m = {0};
+    int per_row = n + 1;
+    int copies = split ? 2 : 1;
+    m.vertices = (Vertex *)malloc((size_t)copies * per_row * per_row *
+                                  sizeof(Vertex));
+    m.faces = (Face *)malloc((size_t)2 * n * n * sizeof(Face));
+    for (int c = 0; c < copies; c++)
+        for (int j = 0; j <= n; j++)
+            for (int i = 0; i <= n; i++) {
+                Vertex *v = &m.vertices[m.vertexCount++];
+                v->x = (float)i / n;
+                v->y = (float)j / n;
+                v->z = 0.0f;
+            }
+    for (int j = 0; j < n; j++)
+        for (int i = 0; i < n; i++) {
+            int base = split && i >= n / 2 ? per_row * per_row : 0;
+            int a = base + j * per_row + i + 1, b = a + 1, c = a + per_row,
+                d = c + 1;
+            m.faces[m.faceCount++] = (Face){a, b, d};
+            m.faces[m.faceCount++] = (Face){a, d, c};
+        }
+    return m;
+}
+
+/* Closed UV sphere of radius 1. */
+static Model make_sphere(int rings, int segments) {
+    Model m = {0};
+    m.vertices = (Vertex *)malloc((size_t)((rings - 1) * segments + 2) *
+                                  sizeof(Vertex));
+    m.faces = (Face *)malloc((size_t)2 * rings * segments * sizeof(Face));
+    m.vertices[m.vertexCount++] = (Vertex){0.0f, 0.0f, 1.0f};
+    for (int r = 1; r < rings; r++) {
+        double theta = M_PI * r / rings;
+        for (int s = 0; s < segments; s++) {
+            double phi = 2.0 * M_PI * s / segments;
+            m.vertices[m.vertexCount++] =
+                (Vertex){(float)(sin(theta) * cos(phi)),
+                         (float)(sin(theta) * sin(phi)), (float)cos(theta)};
+        }
+    }
+    int south = m.vertexCount + 1;
+    m.vertices[m.vertexCount++] = (Vertex){0.0f, 0.0f, -1.0f};
+    for (int s = 0; s < segments; s++) {
+        int s1 = (s + 1) % segments;
+        m.faces[m.faceCount++] = (Face){1, 2 + s, 2 + s1};
+        for (int r = 1; r < rings - 1; r++) {
+            int a = 2 + (r - 1) * segments + s, b = 2 + (r - 1) * segments + s1;
+            int c = a + segments, d = b + segments;
+            m.faces[m.faceCount++] = (Face){a, c, d};
+            m.faces[m.faceCount++] = (Face){a, d, b};
+        }
+        int last = 2 + (rings - 2) * segments;
+        m.faces[m.faceCount++] = (Face){last + s, south, last + s1};
+    }
+    return m;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Every edge used by exactly two triangles, in opposite directions. */
+static int is_closed_manifold(const Model *m) {
+    size_t n = (size_t)m->faceCount * 3;
+    uint64_t *e = (uint64_t *)malloc(n * sizeof(uint64_t));
+    for (int t = 0; t < m->faceCount; t++) {
+        int v[3] = {m->faces[t].v1, m->faces[t].v2, m->faces[t].v3};
+        for (int k = 0; k < 3; k++)
+            e[3 * t + k] =
+                (uint64_t)(uint32_t)v[k] << 32 | (uint32_t)v[(k + 1) % 3];
+    }
+    qsort(e, n, sizeof(uint64_t), cmp_u64);
+    int ok = 1;
+    for (size_t i = 0; ok && i < n; i++) {
+        uint64_t twin = e[i] << 32 | e[i] >> 32;
+        ok = (i == 0 || e[i] != e[i - 1]) &&
+             bsearch(&twin, e, n, sizeof(uint64_t), cmp_u64) != NULL;
+    }
+    free(e);
+    return ok;
+}
+
+static double total_area(const Model *m) {
+    double area = 0.0;
+    for (int t = 0; t < m->faceCount; t++) {
+        const Vertex *a = &m->vertices[m->faces[t].v1 - 1];
+        const Vertex *b = &m->vertices[m->faces[t].v2 - 1];
+        const Vertex *c = &m->vertices[m->faces[t].v3 - 1];
+        double e1[3] = {b->x - a->x, b->y - a->y, b->z - a->z};
+        double e2[3] = {c->x - a->x, c->y - a->y, c->z - a->z};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                       e1[2] * e2[0] - e1[0] * e2[2],
+                       e1[0] * e2[1] - e1[1] * e2[0]};
+        area += 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    }
+    return area;
+}
+
+/* Test 1: a flat grid collapses to a handful of triangles at zero
+ * error, keeping its border and area, across duplicated seam vertices. */
+static void test_flat_grid(void) {
+    printf("test_flat_grid\n");
+    Model in = make_grid(16, 1);
+    Model out;
+    SimplifyReport rep;
+    int rc = simplifyModel(&in, 1e-6f, 0, &out, &rep);
+    CHECK(rc == 0, "simplify succeeds");
+    CHECK(rep.inputFaces == 512 && rep.faceCount == out.faceCount,
+          "report counts");
+    CHECK(out.faceCount <= 4, "flat grid collapses");
+    CHECK(rep.maxError <= 1e-6f, "error within budget");
+    CHECK(fabs(total_area(&out) - 1.0) < 1e-5, "area preserved");
+    CHECK(out.boundsMin[0] == 0.0f && out.boundsMax[0] == 1.0f &&
+              out.boundsMin[1] == 0.0f && out.boundsMax[1] == 1.0f,
+          "border held in place");
+    freeModel(&out);
+    freeModel(&in);
+}
+
+/* Test 2: on a sphere the error budget bounds the result, which stays
+ * closed and close to the surface. */
+static void test_sphere_error_budget(void) {
+    printf("test_sphere_error_budget\n");
+    Model in = make_sphere(32, 64);
+    Model out;
+    SimplifyReport rep;
+    int rc = simplifyModel(&in, 0.01f, 0, &out, &rep);
+    CHECK(rc == 0, "simplify succeeds");
+    CHECK(out.faceCount < in.faceCount / 2, "sphere is reduced");
+    CHECK(rep.maxError > 0.0f && rep.maxError <= 0.01f, "error reported");
+    CHECK(is_closed_manifold(&out), "still closed and manifold");
+    int near = 1;
+    for (int i = 0; i < out.vertexCount; i++) {
+        const Vertex *v = &out.vertices[i];
+        double r = sqrt(v->x * v->x + v->y * v->y + v->z * v->z);
+        near = near && fabs(r - 1.0) <= 0.02;
+    }
+    CHECK(near, "vertices stay near the sphere");
+    freeModel(&out);
+    freeModel(&in);
+}
+
+/* Test 3: without an error limit the face target stops the collapses. */
+static void test_face_target(void) {
+    printf("test_face_target\n");
+    Model in = make_sphere(16, 32);
+    Model out;
+    SimplifyReport rep;
+    int rc = simplifyModel(&in, 0.0f, 100, &out, &rep);
+    CHECK(rc == 0, "simplify succeeds");
+    CHECK(out.faceCount <= 100 && out.faceCount >= 90, "target reached");
+    CHECK(is_closed_manifold(&out), "still closed and manifold");
+    freeModel(&out);
+    freeModel(&in);
+
+    Model empty = {0};
+    CHECK(simplifyModel(&empty, 1.0f, 0, &out, &rep) != 0, "empty input");
+}
+
+int main(void) {
+    printf("mesh simplification unit tests\n");
+    test_flat_grid();
+    test_sphere_error_budget();
+    test_face_target();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,327 @@
+/*
+ * Unit tests for the OBJ and STL loaders. Pure CPU code -- no GL context
+ * needed.
+ */
+
+#include "../obj-file-loader/lib/model_loader.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static const char *TMP_OBJ = "/tmp/test_obj_loader.obj";
+static const char *TMP_STL = "/tmp/test_obj_loader.STL";
+
+static int write_text(const char *path, const char *text) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+    fputs(text, f);
+    return fclose(f);
+}
+
+static int face_is(const Face *f, int a, int b, int c) {
+    return f->v1 == a && f->v2 == b && f->v3 == c;
+}
+
+/* Test 1: the face token forms all resolve to the vertex index. */
+static void test_face_formats(void) {
+    printf("test_face_formats\n");
+    write_text(TMP_OBJ,
+               "# comment\n"
+               "o thing\n"
+               "v 0 0 0\n"
+               "v 1.5 -2.25e1 3E-2\n"
+               "  v\t+0.5 .25 -1.\n"
+               "vt 0 0\n"
+               "vn 0 0 1\n"
+               "f 1 2 3\n"
+               "f 1/1 2/1 3/1\n"
+               "f 1/1/1 2/1/1 3/1/1\n"
+               "f 1//1 2//1 3//1 # trailing comment\n");
+    Model m = loadOBJ(TMP_OBJ);
+    CHECK(m.vertexCount == 3, "three vertices");
+    CHECK(m.faceCount == 4, "four faces");
+    if (m.vertexCount == 3) {
+        CHECK(m.vertices[1].x == 1.5f && m.vertices[1].y == -22.5f &&
+                  m.vertices[1].z == 3e-2f,
+              "exponents parse");
+        CHECK(m.vertices[2].x == 0.5f && m.vertices[2].y == 0.25f &&
+                  m.vertices[2].z == -1.0f,
+              "signs, bare fractions, leading blanks");
+    }
+    int all = 1;
+    for (int i = 0; i < m.faceCount; i++)
+        all &= face_is(&m.faces[i], 1, 2, 3);
+    CHECK(all, "every token form gives 1 2 3");
+    freeModel(&m);
+}
+
+/* Test 2: quads and n-gons fan around their first vertex; negative
+ * indices count back from the latest vertex. */
+static void test_polygons_and_relative(void) {
+    printf("test_polygons_and_relative\n");
+    write_text(TMP_OBJ,
+               "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nv 0.5 2 0\r\n"
+               "f 1 2 3 4 5\r\n"
+               "f -4 -3 -2 -1\r\n"
+               "f 1 2 x\r\n");
+    Model m = loadOBJ(TMP_OBJ);
+    CHECK(m.vertexCount == 5, "five vertices with CRLF");
+    CHECK(m.faceCount == 5, "pentagon -> 3, quad -> 2, bad face dropped");
+    if (m.faceCount == 5) {
+        CHECK(face_is(&m.faces[0], 1, 2, 3) && face_is(&m.faces[1], 1, 3, 4) &&
+                  face_is(&m.faces[2], 1, 4, 5),
+              "pentagon fan");
+        CHECK(face_is(&m.faces[3], 2, 3, 4) && face_is(&m.faces[4], 2, 4, 5),
+              "relative quad fan");
+    }
+    freeModel(&m);
+}
+
+/* Test 3: a missing file gives an empty model. */
+static void test_missing_file(void) {
+    printf("test_missing_file\n");
+    Model m = loadOBJ("/nonexistent/definitely_missing.obj");
+    CHECK(m.vertexCount == 0 && m.faceCount == 0 && !m.vertices && !m.faces,
+          "empty model");
+    freeModel(&m);
+}
+
+/* Test 4: the second load maps the .meshbin written by the first, and
+ * editing the source invalidates it. */
+static void test_meshbin_cache(void) {
+    printf("test_meshbin_cache\n");
+    char cache[256];
+    snprintf(cache, sizeof(cache), "%s.meshbin", TMP_OBJ);
+    remove(cache);
+
+    write_text(TMP_OBJ, "v 0 0 0\nv 2 0 0\nv 0 3 -1\nv 1 1 1\n"
+                        "f 1 2 3 4\n");
+    Model parsed = loadOBJ(TMP_OBJ);
+    Model mapped = loadOBJ(TMP_OBJ);
+    CHECK(parsed.mapping == NULL, "first load parses");
+    CHECK(mapped.mapping != NULL, "second load maps the cache");
+    CHECK(mapped.vertexCount == 4 && mapped.faceCount == 2 &&
+              memcmp(mapped.vertices, parsed.vertices,
+                     4 * sizeof(Vertex)) == 0 &&
+              memcmp(mapped.faces, parsed.faces, 2 * sizeof(Face)) == 0,
+          "cached mesh matches the parse");
+    CHECK(mapped.boundsMin[1] == 0.0f && mapped.boundsMax[1] == 3.0f &&
+              mapped.boundsMin[2] == -1.0f && mapped.boundsMax[0] == 2.0f,
+          "bounds stored in the cache");
+    if (mapped.vertexCount == 4) {
+        mapped.vertices[0].x = 5.0f; /* copy-on-write, file untouched */
+        Model again = loadOBJ(TMP_OBJ);
+        CHECK(again.vertexCount == 4 && again.vertices[0].x == 0.0f,
+              "edits to a mapped model stay private");
+        freeModel(&again);
+    }
+    freeModel(&parsed);
+    freeModel(&mapped);
+
+    write_text(TMP_OBJ, "v 0 0 0\nv 2 0 0\nv 0 4 -1\nv 1 1 1\n"
+                        "f 1 2 3 4\n");
+    Model edited = loadOBJ(TMP_OBJ);
+    CHECK(edited.mapping == NULL && edited.vertexCount == 4 &&
+              edited.vertices[2].y == 4.0f,
+          "edited source is re-parsed");
+    freeModel(&edited);
+    remove(cache);
+}
+
+/* Test 5: a file large enough to be parsed in parallel chunks must
+ * match the serial parse, including relative indices that reach back
+ * across chunk boundaries. */
+static void test_parallel_chunks(void) {
+    printf("test_parallel_chunks\n");
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    FILE *f = fopen(TMP_OBJ, "w");
+    CHECK(f != NULL, "open large OBJ");
+    if (!f)
+        return;
+    int blocks = 200000; /* ~12 MB, above the parallel threshold */
+    for (int b = 0; b < blocks; b++) {
+        fprintf(f, "v %d 0.5 -1.25\nv 0 %d 2e-1\nv 1 1 %d\n", b, b, b);
+        if (b % 2)
+            fprintf(f, "f -3/1/1 -2/1/1 -1/1/1 -4/1/1\n");
+        else
+            fprintf(f, "f %d %d %d\n", 3 * b + 1, 3 * b + 2, 3 * b + 3);
+    }
+    fclose(f);
+
+    Model m = loadOBJUncached(TMP_OBJ);
+    CHECK(m.vertexCount == 3 * blocks, "all vertices");
+    CHECK(m.faceCount == blocks / 2 * 3, "quad fans + triangles");
+    int ok = m.faceCount == blocks / 2 * 3;
+    for (int b = 0, fi = 0; ok && b < blocks; b++) {
+        int v = 3 * b + 1;
+        if (b % 2) {
+            ok = face_is(&m.faces[fi], v, v + 1, v + 2) &&
+                 face_is(&m.faces[fi + 1], v, v + 2, v - 1);
+            fi += 2;
+        } else {
+            ok = face_is(&m.faces[fi], v, v + 1, v + 2);
+            fi += 1;
+        }
+        ok = ok && m.vertices[v - 1].x == (float)b &&
+             m.vertices[v].y == (float)b && m.vertices[v + 1].z == (float)b;
+    }
+    CHECK(ok, "chunked parse matches the file order");
+    freeModel(&m);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+}
+
+/* Unit cube as 12 triangles, 36 corners over 8 distinct positions. */
+static const float CUBE[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0},
+                                 {0, 1, 0}, {0, 0, 1}, {1, 0, 1},
+                                 {1, 1, 1}, {0, 1, 1}};
+static const int CUBE_TRIS[12][3] = {
+    {0, 2, 1}, {0, 3, 2}, {4, 5, 6}, {4, 6, 7}, {0, 1, 5}, {0, 5, 4},
+    {2, 3, 7}, {2, 7, 6}, {1, 2, 6}, {1, 6, 5}, {0, 4, 7}, {0, 7, 3}};
+
+/* Every face must be a distinct cube triangle with its corners in
+ * the original winding. */
+static int cube_faces_match(const Model *m) {
+    for (int t = 0; t < 12; t++) {
+        const Face *f = &m->faces[t];
+        int idx[3] = {f->v1 - 1, f->v2 - 1, f->v3 - 1};
+        for (int k = 0; k < 3; k++) {
+            if (idx[k] < 0 || idx[k] >= m->vertexCount)
+                return 0;
+            const float *want = CUBE[CUBE_TRIS[t][k]];
+            const Vertex *v = &m->vertices[idx[k]];
+            if (fabsf(v->x - want[0]) > 1e-5f ||
+                fabsf(v->y - want[1]) > 1e-5f || fabsf(v->z - want[2]) > 1e-5f)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/* Test 6: binary STL corners weld into shared vertices, including one
+ * jittered below the tolerance, and a collapsed triangle is dropped. */
+static void test_stl_binary(void) {
+    printf("test_stl_binary\n");
+    FILE *f = fopen(TMP_STL, "wb");
+    CHECK(f != NULL, "open STL");
+    if (!f)
+        return;
+    char header[80] = "solid looks-like-ascii";
+    uint32_t count = 13;
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(&count, sizeof(count), 1, f);
+    for (int t = 0; t < 13; t++) {
+        float rec[12] = {0};
+        uint16_t attr = 0;
+        for (int k = 0; k < 3; k++) {
+            /* Triangle 12 has two coincident corners. */
+            const float *c = CUBE[t < 12 ? CUBE_TRIS[t][k] : k == 2];
+            memcpy(&rec[3 + 3 * k], c, 3 * sizeof(float));
+        }
+        if (t == 5)
+            rec[3] += 1e-7f; /* corner 0 of triangle 5, within tolerance */
+        fwrite(rec, sizeof(rec), 1, f);
+        fwrite(&attr, sizeof(attr), 1, f);
+    }
+    fclose(f);
+
+    char cache[256];
+    snprintf(cache, sizeof(cache), "%s.meshbin", TMP_STL);
+    remove(cache);
+    Model m = loadModel(TMP_STL);
+    CHECK(m.vertexCount == 8, "welded to 8 vertices");
+    CHECK(m.faceCount == 12, "degenerate triangle dropped");
+    CHECK(m.faceCount == 12 && cube_faces_match(&m), "faces keep geometry");
+    CHECK(m.boundsMin[0] == 0.0f && m.boundsMax[2] == 1.0f, "bounds");
+    Model cached = loadModel(TMP_STL);
+    CHECK(cached.mapping != NULL && cached.faceCount == 12 &&
+              memcmp(cached.faces, m.faces, 12 * sizeof(Face)) == 0,
+          "STL goes through the meshbin cache");
+    freeModel(&cached);
+    freeModel(&m);
+    remove(cache);
+}
+
+/* Test 7: ASCII STL, with one facet given as a quad loop. */
+static void test_stl_ascii(void) {
+    printf("test_stl_ascii\n");
+    FILE *f = fopen(TMP_STL, "w");
+    CHECK(f != NULL, "open STL");
+    if (!f)
+        return;
+    fprintf(f, "solid cube\r\n");
+    for (int t = 0; t < 12; t++) {
+        fprintf(f, "  facet normal 0 0 0\r\n    outer loop\r\n");
+        for (int k = 0; k < 3; k++) {
+            const float *c = CUBE[CUBE_TRIS[t][k]];
+            fprintf(f, "      vertex %.7e %g %g\r\n", c[0], c[1], c[2]);
+        }
+        fprintf(f, "    endloop\r\n  endfacet\r\n");
+    }
+    fprintf(f, "facet normal 0 0 1\nouter loop\n"
+               "vertex 0 0 2\nvertex 1 0 2\nvertex 1 1 2\nvertex 0 1 2\n"
+               "endloop\nendfacet\n"
+               "facet normal 0 0 1\nouter loop\n"
+               "vertex 0 0 3\nvertex bad\nvertex 1 1 3\n"
+               "endloop\nendfacet\nendsolid cube\n");
+    fclose(f);
+
+    char cache[256];
+    snprintf(cache, sizeof(cache), "%s.meshbin", TMP_STL);
+    remove(cache);
+    Model m = loadSTL(TMP_STL);
+    CHECK(m.vertexCount == 12, "8 cube + 4 quad vertices");
+    CHECK(m.faceCount == 14, "quad fanned, malformed facet skipped");
+    CHECK(m.faceCount == 14 && cube_faces_match(&m), "faces keep geometry");
+    if (m.faceCount == 14)
+        CHECK(m.faces[13].v1 == m.faces[12].v1 &&
+                  m.faces[13].v2 == m.faces[12].v3,
+              "quad fan shares its first vertex");
+    freeModel(&m);
+    remove(cache);
+
+    write_text(TMP_STL, "not a mesh\n");
+    m = loadSTL(TMP_STL);
+    CHECK(m.vertexCount == 0 && m.faceCount == 0, "junk is rejected");
+    freeModel(&m);
+}
+
+int main(void) {
+    printf("obj loader unit tests\n");
+    test_face_formats();
+    test_polygons_and_relative();
+    test_missing_file();
+    test_meshbin_cache();
+    test_parallel_chunks();
+    test_stl_binary();
+    test_stl_ascii();
+    remove(TMP_OBJ);
+    remove(TMP_STL);
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+/*
+ * Unit tests for the host-side particle tracer. Pure CPU code -- no GL
+ * context needed.
+ */
+
+#include "../lib/particle_tracer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+#define NX 64
+#define NY 32
+#define NZ 32
+
+/* Uniform lattice velocity (u, 0, 0) everywhere. */
+static float *uniform_field(float u) {
+    float *v = (float *)calloc((size_t)4 * NX * NY * NZ, sizeof(float));
+    for (int c = 0; c < NX * NY * NZ; c++) {
+        v[4 * c] = u;
+        v[4 * c + 3] = 1.0f;
+    }
+    return v;
+}
+
+/* Unit cube centred on the origin, 12 outward-facing triangles. */
+static const float CUBE[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0},
+                                 {0, 1, 0}, {0, 0, 1}, {1, 0, 1},
+                                 {1, 1, 1}, {0, 1, 1}};
+static const int CUBE_TRIS[12][3] = {
+    {0, 2, 1}, {0, 3, 2}, {4, 5, 6}, {4, 6, 7}, {0, 1, 5}, {0, 5, 4},
+    {2, 3, 7}, {2, 7, 6}, {1, 2, 6}, {1, 6, 5}, {0, 4, 7}, {0, 7, 3}};
+
+static void make_cube(GPUTriangle tris[12], CollisionBVH *bvh) {
+    for (int t = 0; t < 12; t++) {
+        const float *a = CUBE[CUBE_TRIS[t][0]], *b = CUBE[CUBE_TRIS[t][1]],
+                    *c = CUBE[CUBE_TRIS[t][2]];
+        tris[t] = (GPUTriangle){a[0] - 0.5f, a[1] - 0.5f, a[2] - 0.5f, 0,
+                                b[0] - 0.5f, b[1] - 0.5f, b[2] - 0.5f, 0,
+                                c[0] - 0.5f, c[1] - 0.5f, c[2] - 0.5f, 0};
+    }
+    *bvh = buildCollisionBVH(tris, 12);
+}
+
+/* A 21 x 21 block of particles at x = -2 spanning |y|, |z| <= 1, at
+ * rest. */
+static void seed_plane(ParticleTracer *tr) {
+    for (int j = 0; j < 21; j++)
+        for (int k = 0; k < 21; k++)
+            ParticleTracer_Add(tr, -2.0f, -1.0f + 0.1f * j,
+                               -1.0f + 0.1f * k, 0, 0, 0);
+}
+
+/* Test 1: trilinear sampling reproduces a linear field, scaled to world
+ * units, and clamps half a cell inside the grid. */
+static void test_sample_linear(void) {
+    printf("test_sample_linear\n");
+    float *v = (float *)calloc((size_t)4 * NX * NY * NZ, sizeof(float));
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 0; i < NX; i++) {
+                float *c = v + 4 * ((size_t)i + NX * (j + (size_t)NY * k));
+                c[0] = (float)i;
+                c[1] = 2.0f * j;
+                c[2] = -(float)k;
+            }
+    TracerField f = {NX, NY, NZ, v, 8.0f};
+    float out[3];
+    ParticleTracer_SampleVelocity(&f, 0.3f, -0.7f, 1.1f, out);
+    float gx = (0.3f + 4.0f) / 8.0f * NX, gy = (-0.7f + 2.0f) / 4.0f * NY,
+          gz = (1.1f + 2.0f) / 4.0f * NZ;
+    CHECK(fabsf(out[0] - 8.0f * gx) < 1e-3f, "x interpolated");
+    CHECK(fabsf(out[1] - 16.0f * gy) < 1e-3f, "y interpolated");
+    CHECK(fabsf(out[2] + 8.0f * gz) < 1e-3f, "z interpolated");
+    ParticleTracer_SampleVelocity(&f, -10.0f, 10.0f, 0.0f, out);
+    CHECK(fabsf(out[0] - 8.0f * 0.5f) < 1e-4f, "clamped low");
+    CHECK(fabsf(out[1] - 16.0f * (NY - 1.5f)) < 1e-3f, "clamped high");
+    free(v);
+}
+
+/* Test 2: massless particles in a uniform flow leave after the transit
+ * time. */
+static void test_residence_time(void) {
+    printf("test_residence_time\n");
+    float *v = uniform_field(0.125f); /* 1 world unit per time unit */
+    TracerField f = {NX, NY, NZ, v, 8.0f};
+    TracerParams p = {0.01f, 1.0f, 3.0f};
+    ParticleTracer tr;
+    CHECK(ParticleTracer_Init(&tr, 441) == 0, "init");
+    seed_plane(&tr);
+    CHECK(ParticleTracer_Add(&tr, 0, 0, 0, 0, 0, 0) == -1, "full");
+    int steps = ParticleTracer_Run(&tr, &f, NULL, &p, 10000);
+    CHECK(steps < 10000, "all particles leave");
+    int ok = 1;
+    for (int i = 0; i < tr.count; i++)
+        ok = ok && tr.state[i] == TRACER_EXITED &&
+             fabsf(tr.time[i] - 5.0f) < 0.02f;
+    CHECK(ok, "transit time matches the distance over the speed");
+    ParticleTracer_Free(&tr);
+    free(v);
+}
+
+/* Test 3: with deposition on, particles heading for the cube stick to
+ * its upstream face and the rest pass; with it off, nothing ends up
+ * inside the cube. */
+static void test_cube_collision(void) {
+    printf("test_cube_collision\n");
+    float *v = uniform_field(0.125f);
+    TracerField f = {NX, NY, NZ, v, 8.0f};
+    TracerParams p = {0.01f, 1.0f, 3.0f};
+    GPUTriangle tris[12];
+    CollisionBVH bvh;
+    make_cube(tris, &bvh);
+    TracerBody body = {tris, 12, &bvh, 0.03f, 1};
+
+    ParticleTracer tr;
+    ParticleTracer_Init(&tr, 441);
+    seed_plane(&tr);
+    ParticleTracer_Run(&tr, &f, &body, &p, 10000);
+    int deposited = 0, wrong = 0;
+    for (int i = 0; i < tr.count; i++) {
+        /* Seeds inside the face's shadow, including its edges, or
+         * clearly outside it. */
+        float ay = fabsf(tr.y[i]), az = fabsf(tr.z[i]);
+        int aimed = ay < 0.55f && az < 0.55f;
+        int interior = ay < 0.45f && az < 0.45f;
+        if (tr.state[i] == TRACER_DEPOSITED) {
+            deposited++;
+            const GPUTriangle *t = &tris[tr.triangle[i]];
+            wrong += !aimed || fabsf(tr.x[i] + 0.5f) > 1e-5f ||
+                     (interior && (t->v0x != -0.5f || t->v1x != -0.5f ||
+                                   t->v2x != -0.5f));
+        } else {
+            wrong += aimed || tr.state[i] != TRACER_EXITED;
+        }
+    }
+    CHECK(deposited == 121, "11 x 11 seeds deposit"); /* |y|,|z| <= 0.5 */
+    CHECK(wrong == 0, "deposits on the upstream face only");
+    ParticleTracer_Free(&tr);
+
+    body.deposit = 0;
+    ParticleTracer_Init(&tr, 441);
+    seed_plane(&tr);
+    ParticleTracer_Run(&tr, &f, &body, &p, 300);
+    int inside = 0;
+    for (int i = 0; i < tr.count; i++)
+        inside += fabsf(tr.x[i]) < 0.5f && fabsf(tr.y[i]) < 0.5f &&
+                  fabsf(tr.z[i]) < 0.5f;
+    CHECK(inside == 0, "bounce keeps particles out of the cube");
+    ParticleTracer_Free(&tr);
+    freeCollisionBVH(&bvh);
+    free(v);
+}
+
+/* Test 4: results do not depend on the thread count. */
+static void test_threads(void) {
+    printf("test_threads\n");
+    float *v = uniform_field(0.1f);
+    /* Some swirl so particles wander between cells. */
+    for (int c = 0; c < NX * NY * NZ; c++)
+        v[4 * c + 1] = 0.02f * sinf(0.3f * (float)(c % NX));
+    TracerField f = {NX, NY, NZ, v, 8.0f};
+    TracerParams p = {0.01f, 0.2f, 3.0f};
+    GPUTriangle tris[12];
+    CollisionBVH bvh;
+    make_cube(tris, &bvh);
+    TracerBody body = {tris, 12, &bvh, 0.03f, 0};
+    ParticleTracer a, b;
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    ParticleTracer_Init(&a, 441);
+    seed_plane(&a);
+    ParticleTracer_Run(&a, &f, &body, &p, 400);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    ParticleTracer_Init(&b, 441);
+    seed_plane(&b);
+    ParticleTracer_Run(&b, &f, &body, &p, 400);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    size_t bytes = (size_t)a.count * sizeof(float);
+    CHECK(memcmp(a.x, b.x, bytes) == 0 && memcmp(a.y, b.y, bytes) == 0 &&
+              memcmp(a.z, b.z, bytes) == 0 &&
+              memcmp(a.time, b.time, bytes) == 0 &&
+              memcmp(a.state, b.state, (size_t)a.count) == 0,
+          "same result on 1 and 4 threads");
+    ParticleTracer_Free(&a);
+    ParticleTracer_Free(&b);
+    freeCollisionBVH(&bvh);
+    free(v);
+}
+
+int main(void) {
+    printf("particle tracer unit tests\n");
+    test_sample_linear();
+    test_residence_time();
+    test_cube_collision();
+    test_threads();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
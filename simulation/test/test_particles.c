@@ -0,0 +1,303 @@
+/*
+ * Unit tests for the CPU particle system and its counter-based RNG.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#include "../lib/particle_system.h"
+#include "../lib/rng.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static const CollisionBounds BOX = {-1.0f, -0.5f, -0.6f, 1.0f, 0.5f,
+                                    0.6f,  0.0f,  0.0f,  0.0f};
+
+/* n particles on a fixed lattice through the tunnel, some inside BOX,
+ * some about to leave through the outlet or the walls. */
+static void fill(ParticleSystem *ps, int n) {
+    for (int i = 0; i < n; i++) {
+        float x = -4.0f + 8.0f * (float)(i % 97) / 97.0f;
+        float y = -2.0f + 4.0f * (float)(i % 89) / 89.0f;
+        float z = -2.0f + 4.0f * (float)(i % 83) / 83.0f;
+        float vx = 0.5f + 0.01f * (float)(i % 7);
+        float vy = 0.3f * (float)(i % 5) - 0.6f;
+        float vz = 0.2f * (float)(i % 3) - 0.2f;
+        ParticleSystem_AddParticle(ps, x, y, z, vx, vy, vz);
+    }
+}
+
+static int same_state(const ParticleSystem *a, const ParticleSystem *b) {
+    size_t bytes = (size_t)a->numParticles * sizeof(float);
+    return a->numParticles == b->numParticles &&
+           memcmp(a->x, b->x, bytes) == 0 && memcmp(a->y, b->y, bytes) == 0 &&
+           memcmp(a->z, b->z, bytes) == 0 &&
+           memcmp(a->vx, b->vx, bytes) == 0 &&
+           memcmp(a->vy, b->vy, bytes) == 0 &&
+           memcmp(a->vz, b->vz, bytes) == 0 &&
+           memcmp(a->life, b->life, bytes) == 0;
+}
+
+/* Run `steps` updates of n particles from a fresh system. */
+static void run(ParticleSystem *ps, int n, uint64_t seed, int steps) {
+    ParticleSystem_Init(ps, n);
+    ParticleSystem_Seed(ps, seed);
+    fill(ps, n);
+    CollisionBounds box = BOX;
+    for (int s = 0; s < steps; s++)
+        ParticleSystem_UpdateWithCollision(ps, NULL, 0.5f, &box);
+}
+
+/* Test 1: Philox4x32-10 matches the Random123 known-answer vectors. */
+static void test_philox_known_answers(void) {
+    printf("test_philox_known_answers\n");
+    static const uint32_t ctr[3][4] = {
+        {0, 0, 0, 0},
+        {0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu},
+        {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}};
+    static const uint32_t key[3][2] = {
+        {0, 0}, {0xffffffffu, 0xffffffffu}, {0xa4093822u, 0x299f31d0u}};
+    static const uint32_t expect[3][4] = {
+        {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u},
+        {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu},
+        {0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}};
+    for (int t = 0; t < 3; t++) {
+        uint32_t out[4];
+        Rng_Philox4x32(ctr[t], key[t], out);
+        CHECK(memcmp(out, expect[t], sizeof(out)) == 0, "known answer");
+    }
+    CHECK(Rng_Uniform(0) == 0.0f, "uniform lower end");
+    CHECK(Rng_Uniform(0xffffffffu) < 1.0f, "uniform below one");
+}
+
+/* Test 2: capacity is set at run time and AddParticle stops there. */
+static void test_capacity(void) {
+    printf("test_capacity\n");
+    ParticleSystem ps;
+    CHECK(ParticleSystem_Init(&ps, 100) == 0, "init");
+    CHECK(ps.capacity == 100, "capacity");
+    fill(&ps, 150);
+    CHECK(ps.numParticles == 100, "adds stop at capacity");
+    ParticleSystem_Free(&ps);
+    CHECK(ps.x == NULL && ps.capacity == 0, "free resets");
+}
+
+/* Test 3: after an update nothing is left inside the box or outside the
+ * tunnel walls, and respawned particles start at the inlet. */
+static void test_update_bounds(void) {
+    printf("test_update_bounds\n");
+    ParticleSystem ps;
+    run(&ps, 5003, 7, 1);
+    int inside = 0, outside = 0;
+    for (int i = 0; i < ps.numParticles; i++) {
+        inside += ParticleSystem_CheckCollision(ps.x[i], ps.y[i], ps.z[i],
+                                                (CollisionBounds *)&BOX);
+        outside += ps.y[i] < -2.0f || ps.y[i] > 2.0f || ps.z[i] < -2.0f ||
+                   ps.z[i] > 2.0f || ps.x[i] > 4.0f;
+    }
+    CHECK(inside == 0, "no particle left in the box");
+    CHECK(outside == 0, "no particle outside the tunnel");
+
+    /* Particles past the outlet were respawned: full life, at rest
+     * across the stream, just upstream of x = -4. */
+    int respawned = 0, at_inlet = 0;
+    for (int i = 0; i < ps.numParticles; i++) {
+        if (ps.life[i] != 1.0f)
+            continue;
+        respawned++;
+        at_inlet += ps.x[i] >= -4.5f && ps.x[i] <= -4.0f &&
+                    ps.y[i] >= -1.5f && ps.y[i] <= 1.5f &&
+                    ps.z[i] >= -1.5f && ps.z[i] <= 1.5f &&
+                    ps.vy[i] == 0.0f && ps.vz[i] == 0.0f;
+    }
+    CHECK(respawned > 0, "some particles respawned");
+    CHECK(at_inlet == respawned, "respawned particles start at the inlet");
+    ParticleSystem_Free(&ps);
+}
+
+/* Test 4: the same seed reproduces the run on any thread count, a
+ * different seed changes the respawns. */
+static void test_reproducible(void) {
+    printf("test_reproducible\n");
+    int n = 20011, steps = 20; /* enough steps for every x to wrap */
+    ParticleSystem a, b, c;
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    run(&a, n, 42, steps);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    run(&b, n, 42, steps);
+    run(&c, n, 43, steps);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    CHECK(same_state(&a, &b), "same seed, same particles");
+    CHECK(!same_state(&a, &c), "different seed, different particles");
+    ParticleSystem_Free(&a);
+    ParticleSystem_Free(&b);
+    ParticleSystem_Free(&c);
+}
+
+/* Every particle appears once, in the cell holding it, in ascending
+ * index order within the cell. */
+static int bins_consistent(const ParticleSystem *ps) {
+    int n = ps->numParticles;
+    char *seen = (char *)calloc((size_t)n + 1, 1);
+    int ok =
+        ps->cellStart[0] == 0 && ps->cellStart[PARTICLE_GRID_CELLS] == n;
+    for (int c = 0; ok && c < PARTICLE_GRID_CELLS; c++) {
+        for (int k = ps->cellStart[c]; ok && k < ps->cellStart[c + 1]; k++) {
+            int i = ps->order[k];
+            ok = i >= 0 && i < n && !seen[i] &&
+                 ParticleSystem_CellIndex(ps->x[i], ps->y[i], ps->z[i]) ==
+                     c &&
+                 (k == ps->cellStart[c] || ps->order[k - 1] < i);
+            if (ok)
+                seen[i] = 1;
+        }
+    }
+    free(seen);
+    return ok;
+}
+
+/* Test 5: binning is lossless even with everything in one cell or far
+ * outside the grid, and the same on any thread count. */
+static void test_bins(void) {
+    printf("test_bins\n");
+    int n = 30011;
+    ParticleSystem a, b;
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    run(&a, n, 5, 3);
+#ifdef _OPENMP
+    omp_set_num_threads(3);
+#endif
+    run(&b, n, 5, 3);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    CHECK(bins_consistent(&a), "bins hold every particle once");
+    CHECK(memcmp(a.order, b.order, (size_t)n * sizeof(int)) == 0 &&
+              memcmp(a.cellStart, b.cellStart,
+                     (PARTICLE_GRID_CELLS + 1) * sizeof(int)) == 0,
+          "bins independent of thread count");
+
+    /* A crowd in one cell (more than any fixed per-cell budget) plus
+     * stragglers outside the tunnel. */
+    ParticleSystem_Free(&b);
+    ParticleSystem_Init(&b, 5000);
+    for (int i = 0; i < 4990; i++)
+        ParticleSystem_AddParticle(&b, 0.1f, 0.1f, 0.1f, 0, 0, 0);
+    for (int i = 0; i < 10; i++)
+        ParticleSystem_AddParticle(&b, 100.0f * (i - 5), -50.0f, 7.0f, 0,
+                                   0, 0);
+    CHECK(!b.binsValid, "adding invalidates the bins");
+    ParticleSystem_BuildBins(&b);
+    int c = ParticleSystem_CellIndex(0.1f, 0.1f, 0.1f);
+    CHECK(b.cellStart[c + 1] - b.cellStart[c] == 4990, "crowded cell kept");
+    CHECK(bins_consistent(&b), "outliers clamped into edge cells");
+    ParticleSystem_Free(&b);
+
+    /* Sorting moves the particles into bin order without losing any:
+     * slot k now holds what particle order[k] held before. */
+    size_t bytes = (size_t)n * sizeof(float);
+    float *before = (float *)malloc(7 * bytes);
+    int *order = (int *)malloc((size_t)n * sizeof(int));
+    const float *fields[7] = {a.x, a.y, a.z, a.vx, a.vy, a.vz, a.life};
+    for (int f = 0; f < 7; f++)
+        memcpy(before + (size_t)f * n, fields[f], bytes);
+    memcpy(order, a.order, (size_t)n * sizeof(int));
+    CHECK(ParticleSystem_SortByCell(&a) == 0, "sort");
+    int in_order = 1, moved = 1;
+    for (int k = 0; k < n; k++) {
+        in_order = in_order && a.order[k] == k;
+        for (int f = 0; f < 7; f++)
+            moved = moved && memcmp(&fields[f][k],
+                                    &before[(size_t)f * n + order[k]],
+                                    sizeof(float)) == 0;
+    }
+    CHECK(in_order && bins_consistent(&a), "sorted particles are in order");
+    CHECK(moved, "sort keeps the particles");
+    free(before);
+    free(order);
+    ParticleSystem_Free(&a);
+}
+
+/* Test 6: the AVX2 update (when the CPU has it) matches the scalar
+ * update_one path on the same particles, through collisions, respawns
+ * and wall bounces, with a tail that is not a multiple of eight. */
+static void test_simd_matches_scalar(void) {
+    printf("test_simd_matches_scalar\n");
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (!__builtin_cpu_supports("avx2"))
+        printf("  no AVX2 on this CPU, both runs are scalar\n");
+#endif
+    int n = 20011, steps = 20;
+    ParticleSystem a, b;
+    ParticleSystem_Init(&a, n);
+    ParticleSystem_Init(&b, n);
+    a.simd = 0;
+    ParticleSystem_Seed(&a, 9);
+    ParticleSystem_Seed(&b, 9);
+    fill(&a, n);
+    fill(&b, n);
+    CollisionBounds box = BOX;
+    for (int s = 0; s < steps; s++) {
+        ParticleSystem_UpdateWithCollision(&a, NULL, 0.5f, &box);
+        ParticleSystem_UpdateWithCollision(&b, NULL, 0.5f, &box);
+    }
+
+    const float *fa[7] = {a.x, a.y, a.z, a.vx, a.vy, a.vz, a.life};
+    const float *fb[7] = {b.x, b.y, b.z, b.vx, b.vy, b.vz, b.life};
+    float max_pos = 0.0f, max_vel = 0.0f;
+    for (int f = 0; f < 7; f++)
+        for (int i = 0; i < n; i++) {
+            float d = fabsf(fa[f][i] - fb[f][i]);
+            if (!(d == d))
+                d = INFINITY;
+            if (f < 3 && d > max_pos)
+                max_pos = d;
+            else if (f >= 3 && d > max_vel)
+                max_vel = d;
+        }
+    CHECK(max_pos <= 1e-5f, "positions match the scalar path");
+    CHECK(max_vel <= 1e-5f, "velocities and life match the scalar path");
+    ParticleSystem_Free(&a);
+    ParticleSystem_Free(&b);
+}
+
+int main(void) {
+    printf("particle system unit tests\n");
+    test_philox_known_answers();
+    test_capacity();
+    test_update_bounds();
+    test_reproducible();
+    test_bins();
+    test_simd_matches_scalar();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+ * Unit tests for velocity probes: spec parsing, line expansion, host
+ * trilinear sampling and the binary time-series file.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#include "../lib/probes.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+#define NX 32
+#define NY 16
+#define NZ 16
+
+/* Test 1: points and lines parse, malformed specs are rejected and
+ * leave the set unchanged. */
+static void test_parse(void) {
+    printf("test_parse\n");
+    ProbeSet set;
+    probes_init(&set);
+    CHECK(probes_add_point(&set, "1.5,-0.25,0") == 0, "point");
+    CHECK(probes_add_line(&set, "-1,0,0:1,0.5,-1:5") == 0, "line");
+    CHECK(set.numProbes == 6 && set.numGroups == 2, "six probes, two groups");
+    CHECK(set.position[0] == 1.5f && set.position[1] == -0.25f,
+          "point position");
+    CHECK(set.position[3] == -1.0f && set.position[15] == 1.0f &&
+              set.position[16] == 0.5f && set.position[17] == -1.0f,
+          "line endpoints");
+    CHECK(fabsf(set.position[9] - 0.0f) < 1e-6f &&
+              fabsf(set.position[10] - 0.25f) < 1e-6f,
+          "line midpoint");
+    CHECK(set.group[0] == 0 && set.group[1] == 1 && set.group[5] == 1,
+          "groups");
+
+    const char *bad[] = {"", "1,2", "1,2,3,4", "a,b,c", "1,2,3x"};
+    int rejected = 0;
+    for (int i = 0; i < 5; i++)
+        rejected += probes_add_point(&set, bad[i]) == -1;
+    CHECK(rejected == 5, "bad points rejected");
+    CHECK(probes_add_line(&set, "0,0,0:1,1,1:1") == -1, "one-point line");
+    CHECK(probes_add_line(&set, "0,0,0:1,1,1") == -1, "missing count");
+    CHECK(probes_add_line(&set, "0,0,0:1,1,1:2000000000") == -1,
+          "absurd count");
+    CHECK(set.numProbes == 6 && set.numGroups == 2, "set unchanged");
+    probes_free(&set);
+}
+
+/* Linear velocity field in lattice coordinates, 4 floats per cell. */
+static float *linear_field(void) {
+    float *v = (float *)malloc((size_t)NX * NY * NZ * 4 * sizeof(float));
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 0; i < NX; i++) {
+                float *c = v + 4 * ((size_t)i + NX * (j + (size_t)NY * k));
+                c[0] = 0.1f + 0.001f * i;
+                c[1] = 0.002f * j - 0.001f * k;
+                c[2] = 0.003f * k;
+                c[3] = 1.0f;
+            }
+    return v;
+}
+
+/* Test 2: trilinear sampling reproduces a linear field exactly inside
+ * the domain and clamps outside it. */
+static void test_sample(void) {
+    printf("test_sample\n");
+    float *field = linear_field();
+    ProbeSet set;
+    probes_init(&set);
+    probes_add_point(&set, "0.3,0.1,-0.7");
+    probes_add_point(&set, "-9,9,0"); /* outside the tunnel */
+    CHECK(probes_locate(&set, NX, NY, NZ) == 0, "located");
+    float gx = (0.3f + 4.0f) / 8.0f * NX;
+    float gy = (0.1f + 2.0f) / 4.0f * NY;
+    float gz = (-0.7f + 2.0f) / 4.0f * NZ;
+    CHECK(set.grid[0] == gx && set.grid[1] == gy && set.grid[2] == gz,
+          "world to lattice");
+    CHECK(set.grid[4] == 0.5f && set.grid[5] == NY - 1.5f,
+          "clamped to the interpolation range");
+
+    float out[6];
+    probes_sample(&set, field, NX, NY, out);
+    CHECK(fabsf(out[0] - (0.1f + 0.001f * gx)) < 1e-6f &&
+              fabsf(out[1] - (0.002f * gy - 0.001f * gz)) < 1e-6f &&
+              fabsf(out[2] - 0.003f * gz) < 1e-6f,
+          "exact on a linear field");
+    CHECK(fabsf(out[3] - (0.1f + 0.0005f)) < 1e-6f, "clamped sample");
+    probes_free(&set);
+    free(field);
+}
+
+/* Test 3: the file has the documented header, one record per appended
+ * step, singly or in a batch, and the record count patched in on
+ * close. */
+static void test_file(void) {
+    printf("test_file\n");
+    const char *path = "/tmp/test_probes.bin";
+    float *field = linear_field();
+    ProbeSet set;
+    probes_init(&set);
+    probes_add_point(&set, "0,0,0");
+    probes_add_line(&set, "-2,0,0:2,0,0:3");
+    probes_locate(&set, NX, NY, NZ);
+    CHECK(probes_open(&set, path, NX, NY, NZ, 0.05f) == 0, "opened");
+    float vel[12];
+    probes_sample(&set, field, NX, NY, vel);
+    for (unsigned int r = 0; r < 4; r++) {
+        vel[0] = (float)r;
+        probes_append(&set, r * 2, vel);
+    }
+    float block[6 * 12]; /* a batch of steps 7..12, as read back */
+    for (int r = 0; r < 6; r++) {
+        memcpy(block + 12 * r, vel, sizeof(vel));
+        block[12 * r] = (float)(4 + r);
+    }
+    CHECK(probes_append_steps(&set, 7, 6, block) == 0, "batch appended");
+    CHECK(probes_close(&set) == 0 && set.numRecords == 10, "closed");
+
+    FILE *f = fopen(path, "rb");
+    char magic[8] = {0};
+    uint32_t head[5] = {0};
+    float u = 0.0f, pos[12], v[12];
+    uint64_t records = 0;
+    int32_t group[4];
+    uint32_t step = 0;
+    int ok = f && fread(magic, 1, 8, f) == 8 &&
+             fread(head, sizeof(head), 1, f) == 1 &&
+             fread(&u, sizeof(u), 1, f) == 1 &&
+             fread(&records, sizeof(records), 1, f) == 1 &&
+             fread(pos, sizeof(pos), 1, f) == 1 &&
+             fread(group, sizeof(group), 1, f) == 1;
+    CHECK(ok && memcmp(magic, "LBMPROBE", 8) == 0, "magic");
+    CHECK(head[0] == PROBE_FILE_VERSION && head[1] == 4 && head[2] == NX &&
+              head[3] == NY && head[4] == NZ && u == 0.05f,
+          "header fields");
+    CHECK(records == 10, "record count");
+    CHECK(pos[3] == -2.0f && pos[9] == 2.0f && group[0] == 0 &&
+              group[3] == 1,
+          "positions and groups");
+    int match = 1;
+    for (int r = 0; ok && r < 10; r++) {
+        ok = fread(&step, sizeof(step), 1, f) == 1 &&
+             fread(v, sizeof(v), 1, f) == 1;
+        uint32_t expected = r < 4 ? (uint32_t)(2 * r) : (uint32_t)(r + 3);
+        match &= ok && step == expected && v[0] == (float)r &&
+                 memcmp(v + 1, vel + 1, 11 * sizeof(float)) == 0;
+    }
+    CHECK(match, "records");
+    CHECK(f && fgetc(f) == EOF, "nothing after the records");
+    long size = f ? ftell(f) : 0;
+    CHECK(size == 40 + 4 * 16 + 10 * (4 + 4 * 12), "compact layout");
+    if (f)
+        fclose(f);
+    remove(path);
+    probes_free(&set);
+    free(field);
+}
+
+int main(void) {
+    printf("probe unit tests\n");
+    test_parse();
+    test_sample();
+    test_file();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
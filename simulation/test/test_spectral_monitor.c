@@ -0,0 +1,134 @@
+/*
+ * Unit tests for the online Cl spectral monitor: frequency and amplitude
+ * tracking, the stable-cycles stopping rule, and no false stops on a
+ * developing or aperiodic signal.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#define _USE_MATH_DEFINES
+#include "../lib/spectral_monitor.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static uint32_t rng_state = 12345u;
+
+static float frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+#define FS (1.0f / 200.0f) /* 20 frames x 10 substeps per sample */
+
+/* Test 1: bad arguments are rejected. */
+static void test_init(void) {
+    printf("test_init\n");
+    SpectralMonitor m;
+    CHECK(spectral_monitor_init(&m, 0.0f, 128, 10, 0.02f) == -1, "rate");
+    CHECK(spectral_monitor_init(&m, FS, 8, 10, 0.02f) == -1, "window");
+    CHECK(spectral_monitor_init(&m, FS, 128, 0, 0.02f) == -1, "cycles");
+    CHECK(spectral_monitor_init(&m, FS, 128, 10, 0.02f) == 0, "valid");
+    CHECK(m.updateInterval == 16, "updates every eighth of a window");
+    spectral_monitor_free(&m);
+}
+
+/* Test 2: a steady tone between bins is tracked in frequency and
+ * amplitude, and is declared stable after the requested cycles but not
+ * before. */
+static void test_tone(void) {
+    printf("test_tone\n");
+    SpectralMonitor m;
+    spectral_monitor_init(&m, FS, 128, 10, 0.02f);
+    double period = 13.7; /* samples */
+    long stableAt = -1, firstUpdate = -1;
+    for (long i = 0; i < 2000 && stableAt < 0; i++) {
+        float x = 0.1f + 0.3f * (float)sin(2.0 * M_PI * i / period + 0.4) +
+                  0.01f * (2.0f * frand() - 1.0f);
+        if (spectral_monitor_add(&m, x) && firstUpdate < 0)
+            firstUpdate = i;
+        if (m.stable)
+            stableAt = i;
+    }
+    double f = FS / period;
+    CHECK(firstUpdate == 127, "first estimate once the window is full");
+    CHECK(stableAt > 0, "stable");
+    CHECK(fabs(m.frequency - f) < 0.01 * f, "frequency within 1%");
+    CHECK(fabsf(m.amplitude - 0.3f) < 0.015f, "amplitude within 5%");
+    CHECK(stableAt - firstUpdate >= 10 * period, "waits the full cycles");
+    CHECK(stableAt - firstUpdate <= 10 * period + 2 * m.updateInterval,
+          "stops promptly");
+    spectral_monitor_free(&m);
+}
+
+/* Test 3: a frequency change restarts the count; the monitor settles on
+ * the new tone. */
+static void test_frequency_change(void) {
+    printf("test_frequency_change\n");
+    SpectralMonitor m;
+    spectral_monitor_init(&m, FS, 128, 20, 0.02f);
+    double phase = 0.0;
+    int stableBefore = 0, stableJustAfter = 0;
+    for (long i = 0; i < 3000; i++) {
+        double period = i < 1000 ? 11.0 : 16.0;
+        phase += 2.0 * M_PI / period;
+        spectral_monitor_add(&m, 0.2f * (float)sin(phase));
+        if (i == 999)
+            stableBefore = m.stable;
+        if (i == 1200)
+            stableJustAfter = m.stable;
+    }
+    CHECK(stableBefore, "stable on the first tone");
+    CHECK(!stableJustAfter, "reset by the change");
+    CHECK(m.stable && fabs(m.frequency - FS / 16.0) < 0.01 * FS / 16.0,
+          "stable on the second tone");
+    spectral_monitor_free(&m);
+}
+
+/* Test 4: shedding that is still growing, or no tone at all, never
+ * counts as stable. */
+static void test_no_false_stop(void) {
+    printf("test_no_false_stop\n");
+    SpectralMonitor m;
+    spectral_monitor_init(&m, FS, 128, 10, 0.02f);
+    int stable = 0;
+    for (long i = 0; i < 1500; i++) {
+        float a = 0.3f * (1.0f - expf(-(float)i / 1500.0f));
+        stable |= spectral_monitor_add(&m, a * sinf(2.0f * (float)M_PI *
+                                                    i / 12.0f)) &&
+                  m.stable;
+    }
+    CHECK(!stable, "growing amplitude");
+    spectral_monitor_free(&m);
+
+    spectral_monitor_init(&m, FS, 128, 10, 0.02f);
+    stable = 0;
+    for (long i = 0; i < 5000; i++)
+        stable |= spectral_monitor_add(&m, frand() - 0.5f) && m.stable;
+    CHECK(!stable, "white noise");
+    spectral_monitor_free(&m);
+}
+
+int main(void) {
+    printf("spectral monitor unit tests\n");
+    test_init();
+    test_tone();
+    test_frequency_change();
+    test_no_false_stop();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Unit tests for the real-input FFT and the Welch Cl spectrum used for
+ * Strouhal extraction: FFT against a direct DFT over mixed-radix
+ * lengths, spectrum scaling, interpolated peak accuracy between bins
+ * and the CSV writer.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#define _USE_MATH_DEFINES
+#include "../lib/drag_metrics.h"
+#include "../lib/fft.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static uint32_t rng_state = 12345u;
+
+static float frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.0f;
+}
+
+/* Largest deviation of fft_real from a double-precision DFT, relative to
+ * the largest bin magnitude. */
+static double fft_error(int n) {
+    float *x = (float *)malloc((size_t)n * sizeof(float));
+    float *re = (float *)malloc((size_t)(n / 2 + 1) * sizeof(float));
+    float *im = (float *)malloc((size_t)(n / 2 + 1) * sizeof(float));
+    for (int j = 0; j < n; j++)
+        x[j] = 2.0f * frand() - 1.0f;
+    FftPlan *plan = fft_plan_create(n);
+    if (!plan) {
+        free(x);
+        free(re);
+        free(im);
+        return 1e30;
+    }
+    fft_real(plan, x, re, im);
+    double worst = 0.0, scale = 1e-30;
+    for (int k = 0; k <= n / 2; k++) {
+        double sr = 0.0, si = 0.0;
+        for (int j = 0; j < n; j++) {
+            double a = -2.0 * M_PI * (double)((long long)j * k % n) / n;
+            sr += x[j] * cos(a);
+            si += x[j] * sin(a);
+        }
+        double d = hypot(re[k] - sr, im[k] - si);
+        if (d > worst)
+            worst = d;
+        if (hypot(sr, si) > scale)
+            scale = hypot(sr, si);
+    }
+    fft_plan_free(plan);
+    free(x);
+    free(re);
+    free(im);
+    return worst / scale;
+}
+
+/* Test 1: matches a direct DFT for powers of two, odd lengths, primes
+ * and mixed factorizations. */
+static void test_fft_lengths(void) {
+    printf("test_fft_lengths\n");
+    int lengths[] = {1, 2, 3, 5, 6, 8, 12, 15, 64, 97, 100, 360, 1024, 1000};
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        double err = fft_error(lengths[i]);
+        if (err > 1e-5) {
+            printf("  n=%d: relative error %g\n", lengths[i], err);
+            bad++;
+        }
+    }
+    CHECK(bad == 0, "FFT matches DFT");
+    CHECK(fft_plan_create(0) == NULL, "length 0 rejected");
+}
+
+/* Test 2: a pure cosine on bin 5 lands on bin 5 only. */
+static void test_fft_tone(void) {
+    printf("test_fft_tone\n");
+    int n = 64;
+    float x[64], re[33], im[33];
+    for (int j = 0; j < n; j++)
+        x[j] = cosf(2.0f * (float)M_PI * 5 * j / n);
+    FftPlan *plan = fft_plan_create(n);
+    fft_real(plan, x, re, im);
+    int leak = 0;
+    for (int k = 0; k <= n / 2; k++)
+        if (k != 5)
+            leak += hypotf(re[k], im[k]) > 1e-4f;
+    CHECK(fabsf(re[5] - 32.0f) < 1e-4f && fabsf(im[5]) < 1e-4f,
+          "cosine amplitude n/2 on its bin");
+    CHECK(leak == 0, "no leakage into other bins");
+    fft_plan_free(plan);
+}
+
+/* Test 3: the one-sided PSD integrates to the signal variance, and
+ * white noise spreads evenly across the Welch segments. */
+static void test_psd_scaling(void) {
+    printf("test_psd_scaling\n");
+    int n = 8192;
+    float *x = (float *)malloc((size_t)n * sizeof(float));
+    double var = 0.0;
+    for (int i = 0; i < n; i++) {
+        x[i] = 2.0f * frand() - 1.0f;
+        var += (double)x[i] * x[i];
+    }
+    var /= n;
+    float fs = 0.25f;
+    ClSpectrum s;
+    CHECK(cl_spectrum(x, n, fs, 0, &s) == 0, "spectrum computed");
+    CHECK(s.segmentLength == 4096 && s.numSegments == 3,
+          "auto segments are a power of two, 50% overlap");
+    CHECK(s.numBins == s.segmentLength / 2 + 1, "one-sided bins");
+    double area = 0.0;
+    for (int k = 0; k < s.numBins; k++)
+        area += s.power[k] * (fs / s.segmentLength);
+    CHECK(fabs(area / var - 1.0) < 0.05, "PSD integrates to variance");
+    CHECK(fabsf(s.frequency[s.numBins - 1] - 0.5f * fs) < 1e-7f,
+          "last bin at Nyquist");
+    cl_spectrum_free(&s);
+    free(x);
+}
+
+/* Test 4: a tone between bins is located to a small fraction of the
+ * bin width, with noise and a mean offset on top. */
+static void test_peak_interpolation(void) {
+    printf("test_peak_interpolation\n");
+    int n = 2000;
+    float fs = 1.0f / 40.0f; /* 20 frames x 2 substeps per sample */
+    float *x = (float *)malloc((size_t)n * sizeof(float));
+    double worst = 0.0;
+    ClSpectrum s = {0};
+    for (int trial = 0; trial < 8; trial++) {
+        double f = fs * (0.031 + 0.0137 * trial);
+        for (int i = 0; i < n; i++)
+            x[i] = 0.3f + 0.1f * (float)sin(2.0 * M_PI * f * i / fs + trial) +
+                   0.02f * (2.0f * frand() - 1.0f);
+        if (cl_spectrum(x, n, fs, 0, &s) != 0)
+            break;
+        double binWidth = fs / s.segmentLength;
+        double err = fabs(s.peakFrequency - f) / binWidth;
+        if (err > worst)
+            worst = err;
+        cl_spectrum_free(&s);
+    }
+    CHECK(worst < 0.1, "peak within a tenth of a bin");
+
+    /* Interpolation beats the raw bin on a tone half-way between two. */
+    int len = 256;
+    double f = fs * 20.5 / len;
+    for (int i = 0; i < len; i++)
+        x[i] = (float)sin(2.0 * M_PI * f * i / fs);
+    CHECK(cl_spectrum(x, len, fs, len, &s) == 0, "single segment");
+    CHECK(s.numSegments == 1, "one segment");
+    CHECK(fabs(s.peakFrequency - f) < 0.05 * fs / len, "half-bin tone");
+    cl_spectrum_free(&s);
+    free(x);
+}
+
+/* Test 5: bad input is rejected and the CSV has one row per bin. */
+static void test_edge_cases(void) {
+    printf("test_edge_cases\n");
+    float x[12] = {0};
+    ClSpectrum s;
+    CHECK(cl_spectrum(NULL, 12, 1.0f, 0, &s) == -1, "NULL series");
+    CHECK(cl_spectrum(x, 1, 1.0f, 0, &s) == -1, "too short");
+    CHECK(cl_spectrum(x, 12, 0.0f, 0, &s) == -1, "zero sample rate");
+    CHECK(cl_spectrum(x, 12, 1.0f, 0, &s) == 0 && s.numSegments == 1 &&
+              s.peakPower == 0.0f,
+          "constant series has no peak power");
+    cl_spectrum_free(&s);
+
+    for (int i = 0; i < 12; i++)
+        x[i] = (float)(i % 4);
+    const char *path = "/tmp/test_spectrum.csv";
+    int ok = cl_spectrum(x, 12, 1.0f, 0, &s) == 0 &&
+             write_cl_spectrum(&s, path) == 0;
+    CHECK(ok, "CSV written");
+    int rows = 0;
+    FILE *f = fopen(path, "r");
+    if (f) {
+        char line[128];
+        while (fgets(line, sizeof(line), f))
+            rows++;
+        fclose(f);
+    }
+    CHECK(rows == s.numBins + 1, "header plus one row per bin");
+    CHECK(fabsf(s.peakFrequency - 0.25f) < 0.02f, "period-4 signal");
+    cl_spectrum_free(&s);
+    remove(path);
+}
+
+int main(void) {
+    printf("spectrum unit tests\n");
+    test_fft_lengths();
+    test_fft_tone();
+    test_psd_scaling();
+    test_peak_interpolation();
+    test_edge_cases();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
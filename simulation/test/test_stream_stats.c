@@ -0,0 +1,177 @@
+/*
+ * Unit tests for the streaming statistics used for Cd auto-stop:
+ * Welford moments, MSER-5 transient removal and batch-means confidence
+ * intervals on correlated and periodic series.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#define _USE_MATH_DEFINES
+#include "../lib/stream_stats.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+static uint32_t rng_state = 12345u;
+
+static double frand(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (double)(rng_state >> 8) / 16777216.0;
+}
+
+/* Approximately standard normal: sum of 12 uniforms. */
+static double nrand(void) {
+    double s = 0.0;
+    for (int i = 0; i < 12; i++)
+        s += frand();
+    return s - 6.0;
+}
+
+/* Test 1: moments match a two-pass computation, even on a large offset
+ * where the naive sum of squares loses every digit. */
+static void test_moments(void) {
+    printf("test_moments\n");
+    int n = 10000;
+    double *x = (double *)malloc((size_t)n * sizeof(double));
+    StreamStats s;
+    stream_stats_init(&s);
+    for (int i = 0; i < n; i++) {
+        x[i] = 1e8 + nrand();
+        stream_stats_add(&s, x[i]);
+    }
+    double mean = 0.0, var = 0.0, lo = x[0], hi = x[0];
+    for (int i = 0; i < n; i++) {
+        mean += x[i];
+        lo = fmin(lo, x[i]);
+        hi = fmax(hi, x[i]);
+    }
+    mean /= n;
+    for (int i = 0; i < n; i++)
+        var += (x[i] - mean) * (x[i] - mean);
+    var /= n - 1;
+    CHECK(s.count == n, "count");
+    CHECK(fabs(s.mean - mean) < 1e-6, "mean");
+    CHECK(fabs(stream_stats_variance(&s) / var - 1.0) < 1e-6, "variance");
+    CHECK(s.min == lo && s.max == hi, "range");
+    CHECK(s.numGroups == n / STREAM_STATS_GROUP, "group history");
+    stream_stats_free(&s);
+    free(x);
+}
+
+/* Test 2: too little data gives no estimate. */
+static void test_short(void) {
+    printf("test_short\n");
+    StreamStats s;
+    StreamEstimate e;
+    stream_stats_init(&s);
+    stream_stats_estimate(&s, &e);
+    CHECK(!e.valid, "empty");
+    for (int i = 0; i < STREAM_STATS_GROUP * STREAM_STATS_BATCHES - 1; i++)
+        stream_stats_add(&s, 1.0);
+    stream_stats_estimate(&s, &e);
+    CHECK(!e.valid, "one group short of a batch each");
+    stream_stats_add(&s, 1.0);
+    stream_stats_estimate(&s, &e);
+    CHECK(e.valid && e.mean == 1.0 && e.halfWidth == 0.0, "constant series");
+    stream_stats_free(&s);
+}
+
+/* Test 3: an exponential start-up transient is cut off and the estimate
+ * covers the settled value, while the plain mean is biased. While the
+ * series is still mostly transient there is no estimate. */
+static void test_transient(void) {
+    printf("test_transient\n");
+    StreamStats s;
+    StreamEstimate e;
+    stream_stats_init(&s);
+    int early = 0;
+    for (int i = 0; i < 3000; i++) {
+        stream_stats_add(&s, 1.0 + 2.0 * exp(-i / 150.0) + 0.01 * nrand());
+        if (i == 199) {
+            stream_stats_estimate(&s, &e);
+            early = e.valid;
+        }
+    }
+    stream_stats_estimate(&s, &e);
+    CHECK(!early, "no estimate inside the transient");
+    CHECK(e.valid, "estimate after the transient");
+    CHECK(e.truncated >= 500 && e.truncated <= 1500, "transient removed");
+    CHECK(fabs(e.mean - 1.0) < e.halfWidth + 1e-4, "interval covers 1");
+    CHECK(e.halfWidth < 1e-3, "tight interval");
+    CHECK(fabs(s.mean - 1.0) > 0.05, "plain mean is biased");
+    stream_stats_free(&s);
+}
+
+/* Test 4: on a strongly correlated AR(1) series the 95% interval covers
+ * the true mean close to 95% of the time. An interval that treated the
+ * samples as independent would be about four times too narrow. */
+static void test_coverage(void) {
+    printf("test_coverage\n");
+    int reps = 400, covered = 0, valid = 0;
+    for (int r = 0; r < reps; r++) {
+        StreamStats s;
+        StreamEstimate e;
+        stream_stats_init(&s);
+        double y = 0.0;
+        for (int i = 0; i < 4000; i++) {
+            y = 0.9 * y + nrand();
+            stream_stats_add(&s, 5.0 + y);
+        }
+        stream_stats_estimate(&s, &e);
+        valid += e.valid;
+        covered += e.valid && fabs(e.mean - 5.0) <= e.halfWidth;
+        stream_stats_free(&s);
+    }
+    double rate = (double)covered / reps;
+    CHECK(valid > reps * 9 / 10, "stationary series give estimates");
+    CHECK(rate > 0.88 && rate < 0.995, "about 95% coverage");
+}
+
+/* Test 5: periodic shedding with a period longer than a group: the
+ * interval shrinks as whole periods accumulate and covers the mean. */
+static void test_periodic(void) {
+    printf("test_periodic\n");
+    StreamStats s;
+    StreamEstimate e;
+    stream_stats_init(&s);
+    double early = 0.0;
+    for (int i = 0; i < 20000; i++) {
+        stream_stats_add(&s, 0.4 + 0.05 * sin(2.0 * M_PI * i / 37.3) +
+                                 0.005 * nrand());
+        if (i + 1 == 2500) {
+            stream_stats_estimate(&s, &e);
+            early = e.halfWidth;
+        }
+    }
+    stream_stats_estimate(&s, &e);
+    CHECK(e.valid && e.halfWidth < 0.6 * early,
+          "interval shrinks with run length");
+    CHECK(fabs(e.mean - 0.4) <= e.halfWidth, "interval covers the mean");
+    CHECK(e.relHalfWidth < 0.01, "settles below 1%");
+    stream_stats_free(&s);
+}
+
+int main(void) {
+    printf("stream stats unit tests\n");
+    test_moments();
+    test_short();
+    test_transient();
+    test_coverage();
+    test_periodic();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
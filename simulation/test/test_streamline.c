@@ -0,0 +1,322 @@
+/*
+ * Unit tests for the host-side streamline tracer: adaptive RK4 accuracy,
+ * the termination rules, VTI input and VTP output.
+ * Pure CPU code -- no GL context needed.
+ */
+
+#include "../lib/streamline.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static int tests_run = 0;
+static int tests_failed = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        tests_run++;                                                           \
+        if (!(cond)) {                                                         \
+            tests_failed++;                                                    \
+            printf("  FAIL: %s (line %d)\n", msg, __LINE__);                   \
+        }                                                                      \
+    } while (0)
+
+#define NX 64
+#define NY 32
+#define NZ 32
+
+/* World position of the sample point of cell (i, j, k): the sampler
+ * treats grid value i as sitting at grid coordinate i. */
+static void cell_pos(int i, int j, int k, float p[3]) {
+    p[0] = (float)i / NX * 8.0f - 4.0f;
+    p[1] = (float)j / NY * 4.0f - 2.0f;
+    p[2] = (float)k / NZ * 4.0f - 2.0f;
+}
+
+/* Field with velocity (a + b*x + c*y, d*x, e) in world units per lattice
+ * unit scale 8, so linear fields are sampled exactly. */
+static StreamlineField make_field(float a, float b, float c, float d,
+                                  float e) {
+    StreamlineField f = {NX, NY, NZ, NULL, NULL, 8.0f};
+    f.velocity = (float *)calloc((size_t)4 * NX * NY * NZ, sizeof(float));
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 0; i < NX; i++) {
+                float p[3];
+                cell_pos(i, j, k, p);
+                float *v = f.velocity + 4 * (i + NX * (j + (size_t)NY * k));
+                v[0] = (a + b * p[0] + c * p[1]) / 8.0f;
+                v[1] = d * p[0] / 8.0f;
+                v[2] = e / 8.0f;
+                v[3] = 1.0f;
+            }
+    return f;
+}
+
+/* Test 1: uniform flow gives straight lines that end exactly on the
+ * outlet face; a seed outside the box is a one-point line. */
+static void test_uniform(void) {
+    printf("test_uniform\n");
+    StreamlineField f = make_field(1.0f, 0, 0, 0, 0);
+    StreamlineParams p;
+    Streamline_DefaultParams(&f, &p);
+    float seeds[] = {-3.0f, 0.3f, -0.4f, 0.0f, 1.0f, 1.0f, 5.0f, 0, 0};
+    Streamlines sl;
+    CHECK(Streamline_Trace(&f, &p, seeds, 3, &sl) == 0, "trace");
+    CHECK(sl.numLines == 3 && sl.offsets[3] == sl.numPoints, "offsets");
+    int straight = 1;
+    for (int i = sl.offsets[0]; i < sl.offsets[1]; i++)
+        straight = straight && fabsf(sl.points[3 * i + 1] - 0.3f) < 1e-5f &&
+                   fabsf(sl.points[3 * i + 2] + 0.4f) < 1e-5f;
+    int last = sl.offsets[1] - 1;
+    CHECK(straight, "straight line");
+    CHECK(sl.reason[0] == STREAMLINE_EXITED &&
+              fabsf(sl.points[3 * last] - 4.0f) < 1e-5f,
+          "clipped to the outlet");
+    CHECK(fabsf(sl.speed[last] - 1.0f) < 1e-5f, "speed in world units");
+    CHECK(sl.offsets[1] - sl.offsets[0] < 40, "steps grow in smooth flow");
+    CHECK(sl.reason[2] == STREAMLINE_EXITED &&
+              sl.offsets[3] - sl.offsets[2] == 1,
+          "seed outside the box");
+    Streamline_Free(&sl);
+    Streamline_FreeField(&f);
+}
+
+/* Test 2: solid-body rotation about the z axis keeps its radius after a
+ * full turn and stops on maxLength. */
+static void test_rotation(void) {
+    printf("test_rotation\n");
+    StreamlineField f = make_field(0, 0, -1.0f, 1.0f, 0);
+    StreamlineParams p;
+    Streamline_DefaultParams(&f, &p);
+    float r = 1.0f;
+    p.maxLength = 2.0f * (float)M_PI * r;
+    float seeds[] = {r, 0.0f, 0.25f};
+    Streamlines sl;
+    CHECK(Streamline_Trace(&f, &p, seeds, 1, &sl) == 0, "trace");
+    float worst = 0.0f;
+    for (int i = 0; i < sl.numPoints; i++) {
+        float x = sl.points[3 * i], y = sl.points[3 * i + 1];
+        worst = fmaxf(worst, fabsf(sqrtf(x * x + y * y) - r));
+    }
+    int last = sl.numPoints - 1;
+    float dx = sl.points[3 * last] - r, dy = sl.points[3 * last + 1];
+    CHECK(sl.reason[0] == STREAMLINE_LIMIT, "stopped on length");
+    CHECK(worst < 1e-3f, "radius kept");
+    CHECK(sqrtf(dx * dx + dy * dy) < 0.15f, "back near the seed");
+    Streamline_Free(&sl);
+    Streamline_FreeField(&f);
+}
+
+/* Test 3: lines stop before solid cells and at stagnation. */
+static void test_termination(void) {
+    printf("test_termination\n");
+    StreamlineField f = make_field(1.0f, 0, 0, 0, 0);
+    f.solid = (int *)calloc((size_t)NX * NY * NZ, sizeof(int));
+    for (int k = 0; k < NZ; k++)
+        for (int j = 0; j < NY; j++)
+            for (int i = 32; i < 40; i++) /* x in [0, 1) */
+                f.solid[i + NX * (j + NY * k)] = 1;
+    StreamlineParams p;
+    Streamline_DefaultParams(&f, &p);
+    float seeds[] = {-2.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f};
+    Streamlines sl;
+    CHECK(Streamline_Trace(&f, &p, seeds, 2, &sl) == 0, "trace");
+    int last = sl.offsets[1] - 1;
+    CHECK(sl.reason[0] == STREAMLINE_SOLID, "stopped at the solid");
+    CHECK(sl.points[3 * last] < 0.0f &&
+              sl.points[3 * last] > -p.maxStep - 1e-5f,
+          "last point just upstream");
+    CHECK(sl.reason[1] == STREAMLINE_SOLID &&
+              sl.offsets[2] - sl.offsets[1] == 1,
+          "seed inside a solid");
+    Streamline_Free(&sl);
+    Streamline_FreeField(&f);
+
+    f = make_field(0, 0, 0, 0, 0);
+    Streamline_DefaultParams(&f, &p);
+    CHECK(Streamline_Trace(&f, &p, seeds, 1, &sl) == 0 &&
+              sl.reason[0] == STREAMLINE_STAGNANT && sl.numPoints == 1,
+          "stagnant seed");
+    Streamline_Free(&sl);
+    Streamline_FreeField(&f);
+
+    /* With minSpeed 0 a line runs into still fluid without stopping;
+     * it must stay finite there. */
+    f = make_field(1.0f, 0, 0, 0, 0);
+    for (size_t c = 0; c < (size_t)NX * NY * NZ; c++)
+        if ((int)(c % NX) >= 36)
+            memset(f.velocity + 4 * c, 0, 3 * sizeof(float));
+    Streamline_DefaultParams(&f, &p);
+    p.minSpeed = 0.0f;
+    p.maxPoints = 200;
+    CHECK(Streamline_Trace(&f, &p, seeds, 1, &sl) == 0 &&
+              sl.reason[0] == STREAMLINE_LIMIT,
+          "runs into still fluid");
+    int finite = 1;
+    for (int i = 0; i < 3 * sl.numPoints; i++)
+        finite = finite && isfinite(sl.points[i]);
+    CHECK(finite, "no NaN at zero speed");
+    Streamline_Free(&sl);
+    Streamline_FreeField(&f);
+}
+
+/* Writes f in the writeVTI layout. */
+static int write_vti(const StreamlineField *f, const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return -1;
+    size_t total = (size_t)f->sizeX * f->sizeY * f->sizeZ;
+    size_t rhoOffset = 8 + total * 12;
+    size_t solidOffset = rhoOffset + 8 + total * 4;
+    fprintf(out,
+            "<?xml version=\"1.0\"?>\n"
+            "<VTKFile type=\"ImageData\" version=\"1.0\""
+            " byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+            "  <ImageData WholeExtent=\"0 %d 0 %d 0 %d\""
+            " Origin=\"0 0 0\" Spacing=\"1 1 1\">\n"
+            "    <Piece Extent=\"0 %d 0 %d 0 %d\">\n"
+            "      <PointData Vectors=\"velocity\" Scalars=\"rho\">\n"
+            "        <DataArray type=\"Float32\" Name=\"velocity\""
+            " NumberOfComponents=\"3\" format=\"appended\""
+            " offset=\"0\"/>\n"
+            "        <DataArray type=\"Float32\" Name=\"rho\""
+            " format=\"appended\" offset=\"%lu\"/>\n"
+            "        <DataArray type=\"Int32\" Name=\"solid\""
+            " format=\"appended\" offset=\"%lu\"/>\n"
+            "      </PointData>\n"
+            "    </Piece>\n"
+            "  </ImageData>\n"
+            "  <AppendedData encoding=\"raw\">\n_",
+            f->sizeX, f->sizeY, f->sizeZ, f->sizeX, f->sizeY, f->sizeZ,
+            (unsigned long)rhoOffset, (unsigned long)solidOffset);
+    uint64_t bytes = total * 12;
+    fwrite(&bytes, 8, 1, out);
+    for (size_t i = 0; i < total; i++)
+        fwrite(f->velocity + 4 * i, 4, 3, out);
+    bytes = total * 4;
+    fwrite(&bytes, 8, 1, out);
+    for (size_t i = 0; i < total; i++)
+        fwrite(f->velocity + 4 * i + 3, 4, 1, out);
+    fwrite(&bytes, 8, 1, out);
+    fwrite(f->solid, 4, total, out);
+    fprintf(out, "\n  </AppendedData>\n</VTKFile>\n");
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/* Test 4: a writeVTI file loads back unchanged, the VTP holds every
+ * array at the declared offsets, and the lines do not depend on the
+ * thread count. */
+static void test_files(void) {
+    printf("test_files\n");
+    StreamlineField f = make_field(1.0f, 0, -0.3f, 0.3f, 0.1f);
+    f.solid = (int *)calloc((size_t)NX * NY * NZ, sizeof(int));
+    f.solid[5 + NX * (6 + NY * 7)] = 1;
+    const char *vti = "/tmp/test_streamline.vti";
+    const char *vtp = "/tmp/test_streamline.vtp";
+    CHECK(write_vti(&f, vti) == 0, "write vti");
+    StreamlineField g;
+    CHECK(Streamline_LoadVTI(vti, &g) == 0, "load vti");
+    size_t total = (size_t)NX * NY * NZ;
+    CHECK(g.sizeX == NX && g.sizeY == NY && g.sizeZ == NZ, "dimensions");
+    CHECK(g.solid && memcmp(f.solid, g.solid, total * sizeof(int)) == 0,
+          "solid mask");
+    CHECK(memcmp(f.velocity, g.velocity, total * 4 * sizeof(float)) == 0,
+          "velocity");
+    CHECK(Streamline_LoadVTI("/nonexistent.vti", &g) == -1 &&
+              g.velocity == NULL,
+          "missing file");
+
+    int n = 400;
+    float *seeds = (float *)malloc((size_t)n * 3 * sizeof(float));
+    for (int s = 0; s < n; s++) {
+        seeds[3 * s] = -3.5f;
+        seeds[3 * s + 1] = -1.5f + 3.0f * (s / 20 + 0.5f) / 20.0f;
+        seeds[3 * s + 2] = -1.5f + 3.0f * (s % 20 + 0.5f) / 20.0f;
+    }
+    StreamlineParams p;
+    Streamline_DefaultParams(&f, &p);
+    Streamlines a, b;
+#ifdef _OPENMP
+    int saved_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    Streamline_Trace(&f, &p, seeds, n, &a);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    Streamline_Trace(&f, &p, seeds, n, &b);
+#ifdef _OPENMP
+    omp_set_num_threads(saved_threads);
+#endif
+    CHECK(a.numPoints == b.numPoints &&
+              memcmp(a.offsets, b.offsets, (n + 1) * sizeof(int)) == 0 &&
+              memcmp(a.points, b.points,
+                     (size_t)a.numPoints * 3 * sizeof(float)) == 0,
+          "independent of thread count");
+
+    CHECK(Streamline_WriteVTP(&a, vtp) == 0, "write vtp");
+    FILE *in = fopen(vtp, "rb");
+    char *buf = NULL;
+    long size = 0;
+    if (in) {
+        fseek(in, 0, SEEK_END);
+        size = ftell(in);
+        fseek(in, 0, SEEK_SET);
+        buf = (char *)malloc((size_t)size + 1);
+        if (fread(buf, 1, (size_t)size, in) != (size_t)size)
+            size = 0;
+        buf[size] = '\0';
+        fclose(in);
+    }
+    char *data = buf ? strstr(buf, "\n_") : NULL;
+    CHECK(data && strstr(buf, "type=\"PolyData\""), "vtp header");
+    if (data) {
+        data += 2;
+        size_t np = (size_t)a.numPoints;
+        uint64_t bytes;
+        memcpy(&bytes, data, 8);
+        CHECK(bytes == np * 12 &&
+                  memcmp(data + 8, a.points, np * 12) == 0,
+              "points block");
+        char key[64];
+        snprintf(key, sizeof(key), "Name=\"offsets\" format=\"appended\""
+                                   " offset=\"");
+        char *at = strstr(buf, key);
+        long off = at ? strtol(at + strlen(key), NULL, 10) : -1;
+        int32_t lastEnd = 0;
+        if (off > 0)
+            memcpy(&lastEnd, data + off + 8 + (n - 1) * 4, 4);
+        CHECK(lastEnd == a.numPoints, "offsets block");
+        size_t expect = (size_t)(data - buf) + 5 * 8 + np * 12 + np * 4 +
+                        (size_t)n + np * 4 + (size_t)n * 4 +
+                        strlen("\n  </AppendedData>\n</VTKFile>\n");
+        CHECK((size_t)size == expect, "file size");
+    }
+    free(buf);
+    remove(vti);
+    remove(vtp);
+    free(seeds);
+    Streamline_Free(&a);
+    Streamline_Free(&b);
+    Streamline_FreeField(&g);
+    Streamline_FreeField(&f);
+}
+
+int main(void) {
+    printf("streamline unit tests\n");
+    test_uniform();
+    test_rotation();
+    test_termination();
+    test_files();
+
+    printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include "../lib/voxelize.h"
 #include "../obj-file-loader/lib/model_loader.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -130,6 +131,43 @@ static void test_cube_surface(void) {
     free_test_model(&cube);
 }
 
+/* A triangle on the plane x + y + z = 0 has an AABB spanning the whole
+ * grid; the exact overlap test must keep it a thin slab, at most four
+ * cells deep along any column. */
+static void test_surface_tilted(void) {
+    printf("test_surface_tilted\n");
+    Model tri = {0};
+    tri.vertexCount = 3;
+    tri.faceCount = 1;
+    tri.vertices = (Vertex *)calloc(3, sizeof(Vertex));
+    tri.faces = (Face *)calloc(1, sizeof(Face));
+    Vertex verts[3] = {{1.0f, -1.0f, 0.0f}, {-1.0f, 0.0f, 1.0f},
+                       {0.0f, 1.0f, -1.0f}};
+    memcpy(tri.vertices, verts, sizeof(verts));
+    tri.faces[0] = (Face){1, 2, 3};
+
+    int R = 32;
+    VoxelGrid *g = Voxelize_FromModel(&tri, R, 0.0f, 0, VOXELIZE_MODE_SURFACE);
+    CHECK(g != NULL, "voxelize returned non-null");
+    if (g) {
+        float frac = Voxelize_SolidFraction(g);
+        int max_run = 0;
+        for (int z = 0; z < R; z++)
+            for (int y = 0; y < R; y++) {
+                int run = 0;
+                for (int x = 0; x < R; x++)
+                    run += g->data[x + R * (y + R * z)];
+                if (run > max_run) max_run = run;
+            }
+        printf("  tilted triangle fraction: %.4f, max column depth %d\n",
+               frac, max_run);
+        CHECK(frac > 0.0f && frac < 0.1f, "tilted triangle is a thin shell");
+        CHECK(max_run <= 4, "column depth bounded by the plane slab");
+        Voxelize_Free(g);
+    }
+    free_test_model(&tri);
+}
+
 /* Test 3: align_longest_x on a Z-elongated slab should rotate it into X. */
 static void test_align_longest_x(void) {
     printf("test_align_longest_x\n");
@@ -220,13 +258,282 @@ static void test_write_binary(void) {
     free_test_model(&cube);
 }
 
+/* Test 6: pack slots appended out of order load back by id. */
+static void test_pack_roundtrip(void) {
+    printf("test_pack_roundtrip\n");
+    Model cube = make_cube(1.0f);
+    Model slab = make_slab_z();
+    VoxelGrid *a = Voxelize_FromModel(&cube, 8, 0.05f, 1, VOXELIZE_MODE_SOLID);
+    VoxelGrid *b = Voxelize_FromModel(&slab, 8, 0.05f, 1, VOXELIZE_MODE_SOLID);
+    CHECK(a && b, "voxelize ok");
+
+    const char *path = "voxelize_test_tmp.voxpack";
+    VoxelPackWriter *pack = Voxelize_PackOpen(path, 3, 8);
+    CHECK(pack != NULL, "pack open");
+    if (pack && a && b) {
+        CHECK(Voxelize_PackAppend(pack, 2, b) == 0, "append slot 2");
+        CHECK(Voxelize_PackAppend(pack, 0, a) == 0, "append slot 0");
+        CHECK(Voxelize_PackAppend(pack, 0, a) != 0, "slot 0 only once");
+        CHECK(Voxelize_PackClose(pack) == 0, "pack close");
+
+        size_t n = 8 * 8 * 8;
+        VoxelGrid *ra = Voxelize_PackLoad(path, 0);
+        VoxelGrid *rb = Voxelize_PackLoad(path, 2);
+        CHECK(ra && ra->resolution == 8 && memcmp(ra->data, a->data, n) == 0,
+              "slot 0 round-trips");
+        CHECK(rb && rb->resolution == 8 && memcmp(rb->data, b->data, n) == 0,
+              "slot 2 round-trips");
+        CHECK(Voxelize_PackLoad(path, 1) == NULL, "empty slot is NULL");
+        CHECK(Voxelize_PackLoad(path, 3) == NULL, "out of range is NULL");
+        Voxelize_Free(ra);
+        Voxelize_Free(rb);
+        remove(path);
+    }
+
+    Voxelize_Free(a);
+    Voxelize_Free(b);
+    free_test_model(&cube);
+    free_test_model(&slab);
+}
+
+/* Test 7: v2 encodings and v1 files decode to the same grid. */
+static void test_read_binary_versions(void) {
+    printf("test_read_binary_versions\n");
+    Model cube = make_cube(0.6f);
+    /* Odd resolution so rows do not fill whole bytes. */
+    VoxelGrid *g = Voxelize_FromModel(&cube, 13, 0.2f, 1, VOXELIZE_MODE_SOLID);
+    CHECK(g != NULL, "voxelize ok");
+    if (!g) {
+        free_test_model(&cube);
+        return;
+    }
+    size_t n = 13 * 13 * 13;
+
+    const char *path = "voxelize_test_tmp.voxbin";
+    CHECK(Voxelize_WriteBinary(g, path) == 0, "write v1");
+    VoxelGrid *v1 = Voxelize_ReadBinary(path);
+    CHECK(v1 && v1->resolution == 13 && memcmp(v1->data, g->data, n) == 0,
+          "v1 round-trips");
+    Voxelize_Free(v1);
+
+    VoxbinEncoding encs[2] = {VOXBIN_ENCODING_BITS, VOXBIN_ENCODING_RLE};
+    for (int e = 0; e < 2; e++) {
+        CHECK(Voxelize_WriteBinaryV2(g, path, encs[e]) == 0, "write v2");
+        VoxelGrid *v2 = Voxelize_ReadBinary(path);
+        CHECK(v2 && v2->resolution == 13 && memcmp(v2->data, g->data, n) == 0,
+              "v2 round-trips");
+        Voxelize_Free(v2);
+
+        /* Streaming rows must match the grid without loading it whole. */
+        int R = 0, rows = 0, same = 1;
+        uint8_t row[13];
+        VoxbinReader *r = Voxelize_OpenBinary(path, &R);
+        CHECK(r != NULL && R == 13, "open stream");
+        while (r && Voxelize_ReadRow(r, row) == 1) {
+            if (memcmp(row, g->data + (size_t)rows * 13, 13) != 0)
+                same = 0;
+            rows++;
+        }
+        CHECK(rows == 13 * 13 && same, "streamed rows match");
+        Voxelize_CloseBinary(r);
+    }
+
+    /* Even at this tiny size RLE should beat 1 byte/voxel. */
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fclose(f);
+        CHECK(size < (long)n, "RLE file smaller than v1");
+    }
+    remove(path);
+
+    Voxelize_Free(g);
+    free_test_model(&cube);
+}
+
+/* Test 8: SDF matches a brute-force distance to the surface voxels. */
+static void test_sdf_exact(void) {
+    printf("test_sdf_exact\n");
+    Model cube = make_cube(0.6f);
+    int R = 12;
+
+    SdfGrid *sdf = Voxelize_SdfFromModel(&cube, R, 0.2f, 1);
+    VoxelGrid *shell =
+        Voxelize_FromModel(&cube, R, 0.2f, 1, VOXELIZE_MODE_SURFACE);
+    VoxelGrid *fill = Voxelize_FromModel(&cube, R, 0.2f, 1, VOXELIZE_MODE_SOLID);
+    CHECK(sdf && shell && fill, "sdf + reference grids");
+    if (sdf && shell && fill) {
+        float voxel = 2.0f / R;
+        float max_err = 0.0f;
+        int sign_ok = 1;
+        for (int z = 0; z < R; z++)
+            for (int y = 0; y < R; y++)
+                for (int x = 0; x < R; x++) {
+                    int best = 1 << 30;
+                    for (int sz = 0; sz < R; sz++)
+                        for (int sy = 0; sy < R; sy++)
+                            for (int sx = 0; sx < R; sx++) {
+                                if (!shell->data[sx + R * (sy + R * sz)])
+                                    continue;
+                                int d2 = (x - sx) * (x - sx) +
+                                         (y - sy) * (y - sy) +
+                                         (z - sz) * (z - sz);
+                                if (d2 < best) best = d2;
+                            }
+                    int i = x + R * (y + R * z);
+                    float want = sqrtf((float)best) * voxel;
+                    float err = fabsf(fabsf(sdf->data[i]) - want);
+                    if (err > max_err) max_err = err;
+                    int inside = fill->data[i] && !shell->data[i];
+                    if (inside != (sdf->data[i] < 0.0f))
+                        sign_ok = 0;
+                }
+        printf("  max |sdf| error vs brute force: %g\n", max_err);
+        CHECK(max_err < 1e-5f, "distance is exact");
+        CHECK(sign_ok, "negative exactly inside the fill");
+        int c = R / 2;
+        CHECK(sdf->data[c + R * (c + R * c)] < 0.0f, "center is inside");
+        CHECK(sdf->data[0] > 0.0f, "corner is outside");
+    }
+    Voxelize_FreeSdf(sdf);
+    Voxelize_Free(shell);
+    Voxelize_Free(fill);
+    free_test_model(&cube);
+}
+
+/* Coarse pyramid levels must threshold the occupancy of the finest
+ * block they cover, and survive a .voxpyr round trip. */
+static void test_pyramid(void) {
+    printf("test_pyramid\n");
+    Model cube = make_cube(0.6f);
+    const char *path = "/tmp/test_voxelize.voxpyr";
+    int R = 32;
+
+    VoxelPyramid *pyr = Voxelize_PyramidFromModel(
+        &cube, R, 3, 0.2f, 1, VOXELIZE_MODE_SOLID, 0.5f);
+    CHECK(pyr != NULL && pyr->levels == 3, "pyramid built");
+    CHECK(Voxelize_PyramidFromModel(&cube, 24, 5, 0.2f, 1,
+                                    VOXELIZE_MODE_SOLID, 0.5f) == NULL,
+          "resolution not divisible by 2^(levels-1) rejected");
+    if (pyr) {
+        const VoxelGrid *fine = &pyr->grids[0];
+        int exact = 1;
+        for (int l = 1; l < pyr->levels; l++) {
+            const VoxelGrid *g = &pyr->grids[l];
+            int s = 1 << l;
+            CHECK(g->resolution == R >> l, "level resolution halves");
+            for (int z = 0; z < g->resolution; z++)
+                for (int y = 0; y < g->resolution; y++)
+                    for (int x = 0; x < g->resolution; x++) {
+                        int count = 0;
+                        for (int k = 0; k < s * s * s; k++) {
+                            int fx = x * s + k % s;
+                            int fy = y * s + (k / s) % s;
+                            int fz = z * s + k / (s * s);
+                            count += fine->data[fx + R * (fy + R * fz)];
+                        }
+                        int want = 2 * count >= s * s * s;
+                        int res = g->resolution;
+                        if (g->data[x + res * (y + res * z)] != want)
+                            exact = 0;
+                    }
+        }
+        CHECK(exact, "coarse cells match finest-level majority");
+
+        CHECK(Voxelize_WritePyramid(pyr, path) == 0, "write pyramid");
+        for (int l = 0; l < pyr->levels; l++) {
+            VoxelGrid *g = Voxelize_PyramidLoad(path, l);
+            size_t n = (size_t)(R >> l) * (R >> l) * (R >> l);
+            CHECK(g && g->resolution == R >> l &&
+                      memcmp(g->data, pyr->grids[l].data, n) == 0,
+                  "level round-trips");
+            Voxelize_Free(g);
+        }
+        CHECK(Voxelize_PyramidLoad(path, 3) == NULL, "level out of range");
+        remove(path);
+    }
+    Voxelize_FreePyramid(pyr);
+    free_test_model(&cube);
+}
+
+/* Non-cubic lattices: a world-space cube in the LBM-shaped box must
+ * fill exactly the cells whose centers it contains, and the cube box
+ * must reproduce Voxelize_FromModel. */
+static void test_lattice_box(void) {
+    printf("test_lattice_box\n");
+    Model cube = make_cube(1.0f);
+
+    float soup[12 * 3 * 3];
+    for (int t = 0; t < 12; t++) {
+        const Face *f = &cube.faces[t];
+        int idx[3] = {f->v1, f->v2, f->v3};
+        for (int k = 0; k < 3; k++) {
+            const Vertex *v = &cube.vertices[idx[k] - 1];
+            float *p = &soup[(3 * t + k) * 3];
+            p[0] = v->x;
+            p[1] = v->y;
+            p[2] = v->z;
+        }
+    }
+    VoxelBox box = {{16, 8, 4}, {-4.0f, -2.0f, -2.0f}, {4.0f, 2.0f, 2.0f}};
+    VoxelLattice *lat =
+        Voxelize_TrianglesInBox(soup, 3, 12, &box, VOXELIZE_MODE_SOLID);
+    CHECK(lat != NULL, "triangle soup voxelized");
+    if (lat) {
+        int exact = 1;
+        for (int z = 0; z < 4; z++)
+            for (int y = 0; y < 8; y++)
+                for (int x = 0; x < 16; x++) {
+                    float cx = -4.0f + (x + 0.5f) * 0.5f;
+                    float cy = -2.0f + (y + 0.5f) * 0.5f;
+                    float cz = -2.0f + (z + 0.5f) * 1.0f;
+                    int want = fabsf(cx) < 1.0f && fabsf(cy) < 1.0f &&
+                               fabsf(cz) < 1.0f;
+                    if (lat->data[x + 16 * (y + 8 * z)] != want)
+                        exact = 0;
+                }
+        CHECK(exact, "anisotropic cells match the cube");
+
+        const char *path = "/tmp/test_voxelize_lattice.voxbin";
+        CHECK(Voxelize_WriteLattice(lat, path) == 0, "write lattice");
+        VoxelLattice *back = Voxelize_ReadLattice(path);
+        CHECK(back && back->box.dims[0] == 16 && back->box.dims[2] == 4 &&
+                  back->box.min[0] == -4.0f && back->box.max[1] == 2.0f &&
+                  memcmp(back->data, lat->data, 16 * 8 * 4) == 0,
+              "lattice round-trips");
+        CHECK(Voxelize_ReadBinary(path) == NULL,
+              "cubic reader rejects version 3");
+        Voxelize_FreeLattice(back);
+        remove(path);
+    }
+    Voxelize_FreeLattice(lat);
+
+    VoxelBox cube_box = {{16, 16, 16}, {-1, -1, -1}, {1, 1, 1}};
+    VoxelLattice *a = Voxelize_FromModelInBox(
+        &cube, &cube_box, 0.1f, 1, VOXELIZE_MODE_SURFACE);
+    VoxelGrid *b =
+        Voxelize_FromModel(&cube, 16, 0.1f, 1, VOXELIZE_MODE_SURFACE);
+    CHECK(a && b && memcmp(a->data, b->data, 16 * 16 * 16) == 0,
+          "cube box matches Voxelize_FromModel");
+    Voxelize_FreeLattice(a);
+    Voxelize_Free(b);
+    free_test_model(&cube);
+}
+
 int main(void) {
     printf("voxelize unit tests\n");
     test_cube_solid();
     test_cube_surface();
+    test_surface_tilted();
     test_align_longest_x();
     test_determinism();
     test_write_binary();
+    test_pack_roundtrip();
+    test_read_binary_versions();
+    test_sdf_exact();
+    test_pyramid();
+    test_lattice_box();
 
     printf("%d/%d checks passed\n", tests_run - tests_failed, tests_run);
     return tests_failed == 0 ? 0 : 1;